@@ -20,7 +20,7 @@ DSU DomTreeBuilder::resetStructs() {
     orderedBBlocks.resize(bblocksCount, nullptr);
     bblocksParents.resize(bblocksCount, nullptr);
 
-    return DSU(labels, sdoms, graph->GetMemoryResource());
+    return DSU(labels, sdoms, graph->GetScratchArena());
 }
 
 void DomTreeBuilder::dfsTraverse(BasicBlock *bblock) {
@@ -41,7 +41,7 @@ void DomTreeBuilder::dfsTraverse(BasicBlock *bblock) {
 }
 
 void DomTreeBuilder::computeSDoms(DSU &sdomsHelper) {
-    for (int i = getSize() - 1; i >= 0; --i) {
+    for (int i = getVisitedCount() - 1; i >= 0; --i) {
         auto *currentBlock = getOrderedBlock(i);
 
         for (const auto &pred : currentBlock->GetPredecessors()) {
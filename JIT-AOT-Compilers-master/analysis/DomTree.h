@@ -44,12 +44,12 @@ public:
 
     explicit DomTreeBuilder(Graph *graph)
         : PassBase(graph),
-          idoms(graph->GetMemoryResource()),
-          sdoms(graph->GetMemoryResource()),
-          sdomsSet(graph->GetMemoryResource()),
-          labels(graph->GetMemoryResource()),
-          orderedBBlocks(graph->GetMemoryResource()),
-          bblocksParents(graph->GetMemoryResource())
+          idoms(graph->GetScratchArena()),
+          sdoms(graph->GetScratchArena()),
+          sdomsSet(graph->GetScratchArena()),
+          labels(graph->GetScratchArena()),
+          orderedBBlocks(graph->GetScratchArena()),
+          bblocksParents(graph->GetScratchArena())
     {}
     NO_COPY_SEMANTIC(DomTreeBuilder);
     NO_MOVE_SEMANTIC(DomTreeBuilder);
@@ -85,6 +85,10 @@ private:
     size_t getSize() const {
         return idoms.size();
     }
+    // Differs from size if the graph has unlinked basic blocks.
+    size_t getVisitedCount() const {
+        return lastNumber + 1;
+    }
 
     BasicBlock *getImmDominator(size_t id) {
         ASSERT(id < idoms.size());
@@ -171,7 +175,7 @@ bool DomTreeBuilder::build(std::pmr::vector<DominatorInfo> *doms) {
 
 template <bool InPlace>
 void DomTreeBuilder::computeIDoms(std::pmr::vector<DominatorInfo> *doms) {
-    for (size_t i = 1; i < getSize(); ++i) {
+    for (size_t i = 1; i < getVisitedCount(); ++i) {
         auto *currentBlock = getOrderedBlock(i);
         auto currentBlockId = currentBlock->GetId();
         if (getImmDominator(currentBlockId) != getOrderedBlock(getSemiDomNumber(currentBlock))) {
@@ -26,7 +26,7 @@ bool LinearOrdering::Run() {
 void LinearOrdering::orderBlocks(std::pmr::vector<BasicBlock *> &newOrder) {
     visitedMarker = graph->GetNewMarker();
 
-    std::pmr::list<BasicBlock *> remainedBlocks(graph->GetMemoryResource());
+    std::pmr::list<BasicBlock *> remainedBlocks(graph->GetScratchArena());
     remainedBlocks.push_back(graph->GetFirstBasicBlock());
 
     while (!remainedBlocks.empty()) {
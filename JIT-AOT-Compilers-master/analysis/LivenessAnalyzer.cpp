@@ -95,7 +95,25 @@ void LivenessAnalyzer::calculateLiveRanges(BasicBlock::IdType blockId) {
     if (bblock->IsLoopHeader()) {
         auto *loopInfo = bblock->GetLoop();
         ASSERT(loopInfo);
+        // values alive at the loop's entry stay alive during the whole loop
+        // as they might be used on the next iterations
+        auto loopEnd = getLoopEnd(loopInfo);
+        for (auto *instr : liveSet) {
+            liveIntervals.GetLiveIntervals(instr)->AddRange(blockRangeBegin, loopEnd);
+        }
+    }
+}
+
+LiveRange::RangeType LivenessAnalyzer::getLoopEnd(const Loop *loop) const {
+    ASSERT(loop);
+    LiveRange::RangeType loopEnd = 0;
+    for (const auto *bblock : loop->GetBasicBlocks()) {
+        loopEnd = std::max(loopEnd, getBlockInfo(bblock).GetRange().GetEnd());
+    }
+    for (const auto *innerLoop : loop->GetInnerLoops()) {
+        loopEnd = std::max(loopEnd, getLoopEnd(innerLoop));
     }
+    return loopEnd;
 }
 
 void LivenessAnalyzer::calculateInitialLiveSet(BasicBlock *bblock, BlockInfo &info) const {
@@ -11,7 +11,7 @@ class LivenessAnalyzer : public PassBase {
 public:
     explicit LivenessAnalyzer(Graph *graph)
         : PassBase(graph),
-          linearOrderedBlocks(graph->GetMemoryResource())
+          linearOrderedBlocks(graph->GetScratchArena())
     {}
     NO_COPY_SEMANTIC(LivenessAnalyzer);
     NO_MOVE_SEMANTIC(LivenessAnalyzer);
@@ -29,6 +29,8 @@ private:
 
     void calculateLiveRanges(BasicBlock::IdType blockId);
     void calculateInitialLiveSet(BasicBlock *bblock, BlockInfo &info) const;
+    // Returns end of the last basic block of the loop (including inner loops) in linear order.
+    LiveRange::RangeType getLoopEnd(const Loop *loop) const;
 
     BlockInfo &getBlockInfo(BasicBlock *bblock) {
         ASSERT((bblock) && bblock->GetId() < linearOrderedBlocks.size());
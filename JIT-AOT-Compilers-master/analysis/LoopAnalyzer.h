@@ -11,8 +11,8 @@ class LoopAnalyzer : public PassBase {
 public:
     explicit LoopAnalyzer(Graph *graph)
         : PassBase(graph),
-          dfsBlocks(graph->GetMemoryResource()),
-          loops(graph->GetMemoryResource())
+          dfsBlocks(graph->GetScratchArena()),
+          loops(graph->GetScratchArena())
     {}
     NO_COPY_SEMANTIC(LoopAnalyzer);
     NO_MOVE_SEMANTIC(LoopAnalyzer);
@@ -0,0 +1,124 @@
+#include <chrono>
+#include "CompilationScheduler.h"
+#include "default/DefaultArch.h"
+#include <iomanip>
+#include <iostream>
+#include "logger.h"
+#include <string>
+#include "TestFunctionSamples.h"
+#include <thread>
+#include <vector>
+
+
+// Measures how many functions per second CompilationScheduler optimizes
+// depending on the number of threads.
+namespace {
+using namespace ir;
+
+constexpr auto OPS_TYPE = OperandType::I64;
+constexpr size_t DEFAULT_FUNCTIONS_COUNT = 4000;
+constexpr size_t LEAVES_COUNT = 16;
+constexpr size_t REPEATS_COUNT = 3;
+
+// int64 function(int64 n) {
+//     int64 res = 1
+//     for (int64 i = 2; i <= n; ++i) {
+//         res = (res * i) & mask + leaf(i) - (i - i)
+//     }
+//     return res
+// }
+Graph *buildFunction(Compiler &compiler, Graph *leaf, uint64_t mask) {
+    auto *graph = compiler.CreateNewGraph();
+    auto *instrBuilder = graph->GetInstructionBuilder();
+    auto *arg = instrBuilder->CreateARG(OPS_TYPE);
+    auto *constOne = instrBuilder->CreateCONST(OPS_TYPE, 1);
+    auto *constTwo = instrBuilder->CreateCONST(OPS_TYPE, 2);
+    auto *constMask = instrBuilder->CreateCONST(OPS_TYPE, mask);
+    auto *firstBlock = graph->CreateEmptyBasicBlock();
+    instrBuilder->PushBackInstruction(firstBlock, arg, constOne, constTwo, constMask);
+    graph->SetFirstBasicBlock(firstBlock);
+
+    auto *loopHeader = graph->CreateEmptyBasicBlock();
+    graph->ConnectBasicBlocks(firstBlock, loopHeader);
+    auto *exitBlock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(loopHeader, exitBlock);
+    auto *loopBody = graph->CreateEmptyBasicBlock();
+    graph->ConnectBasicBlocks(loopHeader, loopBody);
+    graph->ConnectBasicBlocks(loopBody, loopHeader);
+
+    auto *phiIdx = instrBuilder->CreatePHI(OPS_TYPE);
+    auto *phiRes = instrBuilder->CreatePHI(OPS_TYPE);
+    auto *cmp = instrBuilder->CreateCMP(OPS_TYPE, CondCode::GT, phiIdx, arg);
+    instrBuilder->PushBackInstruction(loopHeader, phiIdx, phiRes, cmp, instrBuilder->CreateJCMP());
+
+    auto *mul = instrBuilder->CreateMUL(OPS_TYPE, phiRes, phiIdx);
+    auto *masked = instrBuilder->CreateAND(OPS_TYPE, mul, constMask);
+    auto *call = instrBuilder->CreateCALL(OPS_TYPE, leaf->GetId(), {phiIdx});
+    auto *add = instrBuilder->CreateADD(OPS_TYPE, masked, call);
+    auto *zero = instrBuilder->CreateSUB(OPS_TYPE, phiIdx, phiIdx);
+    auto *res = instrBuilder->CreateSUB(OPS_TYPE, add, zero);
+    auto *inc = instrBuilder->CreateADDI(OPS_TYPE, phiIdx, 1);
+    instrBuilder->PushBackInstruction(loopBody, mul, masked, call, add, zero, res, inc, instrBuilder->CreateJMP());
+
+    phiIdx->AddPhiInput(constTwo, firstBlock);
+    phiIdx->AddPhiInput(inc, loopBody);
+    phiRes->AddPhiInput(constOne, firstBlock);
+    phiRes->AddPhiInput(res, loopBody);
+
+    instrBuilder->PushBackInstruction(exitBlock, instrBuilder->CreateRET(OPS_TYPE, phiRes));
+    return graph;
+}
+
+std::vector<Graph *> buildFunctions(Compiler &compiler, size_t functionsCount) {
+    std::vector<Graph *> functions;
+    functions.reserve(functionsCount + LEAVES_COUNT);
+    for (size_t i = 0; i < LEAVES_COUNT; ++i) {
+        functions.push_back(tests::BuildLeafFunction(compiler, OPS_TYPE, i + 2).graph);
+    }
+    for (size_t i = 0; i < functionsCount; ++i) {
+        functions.push_back(buildFunction(compiler, functions[i % LEAVES_COUNT], (1ULL << (i % 63)) - 1));
+    }
+    return functions;
+}
+
+// Returns the best time of several runs.
+std::chrono::duration<double> measure(size_t threadsCount, size_t functionsCount) {
+    auto best = std::chrono::duration<double>::max();
+    for (size_t i = 0; i < REPEATS_COUNT; ++i) {
+        Compiler compiler(codegen::DefaultArch::GetInstance());
+        auto functions = buildFunctions(compiler, functionsCount);
+        CompilationScheduler scheduler(&compiler, threadsCount);
+
+        auto start = std::chrono::steady_clock::now();
+        scheduler.Compile(functions);
+        best = std::min<std::chrono::duration<double>>(best, std::chrono::steady_clock::now() - start);
+    }
+    return best;
+}
+}   // namespace
+
+int main(int argc, char *argv[]) {
+    size_t functionsCount = DEFAULT_FUNCTIONS_COUNT;
+    if (argc > 1) {
+        functionsCount = std::stoul(argv[1]);
+    }
+    // compile-time logging must not be measured
+    utils::Logger::GetRoot().setPriority(log4cpp::Priority::WARN);
+
+    size_t maxThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    std::cout << "functions: " << functionsCount << '\n';
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "time, ms"
+              << std::setw(16) << "functions/s" << std::setw(10) << "speedup" << '\n';
+    std::chrono::duration<double> baseline{};
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        auto time = measure(threads, functionsCount);
+        if (threads == 1) {
+            baseline = time;
+        }
+        std::cout << std::setw(8) << threads
+                  << std::setw(12) << std::fixed << std::setprecision(1) << time.count() * 1000
+                  << std::setw(16) << std::setprecision(0) << functionsCount / time.count()
+                  << std::setw(10) << std::setprecision(2) << baseline / time << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "CodeCache.h"
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace ir::codegen {
+CodeCache::~CodeCache() noexcept {
+    for (auto &mapping : mappings) {
+        munmap(mapping.address, mapping.size);
+    }
+}
+
+CodeCache::EntryType CodeCache::Install(FunctionId functionId, std::span<const uint8_t> code) {
+    ASSERT(!code.empty());
+    static const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto size = (code.size() + pageSize - 1) / pageSize * pageSize;
+
+    auto *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(mem, code.data(), code.size());
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return nullptr;
+    }
+    mappings.push_back({mem, size});
+    codeSize += code.size();
+
+    *GetEntrySlot(functionId) = mem;
+    return mem;
+}
+
+CodeCache::EntryType *CodeCache::GetEntrySlot(FunctionId functionId) {
+    if (functionId >= entries.size()) {
+        entries.resize(functionId + 1, nullptr);
+    }
+    return &entries[functionId];
+}
+}   // namespace ir::codegen
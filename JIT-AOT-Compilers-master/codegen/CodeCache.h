@@ -0,0 +1,69 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_CODE_CACHE_H_
+#define JIT_AOT_COMPILERS_COURSE_CODE_CACHE_H_
+
+#include "CompilerBase.h"
+#include <cstdint>
+#include <deque>
+#include "macros.h"
+#include "Runtime.h"
+#include <span>
+#include <vector>
+
+
+namespace ir::codegen {
+// Owns native code of compiled functions.
+// Each function is copied into its own mmap'd pages, which are made executable
+// and read-only right after (W^X); pages are unmapped together with the cache.
+// Calls between compiled functions go through entry slots, so functions
+// may be compiled in any order (but a callee must be installed before it is called).
+class CodeCache {
+public:
+    using EntryType = const void *;
+
+    CodeCache() = default;
+    NO_COPY_SEMANTIC(CodeCache);
+    NO_MOVE_SEMANTIC(CodeCache);
+    virtual ~CodeCache() noexcept;
+
+    // Returns entry of the installed code or nullptr on failure.
+    EntryType Install(FunctionId functionId, std::span<const uint8_t> code);
+
+    EntryType GetEntry(FunctionId functionId) const {
+        return functionId < entries.size() ? entries[functionId] : nullptr;
+    }
+    template <typename FunctionT>
+    FunctionT *GetFunction(FunctionId functionId) const
+    requires std::is_function_v<FunctionT>
+    {
+        return reinterpret_cast<FunctionT *>(const_cast<void *>(GetEntry(functionId)));
+    }
+    // Address of the slot stays the same for the whole lifetime of the cache.
+    EntryType *GetEntrySlot(FunctionId functionId);
+
+    size_t GetCodeSize() const {
+        return codeSize;
+    }
+
+    RuntimeInterface &GetRuntime() {
+        return runtime;
+    }
+    const RuntimeInterface &GetRuntime() const {
+        return runtime;
+    }
+
+private:
+    struct Mapping {
+        void *address;
+        size_t size;
+    };
+
+    // std::deque never relocates elements on growth
+    std::deque<EntryType> entries;
+    std::vector<Mapping> mappings;
+    size_t codeSize = 0;
+
+    RuntimeInterface runtime;
+};
+}   // namespace ir::codegen
+
+#endif  // JIT_AOT_COMPILERS_COURSE_CODE_CACHE_H_
@@ -20,14 +20,16 @@ bool LinearScanRegAlloc::Run() {
 }
 
 void LinearScanRegAlloc::allocateAndAssignRegs() {
-    // live intervals are sorted in ascending order
-    for (auto *intervals : graph->GetLiveIntervals()) {
+    // live intervals are stored in linear order, i.e. sorted by their start points
+    auto &liveIntervals = graph->GetLiveIntervals();
+    for (size_t i = 0, end = liveIntervals.Size(); i < end; ++i) {
+        auto *intervals = liveIntervals[i];
         expireOldIntervals(intervals);
         if (isFull()) {
             spillAtInterval(intervals);
         } else {
-            assignToReg(intervals);
             addActiveInterval(intervals);
+            assignToReg(intervals);
         }
     }
 }
@@ -57,12 +59,13 @@ void LinearScanRegAlloc::spillAtInterval(LiveInterval *intervals) {
         ASSERT(reg.GetType() == LocationType::REGISTER);
         intervals->SetLocation(reg);
         active.pop_back();
+        addActiveInterval(intervals);
     }
 }
 
 void LinearScanRegAlloc::addActiveInterval(LiveInterval *intervals) {
     ASSERT(intervals);
-    ASSERT(!isFull());
+    ASSERT(active.size() < regsCount);
     auto liveEnd = intervals->GetEnd();
     auto iter = std::find_if(active.begin(), active.end(), [liveEnd](LiveInterval *i) {
         return liveEnd <= i->GetEnd();
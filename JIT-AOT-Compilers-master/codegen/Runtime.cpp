@@ -0,0 +1,39 @@
+#include <cstdlib>
+#include <limits>
+#include "logger.h"
+#include "Runtime.h"
+
+
+namespace ir::codegen {
+[[noreturn]] static void allocationFailed(const char *what, uint64_t size) {
+    utils::Logger::GetRoot() << utils::LogPriority::CRIT << "Failed to allocate " << what << " of " << size;
+    std::abort();
+}
+
+void *RuntimeInterface::DefaultNewArray(uint64_t length, [[maybe_unused]] TypeId::TypeIdType typeId) {
+    constexpr uint64_t MAX_LENGTH =
+        (std::numeric_limits<size_t>::max() - static_cast<size_t>(ARRAY_DATA_OFFSET)) / MAX_ELEMENT_SIZE;
+    if (length > MAX_LENGTH) {
+        allocationFailed("array", length);
+    }
+    auto *array = static_cast<uint64_t *>(std::calloc(1, ARRAY_DATA_OFFSET + length * MAX_ELEMENT_SIZE));
+    if (array == nullptr) {
+        allocationFailed("array", length);
+    }
+    array[ARRAY_LENGTH_OFFSET / sizeof(uint64_t)] = length;
+    return array;
+}
+
+void *RuntimeInterface::DefaultNewObject([[maybe_unused]] TypeId::TypeIdType typeId) {
+    auto *object = std::calloc(1, DEFAULT_OBJECT_SIZE);
+    if (object == nullptr) {
+        allocationFailed("object", DEFAULT_OBJECT_SIZE);
+    }
+    return object;
+}
+
+void RuntimeInterface::DefaultCheckFailed(Opcode check) {
+    utils::Logger::GetRoot() << utils::LogPriority::CRIT << "Failed " << getOpcodeName(check);
+    std::abort();
+}
+}   // namespace ir::codegen
@@ -0,0 +1,40 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_RUNTIME_H_
+#define JIT_AOT_COMPILERS_COURSE_RUNTIME_H_
+
+#include <cstdint>
+#include "instructions/InstructionBase.h"
+#include "instructions/Types.h"
+
+
+namespace ir::codegen {
+// Entrypoints of the runtime which native code calls into.
+// Array is laid out as 64-bit length followed by elements; element at index `i`
+// of type `T` is located at `ARRAY_DATA_OFFSET + i * sizeof(T)`.
+// Type ids carry no layout in this IR, so the default allocators reserve
+// `MAX_ELEMENT_SIZE` bytes per array element and `DEFAULT_OBJECT_SIZE` bytes per object.
+// There is no GC: the default allocators never free what they return, so embedders
+// running long-lived code must install their own via `CodeCache::GetRuntime()`.
+// Native code doesn't check allocation results, so allocators must not return
+// nullptr; the default ones abort on oversized lengths and allocation failures.
+struct RuntimeInterface {
+    using NewArrayFunc = void *(*)(uint64_t length, TypeId::TypeIdType typeId);
+    using NewObjectFunc = void *(*)(TypeId::TypeIdType typeId);
+    // Called when one of *_CHECK instructions fails; must not return.
+    using CheckFailedFunc = void (*)(Opcode check);
+
+    static void *DefaultNewArray(uint64_t length, TypeId::TypeIdType typeId);
+    static void *DefaultNewObject(TypeId::TypeIdType typeId);
+    [[noreturn]] static void DefaultCheckFailed(Opcode check);
+
+    NewArrayFunc newArray = DefaultNewArray;
+    NewObjectFunc newObject = DefaultNewObject;
+    CheckFailedFunc checkFailed = DefaultCheckFailed;
+
+    static constexpr int32_t ARRAY_LENGTH_OFFSET = 0;
+    static constexpr int32_t ARRAY_DATA_OFFSET = sizeof(uint64_t);
+    static constexpr size_t MAX_ELEMENT_SIZE = sizeof(uint64_t);
+    static constexpr size_t DEFAULT_OBJECT_SIZE = 256;
+};
+}   // namespace ir::codegen
+
+#endif  // JIT_AOT_COMPILERS_COURSE_RUNTIME_H_
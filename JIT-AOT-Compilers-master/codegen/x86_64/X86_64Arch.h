@@ -0,0 +1,81 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_X86_64_ARCH_H_
+#define JIT_AOT_COMPILERS_COURSE_X86_64_ARCH_H_
+
+#include <array>
+#include "ArchInfoBase.h"
+#include <cstdint>
+
+
+namespace ir::codegen {
+// Hardware encoding of general purpose registers.
+enum class Reg : uint8_t {
+    RAX = 0,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+    NUM_REGS
+};
+
+// System V AMD64 ABI is used both for the compiled functions and for calls from them.
+// Registers RAX, RCX, RDX and R11 are never given to the register allocator:
+// they are reserved as scratch registers for instructions selection
+// (RAX/RDX are used by division, RCX - by shifts).
+class X86_64Arch : public ArchInfoBase {
+public:
+    static X86_64Arch *GetInstance() {
+        static X86_64Arch instance;
+        return &instance;
+    }
+
+    constexpr LocationIdType GetIntRegsCount() const override {
+        return IntRegsCount;
+    }
+    constexpr LocationIdType GetFloatRegsCount() const override {
+        return FloatRegsCount;
+    }
+
+    // Maps register assigned by the register allocator onto the hardware one.
+    static constexpr Reg GetAllocatableReg(LocationIdType id) {
+        ASSERT(id < IntRegsCount);
+        return ALLOCATABLE_REGS[id];
+    }
+    static constexpr bool IsCalleeSaved(Reg reg) {
+        return reg == Reg::RBX || reg == Reg::RBP
+            || (reg >= Reg::R12 && reg <= Reg::R15);
+    }
+
+public:
+    // caller-saved registers go first, so that leaf functions need not save anything
+    static constexpr std::array ALLOCATABLE_REGS{
+        Reg::RDI, Reg::RSI, Reg::R8, Reg::R9, Reg::R10,
+        Reg::RBX, Reg::R12, Reg::R13, Reg::R14, Reg::R15
+    };
+    static constexpr std::array ARGS_REGS{
+        Reg::RDI, Reg::RSI, Reg::RDX, Reg::RCX, Reg::R8, Reg::R9
+    };
+    static constexpr Reg RETURN_REG = Reg::RAX;
+
+    static constexpr LocationIdType IntRegsCount = ALLOCATABLE_REGS.size();
+    static constexpr LocationIdType FloatRegsCount = 16;
+
+    static constexpr size_t WORD_SIZE = 8;
+    static constexpr size_t STACK_ALIGNMENT = 16;
+
+private:
+    X86_64Arch() = default;
+};
+}   // namespace ir::codegen
+
+#endif  // JIT_AOT_COMPILERS_COURSE_X86_64_ARCH_H_
@@ -0,0 +1,829 @@
+#include <algorithm>
+#include "LinearScanRegAlloc.h"
+#include "X86_64CodeGen.h"
+
+
+namespace ir::codegen {
+namespace {
+constexpr size_t CALLER_SAVED_REGS_COUNT = std::count_if(
+    X86_64Arch::ALLOCATABLE_REGS.begin(),
+    X86_64Arch::ALLOCATABLE_REGS.end(),
+    [](Reg reg) { return !X86_64Arch::IsCalleeSaved(reg); });
+
+constexpr int32_t WORD_SIZE = X86_64Arch::WORD_SIZE;
+
+// caller-saved registers must go first to be saved into contiguous area around calls
+static_assert(std::all_of(
+    X86_64Arch::ALLOCATABLE_REGS.begin(),
+    X86_64Arch::ALLOCATABLE_REGS.begin() + CALLER_SAVED_REGS_COUNT,
+    [](Reg reg) { return !X86_64Arch::IsCalleeSaved(reg); }));
+
+Cond inverseCond(Cond cond) {
+    // x86 condition codes come in pairs differing in the lowest bit
+    return static_cast<Cond>(static_cast<uint8_t>(cond) ^ 1);
+}
+
+Cond getCond(CondCode cc, bool isSigned) {
+    switch (cc) {
+    case CondCode::EQ:
+        return Cond::E;
+    case CondCode::NE:
+        return Cond::NE;
+    case CondCode::LT:
+        return isSigned ? Cond::L : Cond::B;
+    case CondCode::LE:
+        return isSigned ? Cond::LE : Cond::BE;
+    case CondCode::GE:
+        return isSigned ? Cond::GE : Cond::AE;
+    case CondCode::GT:
+        return isSigned ? Cond::G : Cond::A;
+    default:
+        UNREACHABLE("");
+        return Cond::E;
+    }
+}
+
+bool isNativeCall(const InstructionBase *instr) {
+    auto opcode = instr->GetOpcode();
+    return opcode == Opcode::CALL
+        || opcode == Opcode::NEW_ARRAY
+        || opcode == Opcode::NEW_ARRAY_IMM
+        || opcode == Opcode::NEW_OBJECT;
+}
+}   // namespace
+
+bool X86_64CodeGen::Run() {
+    if (graph->GetCompiler()->GetArch() != X86_64Arch::GetInstance()) {
+        GetLogger(utils::LogPriority::ERROR) << "Graph #" << graph->GetId() << " is not built for x86-64";
+        return false;
+    }
+    if (!canCompile()) {
+        return false;
+    }
+    PassManager::Run<LinearScanRegAlloc>(graph);
+
+    computeFrameLayout();
+    // register allocation might have inserted new blocks, so labels are created only now
+    blockLabels.resize(graph->GetMaximumBlockId() + 1);
+    for (auto &label : blockLabels) {
+        label = encoder.CreateLabel();
+    }
+    entryLabel = encoder.CreateLabel();
+
+    emitPrologue();
+    std::pmr::vector<BasicBlock *> blocks(graph->GetScratchArena());
+    blocks.reserve(graph->GetBasicBlocksCount());
+    graph->ForEachBasicBlock([&blocks](BasicBlock *bblock) { blocks.push_back(bblock); });
+    for (size_t i = 0, end = blocks.size(); i < end; ++i) {
+        emitBasicBlock(blocks[i], i + 1 < end ? blocks[i + 1] : nullptr);
+    }
+    emitCheckFailures();
+    if (graph->IsMemoryLimitExceeded()) {
+        GetLogger(utils::LogPriority::ERROR) << "Memory limit of function #" << graph->GetId() << " is exceeded";
+        return false;
+    }
+
+    auto code = encoder.Finalize();
+    if (codeCache->Install(graph->GetId(), code) == nullptr) {
+        GetLogger(utils::LogPriority::ERROR) << "Failed to install code of function #" << graph->GetId();
+        return false;
+    }
+    GetLogger(utils::LogPriority::INFO) << "Compiled function #" << graph->GetId()
+                                        << " into " << code.size() << " bytes";
+    return true;
+}
+
+bool X86_64CodeGen::canCompile() {
+    bool res = true;
+    graph->ForEachBasicBlock([this, &res](BasicBlock *bblock) {
+        for (auto *instr : *bblock) {
+            if (!instr->IsCall()) {
+                continue;
+            }
+            auto target = static_cast<CallInstruction *>(instr)->GetCallTarget();
+            if (target == INVALID_FUNCTION_ID || graph->GetCompiler()->GetFunction(target) == nullptr) {
+                GetLogger(utils::LogPriority::ERROR) << "Unknown call target " << target
+                                                     << " in function #" << graph->GetId();
+                res = false;
+            }
+        }
+    });
+    return res;
+}
+
+void X86_64CodeGen::computeFrameLayout() {
+    std::array<bool, X86_64Arch::IntRegsCount> usedRegs{};
+    slotsCount = 0;
+    for (const auto *interval : graph->GetLiveIntervals()) {
+        const auto &loc = interval->GetLocation();
+        if (loc.GetType() == LocationType::REGISTER) {
+            usedRegs[loc.GetId()] = true;
+        } else if (loc.GetType() == LocationType::STACK) {
+            slotsCount = std::max(slotsCount, static_cast<size_t>(loc.GetId()) + 1);
+        }
+    }
+    calleeSaved.clear();
+    for (size_t i = 0; i < usedRegs.size(); ++i) {
+        auto reg = X86_64Arch::GetAllocatableReg(i);
+        if (usedRegs[i] && X86_64Arch::IsCalleeSaved(reg)) {
+            calleeSaved.push_back(reg);
+        }
+    }
+
+    bool hasCalls = false;
+    size_t outgoingArgs = 0;
+    graph->ForEachBasicBlock([&hasCalls, &outgoingArgs](BasicBlock *bblock) {
+        for (auto *instr : bblock->IterateNonPhi()) {
+            hasCalls |= isNativeCall(instr);
+            if (instr->IsCall()) {
+                auto argsCount = instr->AsInputsInstruction()->GetInputsCount();
+                outgoingArgs = std::max(outgoingArgs, argsCount - std::min(argsCount, MAX_REGS_ARGS));
+            }
+        }
+    });
+
+    auto words = calleeSaved.size() + slotsCount + (hasCalls ? CALLER_SAVED_REGS_COUNT : 0) + outgoingArgs;
+    auto alignment = X86_64Arch::STACK_ALIGNMENT;
+    frameSize = (words * WORD_SIZE + alignment - 1) / alignment * alignment;
+    slotsOffset = -WORD_SIZE * static_cast<int32_t>(calleeSaved.size() + 1);
+    callerSavedOffset = slotsOffset - WORD_SIZE * static_cast<int32_t>(slotsCount);
+}
+
+void X86_64CodeGen::emitPrologue() {
+    encoder.BindLabel(entryLabel);
+    encoder.Push(Reg::RBP);
+    encoder.Mov(Reg::RBP, Reg::RSP);
+    if (frameSize != 0) {
+        encoder.AluImm(X86_64Encoder::AluOp::SUB, Reg::RSP, static_cast<int32_t>(frameSize));
+    }
+    for (size_t i = 0, end = calleeSaved.size(); i < end; ++i) {
+        encoder.Mov(Mem{Reg::RBP, -WORD_SIZE * static_cast<int32_t>(i + 1)}, calleeSaved[i]);
+    }
+
+    // first basic block contains all arguments in order
+    std::pmr::vector<Move> moves(graph->GetScratchArena());
+    size_t argIdx = 0;
+    for (auto *instr : *graph->GetFirstBasicBlock()) {
+        if (!instr->IsInputArgument()) {
+            continue;
+        }
+        if (argIdx < MAX_REGS_ARGS) {
+            moves.push_back({X86_64Arch::ARGS_REGS[argIdx], getLocation(instr)});
+        } else {
+            // skip saved rbp and return address
+            auto offset = WORD_SIZE * static_cast<int32_t>(argIdx - MAX_REGS_ARGS + 2);
+            moves.push_back({Mem{Reg::RBP, offset}, getLocation(instr)});
+        }
+        ++argIdx;
+    }
+    emitParallelMove(moves);
+}
+
+void X86_64CodeGen::emitEpilogue() {
+    for (size_t i = 0, end = calleeSaved.size(); i < end; ++i) {
+        encoder.Mov(calleeSaved[i], Mem{Reg::RBP, -WORD_SIZE * static_cast<int32_t>(i + 1)});
+    }
+    encoder.Leave();
+    encoder.Ret();
+}
+
+void X86_64CodeGen::emitBasicBlock(BasicBlock *bblock, const BasicBlock *next) {
+    ASSERT(bblock);
+    encoder.BindLabel(blockLabels[bblock->GetId()]);
+
+    // moves resolving PHIs are inserted at the end of predecessors (maybe even after JMP)
+    // and must be done simultaneously
+    std::pmr::vector<Move> phiMoves(graph->GetScratchArena());
+    CompareInstruction *cmp = nullptr;
+    bool returned = false;
+    for (auto *instr : bblock->IterateNonPhi()) {
+        switch (instr->GetOpcode()) {
+        case Opcode::ARG:
+        case Opcode::JMP:
+        case Opcode::JCMP:
+            break;
+        case Opcode::MOVE:
+            phiMoves.push_back({getInputLocation(instr->AsInputsInstruction(), 0), getLocation(instr)});
+            break;
+        case Opcode::CMP:
+            // fused with the following JCMP
+            ASSERT(instr->GetNextInstruction() && instr->GetNextInstruction()->IsBranch());
+            cmp = static_cast<CompareInstruction *>(instr);
+            break;
+        case Opcode::RET:
+        case Opcode::RETVOID:
+            returned = true;
+            emitInstruction(instr);
+            break;
+        default:
+            emitInstruction(instr);
+        }
+    }
+    emitParallelMove(phiMoves);
+
+    if (returned) {
+        return;
+    }
+    if (cmp != nullptr) {
+        emitBranch(bblock, cmp, next);
+        return;
+    }
+    const auto &succs = bblock->GetSuccessors();
+    if (succs.empty()) {
+        // the last basic block collecting all exits
+        emitEpilogue();
+        return;
+    }
+    ASSERT(succs.size() == 1);
+    if (succs[0] != next) {
+        encoder.Jmp(blockLabels[succs[0]->GetId()]);
+    }
+}
+
+void X86_64CodeGen::emitInstruction(InstructionBase *instr) {
+    using AluOp = X86_64Encoder::AluOp;
+    using ShiftOp = X86_64Encoder::ShiftOp;
+
+    switch (instr->GetOpcode()) {
+    case Opcode::CONST:
+        emitConst(instr->AsConst());
+        break;
+    case Opcode::ADD:
+        emitAlu(instr->AsInputsInstruction(), AluOp::ADD);
+        break;
+    case Opcode::SUB:
+        emitAlu(instr->AsInputsInstruction(), AluOp::SUB);
+        break;
+    case Opcode::AND:
+        emitAlu(instr->AsInputsInstruction(), AluOp::AND);
+        break;
+    case Opcode::OR:
+        emitAlu(instr->AsInputsInstruction(), AluOp::OR);
+        break;
+    case Opcode::XOR:
+        emitAlu(instr->AsInputsInstruction(), AluOp::XOR);
+        break;
+    case Opcode::MUL:
+        emitMul(instr->AsInputsInstruction());
+        break;
+    case Opcode::ADDI:
+        emitAluImm(static_cast<BinaryImmInstruction *>(instr), AluOp::ADD);
+        break;
+    case Opcode::SUBI:
+        emitAluImm(static_cast<BinaryImmInstruction *>(instr), AluOp::SUB);
+        break;
+    case Opcode::ANDI:
+        emitAluImm(static_cast<BinaryImmInstruction *>(instr), AluOp::AND);
+        break;
+    case Opcode::ORI:
+        emitAluImm(static_cast<BinaryImmInstruction *>(instr), AluOp::OR);
+        break;
+    case Opcode::XORI:
+        emitAluImm(static_cast<BinaryImmInstruction *>(instr), AluOp::XOR);
+        break;
+    case Opcode::MULI:
+        emitMulImm(static_cast<BinaryImmInstruction *>(instr));
+        break;
+    case Opcode::DIV:
+    case Opcode::DIVI:
+        emitDiv(instr->AsInputsInstruction(), false);
+        break;
+    case Opcode::MOD:
+    case Opcode::MODI:
+        emitDiv(instr->AsInputsInstruction(), true);
+        break;
+    case Opcode::SRA:
+        emitShift(instr->AsInputsInstruction(), ShiftOp::SAR);
+        break;
+    // both left shifts are the same on x86
+    case Opcode::SLA:
+    case Opcode::SLL:
+        emitShift(instr->AsInputsInstruction(), ShiftOp::SHL);
+        break;
+    case Opcode::SRAI:
+        emitShiftImm(static_cast<BinaryImmInstruction *>(instr), ShiftOp::SAR);
+        break;
+    case Opcode::SLAI:
+    case Opcode::SLLI:
+        emitShiftImm(static_cast<BinaryImmInstruction *>(instr), ShiftOp::SHL);
+        break;
+    case Opcode::NOT:
+    case Opcode::NEG:
+        emitUnary(instr->AsInputsInstruction());
+        break;
+    case Opcode::CAST:
+        emitCast(static_cast<CastInstruction *>(instr));
+        break;
+    case Opcode::RET:
+        emitMove(X86_64Arch::RETURN_REG, getInputLocation(instr->AsInputsInstruction(), 0));
+        emitEpilogue();
+        break;
+    case Opcode::RETVOID:
+        emitEpilogue();
+        break;
+    case Opcode::CALL:
+        emitCall(static_cast<CallInstruction *>(instr));
+        break;
+    case Opcode::NEW_ARRAY: {
+        auto *newArray = static_cast<NewArrayInstruction *>(instr);
+        std::array<Operand, 2> args{
+            getInputLocation(newArray, 0),
+            Operand::Imm(static_cast<int64_t>(newArray->GetTypeId()))};
+        auto func = reinterpret_cast<int64_t>(codeCache->GetRuntime().newArray);
+        emitNativeCall(instr, args, [this, func]() {
+            encoder.MovImm(SCRATCH_REG, func);
+            encoder.CallIndirect(SCRATCH_REG);
+        });
+        break;
+    }
+    case Opcode::NEW_ARRAY_IMM: {
+        auto *newArray = static_cast<NewArrayImmInstruction *>(instr);
+        std::array<Operand, 2> args{
+            Operand::Imm(static_cast<int64_t>(newArray->GetValue())),
+            Operand::Imm(static_cast<int64_t>(newArray->GetTypeId()))};
+        auto func = reinterpret_cast<int64_t>(codeCache->GetRuntime().newArray);
+        emitNativeCall(instr, args, [this, func]() {
+            encoder.MovImm(SCRATCH_REG, func);
+            encoder.CallIndirect(SCRATCH_REG);
+        });
+        break;
+    }
+    case Opcode::NEW_OBJECT: {
+        auto *newObject = static_cast<NewObjectInstruction *>(instr);
+        std::array<Operand, 1> args{Operand::Imm(static_cast<int64_t>(newObject->GetTypeId()))};
+        auto func = reinterpret_cast<int64_t>(codeCache->GetRuntime().newObject);
+        emitNativeCall(instr, args, [this, func]() {
+            encoder.MovImm(SCRATCH_REG, func);
+            encoder.CallIndirect(SCRATCH_REG);
+        });
+        break;
+    }
+    case Opcode::LEN:
+    case Opcode::LOAD_ARRAY:
+    case Opcode::LOAD_ARRAY_IMM:
+    case Opcode::LOAD_OBJECT:
+        emitLoad(instr->AsInputsInstruction());
+        break;
+    case Opcode::STORE_ARRAY:
+    case Opcode::STORE_ARRAY_IMM:
+    case Opcode::STORE_OBJECT:
+        emitStore(instr->AsInputsInstruction());
+        break;
+    case Opcode::NULL_CHECK:
+    case Opcode::ZERO_CHECK:
+    case Opcode::NEGATIVE_CHECK:
+    case Opcode::BOUNDS_CHECK:
+        emitCheck(instr->AsInputsInstruction());
+        break;
+    default:
+        UNREACHABLE("unexpected instruction in codegen");
+    }
+}
+
+void X86_64CodeGen::emitCheckFailures() {
+    auto func = reinterpret_cast<int64_t>(codeCache->GetRuntime().checkFailed);
+    for (auto [check, label] : checkLabels) {
+        encoder.BindLabel(label);
+        encoder.MovImm(X86_64Arch::ARGS_REGS[0], utils::to_underlying(check));
+        encoder.MovImm(SCRATCH_REG, func);
+        encoder.CallIndirect(SCRATCH_REG);
+        encoder.Ud2();
+    }
+}
+
+void X86_64CodeGen::emitConst(ConstantInstruction *instr) {
+    emitMove(getLocation(instr), Operand::Imm(canonicalize(instr->GetValue(), instr->GetType())));
+}
+
+void X86_64CodeGen::emitAlu(InputsInstruction *instr, X86_64Encoder::AluOp op) {
+    auto dst = getResultReg(instr);
+    auto lhs = getInputLocation(instr, 0);
+    auto rhs = getInputLocation(instr, 1);
+    // `dst = lhs` must not overwrite rhs
+    if (rhs.IsReg() && rhs.GetReg() == dst && lhs != rhs) {
+        if (instr->SatisfiesProperty(InstrProp::COMMUTABLE)) {
+            std::swap(lhs, rhs);
+        } else {
+            dst = SCRATCH_REG;
+        }
+    }
+    emitMove(dst, lhs);
+    encoder.Alu(op, dst, rhs);
+    normalize(dst, instr->GetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitAluImm(BinaryImmInstruction *instr, X86_64Encoder::AluOp op) {
+    auto dst = getResultReg(instr);
+    auto imm = canonicalize(instr->GetValue(), instr->GetType());
+    emitMove(dst, getInputLocation(instr, 0));
+    if (X86_64Encoder::FitsImm32(imm)) {
+        encoder.AluImm(op, dst, static_cast<int32_t>(imm));
+    } else {
+        encoder.MovImm(TMP_REG, imm);
+        encoder.Alu(op, dst, TMP_REG);
+    }
+    normalize(dst, instr->GetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitMul(InputsInstruction *instr) {
+    auto dst = getResultReg(instr);
+    auto lhs = getInputLocation(instr, 0);
+    auto rhs = getInputLocation(instr, 1);
+    if (rhs.IsReg() && rhs.GetReg() == dst) {
+        std::swap(lhs, rhs);
+    }
+    emitMove(dst, lhs);
+    encoder.Imul(dst, rhs);
+    normalize(dst, instr->GetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitMulImm(BinaryImmInstruction *instr) {
+    auto dst = getResultReg(instr);
+    auto imm = canonicalize(instr->GetValue(), instr->GetType());
+    if (X86_64Encoder::FitsImm32(imm)) {
+        encoder.ImulImm(dst, getInputLocation(instr, 0), static_cast<int32_t>(imm));
+    } else {
+        encoder.MovImm(TMP_REG, imm);
+        emitMove(dst, getInputLocation(instr, 0));
+        encoder.Imul(dst, TMP_REG);
+    }
+    normalize(dst, instr->GetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitDiv(InputsInstruction *instr, bool isMod) {
+    auto type = instr->GetType();
+    auto isSigned = isSignedType(type);
+
+    // neither RAX nor RDX are allocatable, so the divisor stays intact
+    emitMove(Reg::RAX, getInputLocation(instr, 0));
+    Operand divisor = TMP_REG;
+    bool mayBeMinusOne = isSigned;
+    if (instr->GetOpcode() == Opcode::DIVI || instr->GetOpcode() == Opcode::MODI) {
+        auto imm = canonicalize(static_cast<BinaryImmInstruction *>(instr)->GetValue(), type);
+        encoder.MovImm(TMP_REG, imm);
+        mayBeMinusOne = mayBeMinusOne && imm == -1;
+    } else {
+        divisor = getInputLocation(instr, 1);
+    }
+    if (!isSigned) {
+        encoder.MovImm(Reg::RDX, 0);
+        encoder.Div(divisor, false);
+    } else if (!mayBeMinusOne) {
+        encoder.Cqo();
+        encoder.Div(divisor, true);
+    } else {
+        // INT64_MIN / -1 raises #DE, so division by -1 wraps like the other
+        // arithmetic: quotient is -dividend and remainder is 0
+        auto divLabel = encoder.CreateLabel();
+        auto doneLabel = encoder.CreateLabel();
+        encoder.AluImm(X86_64Encoder::AluOp::CMP, divisor, -1);
+        encoder.Jcc(Cond::NE, divLabel);
+        encoder.Neg(Reg::RAX);
+        encoder.MovImm(Reg::RDX, 0);
+        encoder.Jmp(doneLabel);
+        encoder.BindLabel(divLabel);
+        encoder.Cqo();
+        encoder.Div(divisor, true);
+        encoder.BindLabel(doneLabel);
+    }
+
+    auto res = isMod ? Reg::RDX : Reg::RAX;
+    normalize(res, type);
+    storeResult(instr, res);
+}
+
+void X86_64CodeGen::emitShift(InputsInstruction *instr, X86_64Encoder::ShiftOp op) {
+    // RCX is not allocatable, so it can be loaded before the shifted value
+    emitMove(SHIFT_REG, getInputLocation(instr, 1));
+    auto dst = getResultReg(instr);
+    emitMove(dst, getInputLocation(instr, 0));
+    encoder.ShiftCl(op, dst);
+    normalize(dst, instr->GetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitShiftImm(BinaryImmInstruction *instr, X86_64Encoder::ShiftOp op) {
+    static constexpr uint64_t SHIFT_MASK = 63;
+    auto dst = getResultReg(instr);
+    emitMove(dst, getInputLocation(instr, 0));
+    encoder.ShiftImm(op, dst, static_cast<uint8_t>(instr->GetValue() & SHIFT_MASK));
+    normalize(dst, instr->GetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitUnary(InputsInstruction *instr) {
+    auto dst = getResultReg(instr);
+    emitMove(dst, getInputLocation(instr, 0));
+    if (instr->GetOpcode() == Opcode::NOT) {
+        encoder.Not(dst);
+    } else {
+        encoder.Neg(dst);
+    }
+    normalize(dst, instr->GetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitCast(CastInstruction *instr) {
+    // source value is already canonical for its type
+    auto dst = getResultReg(instr);
+    emitMove(dst, getInputLocation(instr, 0));
+    normalize(dst, instr->GetTargetType());
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitBranch(BasicBlock *bblock, CompareInstruction *cmp, const BasicBlock *next) {
+    auto lhs = toReg(getInputLocation(cmp, 0), SCRATCH_REG);
+    encoder.Alu(X86_64Encoder::AluOp::CMP, lhs, getInputLocation(cmp, 1));
+
+    auto cond = getCond(cmp->GetCondCode(), isSignedType(cmp->GetType()));
+    const auto &succs = bblock->GetSuccessors();
+    ASSERT(succs.size() == 2);
+    auto *trueBranch = succs[0];
+    auto *falseBranch = succs[1];
+    if (trueBranch == next) {
+        encoder.Jcc(inverseCond(cond), blockLabels[falseBranch->GetId()]);
+        return;
+    }
+    encoder.Jcc(cond, blockLabels[trueBranch->GetId()]);
+    if (falseBranch != next) {
+        encoder.Jmp(blockLabels[falseBranch->GetId()]);
+    }
+}
+
+void X86_64CodeGen::emitCall(CallInstruction *instr) {
+    std::pmr::vector<Operand> args(graph->GetScratchArena());
+    args.reserve(instr->GetInputsCount());
+    for (size_t i = 0, end = instr->GetInputsCount(); i < end; ++i) {
+        args.push_back(getInputLocation(instr, i));
+    }
+
+    auto target = instr->GetCallTarget();
+    if (target == graph->GetId()) {
+        emitNativeCall(instr, args, [this]() { encoder.Call(entryLabel); });
+        return;
+    }
+    // callee might be not compiled yet, so its entry is loaded at runtime
+    auto slot = reinterpret_cast<int64_t>(codeCache->GetEntrySlot(target));
+    emitNativeCall(instr, args, [this, slot]() {
+        encoder.MovImm(SCRATCH_REG, slot);
+        encoder.CallIndirect(Mem{SCRATCH_REG});
+    });
+}
+
+void X86_64CodeGen::emitLoad(InputsInstruction *instr) {
+    auto type = instr->GetType();
+    auto base = toReg(getInputLocation(instr, 0), TMP_REG);
+    Mem src{base};
+    switch (instr->GetOpcode()) {
+    case Opcode::LEN:
+        src.disp = RuntimeInterface::ARRAY_LENGTH_OFFSET;
+        break;
+    case Opcode::LOAD_ARRAY:
+        src = getArraySlot(base, getInputLocation(instr, 1), type, SHIFT_REG);
+        break;
+    case Opcode::LOAD_ARRAY_IMM: {
+        auto idx = static_cast<LoadImmInstruction *>(instr)->GetValue();
+        src = getArraySlot(base, Operand::Imm(static_cast<int64_t>(idx)), type, SHIFT_REG);
+        break;
+    }
+    case Opcode::LOAD_OBJECT: {
+        auto offset = static_cast<LoadImmInstruction *>(instr)->GetValue();
+        ASSERT(offset <= INT32_MAX);
+        src.disp = static_cast<int32_t>(offset);
+        break;
+    }
+    default:
+        UNREACHABLE("");
+    }
+
+    auto dst = getResultReg(instr);
+    encoder.Load(dst, src, getOpSize(type), isSignedType(type));
+    storeResult(instr, dst);
+}
+
+void X86_64CodeGen::emitStore(InputsInstruction *instr) {
+    auto *value = instr->GetInput(1).GetInstruction();
+    auto type = value->GetType();
+    auto base = toReg(getInputLocation(instr, 0), TMP_REG);
+    auto src = toReg(getLocation(value), SCRATCH_REG);
+    Mem dst{base};
+    switch (instr->GetOpcode()) {
+    case Opcode::STORE_ARRAY:
+        dst = getArraySlot(base, getInputLocation(instr, 2), type, SHIFT_REG);
+        break;
+    case Opcode::STORE_ARRAY_IMM: {
+        auto idx = static_cast<StoreImmInstruction *>(instr)->GetValue();
+        dst = getArraySlot(base, Operand::Imm(static_cast<int64_t>(idx)), type, SHIFT_REG);
+        break;
+    }
+    case Opcode::STORE_OBJECT: {
+        auto offset = static_cast<StoreImmInstruction *>(instr)->GetValue();
+        ASSERT(offset <= INT32_MAX);
+        dst.disp = static_cast<int32_t>(offset);
+        break;
+    }
+    default:
+        UNREACHABLE("");
+    }
+    encoder.Store(dst, src, getOpSize(type));
+}
+
+void X86_64CodeGen::emitCheck(InputsInstruction *instr) {
+    auto check = instr->GetOpcode();
+    if (check == Opcode::BOUNDS_CHECK) {
+        auto array = toReg(getInputLocation(instr, 0), TMP_REG);
+        auto idx = toReg(getInputLocation(instr, 1), SCRATCH_REG);
+        // negative index is huge when compared as unsigned
+        encoder.Alu(X86_64Encoder::AluOp::CMP, idx, Mem{array, RuntimeInterface::ARRAY_LENGTH_OFFSET});
+        encoder.Jcc(Cond::AE, getCheckLabel(check));
+        return;
+    }
+
+    auto *input = instr->GetInput(0).GetInstruction();
+    if (check == Opcode::NEGATIVE_CHECK && !isSignedType(input->GetType())) {
+        return;
+    }
+    auto value = toReg(getLocation(input), SCRATCH_REG);
+    encoder.Test(value, value);
+    encoder.Jcc(check == Opcode::NEGATIVE_CHECK ? Cond::S : Cond::E, getCheckLabel(check));
+}
+
+template <typename TargetEmitterT>
+void X86_64CodeGen::emitNativeCall(const InstructionBase *instr, std::span<const Operand> args,
+                                   TargetEmitterT emitTarget) {
+    // preserve caller-saved registers holding values which are live after the call
+    const auto &liveIntervals = graph->GetLiveIntervals();
+    auto callNumber = liveIntervals.GetLiveIntervals(instr)->GetLiveNumber();
+    std::array<bool, CALLER_SAVED_REGS_COUNT> mustSave{};
+    for (const auto *interval : liveIntervals) {
+        const auto &loc = interval->GetLocation();
+        if (loc.GetType() == LocationType::REGISTER
+            && loc.GetId() < CALLER_SAVED_REGS_COUNT
+            && interval->GetBegin() < callNumber && callNumber < interval->GetEnd())
+        {
+            mustSave[loc.GetId()] = true;
+        }
+    }
+    auto getSaveSlot = [this](size_t idx) {
+        return Mem{Reg::RBP, callerSavedOffset - WORD_SIZE * static_cast<int32_t>(idx)};
+    };
+    for (size_t i = 0; i < CALLER_SAVED_REGS_COUNT; ++i) {
+        if (mustSave[i]) {
+            encoder.Mov(getSaveSlot(i), X86_64Arch::GetAllocatableReg(i));
+        }
+    }
+
+    std::pmr::vector<Move> moves(graph->GetScratchArena());
+    for (size_t i = 0, end = args.size(); i < end; ++i) {
+        if (i < MAX_REGS_ARGS) {
+            moves.push_back({args[i], X86_64Arch::ARGS_REGS[i]});
+        } else {
+            auto offset = WORD_SIZE * static_cast<int32_t>(i - MAX_REGS_ARGS);
+            moves.push_back({args[i], Mem{Reg::RSP, offset}});
+        }
+    }
+    emitParallelMove(moves);
+    emitTarget();
+
+    for (size_t i = 0; i < CALLER_SAVED_REGS_COUNT; ++i) {
+        if (mustSave[i]) {
+            encoder.Mov(X86_64Arch::GetAllocatableReg(i), getSaveSlot(i));
+        }
+    }
+    if (instr->GetType() != OperandType::VOID) {
+        normalize(X86_64Arch::RETURN_REG, instr->GetType());
+        storeResult(instr, X86_64Arch::RETURN_REG);
+    }
+}
+
+void X86_64CodeGen::emitParallelMove(std::pmr::vector<Move> &moves) {
+    std::erase_if(moves, [](const Move &move) { return move.from == move.to; });
+    while (!moves.empty()) {
+        // a move is safe once no other pending move reads its destination
+        auto ready = std::find_if(moves.begin(), moves.end(), [&moves](const Move &move) {
+            return std::none_of(moves.begin(), moves.end(), [&move](const Move &other) {
+                return other.from == move.to;
+            });
+        });
+        if (ready != moves.end()) {
+            emitMove(ready->to, ready->from);
+            moves.erase(ready);
+            continue;
+        }
+
+        // only cycles remain, so TMP_REG is free: break one of them
+        auto blocked = moves.front().to;
+        emitMove(TMP_REG, blocked);
+        for (auto &move : moves) {
+            if (move.from == blocked) {
+                move.from = TMP_REG;
+            }
+        }
+    }
+}
+
+void X86_64CodeGen::emitMove(Operand to, Operand from) {
+    if (to == from) {
+        return;
+    }
+    ASSERT(!to.IsImm());
+    if (to.IsMem() && (from.IsMem() || (from.IsImm() && !X86_64Encoder::FitsImm32(from.GetImm())))) {
+        encoder.Mov(SCRATCH_REG, from);
+        encoder.Mov(to, SCRATCH_REG);
+        return;
+    }
+    encoder.Mov(to, from);
+}
+
+Operand X86_64CodeGen::getLocation(const InstructionBase *instr) const {
+    ASSERT(instr);
+    const auto &loc = graph->GetLiveIntervals().GetLiveIntervals(instr)->GetLocation();
+    switch (loc.GetType()) {
+    case LocationType::REGISTER:
+        return X86_64Arch::GetAllocatableReg(loc.GetId());
+    case LocationType::STACK:
+        return getSlot(loc.GetId());
+    default:
+        UNREACHABLE("value has no location");
+        return SCRATCH_REG;
+    }
+}
+
+Reg X86_64CodeGen::toReg(Operand value, Reg scratch) {
+    if (value.IsReg()) {
+        return value.GetReg();
+    }
+    emitMove(scratch, value);
+    return scratch;
+}
+
+Mem X86_64CodeGen::getSlot(LocationIdType slot) const {
+    ASSERT(slot < slotsCount);
+    return Mem{Reg::RBP, slotsOffset - WORD_SIZE * static_cast<int32_t>(slot)};
+}
+
+Mem X86_64CodeGen::getArraySlot(Reg array, Operand idx, OperandType type, Reg scratch) {
+    auto elemSize = static_cast<uint8_t>(getOpSize(type));
+    if (idx.IsImm()) {
+        auto offset = RuntimeInterface::ARRAY_DATA_OFFSET + idx.GetImm() * elemSize;
+        if (X86_64Encoder::FitsImm32(offset)) {
+            return Mem{array, static_cast<int32_t>(offset)};
+        }
+    }
+    return Mem{array, RuntimeInterface::ARRAY_DATA_OFFSET, toReg(idx, scratch), elemSize};
+}
+
+void X86_64CodeGen::normalize(Reg reg, OperandType type) {
+    if (type == OperandType::VOID || type == OperandType::REF || type == OperandType::INVALID) {
+        return;
+    }
+    encoder.Extend(reg, getOpSize(type), isSignedType(type));
+}
+
+X86_64CodeGen::Label X86_64CodeGen::getCheckLabel(Opcode check) {
+    auto iter = std::find_if(checkLabels.begin(), checkLabels.end(), [check](const auto &it) {
+        return it.first == check;
+    });
+    if (iter != checkLabels.end()) {
+        return iter->second;
+    }
+    auto label = encoder.CreateLabel();
+    checkLabels.emplace_back(check, label);
+    return label;
+}
+
+bool X86_64CodeGen::isSignedType(OperandType type) {
+    return type == OperandType::I8 || type == OperandType::I16
+        || type == OperandType::I32 || type == OperandType::I64;
+}
+
+OpSize X86_64CodeGen::getOpSize(OperandType type) {
+    if (type == OperandType::REF) {
+        return OpSize::QWORD;
+    }
+    return static_cast<OpSize>(GetTypeBitSize(type) / 8);
+}
+
+int64_t X86_64CodeGen::canonicalize(uint64_t value, OperandType type) {
+    switch (type) {
+    case OperandType::I8:
+        return static_cast<int8_t>(value);
+    case OperandType::I16:
+        return static_cast<int16_t>(value);
+    case OperandType::I32:
+        return static_cast<int32_t>(value);
+    case OperandType::U8:
+        return static_cast<uint8_t>(value);
+    case OperandType::U16:
+        return static_cast<uint16_t>(value);
+    case OperandType::U32:
+        return static_cast<uint32_t>(value);
+    default:
+        return static_cast<int64_t>(value);
+    }
+}
+}   // namespace ir::codegen
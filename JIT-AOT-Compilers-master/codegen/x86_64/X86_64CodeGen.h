@@ -0,0 +1,144 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_X86_64_CODEGEN_H_
+#define JIT_AOT_COMPILERS_COURSE_X86_64_CODEGEN_H_
+
+#include "CodeCache.h"
+#include "logger.h"
+#include "PassBase.h"
+#include "X86_64Encoder.h"
+
+
+namespace ir::codegen {
+// Emits native code for the graph and installs it into the code cache,
+// where it can be found by the graph's id.
+// Values are placed according to LinearScanRegAlloc results, which the pass runs first.
+//
+// Frame layout (addresses grow upwards):
+//      [rbp + 16 + 8 * i]  incoming stack arguments
+//      [rbp + 8]           return address
+//      [rbp]               saved rbp
+//      ...                 saved callee-saved registers
+//      ...                 spill slots
+//      ...                 caller-saved registers preserved across calls
+//      [rsp + 8 * i]       outgoing stack arguments
+// Frame size keeps rsp 16-byte aligned, so calls may be emitted anywhere in the body.
+class X86_64CodeGen : public PassBase, public utils::Logger {
+public:
+    X86_64CodeGen(Graph *graph, CodeCache *codeCache)
+        : PassBase(graph),
+          utils::Logger(log4cpp::Category::getInstance(GetName())),
+          codeCache(codeCache),
+          encoder(graph->GetScratchArena()),
+          blockLabels(graph->GetScratchArena()),
+          calleeSaved(graph->GetScratchArena()),
+          checkLabels(graph->GetScratchArena())
+    {
+        ASSERT(codeCache);
+    }
+    NO_COPY_SEMANTIC(X86_64CodeGen);
+    NO_MOVE_SEMANTIC(X86_64CodeGen);
+    ~X86_64CodeGen() noexcept override = default;
+
+    // Returns false if the graph cannot be compiled, e.g. calls an unknown function.
+    bool Run() override;
+
+    const char *GetName() const {
+        return PASS_NAME;
+    }
+
+public:
+    static constexpr const char *PASS_NAME = "x86_64_codegen";
+
+private:
+    using Label = X86_64Encoder::Label;
+
+    struct Move {
+        Operand from;
+        Operand to;
+    };
+
+    bool canCompile();
+    void computeFrameLayout();
+
+    void emitPrologue();
+    void emitEpilogue();
+    void emitBasicBlock(BasicBlock *bblock, const BasicBlock *next);
+    void emitInstruction(InstructionBase *instr);
+    void emitCheckFailures();
+
+    void emitConst(ConstantInstruction *instr);
+    void emitAlu(InputsInstruction *instr, X86_64Encoder::AluOp op);
+    void emitAluImm(BinaryImmInstruction *instr, X86_64Encoder::AluOp op);
+    void emitMul(InputsInstruction *instr);
+    void emitMulImm(BinaryImmInstruction *instr);
+    void emitDiv(InputsInstruction *instr, bool isMod);
+    void emitShift(InputsInstruction *instr, X86_64Encoder::ShiftOp op);
+    void emitShiftImm(BinaryImmInstruction *instr, X86_64Encoder::ShiftOp op);
+    void emitUnary(InputsInstruction *instr);
+    void emitCast(CastInstruction *instr);
+    void emitBranch(BasicBlock *bblock, CompareInstruction *cmp, const BasicBlock *next);
+    void emitCall(CallInstruction *instr);
+    void emitLoad(InputsInstruction *instr);
+    void emitStore(InputsInstruction *instr);
+    void emitCheck(InputsInstruction *instr);
+
+    // Arguments are passed according to the ABI, the result is taken from RAX.
+    // `emitTarget` emits the call instruction itself.
+    template <typename TargetEmitterT>
+    void emitNativeCall(const InstructionBase *instr, std::span<const Operand> args,
+                        TargetEmitterT emitTarget);
+    // Moves values between locations as if all moves were done simultaneously.
+    void emitParallelMove(std::pmr::vector<Move> &moves);
+    void emitMove(Operand to, Operand from);
+
+    Operand getLocation(const InstructionBase *instr) const;
+    Operand getInputLocation(InputsInstruction *instr, size_t idx) const {
+        return getLocation(instr->GetInput(idx).GetInstruction());
+    }
+    // Returns register holding the value, loading it into scratch register if needed.
+    Reg toReg(Operand value, Reg scratch);
+    // Register to compute the result of instruction in.
+    Reg getResultReg(const InstructionBase *instr) const {
+        auto loc = getLocation(instr);
+        return loc.IsReg() ? loc.GetReg() : SCRATCH_REG;
+    }
+    void storeResult(const InstructionBase *instr, Reg reg) {
+        emitMove(getLocation(instr), reg);
+    }
+    Mem getSlot(LocationIdType slot) const;
+    Mem getArraySlot(Reg array, Operand idx, OperandType type, Reg scratch);
+    // Keeps values canonical: sign- or zero-extended from their type's width into 64 bits.
+    void normalize(Reg reg, OperandType type);
+    Label getCheckLabel(Opcode check);
+
+    static bool isSignedType(OperandType type);
+    static OpSize getOpSize(OperandType type);
+    static int64_t canonicalize(uint64_t value, OperandType type);
+
+private:
+    // accumulator of instructions selection
+    static constexpr Reg SCRATCH_REG = Reg::RAX;
+    // scratch register for operands and breaking cycles in parallel moves
+    static constexpr Reg TMP_REG = Reg::R11;
+    static constexpr Reg SHIFT_REG = Reg::RCX;
+
+    static constexpr size_t MAX_REGS_ARGS = X86_64Arch::ARGS_REGS.size();
+
+    CodeCache *codeCache;
+
+    X86_64Encoder encoder;
+
+    Label entryLabel = 0;
+    std::pmr::vector<Label> blockLabels;
+
+    std::pmr::vector<Reg> calleeSaved;
+    size_t slotsCount = 0;
+    size_t frameSize = 0;
+    // offsets relative to rbp
+    int32_t slotsOffset = 0;
+    int32_t callerSavedOffset = 0;
+
+    std::pmr::vector<std::pair<Opcode, Label>> checkLabels;
+};
+}   // namespace ir::codegen
+
+#endif  // JIT_AOT_COMPILERS_COURSE_X86_64_CODEGEN_H_
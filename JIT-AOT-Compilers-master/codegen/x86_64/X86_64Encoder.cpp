@@ -0,0 +1,293 @@
+#include <cstring>
+#include "X86_64Encoder.h"
+
+
+namespace ir::codegen {
+std::span<const uint8_t> X86_64Encoder::Finalize() {
+    for (const auto &fixup : fixups) {
+        ASSERT(labels[fixup.label] != UNBOUND);
+        auto rel = static_cast<int64_t>(labels[fixup.label])
+            - static_cast<int64_t>(fixup.position + sizeof(int32_t));
+        ASSERT(FitsImm32(rel));
+        auto rel32 = static_cast<int32_t>(rel);
+        std::memcpy(code.data() + fixup.position, &rel32, sizeof(rel32));
+    }
+    fixups.clear();
+    return std::span{code};
+}
+
+void X86_64Encoder::Mov(Operand dst, Operand src) {
+    if (src.IsImm()) {
+        if (dst.IsReg()) {
+            MovImm(dst.GetReg(), src.GetImm());
+            return;
+        }
+        ASSERT(FitsImm32(src.GetImm()));
+        emitOp({0xC7}, true, 0, dst);
+        emitImm32(static_cast<int32_t>(src.GetImm()));
+        return;
+    }
+    if (dst.IsReg()) {
+        if (src.IsReg() && src.GetReg() == dst.GetReg()) {
+            return;
+        }
+        // mov r64, r/m64
+        emitOp({0x8B}, true, idx(dst.GetReg()), src);
+        return;
+    }
+    ASSERT(dst.IsMem() && src.IsReg());
+    // mov r/m64, r64
+    emitOp({0x89}, true, idx(src.GetReg()), dst);
+}
+
+void X86_64Encoder::MovImm(Reg dst, int64_t imm) {
+    // flags must stay intact, so no `xor reg, reg` for zero
+    if (imm >= 0 && imm <= UINT32_MAX) {
+        // mov r32, imm32 zero-extends into the whole register
+        emitRex(false, 0, 0, idx(dst));
+        emitByte(0xB8 + (idx(dst) & 7));
+        emitImm32(static_cast<int32_t>(static_cast<uint32_t>(imm)));
+    } else if (FitsImm32(imm)) {
+        emitOp({0xC7}, true, 0, dst);
+        emitImm32(static_cast<int32_t>(imm));
+    } else {
+        emitRex(true, 0, 0, idx(dst));
+        emitByte(0xB8 + (idx(dst) & 7));
+        emitImm64(imm);
+    }
+}
+
+void X86_64Encoder::Load(Reg dst, const Mem &src, OpSize size, bool isSigned) {
+    switch (size) {
+    case OpSize::BYTE:
+        emitOp({0x0F, static_cast<uint8_t>(isSigned ? 0xBE : 0xB6)}, isSigned, idx(dst), src);
+        break;
+    case OpSize::WORD:
+        emitOp({0x0F, static_cast<uint8_t>(isSigned ? 0xBF : 0xB7)}, isSigned, idx(dst), src);
+        break;
+    case OpSize::DWORD:
+        // movsxd r64, r/m32 or mov r32, r/m32
+        emitOp({static_cast<uint8_t>(isSigned ? 0x63 : 0x8B)}, isSigned, idx(dst), src);
+        break;
+    case OpSize::QWORD:
+        emitOp({0x8B}, true, idx(dst), src);
+        break;
+    }
+}
+
+void X86_64Encoder::Store(const Mem &dst, Reg src, OpSize size) {
+    switch (size) {
+    case OpSize::BYTE:
+        // REX prefix is required to address SIL/DIL instead of DH/BH
+        emitOp({0x88}, false, idx(src), dst, true);
+        break;
+    case OpSize::WORD:
+        emitByte(0x66);
+        emitOp({0x89}, false, idx(src), dst);
+        break;
+    case OpSize::DWORD:
+        emitOp({0x89}, false, idx(src), dst);
+        break;
+    case OpSize::QWORD:
+        emitOp({0x89}, true, idx(src), dst);
+        break;
+    }
+}
+
+void X86_64Encoder::Extend(Reg reg, OpSize size, bool isSigned) {
+    switch (size) {
+    case OpSize::BYTE:
+        emitOp({0x0F, static_cast<uint8_t>(isSigned ? 0xBE : 0xB6)}, isSigned, idx(reg), reg, true);
+        break;
+    case OpSize::WORD:
+        emitOp({0x0F, static_cast<uint8_t>(isSigned ? 0xBF : 0xB7)}, isSigned, idx(reg), reg);
+        break;
+    case OpSize::DWORD:
+        emitOp({static_cast<uint8_t>(isSigned ? 0x63 : 0x8B)}, isSigned, idx(reg), reg);
+        break;
+    case OpSize::QWORD:
+        break;
+    }
+}
+
+void X86_64Encoder::Alu(AluOp op, Reg dst, Operand src) {
+    ASSERT(!src.IsImm());
+    // op r64, r/m64
+    emitOp({static_cast<uint8_t>((static_cast<uint8_t>(op) << 3) | 0x3)}, true, idx(dst), src);
+}
+
+void X86_64Encoder::AluImm(AluOp op, Operand dst, int32_t imm) {
+    ASSERT(!dst.IsImm());
+    if (imm >= INT8_MIN && imm <= INT8_MAX) {
+        emitOp({0x83}, true, static_cast<uint8_t>(op), dst);
+        emitByte(static_cast<uint8_t>(imm));
+    } else {
+        emitOp({0x81}, true, static_cast<uint8_t>(op), dst);
+        emitImm32(imm);
+    }
+}
+
+void X86_64Encoder::Test(Reg lhs, Reg rhs) {
+    emitOp({0x85}, true, idx(rhs), lhs);
+}
+
+void X86_64Encoder::Imul(Reg dst, Operand src) {
+    ASSERT(!src.IsImm());
+    emitOp({0x0F, 0xAF}, true, idx(dst), src);
+}
+
+void X86_64Encoder::ImulImm(Reg dst, Operand src, int32_t imm) {
+    ASSERT(!src.IsImm());
+    emitOp({0x69}, true, idx(dst), src);
+    emitImm32(imm);
+}
+
+void X86_64Encoder::Not(Reg reg) {
+    emitOp({0xF7}, true, 2, reg);
+}
+
+void X86_64Encoder::Neg(Reg reg) {
+    emitOp({0xF7}, true, 3, reg);
+}
+
+void X86_64Encoder::Div(Operand src, bool isSigned) {
+    ASSERT(!src.IsImm());
+    emitOp({0xF7}, true, isSigned ? 7 : 6, src);
+}
+
+void X86_64Encoder::Cqo() {
+    emitByte(0x48);
+    emitByte(0x99);
+}
+
+void X86_64Encoder::ShiftCl(ShiftOp op, Reg reg) {
+    emitOp({0xD3}, true, static_cast<uint8_t>(op), reg);
+}
+
+void X86_64Encoder::ShiftImm(ShiftOp op, Reg reg, uint8_t imm) {
+    emitOp({0xC1}, true, static_cast<uint8_t>(op), reg);
+    emitByte(imm);
+}
+
+void X86_64Encoder::Push(Reg reg) {
+    emitRex(false, 0, 0, idx(reg));
+    emitByte(0x50 + (idx(reg) & 7));
+}
+
+void X86_64Encoder::Pop(Reg reg) {
+    emitRex(false, 0, 0, idx(reg));
+    emitByte(0x58 + (idx(reg) & 7));
+}
+
+void X86_64Encoder::Leave() {
+    emitByte(0xC9);
+}
+
+void X86_64Encoder::Ret() {
+    emitByte(0xC3);
+}
+
+void X86_64Encoder::Ud2() {
+    emitByte(0x0F);
+    emitByte(0x0B);
+}
+
+void X86_64Encoder::Jmp(Label label) {
+    emitByte(0xE9);
+    emitRel32(label);
+}
+
+void X86_64Encoder::Jcc(Cond cond, Label label) {
+    emitByte(0x0F);
+    emitByte(0x80 | static_cast<uint8_t>(cond));
+    emitRel32(label);
+}
+
+void X86_64Encoder::Call(Label label) {
+    emitByte(0xE8);
+    emitRel32(label);
+}
+
+void X86_64Encoder::CallIndirect(Operand target) {
+    emitOp({0xFF}, false, 2, target);
+}
+
+void X86_64Encoder::emitImm32(int32_t imm) {
+    for (size_t i = 0; i < sizeof(imm); ++i) {
+        emitByte(static_cast<uint8_t>(static_cast<uint32_t>(imm) >> (8 * i)));
+    }
+}
+
+void X86_64Encoder::emitImm64(int64_t imm) {
+    for (size_t i = 0; i < sizeof(imm); ++i) {
+        emitByte(static_cast<uint8_t>(static_cast<uint64_t>(imm) >> (8 * i)));
+    }
+}
+
+void X86_64Encoder::emitRex(bool w, uint8_t reg, uint8_t index, uint8_t base, bool force) {
+    uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+    if (rex != 0x40 || force) {
+        emitByte(rex);
+    }
+}
+
+void X86_64Encoder::emitOp(std::initializer_list<uint8_t> opcode, bool w, uint8_t reg, Operand rm,
+                           bool forceRex) {
+    ASSERT(!rm.IsImm());
+    if (rm.IsReg()) {
+        emitRex(w, reg, 0, idx(rm.GetReg()), forceRex);
+    } else {
+        const auto &mem = rm.GetMem();
+        emitRex(w, reg, mem.HasIndex() ? idx(mem.index) : 0, idx(mem.base), forceRex);
+    }
+    for (auto byte : opcode) {
+        emitByte(byte);
+    }
+    emitModRM(reg, rm);
+}
+
+void X86_64Encoder::emitModRM(uint8_t reg, Operand rm) {
+    reg &= 7;
+    if (rm.IsReg()) {
+        emitByte(0xC0 | (reg << 3) | (idx(rm.GetReg()) & 7));
+        return;
+    }
+
+    const auto &mem = rm.GetMem();
+    auto base = idx(mem.base) & 7;
+    uint8_t mod = 0b10;
+    // [rbp] and [r13] have no encoding without displacement
+    if (mem.disp == 0 && base != idx(Reg::RBP)) {
+        mod = 0b00;
+    } else if (mem.disp >= INT8_MIN && mem.disp <= INT8_MAX) {
+        mod = 0b01;
+    }
+
+    // [rsp] and [r12] as well as any indexed address require SIB byte
+    if (mem.HasIndex() || base == idx(Reg::RSP)) {
+        emitByte((mod << 6) | (reg << 3) | idx(Reg::RSP));
+        uint8_t scaleBits = 0;
+        if (mem.HasIndex()) {
+            ASSERT(mem.index != Reg::RSP);
+            ASSERT(mem.scale == 1 || mem.scale == 2 || mem.scale == 4 || mem.scale == 8);
+            scaleBits = static_cast<uint8_t>(__builtin_ctz(mem.scale));
+        }
+        auto index = mem.HasIndex() ? (idx(mem.index) & 7) : idx(Reg::RSP);
+        emitByte((scaleBits << 6) | (index << 3) | base);
+    } else {
+        emitByte((mod << 6) | (reg << 3) | base);
+    }
+
+    if (mod == 0b01) {
+        emitByte(static_cast<uint8_t>(static_cast<int8_t>(mem.disp)));
+    } else if (mod == 0b10) {
+        emitImm32(mem.disp);
+    }
+}
+
+void X86_64Encoder::emitRel32(Label label) {
+    ASSERT(label < labels.size());
+    fixups.push_back({code.size(), label});
+    emitImm32(0);
+}
+}   // namespace ir::codegen
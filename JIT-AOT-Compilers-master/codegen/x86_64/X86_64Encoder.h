@@ -0,0 +1,222 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_X86_64_ENCODER_H_
+#define JIT_AOT_COMPILERS_COURSE_X86_64_ENCODER_H_
+
+#include <cstdint>
+#include "macros.h"
+#include <memory_resource>
+#include <span>
+#include <vector>
+#include "X86_64Arch.h"
+
+
+namespace ir::codegen {
+// Memory operand [base + index * scale + disp].
+struct Mem {
+    Reg base;
+    int32_t disp = 0;
+    Reg index = Reg::NUM_REGS;
+    uint8_t scale = 1;
+
+    bool HasIndex() const {
+        return index != Reg::NUM_REGS;
+    }
+    bool operator==(const Mem &other) const = default;
+};
+
+// Register, memory or immediate operand of moves.
+class Operand final {
+public:
+    enum class Kind : uint8_t {
+        REG,
+        MEM,
+        IMM
+    };
+
+    Operand(Reg reg) : kind(Kind::REG), reg(reg) {}
+    Operand(Mem mem) : kind(Kind::MEM), mem(mem) {}
+    static Operand Imm(int64_t value) {
+        Operand res(Reg::RAX);
+        res.kind = Kind::IMM;
+        res.imm = value;
+        return res;
+    }
+    DEFAULT_COPY_SEMANTIC(Operand);
+    DEFAULT_MOVE_SEMANTIC(Operand);
+    DEFAULT_DTOR(Operand);
+
+    bool IsReg() const {
+        return kind == Kind::REG;
+    }
+    bool IsMem() const {
+        return kind == Kind::MEM;
+    }
+    bool IsImm() const {
+        return kind == Kind::IMM;
+    }
+    Reg GetReg() const {
+        ASSERT(IsReg());
+        return reg;
+    }
+    const Mem &GetMem() const {
+        ASSERT(IsMem());
+        return mem;
+    }
+    int64_t GetImm() const {
+        ASSERT(IsImm());
+        return imm;
+    }
+
+    bool operator==(const Operand &other) const {
+        if (kind != other.kind) {
+            return false;
+        }
+        switch (kind) {
+        case Kind::REG:
+            return reg == other.reg;
+        case Kind::MEM:
+            return mem == other.mem;
+        default:
+            return imm == other.imm;
+        }
+    }
+
+private:
+    Kind kind;
+    Reg reg = Reg::NUM_REGS;
+    Mem mem{Reg::NUM_REGS};
+    int64_t imm = 0;
+};
+
+// Condition codes in hardware encoding (the low nibble of Jcc/SETcc opcodes).
+enum class Cond : uint8_t {
+    B = 0x2,
+    AE = 0x3,
+    E = 0x4,
+    NE = 0x5,
+    BE = 0x6,
+    A = 0x7,
+    S = 0x8,
+    L = 0xC,
+    GE = 0xD,
+    LE = 0xE,
+    G = 0xF,
+};
+
+// Operand size of memory accesses and extensions, in bytes.
+enum class OpSize : uint8_t {
+    BYTE = 1,
+    WORD = 2,
+    DWORD = 4,
+    QWORD = 8,
+};
+
+// Emits x86-64 machine code into a plain buffer.
+// Unless stated otherwise, instructions operate on 64-bit registers.
+class X86_64Encoder {
+public:
+    using Label = size_t;
+
+    enum class AluOp : uint8_t {
+        ADD = 0,
+        OR = 1,
+        AND = 4,
+        SUB = 5,
+        XOR = 6,
+        CMP = 7,
+    };
+    enum class ShiftOp : uint8_t {
+        SHL = 4,
+        SAR = 7,
+    };
+
+    explicit X86_64Encoder(std::pmr::memory_resource *memResource)
+        : code(memResource), labels(memResource), fixups(memResource) {}
+    NO_COPY_SEMANTIC(X86_64Encoder);
+    NO_MOVE_SEMANTIC(X86_64Encoder);
+    virtual DEFAULT_DTOR(X86_64Encoder);
+
+    size_t GetSize() const {
+        return code.size();
+    }
+    // Resolves all jumps; must be called once all labels are bound.
+    std::span<const uint8_t> Finalize();
+
+    Label CreateLabel() {
+        labels.push_back(UNBOUND);
+        return labels.size() - 1;
+    }
+    void BindLabel(Label label) {
+        ASSERT(label < labels.size() && labels[label] == UNBOUND);
+        labels[label] = code.size();
+    }
+
+    // mov dst, src; memory-to-memory moves are not encodable
+    void Mov(Operand dst, Operand src);
+    void MovImm(Reg dst, int64_t imm);
+    // loads with sign/zero extension into 64-bit register
+    void Load(Reg dst, const Mem &src, OpSize size, bool isSigned);
+    void Store(const Mem &dst, Reg src, OpSize size);
+    // sign/zero extends the low part of register into the whole 64-bit register
+    void Extend(Reg reg, OpSize size, bool isSigned);
+
+    void Alu(AluOp op, Reg dst, Operand src);
+    void AluImm(AluOp op, Operand dst, int32_t imm);
+    void Test(Reg lhs, Reg rhs);
+    void Imul(Reg dst, Operand src);
+    void ImulImm(Reg dst, Operand src, int32_t imm);
+    void Not(Reg reg);
+    void Neg(Reg reg);
+    // rdx:rax / src
+    void Div(Operand src, bool isSigned);
+    void Cqo();
+    void ShiftCl(ShiftOp op, Reg reg);
+    void ShiftImm(ShiftOp op, Reg reg, uint8_t imm);
+
+    void Push(Reg reg);
+    void Pop(Reg reg);
+    void Leave();
+    void Ret();
+    void Ud2();
+
+    void Jmp(Label label);
+    void Jcc(Cond cond, Label label);
+    void Call(Label label);
+    void CallIndirect(Operand target);
+
+    static constexpr bool FitsImm32(int64_t imm) {
+        return imm >= INT32_MIN && imm <= INT32_MAX;
+    }
+
+private:
+    void emitByte(uint8_t byte) {
+        code.push_back(byte);
+    }
+    void emitImm32(int32_t imm);
+    void emitImm64(int64_t imm);
+    void emitRex(bool w, uint8_t reg, uint8_t index, uint8_t base, bool force = false);
+    // emits REX prefix (when needed), opcode bytes and ModRM/SIB/displacement
+    void emitOp(std::initializer_list<uint8_t> opcode, bool w, uint8_t reg, Operand rm,
+                bool forceRex = false);
+    void emitModRM(uint8_t reg, Operand rm);
+    void emitRel32(Label label);
+
+    static constexpr uint8_t idx(Reg reg) {
+        return static_cast<uint8_t>(reg);
+    }
+
+private:
+    static constexpr size_t UNBOUND = static_cast<size_t>(-1);
+
+    struct Fixup {
+        // position of rel32 field
+        size_t position;
+        Label label;
+    };
+
+    std::pmr::vector<uint8_t> code;
+    std::pmr::vector<size_t> labels;
+    std::pmr::vector<Fixup> fixups;
+};
+}   // namespace ir::codegen
+
+#endif  // JIT_AOT_COMPILERS_COURSE_X86_64_ENCODER_H_
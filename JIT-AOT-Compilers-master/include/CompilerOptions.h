@@ -1,6 +1,8 @@
 #ifndef JIT_AOT_COMPILERS_COURSE_COMPILER_OPTIONS_H_
 #define JIT_AOT_COMPILERS_COURSE_COMPILER_OPTIONS_H_
 
+#include <cstddef>
+#include <cstdint>
 #include "macros.h"
 
 
@@ -14,15 +16,62 @@ public:                                     \
 private:                                    \
     type name = value
 
+enum class OptLevel : uint8_t {
+    // no optimizations
+    O0,
+    // cheap intraprocedural cleanups
+    O1,
+    // inlining, checks elimination and cleanups iterated until fixed point
+    O2,
+};
+
 class CompilerOptions final {
 public:
-    CompilerOptions() = default;
+    CompilerOptions() {
+        SetOptLevel(OptLevel::O2);
+    }
     NO_COPY_SEMANTIC(CompilerOptions);
     NO_MOVE_SEMANTIC(CompilerOptions);
     DEFAULT_DTOR(CompilerOptions);
 
+    // Sets passes according to the preset; separate passes can be toggled afterwards.
+    void SetOptLevel(OptLevel level) {
+        OptimizationLevel = level;
+        EnableInlining = level >= OptLevel::O2;
+        EnableChecksElimination = level >= OptLevel::O2;
+        EnablePeepholes = level >= OptLevel::O1;
+        EnableGVN = level >= OptLevel::O1;
+        EnableBranchElimination = level >= OptLevel::O1;
+        EnableDCE = level >= OptLevel::O1;
+        EnableEmptyBlocksRemoval = level >= OptLevel::O1;
+        MaxCleanupIterations = level >= OptLevel::O2 ? 4 : 1;
+    }
+    OptLevel GetOptLevel() const {
+        return OptimizationLevel;
+    }
+
     PASS_OPTION(size_t, MaxCalleeInstrs, 25);
     PASS_OPTION(size_t, MaxInstrsAfterInlining, 250);
+
+    PASS_OPTION(bool, EnableInlining, true);
+    PASS_OPTION(bool, EnableChecksElimination, true);
+    PASS_OPTION(bool, EnablePeepholes, true);
+    PASS_OPTION(bool, EnableGVN, true);
+    PASS_OPTION(bool, EnableBranchElimination, true);
+    PASS_OPTION(bool, EnableDCE, true);
+    PASS_OPTION(bool, EnableEmptyBlocksRemoval, true);
+    // cleanup passes are repeated until none of them changes the graph or the limit is reached
+    PASS_OPTION(size_t, MaxCleanupIterations, 4);
+    // no more cleanup iterations start once the budget is spent, 0 means unlimited
+    PASS_OPTION(size_t, CompileTimeBudgetUs, 0);
+    // bytes the arena of a new function's graph may reserve, 0 means unlimited;
+    // compilation of the function fails once the limit is exceeded
+    PASS_OPTION(size_t, GraphMemoryLimit, 0);
+    // enables collecting of per-pass time and instructions counters
+    PASS_OPTION(bool, CollectPassStatistics, false);
+
+private:
+    OptLevel OptimizationLevel = OptLevel::O2;
 };
 
 #undef PASS_OPTION
@@ -340,11 +340,6 @@ BasicBlock *BasicBlock::SplitAfterInstruction(InstructionBase *instr, bool conne
     auto *graph = GetGraph();
     auto *newBBlock = graph->CreateEmptyBasicBlock();
 
-    // might leave unconnected, e.g. for further usage in inlining
-    if (connectAfterSplit) {
-        graph->ConnectBasicBlocks(this, newBBlock);
-    }
-
     if (GetLoop()) {
         GetLoop()->AddBasicBlock(newBBlock);
         newBBlock->SetLoop(GetLoop());
@@ -352,8 +347,16 @@ BasicBlock *BasicBlock::SplitAfterInstruction(InstructionBase *instr, bool conne
     for (auto *succ : GetSuccessors()) {
         succ->RemovePredecessor(this);
         graph->ConnectBasicBlocks(newBBlock, succ);
+        // control flow now reaches PHIs of the successor from the new block
+        for (auto *phi : succ->IteratePhi()) {
+            phi->ReplaceSourceBasicBlock(this, newBBlock);
+        }
     }
     succs.clear();
+    // might leave unconnected, e.g. for further usage in inlining
+    if (connectAfterSplit) {
+        graph->ConnectBasicBlocks(this, newBBlock);
+    }
 
     instr->SetNextInstruction(nullptr);
     nextInstr->SetPrevInstruction(nullptr);
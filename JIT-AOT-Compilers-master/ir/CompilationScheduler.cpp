@@ -0,0 +1,125 @@
+#include <algorithm>
+#include "CompilationScheduler.h"
+#include <limits>
+#include <unordered_map>
+
+
+namespace ir {
+bool CompilationScheduler::Compile(std::span<Graph *const> graphs) {
+    failed = false;
+    buildTasks(graphs);
+    // running tasks decrease the counters, so ready tasks must be found before any submission
+    std::vector<size_t> readyTasks;
+    for (size_t i = 0, end = tasks.size(); i < end; ++i) {
+        if (tasks[i].pendingCallees == 0) {
+            readyTasks.push_back(i);
+        }
+    }
+    for (auto taskIdx : readyTasks) {
+        pool.Submit([this, taskIdx]() { runTask(taskIdx); });
+    }
+    pool.Wait();
+    tasks.clear();
+    return !failed;
+}
+
+void CompilationScheduler::runTask(size_t taskIdx) {
+    auto &task = tasks[taskIdx];
+    for (auto *graph : task.graphs) {
+        if (compiler->Optimize(graph) == nullptr) {
+            failed = true;
+        }
+    }
+    for (auto dependent : task.dependents) {
+        if (--tasks[dependent].pendingCallees == 0) {
+            pool.Submit([this, dependent]() { runTask(dependent); });
+        }
+    }
+}
+
+// Iterative Tarjan's algorithm, which emits callees' components before callers' ones.
+void CompilationScheduler::buildTasks(std::span<Graph *const> graphs) {
+    std::unordered_map<FunctionId, size_t> indices;
+    for (size_t i = 0, end = graphs.size(); i < end; ++i) {
+        ASSERT(graphs[i]);
+        indices.emplace(graphs[i]->GetId(), i);
+    }
+    std::vector<std::vector<size_t>> callees(graphs.size());
+    for (size_t i = 0, end = graphs.size(); i < end; ++i) {
+        graphs[i]->ForEachBasicBlock([&indices, &calleesList = callees[i]](BasicBlock *bblock) {
+            for (auto *instr : *bblock) {
+                if (!instr->IsCall()) {
+                    continue;
+                }
+                auto iter = indices.find(static_cast<CallInstruction *>(instr)->GetCallTarget());
+                if (iter != indices.end()) {
+                    calleesList.push_back(iter->second);
+                }
+            }
+        });
+    }
+
+    constexpr auto UNVISITED = std::numeric_limits<size_t>::max();
+    std::vector<size_t> order(graphs.size(), UNVISITED);
+    std::vector<size_t> lowLink(graphs.size(), UNVISITED);
+    std::vector<size_t> components(graphs.size(), UNVISITED);
+    std::vector<size_t> componentStack;
+    // pairs of a node and index of its next callee to visit
+    std::vector<std::pair<size_t, size_t>> dfsStack;
+    size_t counter = 0;
+    size_t componentsCount = 0;
+
+    auto visit = [&](size_t node) {
+        order[node] = lowLink[node] = counter++;
+        componentStack.push_back(node);
+        dfsStack.emplace_back(node, 0);
+    };
+    for (size_t root = 0, end = graphs.size(); root < end; ++root) {
+        if (order[root] != UNVISITED) {
+            continue;
+        }
+        visit(root);
+        while (!dfsStack.empty()) {
+            auto [node, calleeIdx] = dfsStack.back();
+            if (calleeIdx < callees[node].size()) {
+                ++dfsStack.back().second;
+                auto callee = callees[node][calleeIdx];
+                if (order[callee] == UNVISITED) {
+                    visit(callee);
+                } else if (components[callee] == UNVISITED) {
+                    // callee is still on the component stack
+                    lowLink[node] = std::min(lowLink[node], order[callee]);
+                }
+                continue;
+            }
+
+            dfsStack.pop_back();
+            if (!dfsStack.empty()) {
+                auto parent = dfsStack.back().first;
+                lowLink[parent] = std::min(lowLink[parent], lowLink[node]);
+            }
+            if (lowLink[node] == order[node]) {
+                size_t member = UNVISITED;
+                do {
+                    member = componentStack.back();
+                    componentStack.pop_back();
+                    components[member] = componentsCount;
+                } while (member != node);
+                ++componentsCount;
+            }
+        }
+    }
+
+    tasks = std::vector<Task>(componentsCount);
+    for (size_t i = 0, end = graphs.size(); i < end; ++i) {
+        auto &task = tasks[components[i]];
+        task.graphs.push_back(graphs[i]);
+        for (auto callee : callees[i]) {
+            if (components[callee] != components[i]) {
+                tasks[components[callee]].dependents.push_back(components[i]);
+                ++task.pendingCallees;
+            }
+        }
+    }
+}
+}   // namespace ir
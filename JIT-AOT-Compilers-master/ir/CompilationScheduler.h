@@ -0,0 +1,62 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_COMPILATION_SCHEDULER_H_
+#define JIT_AOT_COMPILERS_COURSE_COMPILATION_SCHEDULER_H_
+
+#include <atomic>
+#include "Compiler.h"
+#include "macros.h"
+#include <span>
+#include "ThreadPool.h"
+#include <vector>
+
+
+namespace ir {
+// Optimizes batches of functions' graphs concurrently on a pool of threads.
+//
+// Graphs are compiled bottom-up over the call graph: a graph is scheduled only after
+// all its callees from the same batch are compiled, so inlining reads finished callees only.
+// Mutually recursive graphs are compiled one after another by a single task.
+class CompilationScheduler final {
+public:
+    // Zero threads count means the number of hardware threads.
+    explicit CompilationScheduler(Compiler *compiler, size_t threadsCount = 0)
+        : compiler(compiler), pool(threadsCount)
+    {
+        ASSERT(compiler);
+    }
+    NO_COPY_SEMANTIC(CompilationScheduler);
+    NO_MOVE_SEMANTIC(CompilationScheduler);
+    DEFAULT_DTOR(CompilationScheduler);
+
+    size_t GetThreadsCount() const {
+        return pool.GetThreadsCount();
+    }
+
+    // Blocks until all the graphs are optimized.
+    // Functions called from the batch but not included into it must not be modified concurrently.
+    // Returns false if compilation of any graph failed, e.g. its memory limit was exceeded.
+    bool Compile(std::span<Graph *const> graphs);
+
+private:
+    struct Task {
+        std::vector<Graph *> graphs;
+        // tasks containing callers of the graphs
+        std::vector<size_t> dependents;
+        // number of not yet compiled tasks containing callees of the graphs
+        std::atomic<size_t> pendingCallees = 0;
+    };
+
+    // Splits the graphs into strongly connected components of the call graph.
+    void buildTasks(std::span<Graph *const> graphs);
+    void runTask(size_t taskIdx);
+
+private:
+    Compiler *compiler;
+
+    utils::ThreadPool pool;
+
+    std::vector<Task> tasks;
+    std::atomic<bool> failed = false;
+};
+}   // namespace ir
+
+#endif  // JIT_AOT_COMPILERS_COURSE_COMPILATION_SCHEDULER_H_
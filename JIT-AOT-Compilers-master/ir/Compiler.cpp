@@ -1,20 +1,89 @@
 #include "Compiler.h"
 #include "GraphCopyHelper.h"
 #include "Loop.h"
+#include "OptimizationPipeline.h"
 
 
 // TODO: move builders & compiler into a dedicated ir's subdirectory
 namespace ir {
+Graph *Compiler::CreateNewGraph() {
+    auto arena = std::make_unique<utils::Arena>(options.GetGraphMemoryLimit());
+    auto *instrBuilder = utils::template New<InstructionBuilder>(arena.get(), arena.get());
+    auto *graph = utils::template New<Graph>(arena.get(), this, arena.get(), instrBuilder);
+    return registerGraph(graph, std::move(arena));
+}
+
 Graph *Compiler::CreateNewGraph(InstructionBuilder *instrBuilder) {
-    auto *graph = utils::template New<Graph>(&memResource, this, &memResource, instrBuilder);
-    graph->SetId(functionsGraphs.size());
-    functionsGraphs.push_back(graph);
+    ASSERT(instrBuilder);
+    auto *mem = instrBuilder->GetMemoryResource();
+    return registerGraph(utils::template New<Graph>(mem, this, mem, instrBuilder), nullptr);
+}
+
+Graph *Compiler::registerGraph(Graph *graph, std::unique_ptr<utils::Arena> ownArena) {
+    ASSERT(graph);
+    std::lock_guard guard(functionsLock);
+    graph->SetId(functions.size());
+    functions.push_back({graph, graph->GetArena(), std::move(ownArena)});
     return graph;
 }
 
+bool Compiler::DeleteFunctionGraph(FunctionId functionId) {
+    std::lock_guard guard(functionsLock);
+    if (functionId >= functions.size() || functions[functionId].graph == nullptr) {
+        return false;
+    }
+    auto &function = functions[functionId];
+    if (function.ownArena == nullptr) {
+        function.graph = nullptr;
+        function.arena = nullptr;
+        return true;
+    }
+    auto *arena = function.arena;
+    for (auto &other : functions) {
+        if (other.arena == arena) {
+            other.graph = nullptr;
+            other.arena = nullptr;
+        }
+    }
+    function.ownArena.reset();
+    return true;
+}
+
+Compiler::MemoryUsage Compiler::GetFunctionMemoryUsage(FunctionId functionId) const {
+    std::shared_lock guard(functionsLock);
+    if (functionId >= functions.size() || functions[functionId].arena == nullptr) {
+        return {};
+    }
+    const auto *arena = functions[functionId].arena;
+    return {arena->GetAllocatedBytes(), arena->GetReservedBytes()};
+}
+
+Compiler::MemoryUsage Compiler::GetMemoryUsage() const {
+    std::shared_lock guard(functionsLock);
+    MemoryUsage usage;
+    for (const auto &function : functions) {
+        // copied graphs are accounted by arenas' owners
+        if (function.ownArena) {
+            usage.allocatedBytes += function.ownArena->GetAllocatedBytes();
+            usage.reservedBytes += function.ownArena->GetReservedBytes();
+        }
+    }
+    return usage;
+}
+
 // Depth first ordered graph copy algorithm implementation.
 Graph *Compiler::CopyGraph(const Graph *source, InstructionBuilder *instrBuilder) {
     ASSERT((source) && (instrBuilder));
     return GraphCopyHelper::CreateCopy(source, CreateNewGraph(instrBuilder));
 }
+
+Graph *Compiler::Optimize(Graph *graph) {
+    ASSERT(graph);
+    if (options.GetCollectPassStatistics()) {
+        graph->SetPassStatistics(&passStatistics);
+    }
+    PassManager::Run<OptimizationPipeline>(graph);
+    graph->SetPassStatistics(nullptr);
+    return graph->IsMemoryLimitExceeded() ? nullptr : graph;
+}
 }   // namespace ir
@@ -2,56 +2,98 @@
 #define JIT_AOT_COMPILERS_COURSE_COMPILER_H_
 
 #include "AllocatorUtils.h"
+#include "Arena.h"
 #include "CompilerBase.h"
 #include "CompilerOptions.h"
 #include "InstructionBuilder.h"
-#include <memory_resource>
+#include <memory>
+#include <mutex>
+#include "PassStatistics.h"
+#include <shared_mutex>
+#include <vector>
 
 
 namespace ir {
+// Each graph allocates from its own arena, so distinct graphs may be created
+// and optimized from different threads concurrently. Deleting a function's graph
+// returns its arena's memory to the system.
 class Compiler : public CompilerBase {
 public:
-    explicit Compiler(codegen::ArchInfoBase *arch)
-        : memResource(), functionsGraphs(&memResource), arch(arch) {}
+    // Memory taken by a function's graph, its passes' scratch data
+    // and graphs copied into it by inlining.
+    struct MemoryUsage {
+        size_t allocatedBytes = 0;
+        size_t reservedBytes = 0;
+    };
+
+    explicit Compiler(codegen::ArchInfoBase *arch) : arch(arch) {}
 
     codegen::ArchInfoBase *GetArch() const {
         return arch;
     }
-    Graph *CreateNewGraph() override {
-        auto *instrBuilder = utils::template New<InstructionBuilder>(&memResource, &memResource);
-        return CreateNewGraph(instrBuilder);
-    }
+    // The graph gets its own arena limited by GraphMemoryLimit option.
+    Graph *CreateNewGraph() override;
+    // The graph shares memory resource with the builder.
     Graph *CreateNewGraph(InstructionBuilder *instrBuilder);
     Graph *CopyGraph(const Graph *source, InstructionBuilder *instrBuilder) override;
-    Graph *Optimize(Graph *graph) override {
-        // TODO: run optimizations here
-        return graph;
-    }
+    // Runs the passes enabled in options over the graph.
+    // Returns nullptr if the graph's memory limit was exceeded: the graph stays valid,
+    // but might be optimized partially.
+    Graph *Optimize(Graph *graph) override;
+    // Returns nullptr for deleted functions.
     Graph *GetFunction(FunctionId functionId) override {
-        if (functionId >= functionsGraphs.size()) {
+        std::shared_lock guard(functionsLock);
+        if (functionId >= functions.size()) {
             return nullptr;
         }
-        return functionsGraphs[functionId];
+        return functions[functionId].graph;
     }
-    bool DeleteFunctionGraph(FunctionId functionId) override {
-        if (functionId >= functionsGraphs.size()) {
-            return false;
-        }
-        functionsGraphs.erase(functionsGraphs.begin() + functionId);
-        return true;
+    // Includes deleted functions, as their ids are never reused.
+    size_t GetFunctionsCount() const {
+        std::shared_lock guard(functionsLock);
+        return functions.size();
     }
+    // Releases the graph's arena, which also deletes graphs copied into it.
+    bool DeleteFunctionGraph(FunctionId functionId) override;
+    // Must not be called while the function is being compiled.
+    MemoryUsage GetFunctionMemoryUsage(FunctionId functionId) const;
+    // Summary usage of all functions, same restrictions apply.
+    MemoryUsage GetMemoryUsage() const;
     const CompilerOptions &GetOptions() const override {
         return options;
     }
+    CompilerOptions &GetOptions() {
+        return options;
+    }
+    // Accumulated over all Optimize calls while CollectPassStatistics option is set.
+    // Safe to update concurrently, but must not be read until compilation is finished.
+    const PassStatistics &GetPassStatistics() const {
+        return passStatistics;
+    }
+    PassStatistics &GetPassStatistics() {
+        return passStatistics;
+    }
 
 private:
-    // TODO: limit maximum memory size
-    std::pmr::monotonic_buffer_resource memResource;
+    struct FunctionInfo {
+        Graph *graph = nullptr;
+        // arena the graph is allocated in, nullptr if it is not an arena
+        utils::Arena *arena = nullptr;
+        // set only for graphs created with their own arena
+        std::unique_ptr<utils::Arena> ownArena;
+    };
 
-    std::pmr::vector<Graph *> functionsGraphs;
+    Graph *registerGraph(Graph *graph, std::unique_ptr<utils::Arena> ownArena);
+
+private:
+    // guards functions' graphs and arenas
+    mutable std::shared_mutex functionsLock;
+    std::vector<FunctionInfo> functions;
 
     CompilerOptions options;
 
+    PassStatistics passStatistics;
+
     codegen::ArchInfoBase *arch;
 };
 }   // namespace ir
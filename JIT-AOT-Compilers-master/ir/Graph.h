@@ -4,6 +4,7 @@
 #include "AnalysisValidityManager.h"
 #include <algorithm>
 #include "AllocatorUtils.h"
+#include "Arena.h"
 #include "BasicBlock.h"
 #include "LiveAnalysisStructs.h"
 #include "macros.h"
@@ -17,6 +18,7 @@ class InstructionBuilder;
 class LinearOrdering;
 class LivenessAnalyzer;
 class Loop;
+class PassStatistics;
 
 class Graph : public MarkerManager, public AnalysisValidityManager {
 public:
@@ -31,7 +33,9 @@ public:
           loopTreeRoot(nullptr),
           instrBuilder(instrBuilder),
           liveIntervals(mem),
-          memResource(mem)
+          memResource(mem),
+          arena(dynamic_cast<utils::Arena *>(mem)),
+          scratchArena(0, mem)
     {
         ASSERT(compiler);
         ASSERT(memResource);
@@ -59,6 +63,21 @@ public:
     [[nodiscard]] T *New(ArgsT&&... args) const {
         return utils::template New<T>(GetMemoryResource(), std::forward<ArgsT>(args)...);
     }
+    // Returns nullptr if the graph's memory resource is not an arena.
+    utils::Arena *GetArena() {
+        return arena;
+    }
+    const utils::Arena *GetArena() const {
+        return arena;
+    }
+    bool IsMemoryLimitExceeded() const {
+        return arena != nullptr && arena->IsLimitExceeded();
+    }
+    // Temporary data of passes, which is freed once the pass finishes.
+    // Its chunks are taken from the graph's memory and reused by the following passes.
+    utils::Arena *GetScratchArena() {
+        return &scratchArena;
+    }
 
     BasicBlock *GetFirstBasicBlock() {
         return firstBlock;
@@ -118,6 +137,14 @@ public:
         return liveIntervals;
     }
 
+    // Returns nullptr if passes run on the graph are not measured.
+    PassStatistics *GetPassStatistics() {
+        return passStatistics;
+    }
+    void SetPassStatistics(PassStatistics *statistics) {
+        passStatistics = statistics;
+    }
+
     void SetFirstBasicBlock(BasicBlock *bblock) {
         firstBlock = bblock;
         invalidateAfterChangedCFG();
@@ -203,7 +230,11 @@ private:
 
     LiveIntervals liveIntervals;
 
+    PassStatistics *passStatistics = nullptr;
+
     mutable std::pmr::memory_resource *memResource;
+    utils::Arena *arena;
+    utils::Arena scratchArena;
 };
 }   // namespace ir
 
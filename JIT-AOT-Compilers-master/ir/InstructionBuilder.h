@@ -23,6 +23,10 @@ public:
     NO_MOVE_SEMANTIC(InstructionBuilder);
     virtual DEFAULT_DTOR(InstructionBuilder);
 
+    std::pmr::memory_resource *GetMemoryResource() const {
+        return allocator.resource();
+    }
+
     void AttachInstruction(InstructionBase *inst) {
         ASSERT((inst) && (inst->GetId() == InstructionBase::INVALID_ID));
         inst->SetId(currentId++);
@@ -21,16 +21,24 @@ void LiveInterval::SetBegin(LiveRange::RangeType begin) {
 void LiveInterval::AddRange(const LiveRange &rng) {
     if (ranges.empty()) {
         ranges.push_back(rng);
-    } else {
-        auto &earliest = ranges.back();
-        if (rng.LeftAdjacent(earliest)) {
-            earliest.SetBegin(rng.GetBegin());
-        } else if (rng < earliest) {
-            ranges.push_back(rng);
-        } else {
-            ASSERT(earliest.Includes(rng));
-        }
+        return;
+    }
+    if (rng < ranges.back() && !rng.LeftAdjacent(ranges.back())) {
+        ranges.push_back(rng);
+        return;
+    }
+    // ranges are added in reverse linear order, so the new range can cover only the earliest ones,
+    // e.g. when a loop's range is added
+    LiveRange merged = rng;
+    while (!ranges.empty()
+           && (merged.Intersects(ranges.back()) || merged.LeftAdjacent(ranges.back())))
+    {
+        merged = {std::min(merged.GetBegin(), ranges.back().GetBegin()),
+                  std::max(merged.GetEnd(), ranges.back().GetEnd())};
+        ranges.pop_back();
     }
+    ASSERT(ranges.empty() || merged < ranges.back());
+    ranges.push_back(merged);
 }
 
 LiveInterval *LiveIntervals::AddLiveInterval(LiveRange::RangeType liveNum, InstructionBase *instr) {
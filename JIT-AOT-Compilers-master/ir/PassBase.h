@@ -1,8 +1,10 @@
 #ifndef JIT_AOT_COMPILERS_COURSE_PASS_BASE_H_
 #define JIT_AOT_COMPILERS_COURSE_PASS_BASE_H_
 
+#include <chrono>
 #include "Graph.h"
 #include <log4cpp/Category.hh>
+#include "PassStatistics.h"
 
 
 namespace ir {
@@ -24,17 +26,40 @@ public:
             if (graph->IsAnalysisValid(PassT::SET_FLAG)) {
                 return true;
             }
-            auto res = PassT(graph, args...).Run();
+            auto res = runPass<PassT>(graph, args...);
             graph->SetAnalysisValid<PassT::SET_FLAG>(true);
             return res;
         }
-        return PassT(graph, args...).Run();
+        return runPass<PassT>(graph, args...);
     }
 
     template <AnalysisFlag... Flags>
     static void SetInvalid(Graph *graph) {
         utils::expand_t{(graph->SetAnalysisValid<Flags>(false), void(), 0)...};
     }
+
+private:
+    // Scratch memory of the pass and its nested passes is rewound after it finishes.
+    // Named passes are measured when the graph has statistics attached.
+    template <typename PassT, typename... ArgsT>
+    static bool runPass(Graph *graph, ArgsT... args) {
+        // must outlive the pass, which may keep scratch data in its fields
+        utils::Arena::Scope scratchScope(graph->GetScratchArena());
+        PassT pass(graph, args...);
+        if constexpr (requires { pass.GetName(); }) {
+            auto *statistics = graph->GetPassStatistics();
+            if (statistics != nullptr) {
+                auto instrsBefore = static_cast<int64_t>(graph->CountInstructions());
+                auto start = std::chrono::steady_clock::now();
+                auto res = pass.Run();
+                auto time = std::chrono::steady_clock::now() - start;
+                auto instrsDelta = static_cast<int64_t>(graph->CountInstructions()) - instrsBefore;
+                statistics->AddRun(pass.GetName(), res, time, instrsDelta);
+                return res;
+            }
+        }
+        return pass.Run();
+    }
 };
 
 class PassBase {
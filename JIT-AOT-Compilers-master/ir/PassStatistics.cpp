@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <iomanip>
+#include "PassStatistics.h"
+
+
+namespace ir {
+void PassStatistics::AddRun(std::string_view passName, bool changed, Duration time, int64_t instrsDelta) {
+    std::lock_guard guard(lock);
+    auto iter = std::find_if(passes.begin(), passes.end(), [passName](const auto &it) {
+        return it.first == passName;
+    });
+    if (iter == passes.end()) {
+        iter = passes.emplace(passes.end(), passName, PassInfo{});
+    }
+    auto &info = iter->second;
+    ++info.runsCount;
+    info.changesCount += changed;
+    info.time += time;
+    info.instrsDelta += instrsDelta;
+}
+
+const PassStatistics::PassInfo *PassStatistics::GetPassInfo(std::string_view passName) const {
+    auto iter = std::find_if(passes.begin(), passes.end(), [passName](const auto &it) {
+        return it.first == passName;
+    });
+    return iter != passes.end() ? &iter->second : nullptr;
+}
+
+void PassStatistics::Dump(std::ostream &os) const {
+    os << std::left << std::setw(24) << "pass" << std::right
+       << std::setw(8) << "runs" << std::setw(10) << "changed"
+       << std::setw(12) << "time, us" << std::setw(12) << "instrs" << '\n';
+    for (const auto &[name, info] : passes) {
+        os << std::left << std::setw(24) << name << std::right
+           << std::setw(8) << info.runsCount << std::setw(10) << info.changesCount
+           << std::setw(12) << std::chrono::duration_cast<std::chrono::microseconds>(info.time).count()
+           << std::setw(12) << info.instrsDelta << '\n';
+    }
+}
+}   // namespace ir
@@ -0,0 +1,60 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_PASS_STATISTICS_H_
+#define JIT_AOT_COMPILERS_COURSE_PASS_STATISTICS_H_
+
+#include <chrono>
+#include <cstdint>
+#include "macros.h"
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace ir {
+// Counters of passes' runs, which PassManager collects for graphs having the statistics attached.
+class PassStatistics final {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    struct PassInfo {
+        size_t runsCount = 0;
+        // number of runs which reported the graph was changed
+        size_t changesCount = 0;
+        // wall time, includes analyses run by the pass itself
+        Duration time{0};
+        // difference between instructions counts after and before runs
+        int64_t instrsDelta = 0;
+    };
+
+    PassStatistics() = default;
+    NO_COPY_SEMANTIC(PassStatistics);
+    NO_MOVE_SEMANTIC(PassStatistics);
+    DEFAULT_DTOR(PassStatistics);
+
+    // Thread-safe, other methods must not be called concurrently with it.
+    void AddRun(std::string_view passName, bool changed, Duration time, int64_t instrsDelta);
+
+    // Returns nullptr if the pass has never run.
+    const PassInfo *GetPassInfo(std::string_view passName) const;
+    size_t GetPassesCount() const {
+        return passes.size();
+    }
+    // Passes are listed in order of their first runs.
+    const auto &GetPasses() const {
+        return passes;
+    }
+
+    void Clear() {
+        passes.clear();
+    }
+
+    void Dump(std::ostream &os) const;
+
+private:
+    std::mutex lock;
+    std::vector<std::pair<std::string_view, PassInfo>> passes;
+};
+}   // namespace ir
+
+#endif  // JIT_AOT_COMPILERS_COURSE_PASS_STATISTICS_H_
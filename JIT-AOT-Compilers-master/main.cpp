@@ -1,12 +1,75 @@
-#include "codegen/default/DefaultArch.h"
+#include "codegen/x86_64/X86_64CodeGen.h"
 #include "Compiler.h"
+#include <iostream>
 #include "Traversals.h"
 
 
-int main() {
-    ir::Compiler compiler(ir::codegen::DefaultArch::GetInstance());
+// int64 fact(int64 n) {
+//     int64 res = 1
+//     for (int64 i = 2; i <= n; ++i) {
+//         res *= i
+//     }
+//     return res
+// }
+static ir::Graph *buildFactorial(ir::Compiler &compiler) {
+    using namespace ir;
+
+    auto type = OperandType::I64;
     auto *graph = compiler.CreateNewGraph();
+    auto *instrBuilder = graph->GetInstructionBuilder();
+
+    auto *arg = instrBuilder->CreateARG(type);
+    auto *constOne = instrBuilder->CreateCONST(type, 1);
+    auto *constTwo = instrBuilder->CreateCONST(type, 2);
+    auto *firstBlock = graph->CreateEmptyBasicBlock();
+    instrBuilder->PushBackInstruction(firstBlock, arg, constOne, constTwo);
+    graph->SetFirstBasicBlock(firstBlock);
+
+    auto *loopHeader = graph->CreateEmptyBasicBlock();
+    graph->ConnectBasicBlocks(firstBlock, loopHeader);
+    auto *exitBlock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(loopHeader, exitBlock);
+    auto *loopBody = graph->CreateEmptyBasicBlock();
+    graph->ConnectBasicBlocks(loopHeader, loopBody);
+    graph->ConnectBasicBlocks(loopBody, loopHeader);
+
+    auto *phiIdx = instrBuilder->CreatePHI(type);
+    auto *phiRes = instrBuilder->CreatePHI(type);
+    auto *cmp = instrBuilder->CreateCMP(type, CondCode::GT, phiIdx, arg);
+    auto *jcmp = instrBuilder->CreateJCMP();
+    instrBuilder->PushBackInstruction(loopHeader, phiIdx, phiRes, cmp, jcmp);
+
+    auto *mul = instrBuilder->CreateMUL(type, phiRes, phiIdx);
+    auto *inc = instrBuilder->CreateADDI(type, phiIdx, 1);
+    auto *jmp = instrBuilder->CreateJMP();
+    instrBuilder->PushBackInstruction(loopBody, mul, inc, jmp);
+
+    phiIdx->AddPhiInput(constTwo, firstBlock);
+    phiIdx->AddPhiInput(inc, loopBody);
+    phiRes->AddPhiInput(constOne, firstBlock);
+    phiRes->AddPhiInput(mul, loopBody);
+
+    instrBuilder->PushBackInstruction(exitBlock, instrBuilder->CreateRET(type, phiRes));
+    return graph;
+}
+
+int main() {
+    ir::Compiler compiler(ir::codegen::X86_64Arch::GetInstance());
+    compiler.GetOptions().SetCollectPassStatistics(true);
+    auto *graph = buildFactorial(compiler);
     graph = compiler.Optimize(graph);
     ir::DumpGraphRPO(graph);
+    compiler.GetPassStatistics().Dump(std::cout);
+
+#ifdef __x86_64__
+    ir::codegen::CodeCache codeCache;
+    if (!ir::PassManager::Run<ir::codegen::X86_64CodeGen>(graph, &codeCache)) {
+        return 1;
+    }
+    auto *fact = codeCache.GetFunction<int64_t(int64_t)>(graph->GetId());
+    for (int64_t i = 0; i <= 20; ++i) {
+        std::cout << i << "! = " << fact(i) << std::endl;
+    }
+#endif  // __x86_64__
     return 0;
 }
@@ -10,7 +10,8 @@ bool DCEPass::Run() {
     auto rpoTraversal = graph->GetRPO();
     for (auto &bblock : rpoTraversal) {
         for (auto *instr : *bblock) {
-            if (instr->HasSideEffects()) {
+            // arguments define the function's signature even if unused
+            if (instr->HasSideEffects() || instr->IsInputArgument()) {
                 markAlive(instr);
             }
         }
@@ -26,6 +27,7 @@ bool DCEPass::Run() {
 
     bool foundDead = !deadInstrs.empty();
     removeDead();
+    graph->ReleaseMarker(aliveMarker);
     return foundDead;
 }
 
@@ -12,7 +12,7 @@ public:
     explicit DCEPass(Graph *graph)
         : PassBase(graph),
           utils::Logger(log4cpp::Category::getInstance(GetName())),
-          deadInstrs(graph->GetMemoryResource())
+          deadInstrs(graph->GetScratchArena())
     {}
     ~DCEPass() noexcept override = default;
 
@@ -0,0 +1,145 @@
+#include "DomTree.h"
+#include "GraphChecker.h"
+#include "GVN.h"
+#include <unordered_map>
+
+
+namespace ir {
+bool GVNPass::Run() {
+    if (graph->IsEmpty()) {
+        return false;
+    }
+    PassManager::Run<DomTreeBuilder>(graph);
+
+    auto *scratch = graph->GetScratchArena();
+    std::pmr::unordered_map<ValueKey, InstructionBase *, ValueKeyHash> leaders(scratch);
+    // values numbered in the blocks on the current dominator tree path,
+    // they are forgotten when the walk leaves the blocks
+    std::pmr::vector<const ValueKey *> scopedKeys(scratch);
+    // (block, index of the next dominated block to visit, size of scopedKeys on entering the block)
+    std::pmr::vector<std::tuple<BasicBlock *, size_t, size_t>> stack(scratch);
+
+    bool changed = false;
+    auto enterBlock = [&](BasicBlock *bblock) {
+        stack.emplace_back(bblock, 0, scopedKeys.size());
+        for (auto *instr = bblock->GetFirstInstruction(); instr != nullptr;) {
+            auto *next = instr->GetNextInstruction();
+            if (IsNumberable(instr)) {
+                auto [iter, inserted] = leaders.try_emplace(makeKey(instr), instr);
+                if (inserted) {
+                    scopedKeys.push_back(&iter->first);
+                } else {
+                    replace(instr, iter->second);
+                    changed = true;
+                }
+            }
+            instr = next;
+        }
+    };
+
+    enterBlock(graph->GetFirstBasicBlock());
+    while (!stack.empty()) {
+        auto &[bblock, dominatedIdx, keysCount] = stack.back();
+        auto &dominated = bblock->GetDominatedBlocks();
+        if (dominatedIdx < dominated.size()) {
+            enterBlock(dominated[dominatedIdx++]);
+            continue;
+        }
+        for (size_t i = keysCount, end = scopedKeys.size(); i < end; ++i) {
+            // the key must not refer to the erased node
+            auto key = *scopedKeys[i];
+            leaders.erase(key);
+        }
+        scopedKeys.resize(keysCount);
+        stack.pop_back();
+    }
+
+    if (changed) {
+        ASSERT(PassManager::Run<GraphChecker>(graph));
+    }
+    return changed;
+}
+
+/* static */
+bool GVNPass::IsNumberable(const InstructionBase *instr) {
+    ASSERT(instr);
+    switch (instr->GetOpcode()) {
+    case Opcode::LEN:
+        // arrays are never resized
+        return true;
+    case Opcode::ARG:
+    case Opcode::PHI:
+    case Opcode::MOVE:
+        return false;
+    default:
+        return !instr->HasSideEffects()
+            && !instr->SatisfiesProperty(InstrProp::CF)
+            && !instr->SatisfiesProperty(InstrProp::MEM);
+    }
+}
+
+/* static */
+GVNPass::ValueKey GVNPass::makeKey(const InstructionBase *instr) {
+    ValueKey key{instr->GetOpcode(), instr->GetType(), 0, {nullptr, nullptr}};
+    switch (instr->GetOpcode()) {
+    case Opcode::CONST:
+        key.payload = instr->AsConst()->GetValue();
+        break;
+    case Opcode::CAST:
+        key.payload = utils::to_underlying(static_cast<const CastInstruction *>(instr)->GetTargetType());
+        break;
+    case Opcode::ANDI:
+    case Opcode::ORI:
+    case Opcode::XORI:
+    case Opcode::ADDI:
+    case Opcode::SUBI:
+    case Opcode::MULI:
+    case Opcode::SRAI:
+    case Opcode::SLAI:
+    case Opcode::SLLI:
+        key.payload = static_cast<const BinaryImmInstruction *>(instr)->GetValue();
+        break;
+    default:
+        break;
+    }
+
+    if (instr->HasInputs()) {
+        const auto *inputsInstr = instr->AsInputsInstruction();
+        auto inputsCount = inputsInstr->GetInputsCount();
+        ASSERT(inputsCount <= key.inputs.size());
+        for (size_t i = 0; i < inputsCount; ++i) {
+            key.inputs[i] = inputsInstr->GetInput(i).GetInstruction();
+        }
+        if (instr->SatisfiesProperty(InstrProp::COMMUTABLE) && inputsCount == 2
+            && key.inputs[1]->GetId() < key.inputs[0]->GetId())
+        {
+            std::swap(key.inputs[0], key.inputs[1]);
+        }
+    }
+    return key;
+}
+
+size_t GVNPass::ValueKeyHash::operator()(const ValueKey &key) const {
+    auto combine = [](size_t seed, size_t value) {
+        return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    };
+    size_t hash = utils::to_underlying(key.opcode);
+    hash = combine(hash, utils::to_underlying(key.type));
+    hash = combine(hash, std::hash<uint64_t>{}(key.payload));
+    for (const auto *input : key.inputs) {
+        hash = combine(hash, std::hash<const InstructionBase *>{}(input));
+    }
+    return hash;
+}
+
+void GVNPass::replace(InstructionBase *instr, InstructionBase *leader) {
+    ASSERT((instr) && (leader) && leader->Dominates(instr));
+    GetLogger(utils::LogPriority::INFO) << "Replaced " << instr->GetOpcodeName() << " #" << instr->GetId()
+                                        << " with #" << leader->GetId();
+    instr->ReplaceInputInUsers(leader);
+    if (instr->HasInputs()) {
+        instr->AsInputsInstruction()->RemoveUserFromInputs();
+    }
+    instr->GetBasicBlock()->UnlinkInstruction(instr);
+}
+}   // namespace ir
@@ -0,0 +1,54 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_GVN_H_
+#define JIT_AOT_COMPILERS_COURSE_GVN_H_
+
+#include <array>
+#include "logger.h"
+#include "PassBase.h"
+
+
+namespace ir {
+// Dominator-based global value numbering.
+// Pure instructions are numbered by opcode, type, immediate and inputs, which are
+// ordered for commutable ones. Walking the dominator tree in preorder, an instruction
+// equal to one of its dominators is replaced with it. CFG is never changed,
+// so CFG analyses stay valid.
+class GVNPass : public PassBase, public utils::Logger {
+public:
+    explicit GVNPass(Graph *graph)
+        : PassBase(graph), utils::Logger(log4cpp::Category::getInstance(GetName())) {}
+    ~GVNPass() noexcept override = default;
+
+    bool Run() override;
+
+    const char *GetName() const {
+        return PASS_NAME;
+    }
+
+    // Instructions without side effects, or ones whose result depends only on inputs,
+    // e.g. length of an array.
+    static bool IsNumberable(const InstructionBase *instr);
+
+private:
+    struct ValueKey {
+        Opcode opcode;
+        OperandType type;
+        // immediate, value of constant or target type of cast
+        uint64_t payload;
+        std::array<const InstructionBase *, 2> inputs;
+
+        bool operator==(const ValueKey &other) const = default;
+    };
+
+    struct ValueKeyHash {
+        size_t operator()(const ValueKey &key) const;
+    };
+
+    static ValueKey makeKey(const InstructionBase *instr);
+    void replace(InstructionBase *instr, InstructionBase *leader);
+
+private:
+    static constexpr const char *PASS_NAME = "gvn";
+};
+}   // namespace ir
+
+#endif  // JIT_AOT_COMPILERS_COURSE_GVN_H_
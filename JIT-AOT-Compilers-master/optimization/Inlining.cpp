@@ -50,6 +50,10 @@ const Graph *InliningPass::canInlineFunction(CallInstruction *call,
         GetLogger(utils::LogPriority::INFO) << "No IR graph found, skipping. id = " << call->GetCallTarget();
         return nullptr;
     }
+    if (graph->IsMemoryLimitExceeded()) {
+        GetLogger(utils::LogPriority::INFO) << "Memory limit is exceeded, skipping. id = " << call->GetCallTarget();
+        return nullptr;
+    }
 
     auto instrsCount = callerInstrsCount;
     if (callee != graph) {
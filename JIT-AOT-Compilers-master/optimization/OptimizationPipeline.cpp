@@ -0,0 +1,73 @@
+#include "BranchElimination.h"
+#include "CheckElimination.h"
+#include <chrono>
+#include "CompilerBase.h"
+#include "DCE.h"
+#include "EmptyBlocksRemoval.h"
+#include "GVN.h"
+#include "Inlining.h"
+#include "OptimizationPipeline.h"
+#include "Peephole.h"
+
+
+namespace ir {
+OptimizationPipeline::OptimizationPipeline(Graph *graph)
+    : PassBase(graph),
+      utils::Logger(log4cpp::Category::getInstance(GetName())),
+      options(graph->GetCompiler()->GetOptions())
+{}
+
+bool OptimizationPipeline::Run() {
+    auto start = std::chrono::steady_clock::now();
+    auto budget = std::chrono::microseconds(options.GetCompileTimeBudgetUs());
+
+    bool changed = false;
+    if (options.GetEnableInlining()) {
+        changed |= PassManager::Run<InliningPass>(graph);
+    }
+
+    size_t iteration = 0;
+    for (; iteration < options.GetMaxCleanupIterations(); ++iteration) {
+        if (graph->IsMemoryLimitExceeded()) {
+            GetLogger(utils::LogPriority::WARN) << "Memory limit of graph #" << graph->GetId()
+                << " is exceeded after " << iteration << " cleanup iterations";
+            break;
+        }
+        if (budget.count() != 0 && std::chrono::steady_clock::now() - start >= budget) {
+            GetLogger(utils::LogPriority::INFO) << "Compile time budget is spent after "
+                << iteration << " cleanup iterations";
+            break;
+        }
+        if (!runCleanups()) {
+            break;
+        }
+        changed = true;
+    }
+    GetLogger(utils::LogPriority::DEBUG) << "Finished after " << iteration << " cleanup iterations";
+    return changed;
+}
+
+bool OptimizationPipeline::runCleanups() {
+    bool changed = false;
+    if (options.GetEnablePeepholes()) {
+        changed |= PassManager::Run<PeepholePass>(graph);
+    }
+    // equal values get the same instruction, so checks on them become redundant
+    if (options.GetEnableGVN()) {
+        changed |= PassManager::Run<GVNPass>(graph);
+    }
+    if (options.GetEnableChecksElimination()) {
+        changed |= PassManager::Run<CheckElimination>(graph);
+    }
+    if (options.GetEnableBranchElimination()) {
+        changed |= PassManager::Run<BranchElimination>(graph);
+    }
+    if (options.GetEnableDCE()) {
+        changed |= PassManager::Run<DCEPass>(graph);
+    }
+    if (options.GetEnableEmptyBlocksRemoval()) {
+        changed |= PassManager::Run<EmptyBlocksRemoval>(graph);
+    }
+    return changed;
+}
+}   // namespace ir
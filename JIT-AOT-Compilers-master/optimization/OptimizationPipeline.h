@@ -0,0 +1,37 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_OPTIMIZATION_PIPELINE_H_
+#define JIT_AOT_COMPILERS_COURSE_OPTIMIZATION_PIPELINE_H_
+
+#include "CompilerOptions.h"
+#include "logger.h"
+#include "PassBase.h"
+
+
+namespace ir {
+// Runs the optimization passes enabled in compiler's options.
+// Inlining runs once, then the cleanup passes are iterated until the graph stops
+// changing, the iterations limit is reached, the compile time budget is spent
+// or the graph's memory limit is exceeded.
+class OptimizationPipeline : public PassBase, public utils::Logger {
+public:
+    explicit OptimizationPipeline(Graph *graph);
+    ~OptimizationPipeline() noexcept override = default;
+
+    bool Run() override;
+
+    const char *GetName() const {
+        return PASS_NAME;
+    }
+
+private:
+    // Returns true if any of the passes changed the graph.
+    bool runCleanups();
+
+private:
+    static constexpr const char *PASS_NAME = "optimization_pipeline";
+
+private:
+    const CompilerOptions &options;
+};
+}   // namespace ir
+
+#endif  // JIT_AOT_COMPILERS_COURSE_OPTIMIZATION_PIPELINE_H_
@@ -0,0 +1,143 @@
+#include "Arena.h"
+#include "CompilerTestBase.h"
+#include "DomTree.h"
+#include "TestFunctionSamples.h"
+
+
+namespace ir::tests {
+TEST(ArenaTest, TestRewind) {
+    utils::Arena arena;
+    auto *first = arena.allocate(24, 8);
+    auto mark = arena.GetMark();
+    ASSERT_EQ(arena.GetAllocatedBytes(), 24);
+
+    // spans several chunks
+    for (size_t i = 0; i < 64; ++i) {
+        auto *ptr = arena.allocate(1000, 16);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % 16, 0);
+    }
+    auto reserved = arena.GetReservedBytes();
+    ASSERT_GT(reserved, 64 * 1000);
+
+    arena.Rewind(mark);
+    ASSERT_EQ(arena.GetAllocatedBytes(), 24);
+    ASSERT_EQ(arena.GetReservedBytes(), reserved);
+    ASSERT_NE(arena.allocate(8, 8), first);
+
+    // chunks left after rewinding are reused
+    for (size_t i = 0; i < 64; ++i) {
+        ASSERT_NE(arena.allocate(1000, 16), nullptr);
+    }
+    ASSERT_EQ(arena.GetReservedBytes(), reserved);
+}
+
+TEST(ArenaTest, TestScope) {
+    utils::Arena arena;
+    ASSERT_NE(arena.allocate(16, 8), nullptr);
+    {
+        utils::Arena::Scope outer(&arena);
+        ASSERT_NE(arena.allocate(32, 8), nullptr);
+        {
+            utils::Arena::Scope inner(&arena);
+            ASSERT_NE(arena.allocate(64, 8), nullptr);
+            ASSERT_EQ(arena.GetAllocatedBytes(), 112);
+        }
+        ASSERT_EQ(arena.GetAllocatedBytes(), 48);
+    }
+    ASSERT_EQ(arena.GetAllocatedBytes(), 16);
+}
+
+TEST(ArenaTest, TestLimit) {
+    constexpr size_t LIMIT = 16 * 1024;
+    utils::Arena arena(LIMIT);
+    ASSERT_EQ(arena.GetLimit(), LIMIT);
+    while (!arena.IsLimitExceeded()) {
+        // allocations over the limit still succeed
+        ASSERT_NE(arena.allocate(512, 8), nullptr);
+    }
+    ASSERT_GT(arena.GetReservedBytes(), LIMIT);
+
+    arena.Release();
+    ASSERT_FALSE(arena.IsLimitExceeded());
+    ASSERT_EQ(arena.GetReservedBytes(), 0);
+    ASSERT_EQ(arena.GetAllocatedBytes(), 0);
+}
+
+class CompilerMemoryTest : public CompilerTestBase {
+public:
+    Graph *BuildCallee() {
+        return BuildLeafFunction(compiler, OPS_TYPE, 3).graph;
+    }
+
+    Graph *BuildCaller(Graph *callee) {
+        return BuildCallerFunction(compiler, OPS_TYPE, {callee});
+    }
+
+public:
+    static constexpr auto OPS_TYPE = OperandType::I32;
+};
+
+TEST_F(CompilerMemoryTest, TestScratchRewoundAfterPass) {
+    auto *callee = BuildCallee();
+    auto *scratch = callee->GetScratchArena();
+    auto reserved = callee->GetArena()->GetReservedBytes();
+
+    PassManager::Run<DomTreeBuilder>(callee);
+    ASSERT_EQ(scratch->GetAllocatedBytes(), 0);
+    ASSERT_GT(scratch->GetReservedBytes(), 0);
+    // scratch chunks are taken from the graph's arena
+    ASSERT_GT(callee->GetArena()->GetReservedBytes(), reserved);
+
+    reserved = callee->GetArena()->GetReservedBytes();
+    PassManager::SetInvalid<AnalysisFlag::DOM_TREE>(callee);
+    PassManager::Run<DomTreeBuilder>(callee);
+    ASSERT_EQ(callee->GetArena()->GetReservedBytes(), reserved);
+    ASSERT_EQ(callee->GetFirstBasicBlock()->GetDominatedBlocks().size(), 1);
+}
+
+TEST_F(CompilerMemoryTest, TestMemoryLimit) {
+    compiler.GetOptions().SetGraphMemoryLimit(1);
+    auto *callee = BuildCallee();
+    ASSERT_TRUE(callee->IsMemoryLimitExceeded());
+
+    ASSERT_EQ(compiler.Optimize(callee), nullptr);
+    // the graph stays valid
+    VerifyControlAndDataFlowGraphs(callee);
+    ASSERT_EQ(compiler.GetFunction(callee->GetId()), callee);
+
+    compiler.GetOptions().SetGraphMemoryLimit(0);
+    auto *other = BuildCallee();
+    ASSERT_EQ(compiler.Optimize(other), other);
+}
+
+TEST_F(CompilerMemoryTest, TestDeleteReleasesMemory) {
+    auto *callee = BuildCallee();
+    auto *caller = BuildCaller(callee);
+    auto callerId = caller->GetId();
+    auto functionsCount = compiler.GetFunctionsCount();
+
+    auto before = compiler.GetFunctionMemoryUsage(callerId);
+    ASSERT_GT(before.allocatedBytes, 0);
+    ASSERT_GE(before.reservedBytes, before.allocatedBytes);
+    auto total = compiler.GetMemoryUsage();
+    ASSERT_GE(total.reservedBytes, before.reservedBytes);
+
+    ASSERT_EQ(compiler.Optimize(caller), caller);
+    // the callee's copy is registered as a function sharing the caller's arena
+    ASSERT_GT(compiler.GetFunctionsCount(), functionsCount);
+    auto copyId = compiler.GetFunctionsCount() - 1;
+    ASSERT_EQ(compiler.GetFunction(copyId)->GetArena(), caller->GetArena());
+    ASSERT_GT(compiler.GetFunctionMemoryUsage(callerId).allocatedBytes, before.allocatedBytes);
+
+    ASSERT_TRUE(compiler.DeleteFunctionGraph(callerId));
+    ASSERT_FALSE(compiler.DeleteFunctionGraph(callerId));
+    ASSERT_EQ(compiler.GetFunction(callerId), nullptr);
+    ASSERT_EQ(compiler.GetFunction(copyId), nullptr);
+    ASSERT_EQ(compiler.GetFunctionMemoryUsage(callerId).reservedBytes, 0);
+    ASSERT_LT(compiler.GetMemoryUsage().reservedBytes, total.reservedBytes);
+
+    // ids of the remaining functions are kept
+    ASSERT_EQ(compiler.GetFunction(callee->GetId()), callee);
+    ASSERT_GT(compiler.GetFunctionMemoryUsage(callee->GetId()).reservedBytes, 0);
+}
+}   // namespace ir::tests
@@ -145,4 +145,50 @@ TEST_F(BasicBlockTest, TestSplitAfterInstruction) {
     ASSERT_EQ(jcmp->GetPrevInstruction(), cmp);
     ASSERT_EQ(jcmp->GetNextInstruction(), nullptr);
 }
+
+TEST_F(BasicBlockTest, TestSplitAfterInstructionFixesPhi) {
+    // res = 0
+    // do {
+    //     callValue = foo(res)
+    //     res = callValue + 1
+    // } while (res < 10)
+    // return res
+    auto *instrBuilder = GetInstructionBuilder();
+    auto type = OperandType::I32;
+    auto *graph = GetGraph();
+
+    auto *firstBlock = graph->CreateEmptyBasicBlock();
+    graph->SetFirstBasicBlock(firstBlock);
+    auto *constZero = instrBuilder->CreateCONST(type, 0);
+    auto *constTen = instrBuilder->CreateCONST(type, 10);
+    instrBuilder->PushBackInstruction(firstBlock, constZero, constTen);
+
+    auto *loopBlock = graph->CreateEmptyBasicBlock();
+    graph->ConnectBasicBlocks(firstBlock, loopBlock);
+    auto *phi = instrBuilder->CreatePHI(type);
+    auto *call = instrBuilder->CreateCALL(type, INVALID_FUNCTION_ID, {phi});
+    auto *addi = instrBuilder->CreateADDI(type, call, 1);
+    auto *cmp = instrBuilder->CreateCMP(type, CondCode::LT, addi, constTen);
+    auto *jcmp = instrBuilder->CreateJCMP();
+    instrBuilder->PushBackInstruction(loopBlock, phi, call, addi, cmp, jcmp);
+    graph->ConnectBasicBlocks(loopBlock, loopBlock);
+    phi->AddPhiInput(constZero, firstBlock);
+    phi->AddPhiInput(addi, loopBlock);
+
+    auto *exitBlock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(loopBlock, exitBlock);
+    instrBuilder->PushBackInstruction(exitBlock, instrBuilder->CreateRET(type, addi));
+
+    auto *newBlock = loopBlock->SplitAfterInstruction(call, true);
+
+    ASSERT_EQ(loopBlock->GetSuccessors(), std::pmr::vector<BasicBlock *>{newBlock});
+    ASSERT_TRUE(loopBlock->HasPredecessor(newBlock));
+    ASSERT_TRUE(newBlock->HasPredecessor(loopBlock));
+    ASSERT_EQ(phi->GetBasicBlock(), loopBlock);
+    ASSERT_EQ(phi->GetInputsCount(), 2);
+    ASSERT_EQ(phi->GetSourceBasicBlock(phi->IndexOf(firstBlock)), firstBlock);
+    ASSERT_EQ(phi->ResolveInput(newBlock).GetInstruction(), addi);
+    ASSERT_EQ(phi->IndexOf(loopBlock), phi->GetInputsCount());
+    ASSERT_EQ(newBlock->GetSuccessorsCount(), 2);
+}
 }   // namespace ir::tests
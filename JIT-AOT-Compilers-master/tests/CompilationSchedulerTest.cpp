@@ -0,0 +1,125 @@
+#include <atomic>
+#include "CompilationScheduler.h"
+#include "CompilerTestBase.h"
+#include "TestFunctionSamples.h"
+#include "ThreadPool.h"
+
+
+namespace ir::tests {
+class CompilationSchedulerTest : public CompilerTestBase {
+public:
+    // Builds functions into the compiler in bottom-up order, leaves come first.
+    static std::vector<Graph *> BuildFunctions(Compiler &targetCompiler);
+
+    static size_t CountCalls(const Graph *g) {
+        size_t count = 0;
+        g->ForEachBasicBlock([&count](const BasicBlock *bblock) {
+            for (const auto *instr : *bblock) {
+                count += instr->IsCall();
+            }
+        });
+        return count;
+    }
+
+public:
+    static constexpr auto OPS_TYPE = OperandType::I32;
+    static constexpr size_t LEAVES_COUNT = 48;
+    static constexpr size_t CALLEES_PER_CALLER = 3;
+    static constexpr size_t THREADS_COUNT = 4;
+};
+
+std::vector<Graph *> CompilationSchedulerTest::BuildFunctions(Compiler &targetCompiler) {
+    std::vector<Graph *> functions;
+    for (size_t i = 0; i < LEAVES_COUNT; ++i) {
+        functions.push_back(BuildLeafFunction(targetCompiler, OPS_TYPE, i + 2).graph);
+    }
+    for (size_t i = 0; i + CALLEES_PER_CALLER <= LEAVES_COUNT; i += CALLEES_PER_CALLER) {
+        std::vector<Graph *> callees(functions.begin() + i, functions.begin() + i + CALLEES_PER_CALLER);
+        functions.push_back(BuildCallerFunction(targetCompiler, OPS_TYPE, callees));
+    }
+    // caller of callers
+    std::vector<Graph *> callers(functions.end() - CALLEES_PER_CALLER, functions.end());
+    functions.push_back(BuildCallerFunction(targetCompiler, OPS_TYPE, callers));
+    return functions;
+}
+
+TEST_F(CompilationSchedulerTest, TestMatchesSequentialCompilation) {
+    Compiler reference(codegen::DefaultArch::GetInstance());
+    auto referenceFunctions = BuildFunctions(reference);
+    for (auto *function : referenceFunctions) {
+        reference.Optimize(function);
+    }
+
+    auto functions = BuildFunctions(compiler);
+    ASSERT_EQ(functions.size(), referenceFunctions.size());
+    // callers come before callees in the batch, the scheduler must reorder them
+    std::vector<Graph *> batch(functions.rbegin(), functions.rend());
+    CompilationScheduler scheduler(&compiler, THREADS_COUNT);
+    ASSERT_EQ(scheduler.GetThreadsCount(), THREADS_COUNT);
+    ASSERT_TRUE(scheduler.Compile(batch));
+
+    for (size_t i = 0, end = functions.size(); i < end; ++i) {
+        VerifyControlAndDataFlowGraphs(functions[i]);
+        ASSERT_EQ(functions[i]->CountInstructions(), referenceFunctions[i]->CountInstructions());
+        ASSERT_EQ(CountCalls(functions[i]), CountCalls(referenceFunctions[i]));
+    }
+    // leaves are small enough to be inlined
+    ASSERT_LT(CountCalls(functions[LEAVES_COUNT]), CALLEES_PER_CALLER);
+}
+
+TEST_F(CompilationSchedulerTest, TestRecursiveFunctions) {
+    // int32 first(int32 a) {
+    //     return second(a) + first(a)
+    // }
+    // int32 second(int32 a) {
+    //     return first(a) + leaf(a)
+    // }
+    auto *leaf = BuildLeafFunction(compiler, OPS_TYPE, 3).graph;
+    auto *first = compiler.CreateNewGraph();
+    auto *second = compiler.CreateNewGraph();
+    auto buildBody = [](Graph *g, Graph *callee1, Graph *callee2) {
+        auto *instrBuilder = g->GetInstructionBuilder();
+        auto *arg = instrBuilder->CreateARG(OPS_TYPE);
+        auto *firstBlock = FillFirstBlock(g, arg);
+        auto *bblock = g->CreateEmptyBasicBlock(true);
+        g->ConnectBasicBlocks(firstBlock, bblock);
+        auto *call1 = instrBuilder->CreateCALL(OPS_TYPE, callee1->GetId(), {arg});
+        auto *call2 = instrBuilder->CreateCALL(OPS_TYPE, callee2->GetId(), {arg});
+        auto *add = instrBuilder->CreateADD(OPS_TYPE, call1, call2);
+        auto *ret = instrBuilder->CreateRET(OPS_TYPE, add);
+        instrBuilder->PushBackInstruction(bblock, call1, call2, add, ret);
+    };
+    buildBody(first, second, first);
+    buildBody(second, first, leaf);
+
+    CompilationScheduler scheduler(&compiler, THREADS_COUNT);
+    std::vector<Graph *> batch{first, second, leaf};
+    ASSERT_TRUE(scheduler.Compile(batch));
+
+    VerifyControlAndDataFlowGraphs(first);
+    VerifyControlAndDataFlowGraphs(second);
+    VerifyControlAndDataFlowGraphs(leaf);
+    // the leaf was compiled before its caller and then inlined
+    ASSERT_EQ(leaf->CountInstructions(), 4);
+    ASSERT_GT(CountCalls(first), 0);
+}
+
+TEST(ThreadPoolTest, TestNestedSubmits) {
+    constexpr size_t TASKS_COUNT = 256;
+    std::atomic<size_t> counter = 0;
+    utils::ThreadPool pool(CompilationSchedulerTest::THREADS_COUNT);
+    for (size_t i = 0; i < TASKS_COUNT; ++i) {
+        pool.Submit([&pool, &counter]() {
+            ++counter;
+            pool.Submit([&counter]() { ++counter; });
+        });
+    }
+    pool.Wait();
+    ASSERT_EQ(counter, 2 * TASKS_COUNT);
+
+    // the pool is reusable after waiting
+    pool.Submit([&counter]() { ++counter; });
+    pool.Wait();
+    ASSERT_EQ(counter, 2 * TASKS_COUNT + 1);
+}
+}   // namespace ir::tests
@@ -12,7 +12,8 @@
 namespace ir::tests {
 class CompilerTestBase : public ::testing::Test {
 public:
-    CompilerTestBase() : compiler(codegen::DefaultArch::GetInstance()) {}
+    explicit CompilerTestBase(codegen::ArchInfoBase *arch = codegen::DefaultArch::GetInstance())
+        : compiler(arch) {}
 
     void SetUp() override {
         graph = compiler.CreateNewGraph();
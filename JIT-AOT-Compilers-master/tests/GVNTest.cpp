@@ -0,0 +1,139 @@
+#include "CheckElimination.h"
+#include "DomTree.h"
+#include "GVN.h"
+#include "TestGraphSamples.h"
+
+
+namespace ir::tests {
+class GVNTest : public TestGraphSamples {
+public:
+    void RunPass(bool expectChanged) {
+        auto *graph = GetGraph();
+        PassManager::Run<DomTreeBuilder>(graph);
+        ASSERT_EQ(PassManager::Run<GVNPass>(graph), expectChanged);
+        // CFG is not changed
+        ASSERT_TRUE(graph->IsAnalysisValid(AnalysisFlag::DOM_TREE));
+        VerifyControlAndDataFlowGraphs(graph);
+    }
+
+public:
+    static constexpr auto OPS_TYPE = OperandType::I32;
+};
+
+TEST_F(GVNTest, TestDominatedDuplicates) {
+    /*
+       B0
+       |
+       B1
+      / \
+     /   \
+    B2   B3
+     \   /
+      \ /
+       B4
+       |
+       B5
+    */
+    auto [graph, bblocks] = BuildCase0();
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *arg0 = instrBuilder->CreateARG(OPS_TYPE);
+    auto *arg1 = instrBuilder->CreateARG(OPS_TYPE);
+    auto *constZero = instrBuilder->CreateCONST(OPS_TYPE, 0);
+    auto *constZeroCopy = instrBuilder->CreateCONST(OPS_TYPE, 0);
+    instrBuilder->PushBackInstruction(bblocks[0], arg0, arg1, constZero, constZeroCopy);
+
+    auto *add = instrBuilder->CreateADD(OPS_TYPE, arg0, arg1);
+    auto *sub = instrBuilder->CreateSUB(OPS_TYPE, arg0, arg1);
+    auto *cmp = instrBuilder->CreateCMP(OPS_TYPE, CondCode::EQ, add, constZeroCopy);
+    instrBuilder->PushBackInstruction(bblocks[1], add, sub, cmp, instrBuilder->CreateJCMP());
+
+    // operands of commutable instruction are swapped
+    auto *addDup = instrBuilder->CreateADD(OPS_TYPE, arg1, arg0);
+    auto *trueValue = instrBuilder->CreateMULI(OPS_TYPE, addDup, 3);
+    instrBuilder->PushBackInstruction(bblocks[2], addDup, trueValue);
+
+    auto *falseValue = instrBuilder->CreateMULI(OPS_TYPE, add, 3);
+    instrBuilder->PushBackInstruction(bblocks[3], falseValue);
+
+    // B3 does not dominate B4, the operands of SUB are swapped
+    auto *muliNotDup = instrBuilder->CreateMULI(OPS_TYPE, add, 3);
+    auto *subNotDup = instrBuilder->CreateSUB(OPS_TYPE, arg1, arg0);
+    auto *phi = instrBuilder->CreatePHI(OPS_TYPE, {trueValue, falseValue}, {bblocks[2], bblocks[3]});
+    auto *res = instrBuilder->CreateADD(OPS_TYPE, phi, muliNotDup);
+    auto *resDup = instrBuilder->CreateADD(OPS_TYPE, muliNotDup, phi);
+    auto *sum = instrBuilder->CreateADD(OPS_TYPE, res, resDup);
+    auto *final = instrBuilder->CreateSUB(OPS_TYPE, sum, subNotDup);
+    auto *ret = instrBuilder->CreateRET(OPS_TYPE, final);
+    instrBuilder->PushBackInstruction(bblocks[4], phi, muliNotDup, subNotDup, res, resDup, sum, final, ret);
+
+    RunPass(true);
+
+    compareInstructions({arg0, arg1, constZero}, bblocks[0]);
+    ASSERT_EQ(cmp->GetInput(1), constZero);
+    ASSERT_EQ(addDup->GetBasicBlock(), nullptr);
+    compareInstructions({trueValue}, bblocks[2]);
+    ASSERT_EQ(trueValue->GetInput(0), add);
+    ASSERT_EQ(resDup->GetBasicBlock(), nullptr);
+    ASSERT_EQ(sum->GetInput(0), res);
+    ASSERT_EQ(sum->GetInput(1), res);
+    compareInstructions({phi, muliNotDup, subNotDup, res, sum, final, ret}, bblocks[4]);
+
+    RunPass(false);
+}
+
+TEST_F(GVNTest, TestSideEffectsAreKept) {
+    auto [graph, bblocks] = BuildCase0();
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *arg = instrBuilder->CreateARG(OPS_TYPE);
+    auto *array = instrBuilder->CreateARG(OperandType::REF);
+    instrBuilder->PushBackInstruction(bblocks[0], arg, array);
+
+    auto *div = instrBuilder->CreateDIVI(OPS_TYPE, arg, 3);
+    auto *load = instrBuilder->CreateLOAD_ARRAY(OPS_TYPE, array, arg);
+    auto *call = instrBuilder->CreateCALL(OPS_TYPE, INVALID_FUNCTION_ID, {arg});
+    auto *len = instrBuilder->CreateLEN(array);
+    instrBuilder->PushBackInstruction(bblocks[1], div, load, call, len);
+
+    auto *divDup = instrBuilder->CreateDIVI(OPS_TYPE, arg, 3);
+    auto *store = instrBuilder->CreateSTORE_ARRAY(array, divDup, arg);
+    auto *loadDup = instrBuilder->CreateLOAD_ARRAY(OPS_TYPE, array, arg);
+    auto *callDup = instrBuilder->CreateCALL(OPS_TYPE, INVALID_FUNCTION_ID, {arg});
+    // length of an array never changes, even after stores into it
+    auto *lenDup = instrBuilder->CreateLEN(array);
+    auto *sum = instrBuilder->CreateADD(OPS_TYPE, loadDup, lenDup);
+    instrBuilder->PushBackInstruction(bblocks[2], divDup, store, loadDup, callDup, lenDup, sum);
+
+    RunPass(true);
+
+    compareInstructions({div, load, call, len}, bblocks[1]);
+    compareInstructions({divDup, store, loadDup, callDup, sum}, bblocks[2]);
+    ASSERT_EQ(sum->GetInput(1), len);
+}
+
+TEST_F(GVNTest, TestEnablesChecksElimination) {
+    // repeated address computations are numbered equally,
+    // so the second BOUNDS_CHECK becomes redundant
+    auto [graph, bblocks] = BuildCase0();
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *idx = instrBuilder->CreateARG(OPS_TYPE);
+    auto *array = instrBuilder->CreateARG(OperandType::REF);
+    instrBuilder->PushBackInstruction(bblocks[0], idx, array);
+
+    auto *addr = instrBuilder->CreateADDI(OPS_TYPE, idx, 1);
+    auto *check = instrBuilder->CreateBOUNDS_CHECK(array, addr);
+    auto *load = instrBuilder->CreateLOAD_ARRAY(OPS_TYPE, array, addr);
+    instrBuilder->PushBackInstruction(bblocks[1], addr, check, load);
+
+    auto *addrDup = instrBuilder->CreateADDI(OPS_TYPE, idx, 1);
+    auto *checkDup = instrBuilder->CreateBOUNDS_CHECK(array, addrDup);
+    auto *store = instrBuilder->CreateSTORE_ARRAY(array, load, addrDup);
+    instrBuilder->PushBackInstruction(bblocks[4], addrDup, checkDup, store);
+
+    ASSERT_FALSE(PassManager::Run<CheckElimination>(graph));
+    RunPass(true);
+    ASSERT_EQ(store->GetInput(2), addr);
+    ASSERT_TRUE(PassManager::Run<CheckElimination>(graph));
+
+    compareInstructions({store}, bblocks[4]);
+}
+}   // namespace ir::tests
@@ -0,0 +1,137 @@
+#include "CompilerTestBase.h"
+#include "DCE.h"
+#include "Inlining.h"
+#include "OptimizationPipeline.h"
+#include "Peephole.h"
+#include "TestFunctionSamples.h"
+
+
+namespace ir::tests {
+class OptimizationPipelineTest : public CompilerTestBase {
+public:
+    void SetUp() override {
+        CompilerTestBase::SetUp();
+        compiler.GetPassStatistics().Clear();
+    }
+
+    // (a - 0) must be replaced with a, the dead multiplication and constant zero must be cleared
+    void BuildGraph() {
+        leaf = BuildLeafFunction(compiler, OPS_TYPE, 2);
+    }
+
+    void VerifyOptimized() {
+        compareInstructions({leaf.mul, leaf.add, leaf.ret}, leaf.bblock);
+        compareInstructions({leaf.arg}, leaf.graph->GetFirstBasicBlock());
+        ASSERT_EQ(leaf.mul->GetInput(0), leaf.arg);
+        VerifyControlAndDataFlowGraphs(leaf.graph);
+    }
+
+public:
+    static constexpr auto OPS_TYPE = OperandType::I32;
+
+    LeafFunction leaf;
+};
+
+TEST_F(OptimizationPipelineTest, TestO0) {
+    compiler.GetOptions().SetOptLevel(OptLevel::O0);
+    BuildGraph();
+
+    ASSERT_EQ(compiler.Optimize(leaf.graph), leaf.graph);
+
+    compareInstructions({leaf.sub, leaf.mul, leaf.dead, leaf.add, leaf.ret}, leaf.bblock);
+    compareInstructions({leaf.arg, leaf.constZero}, leaf.graph->GetFirstBasicBlock());
+}
+
+TEST_F(OptimizationPipelineTest, TestO1) {
+    compiler.GetOptions().SetOptLevel(OptLevel::O1);
+    ASSERT_FALSE(compiler.GetOptions().GetEnableInlining());
+    BuildGraph();
+
+    compiler.Optimize(leaf.graph);
+
+    VerifyOptimized();
+}
+
+TEST_F(OptimizationPipelineTest, TestO2Statistics) {
+    auto &options = compiler.GetOptions();
+    options.SetOptLevel(OptLevel::O2);
+    options.SetCollectPassStatistics(true);
+    BuildGraph();
+
+    compiler.Optimize(leaf.graph);
+
+    VerifyOptimized();
+    ASSERT_EQ(leaf.graph->GetPassStatistics(), nullptr);
+
+    const auto &statistics = compiler.GetPassStatistics();
+    const auto *inlining = statistics.GetPassInfo(InliningPass(leaf.graph).GetName());
+    ASSERT_NE(inlining, nullptr);
+    ASSERT_EQ(inlining->runsCount, 1);
+    ASSERT_EQ(inlining->changesCount, 0);
+
+    // the second iteration finds nothing to optimize
+    const auto *peephole = statistics.GetPassInfo(PeepholePass(leaf.graph).GetName());
+    ASSERT_NE(peephole, nullptr);
+    ASSERT_EQ(peephole->runsCount, 2);
+    ASSERT_EQ(peephole->changesCount, 1);
+    ASSERT_EQ(peephole->instrsDelta, -1);
+
+    const auto *dce = statistics.GetPassInfo(DCEPass(leaf.graph).GetName());
+    ASSERT_NE(dce, nullptr);
+    ASSERT_EQ(dce->runsCount, 2);
+    ASSERT_EQ(dce->changesCount, 1);
+    ASSERT_EQ(dce->instrsDelta, -2);
+
+    const auto *pipeline = statistics.GetPassInfo(OptimizationPipeline(leaf.graph).GetName());
+    ASSERT_NE(pipeline, nullptr);
+    ASSERT_EQ(pipeline->runsCount, 1);
+    ASSERT_EQ(pipeline->instrsDelta, -3);
+    ASSERT_GE(pipeline->time, dce->time);
+}
+
+TEST_F(OptimizationPipelineTest, TestCleanupIterationsLimit) {
+    auto &options = compiler.GetOptions();
+    options.SetOptLevel(OptLevel::O2);
+    options.SetMaxCleanupIterations(1);
+    options.SetCollectPassStatistics(true);
+    BuildGraph();
+
+    compiler.Optimize(leaf.graph);
+
+    VerifyOptimized();
+    const auto *dce = compiler.GetPassStatistics().GetPassInfo(DCEPass(leaf.graph).GetName());
+    ASSERT_NE(dce, nullptr);
+    ASSERT_EQ(dce->runsCount, 1);
+}
+
+TEST_F(OptimizationPipelineTest, TestCompileTimeBudget) {
+    auto &options = compiler.GetOptions();
+    options.SetOptLevel(OptLevel::O2);
+    options.SetCompileTimeBudgetUs(1);
+    options.SetCollectPassStatistics(true);
+    BuildGraph();
+
+    compiler.Optimize(leaf.graph);
+
+    // w/o the budget cleanups run twice, the second run finds the fixed point;
+    // the budget is spent by inlining or the first cleanup iteration
+    const auto *peephole = compiler.GetPassStatistics().GetPassInfo(PeepholePass(leaf.graph).GetName());
+    ASSERT_TRUE(peephole == nullptr || peephole->runsCount < 2);
+    VerifyControlAndDataFlowGraphs(leaf.graph);
+    ASSERT_EQ(leaf.bblock->GetLastInstruction(), leaf.ret);
+}
+
+TEST_F(OptimizationPipelineTest, TestDisabledPass) {
+    auto &options = compiler.GetOptions();
+    options.SetOptLevel(OptLevel::O2);
+    options.SetEnableDCE(false);
+    options.SetCollectPassStatistics(true);
+    BuildGraph();
+
+    compiler.Optimize(leaf.graph);
+
+    compareInstructions({leaf.mul, leaf.dead, leaf.add, leaf.ret}, leaf.bblock);
+    ASSERT_EQ(leaf.mul->GetInput(0), leaf.arg);
+    ASSERT_EQ(compiler.GetPassStatistics().GetPassInfo(DCEPass(leaf.graph).GetName()), nullptr);
+}
+}   // namespace ir::tests
@@ -0,0 +1,82 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_TEST_FUNCTION_SAMPLES_H_
+#define JIT_AOT_COMPILERS_COURSE_TEST_FUNCTION_SAMPLES_H_
+
+#include "Compiler.h"
+#include "InstructionBuilder.h"
+#include <vector>
+
+
+// Functions built straight into a compiler, shared by tests and benchmarks,
+// so they must not depend on gtest.
+namespace ir::tests {
+// int leaf(int a) {
+//     v0 = (a - 0) * factor
+//     v1 = a * 7
+//     return v0 + a
+// }
+// `a - 0` is folded by peepholes, v1 and constant zero are removed by DCE.
+struct LeafFunction {
+    Graph *graph = nullptr;
+    InputArgumentInstruction *arg = nullptr;
+    ConstantInstruction *constZero = nullptr;
+    BasicBlock *bblock = nullptr;
+    InstructionBase *sub = nullptr;
+    BinaryImmInstruction *mul = nullptr;
+    InstructionBase *dead = nullptr;
+    InstructionBase *add = nullptr;
+    InstructionBase *ret = nullptr;
+};
+
+inline LeafFunction BuildLeafFunction(Compiler &compiler, OperandType type, uint64_t factor) {
+    LeafFunction leaf;
+    auto *g = compiler.CreateNewGraph();
+    auto *instrBuilder = g->GetInstructionBuilder();
+    leaf.graph = g;
+    leaf.arg = instrBuilder->CreateARG(type);
+    leaf.constZero = instrBuilder->CreateCONST(type, 0);
+    auto *firstBlock = g->CreateEmptyBasicBlock();
+    instrBuilder->PushBackInstruction(firstBlock, leaf.arg, leaf.constZero);
+    g->SetFirstBasicBlock(firstBlock);
+
+    leaf.bblock = g->CreateEmptyBasicBlock(true);
+    g->ConnectBasicBlocks(firstBlock, leaf.bblock);
+    leaf.sub = instrBuilder->CreateSUB(type, leaf.arg, leaf.constZero);
+    leaf.mul = instrBuilder->CreateMULI(type, leaf.sub, factor);
+    leaf.dead = instrBuilder->CreateMULI(type, leaf.arg, 7);
+    leaf.add = instrBuilder->CreateADD(type, leaf.mul, leaf.arg);
+    leaf.ret = instrBuilder->CreateRET(type, leaf.add);
+    instrBuilder->PushBackInstruction(leaf.bblock, leaf.sub, leaf.mul, leaf.dead, leaf.add, leaf.ret);
+    return leaf;
+}
+
+// int caller(int a) {
+//     return callee_0(a) + ... + callee_n(a)
+// }
+inline Graph *BuildCallerFunction(Compiler &compiler, OperandType type, const std::vector<Graph *> &callees) {
+    ASSERT(!callees.empty());
+    auto *g = compiler.CreateNewGraph();
+    auto *instrBuilder = g->GetInstructionBuilder();
+    auto *arg = instrBuilder->CreateARG(type);
+    auto *firstBlock = g->CreateEmptyBasicBlock();
+    instrBuilder->PushBackInstruction(firstBlock, arg);
+    g->SetFirstBasicBlock(firstBlock);
+
+    auto *bblock = g->CreateEmptyBasicBlock(true);
+    g->ConnectBasicBlocks(firstBlock, bblock);
+    InstructionBase *acc = nullptr;
+    for (auto *callee : callees) {
+        auto *call = instrBuilder->CreateCALL(type, callee->GetId(), {arg});
+        instrBuilder->PushBackInstruction(bblock, call);
+        if (acc == nullptr) {
+            acc = call;
+        } else {
+            acc = instrBuilder->CreateADD(type, acc, call);
+            instrBuilder->PushBackInstruction(bblock, acc);
+        }
+    }
+    instrBuilder->PushBackInstruction(bblock, instrBuilder->CreateRET(type, acc));
+    return g;
+}
+}   // namespace ir::tests
+
+#endif  // JIT_AOT_COMPILERS_COURSE_TEST_FUNCTION_SAMPLES_H_
@@ -0,0 +1,440 @@
+#ifdef __x86_64__
+
+#include "CompilerTestBase.h"
+#include <limits>
+#include "x86_64/X86_64CodeGen.h"
+
+
+namespace ir::codegen::tests {
+class X86_64CodeGenTest : public ir::tests::CompilerTestBase {
+public:
+    X86_64CodeGenTest() : ir::tests::CompilerTestBase(X86_64Arch::GetInstance()) {}
+
+    template <typename FunctionT>
+    FunctionT *Compile(Graph *target) {
+        EXPECT_TRUE(PassManager::Run<X86_64CodeGen>(target, &codeCache));
+        auto *func = codeCache.GetFunction<FunctionT>(target->GetId());
+        EXPECT_NE(func, nullptr);
+        return func;
+    }
+
+    // int64 sum(int64 n) {
+    //     int64 res = 0
+    //     for (int64 i = 1; i <= n; ++i) {
+    //         res += i
+    //     }
+    //     return res
+    // }
+    void BuildSumGraph(Graph *target);
+    // int64 fib(int64 n) {
+    //     return n < 2 ? n : fib(n - 1) + fib(n - 2)
+    // }
+    void BuildFibGraph(Graph *target);
+
+public:
+    static constexpr auto OPS_TYPE = OperandType::I64;
+
+    CodeCache codeCache;
+};
+
+void X86_64CodeGenTest::BuildSumGraph(Graph *target) {
+    auto *instrBuilder = GetInstructionBuilder(target);
+    auto *arg = instrBuilder->CreateARG(OPS_TYPE);
+    auto *constZero = instrBuilder->CreateCONST(OPS_TYPE, 0);
+    auto *constOne = instrBuilder->CreateCONST(OPS_TYPE, 1);
+    auto *firstBlock = FillFirstBlock(target, arg, constZero, constOne);
+
+    auto *loopHeader = target->CreateEmptyBasicBlock();
+    target->ConnectBasicBlocks(firstBlock, loopHeader);
+    auto *exitBlock = target->CreateEmptyBasicBlock(true);
+    target->ConnectBasicBlocks(loopHeader, exitBlock);
+    auto *loopBody = target->CreateEmptyBasicBlock();
+    target->ConnectBasicBlocks(loopHeader, loopBody);
+    target->ConnectBasicBlocks(loopBody, loopHeader);
+
+    auto *phiIdx = instrBuilder->CreatePHI(OPS_TYPE);
+    auto *phiRes = instrBuilder->CreatePHI(OPS_TYPE);
+    auto *cmp = instrBuilder->CreateCMP(OPS_TYPE, CondCode::GT, phiIdx, arg);
+    auto *jcmp = instrBuilder->CreateJCMP();
+    instrBuilder->PushBackInstruction(loopHeader, phiIdx, phiRes, cmp, jcmp);
+
+    auto *add = instrBuilder->CreateADD(OPS_TYPE, phiRes, phiIdx);
+    auto *inc = instrBuilder->CreateADDI(OPS_TYPE, phiIdx, 1);
+    auto *jmp = instrBuilder->CreateJMP();
+    instrBuilder->PushBackInstruction(loopBody, add, inc, jmp);
+
+    phiIdx->AddPhiInput(constOne, firstBlock);
+    phiIdx->AddPhiInput(inc, loopBody);
+    phiRes->AddPhiInput(constZero, firstBlock);
+    phiRes->AddPhiInput(add, loopBody);
+
+    auto *ret = instrBuilder->CreateRET(OPS_TYPE, phiRes);
+    instrBuilder->PushBackInstruction(exitBlock, ret);
+    VerifyControlAndDataFlowGraphs(target);
+}
+
+void X86_64CodeGenTest::BuildFibGraph(Graph *target) {
+    auto *instrBuilder = GetInstructionBuilder(target);
+    auto *arg = instrBuilder->CreateARG(OPS_TYPE);
+    auto *constTwo = instrBuilder->CreateCONST(OPS_TYPE, 2);
+    auto *firstBlock = FillFirstBlock(target, arg, constTwo);
+
+    auto *condBlock = target->CreateEmptyBasicBlock();
+    target->ConnectBasicBlocks(firstBlock, condBlock);
+    auto *cmp = instrBuilder->CreateCMP(OPS_TYPE, CondCode::LT, arg, constTwo);
+    auto *jcmp = instrBuilder->CreateJCMP();
+    instrBuilder->PushBackInstruction(condBlock, cmp, jcmp);
+
+    auto *trueBranch = target->CreateEmptyBasicBlock(true);
+    target->ConnectBasicBlocks(condBlock, trueBranch);
+    instrBuilder->PushBackInstruction(trueBranch, instrBuilder->CreateRET(OPS_TYPE, arg));
+
+    auto *falseBranch = target->CreateEmptyBasicBlock(true);
+    target->ConnectBasicBlocks(condBlock, falseBranch);
+    auto *sub1 = instrBuilder->CreateSUBI(OPS_TYPE, arg, 1);
+    auto *call1 = instrBuilder->CreateCALL(OPS_TYPE, target->GetId(), {sub1});
+    auto *sub2 = instrBuilder->CreateSUBI(OPS_TYPE, arg, 2);
+    auto *call2 = instrBuilder->CreateCALL(OPS_TYPE, target->GetId(), {sub2});
+    auto *add = instrBuilder->CreateADD(OPS_TYPE, call1, call2);
+    auto *ret = instrBuilder->CreateRET(OPS_TYPE, add);
+    instrBuilder->PushBackInstruction(falseBranch, sub1, call1, sub2, call2, add, ret);
+    VerifyControlAndDataFlowGraphs(target);
+}
+
+TEST_F(X86_64CodeGenTest, TestArithmetic) {
+    // return ((a + b) * (a - b)) ^ ((a & 7) | (b >> 2)) + a % b - b / 3
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *arg0 = instrBuilder->CreateARG(OPS_TYPE);
+    auto *arg1 = instrBuilder->CreateARG(OPS_TYPE);
+    auto *firstBlock = FillFirstBlock(graph, arg0, arg1);
+
+    auto *bblock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(firstBlock, bblock);
+    auto *add = instrBuilder->CreateADD(OPS_TYPE, arg0, arg1);
+    auto *sub = instrBuilder->CreateSUB(OPS_TYPE, arg0, arg1);
+    auto *mul = instrBuilder->CreateMUL(OPS_TYPE, add, sub);
+    auto *andi = instrBuilder->CreateANDI(OPS_TYPE, arg0, 7);
+    auto *srai = instrBuilder->CreateSRAI(OPS_TYPE, arg1, 2);
+    auto *orr = instrBuilder->CreateOR(OPS_TYPE, andi, srai);
+    auto *mod = instrBuilder->CreateMOD(OPS_TYPE, arg0, arg1);
+    auto *divi = instrBuilder->CreateDIVI(OPS_TYPE, arg1, 3);
+    auto *sum = instrBuilder->CreateADD(OPS_TYPE, orr, mod);
+    auto *diff = instrBuilder->CreateSUB(OPS_TYPE, sum, divi);
+    auto *xorr = instrBuilder->CreateXOR(OPS_TYPE, mul, diff);
+    auto *ret = instrBuilder->CreateRET(OPS_TYPE, xorr);
+    instrBuilder->PushBackInstruction(bblock, add, sub, mul, andi, srai, orr, mod, divi, sum, diff, xorr, ret);
+    VerifyControlAndDataFlowGraphs(graph);
+
+    auto *func = Compile<int64_t(int64_t, int64_t)>(graph);
+    ASSERT_NE(func, nullptr);
+    auto expected = [](int64_t a, int64_t b) {
+        // compute in uint64_t: machine code wraps on overflow, signed overflow is UB
+        auto ua = static_cast<uint64_t>(a);
+        auto ub = static_cast<uint64_t>(b);
+        auto mul = static_cast<int64_t>((ua + ub) * (ua - ub));
+        return mul ^ (((a & 7) | (b >> 2)) + a % b - b / 3);
+    };
+    for (auto [a, b] : std::vector<std::pair<int64_t, int64_t>>{{7, 3}, {-100, 7}, {1LL << 40, -13}, {5, 5}}) {
+        ASSERT_EQ(func(a, b), expected(a, b)) << a << ' ' << b;
+    }
+}
+
+TEST_F(X86_64CodeGenTest, TestSignedDivisionOverflow) {
+    // int64 test(int64 a, int64 b) { return a op b }, op is one of /, %, / -1, % -1;
+    // INT64_MIN / -1 wraps like the other arithmetic instead of trapping
+    auto *instrBuilder = GetInstructionBuilder();
+    auto build = [this, instrBuilder](Opcode opcode) {
+        auto *target = compiler.CreateNewGraph();
+        auto *arg0 = instrBuilder->CreateARG(OPS_TYPE);
+        auto *arg1 = instrBuilder->CreateARG(OPS_TYPE);
+        auto *firstBlock = FillFirstBlock(target, arg0, arg1);
+        auto *bblock = target->CreateEmptyBasicBlock(true);
+        target->ConnectBasicBlocks(firstBlock, bblock);
+        InputsInstruction *op = nullptr;
+        switch (opcode) {
+        case Opcode::DIV:
+            op = instrBuilder->CreateDIV(OPS_TYPE, arg0, arg1);
+            break;
+        case Opcode::MOD:
+            op = instrBuilder->CreateMOD(OPS_TYPE, arg0, arg1);
+            break;
+        case Opcode::DIVI:
+            op = instrBuilder->CreateDIVI(OPS_TYPE, arg0, int64_t{-1});
+            break;
+        default:
+            op = instrBuilder->CreateMODI(OPS_TYPE, arg0, int64_t{-1});
+        }
+        auto *ret = instrBuilder->CreateRET(OPS_TYPE, op);
+        instrBuilder->PushBackInstruction(bblock, op, ret);
+        VerifyControlAndDataFlowGraphs(target);
+        return Compile<int64_t(int64_t, int64_t)>(target);
+    };
+    auto *div = build(Opcode::DIV);
+    auto *mod = build(Opcode::MOD);
+    auto *divMinusOne = build(Opcode::DIVI);
+    auto *modMinusOne = build(Opcode::MODI);
+    ASSERT_NE(div, nullptr);
+    ASSERT_NE(mod, nullptr);
+    ASSERT_NE(divMinusOne, nullptr);
+    ASSERT_NE(modMinusOne, nullptr);
+
+    constexpr auto MIN = std::numeric_limits<int64_t>::min();
+    ASSERT_EQ(div(MIN, -1), MIN);
+    ASSERT_EQ(mod(MIN, -1), 0);
+    ASSERT_EQ(divMinusOne(MIN, 0), MIN);
+    ASSERT_EQ(modMinusOne(MIN, 0), 0);
+    ASSERT_EQ(div(7, -1), -7);
+    ASSERT_EQ(mod(7, -1), 0);
+    ASSERT_EQ(divMinusOne(7, 0), -7);
+    ASSERT_EQ(div(-7, 2), -3);
+    ASSERT_EQ(mod(-7, 2), -1);
+    ASSERT_EQ(div(MIN, 1), MIN);
+}
+
+TEST_F(X86_64CodeGenTest, TestLoop) {
+    BuildSumGraph(graph);
+
+    auto *func = Compile<int64_t(int64_t)>(graph);
+    ASSERT_NE(func, nullptr);
+    ASSERT_EQ(func(0), 0);
+    ASSERT_EQ(func(1), 1);
+    ASSERT_EQ(func(100), 5050);
+}
+
+TEST_F(X86_64CodeGenTest, TestRecursiveCall) {
+    BuildFibGraph(graph);
+
+    auto *func = Compile<int64_t(int64_t)>(graph);
+    ASSERT_NE(func, nullptr);
+    ASSERT_EQ(func(1), 1);
+    ASSERT_EQ(func(10), 55);
+    ASSERT_EQ(func(20), 6765);
+}
+
+TEST_F(X86_64CodeGenTest, TestCallBetweenFunctions) {
+    // int64 caller(int64 n) {
+    //     return fib(n) * sum(n) + n
+    // }
+    auto *fibGraph = compiler.CreateNewGraph();
+    BuildFibGraph(fibGraph);
+    auto *sumGraph = compiler.CreateNewGraph();
+    BuildSumGraph(sumGraph);
+
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *arg = instrBuilder->CreateARG(OPS_TYPE);
+    auto *firstBlock = FillFirstBlock(graph, arg);
+    auto *bblock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(firstBlock, bblock);
+    auto *callFib = instrBuilder->CreateCALL(OPS_TYPE, fibGraph->GetId(), {arg});
+    auto *callSum = instrBuilder->CreateCALL(OPS_TYPE, sumGraph->GetId(), {arg});
+    auto *mul = instrBuilder->CreateMUL(OPS_TYPE, callFib, callSum);
+    auto *add = instrBuilder->CreateADD(OPS_TYPE, mul, arg);
+    auto *ret = instrBuilder->CreateRET(OPS_TYPE, add);
+    instrBuilder->PushBackInstruction(bblock, callFib, callSum, mul, add, ret);
+    VerifyControlAndDataFlowGraphs(graph);
+
+    // callees are resolved at runtime, so they may be compiled after the caller
+    auto *func = Compile<int64_t(int64_t)>(graph);
+    ASSERT_NE(func, nullptr);
+    ASSERT_NE(Compile<int64_t(int64_t)>(fibGraph), nullptr);
+    ASSERT_NE(Compile<int64_t(int64_t)>(sumGraph), nullptr);
+    ASSERT_EQ(func(10), 55 * 55 + 10);
+}
+
+TEST_F(X86_64CodeGenTest, TestUnknownCallee) {
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *arg = instrBuilder->CreateARG(OPS_TYPE);
+    auto *firstBlock = FillFirstBlock(graph, arg);
+    auto *bblock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(firstBlock, bblock);
+    auto *call = instrBuilder->CreateCALL(OPS_TYPE, graph->GetId() + 1, {arg});
+    auto *ret = instrBuilder->CreateRET(OPS_TYPE, call);
+    instrBuilder->PushBackInstruction(bblock, call, ret);
+
+    ASSERT_FALSE(PassManager::Run<X86_64CodeGen>(graph, &codeCache));
+    ASSERT_EQ(codeCache.GetEntry(graph->GetId()), nullptr);
+}
+
+TEST_F(X86_64CodeGenTest, TestStackArgumentsAndSpills) {
+    // int64 callee(int64 a0, ..., int64 a7) {
+    //     t_i = a_i * a_{(i + 1) % 8}, all alive simultaneously with the arguments
+    //     return sum(t_i - a_i)
+    // }
+    // int64 caller(int64 a0, ..., int64 a7) {
+    //     return callee(a7, a6, ..., a0) + a0
+    // }
+    constexpr size_t ARGS_COUNT = 8;
+    auto *callee = compiler.CreateNewGraph();
+    auto *instrBuilder = GetInstructionBuilder(callee);
+    std::vector<InstructionBase *> args;
+    for (size_t i = 0; i < ARGS_COUNT; ++i) {
+        args.push_back(instrBuilder->CreateARG(OPS_TYPE));
+    }
+    auto *firstBlock = FillFirstBlock(callee, std::vector<InstructionBase *>(args));
+    auto *bblock = callee->CreateEmptyBasicBlock(true);
+    callee->ConnectBasicBlocks(firstBlock, bblock);
+    std::vector<InstructionBase *> products;
+    for (size_t i = 0; i < ARGS_COUNT; ++i) {
+        auto *mul = instrBuilder->CreateMUL(OPS_TYPE, args[i], args[(i + 1) % ARGS_COUNT]);
+        instrBuilder->PushBackInstruction(bblock, mul);
+        products.push_back(mul);
+    }
+    InstructionBase *acc = nullptr;
+    for (size_t i = 0; i < ARGS_COUNT; ++i) {
+        auto *sub = instrBuilder->CreateSUB(OPS_TYPE, products[i], args[i]);
+        instrBuilder->PushBackInstruction(bblock, sub);
+        if (acc == nullptr) {
+            acc = sub;
+        } else {
+            acc = instrBuilder->CreateADD(OPS_TYPE, acc, sub);
+            instrBuilder->PushBackInstruction(bblock, acc);
+        }
+    }
+    instrBuilder->PushBackInstruction(bblock, instrBuilder->CreateRET(OPS_TYPE, acc));
+    VerifyControlAndDataFlowGraphs(callee);
+
+    instrBuilder = GetInstructionBuilder();
+    std::vector<InstructionBase *> callerArgs;
+    for (size_t i = 0; i < ARGS_COUNT; ++i) {
+        callerArgs.push_back(instrBuilder->CreateARG(OPS_TYPE));
+    }
+    firstBlock = FillFirstBlock(graph, std::vector<InstructionBase *>(callerArgs));
+    bblock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(firstBlock, bblock);
+    std::vector<InstructionBase *> reversedArgs(callerArgs.rbegin(), callerArgs.rend());
+    auto *call = instrBuilder->CreateCALL(OPS_TYPE, callee->GetId(), reversedArgs);
+    auto *add = instrBuilder->CreateADD(OPS_TYPE, call, callerArgs[0]);
+    auto *ret = instrBuilder->CreateRET(OPS_TYPE, add);
+    instrBuilder->PushBackInstruction(bblock, call, add, ret);
+    VerifyControlAndDataFlowGraphs(graph);
+
+    using FunctionType = int64_t(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t);
+    auto *calleeFunc = Compile<FunctionType>(callee);
+    auto *callerFunc = Compile<FunctionType>(graph);
+    ASSERT_NE(calleeFunc, nullptr);
+    ASSERT_NE(callerFunc, nullptr);
+
+    std::array<int64_t, ARGS_COUNT> values{3, -5, 7, 11, -13, 17, 19, -23};
+    auto expected = [](const std::array<int64_t, ARGS_COUNT> &a) {
+        int64_t res = 0;
+        for (size_t i = 0; i < ARGS_COUNT; ++i) {
+            res += a[i] * a[(i + 1) % ARGS_COUNT] - a[i];
+        }
+        return res;
+    };
+    auto reversed = values;
+    std::reverse(reversed.begin(), reversed.end());
+    ASSERT_EQ(std::apply(calleeFunc, values), expected(values));
+    ASSERT_EQ(std::apply(callerFunc, values), expected(reversed) + values[0]);
+}
+
+TEST_F(X86_64CodeGenTest, TestArrays) {
+    // int32 test(int64 idx, int32 value) {
+    //     int32[] arr = new int32[4]
+    //     arr[0] = value
+    //     arr[idx] = value * 2
+    //     return arr[0] + arr[idx] + len(arr)
+    // }
+    auto type = OperandType::I32;
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *idx = instrBuilder->CreateARG(OPS_TYPE);
+    auto *value = instrBuilder->CreateARG(type);
+    auto *firstBlock = FillFirstBlock(graph, idx, value);
+
+    auto *bblock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(firstBlock, bblock);
+    auto *arr = instrBuilder->CreateNEW_ARRAY_IMM(4, MAGIC_TYPE_ID);
+    auto *store0 = instrBuilder->CreateSTORE_ARRAY_IMM(arr, value, 0);
+    auto *doubled = instrBuilder->CreateMULI(type, value, 2);
+    auto *check = instrBuilder->CreateBOUNDS_CHECK(arr, idx);
+    auto *store1 = instrBuilder->CreateSTORE_ARRAY(arr, doubled, idx);
+    auto *load0 = instrBuilder->CreateLOAD_ARRAY_IMM(type, arr, 0);
+    auto *load1 = instrBuilder->CreateLOAD_ARRAY(type, arr, idx);
+    auto *len = instrBuilder->CreateLEN(arr);
+    auto *lenCast = instrBuilder->CreateCAST(len->GetType(), type, len);
+    auto *add0 = instrBuilder->CreateADD(type, load0, load1);
+    auto *add1 = instrBuilder->CreateADD(type, add0, lenCast);
+    auto *ret = instrBuilder->CreateRET(type, add1);
+    instrBuilder->PushBackInstruction(
+        bblock, arr, store0, doubled, check, store1, load0, load1, len, lenCast, add0, add1, ret);
+    VerifyControlAndDataFlowGraphs(graph);
+
+    auto *func = Compile<int32_t(int64_t, int32_t)>(graph);
+    ASSERT_NE(func, nullptr);
+    ASSERT_EQ(func(0, -3), -12 + 4);
+    ASSERT_EQ(func(3, 5), 5 + 10 + 4);
+    ASSERT_DEATH(func(4, 1), "");
+    ASSERT_DEATH(func(-1, 1), "");
+}
+
+TEST_F(X86_64CodeGenTest, TestOversizedArray) {
+    // uint64 test(int64 length) {
+    //     int64[] arr = new int64[length]
+    //     return len(arr)
+    // }
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *length = instrBuilder->CreateARG(OPS_TYPE);
+    auto *firstBlock = FillFirstBlock(graph, length);
+
+    auto *bblock = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(firstBlock, bblock);
+    auto *check = instrBuilder->CreateNEGATIVE_CHECK(length);
+    auto *arr = instrBuilder->CreateNEW_ARRAY(length, MAGIC_TYPE_ID);
+    auto *len = instrBuilder->CreateLEN(arr);
+    auto *ret = instrBuilder->CreateRET(len->GetType(), len);
+    instrBuilder->PushBackInstruction(bblock, check, arr, len, ret);
+    VerifyControlAndDataFlowGraphs(graph);
+
+    auto *func = Compile<uint64_t(int64_t)>(graph);
+    ASSERT_NE(func, nullptr);
+    ASSERT_EQ(func(3), 3U);
+    // length * element size wraps around and must not produce a tiny block
+    ASSERT_DEATH(func(int64_t{1} << 62), "");
+    ASSERT_DEATH(func(std::numeric_limits<int64_t>::max()), "");
+}
+
+TEST_F(X86_64CodeGenTest, TestCastsAndUnsigned) {
+    // uint64 test(int64 a, uint64 b) {
+    //     int64 narrowed = (int64)(int8)a
+    //     uint64 quotient = (uint64)(uint32)b / 3
+    //     return max(narrowed, quotient)  // compared as unsigned
+    // }
+    auto *instrBuilder = GetInstructionBuilder();
+    auto *arg0 = instrBuilder->CreateARG(OperandType::I64);
+    auto *arg1 = instrBuilder->CreateARG(OperandType::U64);
+    auto *firstBlock = FillFirstBlock(graph, arg0, arg1);
+
+    auto *bblock = graph->CreateEmptyBasicBlock();
+    graph->ConnectBasicBlocks(firstBlock, bblock);
+    auto *toI8 = instrBuilder->CreateCAST(OperandType::I64, OperandType::I8, arg0);
+    auto *fromI8 = instrBuilder->CreateCAST(OperandType::I8, OperandType::U64, toI8);
+    auto *toU32 = instrBuilder->CreateCAST(OperandType::U64, OperandType::U32, arg1);
+    auto *fromU32 = instrBuilder->CreateCAST(OperandType::U32, OperandType::U64, toU32);
+    auto *div = instrBuilder->CreateDIVI(OperandType::U64, fromU32, 3);
+    auto *cmp = instrBuilder->CreateCMP(OperandType::U64, CondCode::GE, fromI8, div);
+    auto *jcmp = instrBuilder->CreateJCMP();
+    instrBuilder->PushBackInstruction(bblock, toI8, fromI8, toU32, fromU32, div, cmp, jcmp);
+
+    auto *trueBranch = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(bblock, trueBranch);
+    instrBuilder->PushBackInstruction(trueBranch, instrBuilder->CreateRET(OperandType::U64, fromI8));
+    auto *falseBranch = graph->CreateEmptyBasicBlock(true);
+    graph->ConnectBasicBlocks(bblock, falseBranch);
+    instrBuilder->PushBackInstruction(falseBranch, instrBuilder->CreateRET(OperandType::U64, div));
+    VerifyControlAndDataFlowGraphs(graph);
+
+    auto *func = Compile<uint64_t(int64_t, uint64_t)>(graph);
+    ASSERT_NE(func, nullptr);
+    auto expected = [](int64_t a, uint64_t b) {
+        auto narrowed = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(a)));
+        auto quotient = static_cast<uint64_t>(static_cast<uint32_t>(b)) / 3;
+        return std::max(narrowed, quotient);
+    };
+    for (auto [a, b] : std::vector<std::pair<int64_t, uint64_t>>{
+            {0x17F, 0xFFFFFFFF00000300}, {0x101, 0x300}, {-1, 5}, {3, UINT64_MAX}}) {
+        ASSERT_EQ(func(a, b), expected(a, b)) << a << ' ' << b;
+    }
+}
+}   // namespace ir::codegen::tests
+
+#endif  // __x86_64__
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include "Arena.h"
+#include <memory>
+
+
+namespace utils {
+Arena::Arena(size_t limit, std::pmr::memory_resource *upstream)
+    : upstream(upstream), limit(limit)
+{
+    ASSERT(upstream);
+}
+
+Arena::~Arena() noexcept {
+    Release();
+}
+
+void Arena::Rewind(const Mark &mark) {
+    ASSERT(mark.allocatedBytes <= allocatedBytes);
+    current = mark.chunk;
+    offset = mark.offset;
+    allocatedBytes = mark.allocatedBytes;
+}
+
+void Arena::Release() {
+    for (auto *chunk = head; chunk != nullptr;) {
+        auto *next = chunk->next;
+        upstream->deallocate(chunk, HEADER_SIZE + chunk->size, alignof(std::max_align_t));
+        chunk = next;
+    }
+    head = nullptr;
+    tail = nullptr;
+    current = nullptr;
+    offset = 0;
+    allocatedBytes = 0;
+    reservedBytes = 0;
+    nextChunkSize = INITIAL_CHUNK_SIZE;
+}
+
+void *Arena::do_allocate(size_t bytes, size_t alignment) {
+    auto *ptr = tryAllocate(bytes, alignment);
+    if (ptr == nullptr) {
+        appendChunk(bytes + alignment);
+        ptr = tryAllocate(bytes, alignment);
+        ASSERT(ptr);
+    }
+    allocatedBytes += bytes;
+    return ptr;
+}
+
+// Allocates from the current chunk or from the following ones, which are left after rewinding.
+void *Arena::tryAllocate(size_t bytes, size_t alignment) {
+    if (current == nullptr) {
+        if (head == nullptr) {
+            return nullptr;
+        }
+        current = head;
+        offset = 0;
+    }
+    while (true) {
+        void *ptr = current->GetData() + offset;
+        auto space = current->size - offset;
+        if (std::align(alignment, bytes, ptr, space)) {
+            offset = static_cast<std::byte *>(ptr) + bytes - current->GetData();
+            return ptr;
+        }
+        if (current->next == nullptr) {
+            return nullptr;
+        }
+        current = current->next;
+        offset = 0;
+    }
+}
+
+void Arena::appendChunk(size_t minSize) {
+    auto size = std::max(nextChunkSize, minSize);
+    nextChunkSize = std::min(nextChunkSize * 2, MAX_CHUNK_SIZE);
+
+    auto *chunk = static_cast<Chunk *>(upstream->allocate(HEADER_SIZE + size, alignof(std::max_align_t)));
+    chunk->next = nullptr;
+    chunk->size = size;
+    if (tail == nullptr) {
+        head = chunk;
+    } else {
+        tail->next = chunk;
+    }
+    tail = chunk;
+    reservedBytes += HEADER_SIZE + size;
+    // chunks after the current one are all full, so allocation continues from the new chunk
+    current = chunk;
+    offset = 0;
+}
+}   // namespace utils
@@ -0,0 +1,124 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_ARENA_H_
+#define JIT_AOT_COMPILERS_COURSE_ARENA_H_
+
+#include <cstddef>
+#include "macros.h"
+#include <memory_resource>
+
+
+namespace utils {
+// Bump-pointer memory resource taking chunks from the upstream resource.
+// Deallocations are no-ops: memory is reclaimed either by rewinding to a mark,
+// which keeps chunks for reuse, or by releasing the whole arena.
+//
+// The limit is soft: allocations over it succeed, but mark the arena as exhausted,
+// so that its owner can fail gracefully at a safe point instead of throwing.
+// Not thread-safe.
+class Arena final : public std::pmr::memory_resource {
+    struct Chunk;
+
+public:
+    // Position in the arena to rewind to.
+    class Mark {
+    private:
+        Mark(Chunk *chunk, size_t offset, size_t allocatedBytes)
+            : chunk(chunk), offset(offset), allocatedBytes(allocatedBytes) {}
+
+    private:
+        Chunk *chunk;
+        size_t offset;
+        size_t allocatedBytes;
+
+        friend class Arena;
+    };
+
+    // Rewinds the arena to the position it had on the scope's creation.
+    class Scope final {
+    public:
+        explicit Scope(Arena *arena) : arena(arena), mark(arena->GetMark()) {}
+        NO_COPY_SEMANTIC(Scope);
+        NO_MOVE_SEMANTIC(Scope);
+        ~Scope() noexcept {
+            arena->Rewind(mark);
+        }
+
+    private:
+        Arena *arena;
+        Mark mark;
+    };
+
+    // Zero limit means unlimited arena.
+    explicit Arena(size_t limit = 0, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+    NO_COPY_SEMANTIC(Arena);
+    NO_MOVE_SEMANTIC(Arena);
+    ~Arena() noexcept override;
+
+    // Bytes handed out and not rewound yet.
+    size_t GetAllocatedBytes() const {
+        return allocatedBytes;
+    }
+    // Bytes taken from the upstream resource.
+    size_t GetReservedBytes() const {
+        return reservedBytes;
+    }
+    size_t GetLimit() const {
+        return limit;
+    }
+    bool IsLimitExceeded() const {
+        return limit != 0 && reservedBytes > limit;
+    }
+
+    Mark GetMark() const {
+        return Mark(current, offset, allocatedBytes);
+    }
+    // Frees everything allocated after the mark was taken.
+    void Rewind(const Mark &mark);
+    // Returns all chunks to the upstream resource.
+    void Release();
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate([[maybe_unused]] void *ptr,
+                       [[maybe_unused]] size_t bytes,
+                       [[maybe_unused]] size_t alignment) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    void *tryAllocate(size_t bytes, size_t alignment);
+    void appendChunk(size_t minSize);
+
+private:
+    // chunk's header is placed at the beginning of its memory
+    struct Chunk {
+        Chunk *next;
+        // size of the usable memory following the header
+        size_t size;
+
+        std::byte *GetData() {
+            return reinterpret_cast<std::byte *>(this) + HEADER_SIZE;
+        }
+    };
+
+    static constexpr size_t HEADER_SIZE =
+        (sizeof(Chunk) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    static constexpr size_t INITIAL_CHUNK_SIZE = 4096;
+    static constexpr size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+private:
+    std::pmr::memory_resource *upstream;
+    size_t limit;
+
+    Chunk *head = nullptr;
+    Chunk *tail = nullptr;
+    // chunk to allocate from, nullptr until the first allocation
+    Chunk *current = nullptr;
+    size_t offset = 0;
+
+    size_t allocatedBytes = 0;
+    size_t reservedBytes = 0;
+    size_t nextChunkSize = INITIAL_CHUNK_SIZE;
+};
+}   // namespace utils
+
+#endif  // JIT_AOT_COMPILERS_COURSE_ARENA_H_
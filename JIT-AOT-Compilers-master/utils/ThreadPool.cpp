@@ -0,0 +1,64 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+
+namespace utils {
+ThreadPool::ThreadPool(size_t threadsCount) {
+    if (threadsCount == 0) {
+        threadsCount = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    workers.reserve(threadsCount);
+    for (size_t i = 0; i < threadsCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    {
+        std::lock_guard guard(lock);
+        stopped = true;
+    }
+    tasksCondition.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(Task task) {
+    ASSERT(task);
+    {
+        std::lock_guard guard(lock);
+        ASSERT(!stopped);
+        tasks.push_back(std::move(task));
+    }
+    tasksCondition.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock guard(lock);
+    idleCondition.wait(guard, [this]() { return tasks.empty() && runningCount == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock guard(lock);
+    while (true) {
+        tasksCondition.wait(guard, [this]() { return stopped || !tasks.empty(); });
+        if (tasks.empty()) {
+            ASSERT(stopped);
+            return;
+        }
+        auto task = std::move(tasks.front());
+        tasks.pop_front();
+        ++runningCount;
+
+        guard.unlock();
+        task();
+        guard.lock();
+
+        --runningCount;
+        if (tasks.empty() && runningCount == 0) {
+            idleCondition.notify_all();
+        }
+    }
+}
+}   // namespace utils
@@ -0,0 +1,50 @@
+#ifndef JIT_AOT_COMPILERS_COURSE_THREAD_POOL_H_
+#define JIT_AOT_COMPILERS_COURSE_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include "macros.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace utils {
+// Fixed-size pool of worker threads executing submitted tasks in FIFO order.
+class ThreadPool final {
+public:
+    using Task = std::function<void()>;
+
+    // Zero threads count means the number of hardware threads.
+    explicit ThreadPool(size_t threadsCount = 0);
+    NO_COPY_SEMANTIC(ThreadPool);
+    NO_MOVE_SEMANTIC(ThreadPool);
+    ~ThreadPool() noexcept;
+
+    size_t GetThreadsCount() const {
+        return workers.size();
+    }
+
+    // Tasks may be submitted from other tasks.
+    void Submit(Task task);
+
+    // Blocks until all submitted tasks, including the ones submitted by running tasks, are finished.
+    void Wait();
+
+private:
+    void workerLoop();
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex lock;
+    std::condition_variable tasksCondition;
+    std::condition_variable idleCondition;
+    std::deque<Task> tasks;
+    size_t runningCount = 0;
+    bool stopped = false;
+};
+}   // namespace utils
+
+#endif  // JIT_AOT_COMPILERS_COURSE_THREAD_POOL_H_
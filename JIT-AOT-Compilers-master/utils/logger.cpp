@@ -3,4 +3,5 @@
 
 namespace utils {
 std::unique_ptr<log4cpp::OstreamAppender> Logger::stdoutAppender = nullptr;
+std::mutex Logger::initLock;
 }   // namespace utils
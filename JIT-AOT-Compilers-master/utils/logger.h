@@ -5,6 +5,7 @@
 #include <log4cpp/OstreamAppender.hh>
 #include "macros.h"
 #include <memory>
+#include <mutex>
 
 
 namespace utils {
@@ -43,8 +44,8 @@ public:
     static constexpr const char *STDERR_APPENDER_NAME = "stderr";
 
 protected:
+    // Must be called with initLock held.
     static log4cpp::Appender &GetStdOutAppender() {
-        // TODO: properly init global appender
         if UNLIKELY(stdoutAppender == nullptr) {
             stdoutAppender = std::make_unique<log4cpp::OstreamAppender>(
                 STDOUT_APPENDER_NAME, &std::cout);
@@ -54,6 +55,8 @@ protected:
     }
 
     virtual void initLogger() const {
+        // loggers may be created concurrently by passes running on different threads
+        std::lock_guard guard(initLock);
         if (logger.getAllAppenders().empty()) {
             logger.addAppender(GetStdOutAppender());
         }
@@ -61,6 +64,7 @@ protected:
 
 private:
     static std::unique_ptr<log4cpp::OstreamAppender> stdoutAppender;
+    static std::mutex initLock;
 
     log4cpp::Category &logger;
 };
@@ -0,0 +1,76 @@
+#ifndef __BENCH_BENCH_HH__
+#define __BENCH_BENCH_HH__
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "executor/executor.hh"
+#include "frontend/frontend.hh"
+#include "leechfile/verifier.hh"
+
+namespace leech::bench {
+
+/* Output of PRINT is dropped while it is alive */
+class MuteStdout final {
+  std::ostringstream sink_{};
+  std::streambuf *old_ = nullptr;
+
+public:
+  MuteStdout() : old_(std::cout.rdbuf(sink_.rdbuf())) {}
+  ~MuteStdout() { std::cout.rdbuf(old_); }
+
+  MuteStdout(const MuteStdout &) = delete;
+  MuteStdout &operator=(const MuteStdout &) = delete;
+  MuteStdout(MuteStdout &&) = delete;
+  MuteStdout &operator=(MuteStdout &&) = delete;
+};
+
+/* Parse and verify file as leechVM loads it */
+inline std::shared_ptr<LeechFile> parse(std::istream &ist) {
+  yy::Driver driver(ist, std::cerr);
+  if (!driver.parse())
+    throw std::runtime_error("Parsing of benchmark source failed");
+  auto pfile = driver.getLeechFile();
+  verify(*pfile);
+  return pfile;
+}
+
+inline std::shared_ptr<LeechFile> parseSource(const std::string &src) {
+  std::istringstream ist(src);
+  return parse(ist);
+}
+
+inline std::shared_ptr<LeechFile> parseFile(const std::string &path) {
+  std::ifstream ist(path);
+  if (!ist.is_open())
+    throw std::runtime_error("Cannot open " + path);
+  return parse(ist);
+}
+
+inline std::string readFile(const std::string &path) {
+  std::ifstream ist(path);
+  std::ostringstream res;
+  res << ist.rdbuf();
+  return res.str();
+}
+
+/* Interpreter alone, w/o JIT */
+inline ExecOptions interpOptions(DispatchMode mode) {
+  ExecOptions opts{mode};
+  opts.jitThreshold = 0;
+  return opts;
+}
+
+inline void run(LeechFile *pfile, const ExecOptions &opts) {
+  MuteStdout mute{};
+  Executor exec(pfile, opts);
+  exec.execute();
+}
+
+} // namespace leech::bench
+
+#endif // __BENCH_BENCH_HH__
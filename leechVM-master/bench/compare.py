@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Compare Google Benchmark JSON output of leech_bench with a baseline.
+
+Benchmarks whose time grew by more than the threshold are reported as
+regressions and make the script exit with non-zero status.
+"""
+
+import argparse
+import json
+import sys
+
+TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    """Map of benchmark name to its time in ns.
+
+    Median of repetitions is taken when the run has aggregates.
+    """
+    with open(path) as file:
+        runs = json.load(file)["benchmarks"]
+
+    medians = [run for run in runs if run.get("aggregate_name") == "median"]
+    if medians:
+        runs = medians
+    else:
+        runs = [run for run in runs if run.get("run_type") == "iteration"]
+
+    return {
+        run.get("run_name", run["name"]): run[metric] * TO_NS[run["time_unit"]]
+        for run in runs
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("baseline", help="stored JSON output")
+    parser.add_argument("current", help="JSON output of the run to check")
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=0.1,
+        help="relative slowdown treated as regression (default: 0.1)",
+    )
+    parser.add_argument(
+        "--metric", choices=["real_time", "cpu_time"], default="cpu_time"
+    )
+    args = parser.parse_args()
+
+    try:
+        baseline = load(args.baseline, args.metric)
+    except FileNotFoundError:
+        sys.exit(f"No baseline at {args.baseline}, store one first")
+    current = load(args.current, args.metric)
+
+    regressions = []
+    width = max(map(len, current), default=0)
+    print(
+        f"{'Benchmark':<{width}} {'Baseline':>14} {'Current':>14} "
+        f"{'Change':>8}"
+    )
+    for name, time in current.items():
+        if name not in baseline:
+            print(f"{name:<{width}} {'-':>14} {time:>12.0f}ns {'new':>8}")
+            continue
+        change = time / baseline[name] - 1
+        mark = ""
+        if change > args.threshold:
+            mark = "  REGRESSION"
+            regressions.append(name)
+        print(
+            f"{name:<{width}} {baseline[name]:>12.0f}ns {time:>12.0f}ns "
+            f"{change:>+8.1%}{mark}"
+        )
+
+    for name in sorted(baseline.keys() - current.keys()):
+        print(f"{name}: missing in current run")
+
+    if regressions:
+        print(
+            f"{len(regressions)} benchmark(s) slower than baseline by more "
+            f"than {args.threshold:.0%}"
+        )
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+
+#include "bench.hh"
+#include "config.hh"
+
+#define PATH(test) TESTS_DIR test
+
+using namespace leech;
+using namespace leech::bench;
+
+namespace {
+/* Whole programs of test/frontend, each run includes executor setup */
+void BM_Program(benchmark::State &state, const char *path,
+                const ExecOptions &opts) {
+  auto pfile = parseFile(path);
+  for (auto _ : state)
+    run(pfile.get(), opts);
+}
+
+BENCHMARK_CAPTURE(BM_Program, fib_rec_threaded, PATH("fib_rec.leech"),
+                  interpOptions(DispatchMode::Threaded))
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Program, fib_rec_register, PATH("fib_rec.leech"),
+                  interpOptions(DispatchMode::Register))
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Program, fib_rec_jit, PATH("fib_rec.leech"),
+                  ExecOptions{})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Program, average, PATH("average.leech"),
+                  interpOptions(DispatchMode::Threaded));
+BENCHMARK_CAPTURE(BM_Program, methods, PATH("methods.leech"),
+                  interpOptions(DispatchMode::Threaded));
+BENCHMARK_CAPTURE(BM_Program, shapes, PATH("shapes.leech"),
+                  interpOptions(DispatchMode::Threaded));
+} // namespace
@@ -0,0 +1,201 @@
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench.hh"
+#include "config.hh"
+
+#define PATH(test) TESTS_DIR test
+
+using namespace leech;
+using namespace leech::bench;
+
+namespace {
+/* Iterations of loop in each run of micro benchmark program */
+constexpr std::int64_t kLoopIters = 1 << 14;
+
+/**
+ * Loop of main runs body kLoopIters times. Body starts and ends w/ empty
+ * data stack, it may use name 0 (counter) and constants 0, 1
+ */
+std::string makeLoop(const std::string &body, const std::string &cpool = "",
+                     const std::string &names = "",
+                     const std::string &prologue = "",
+                     const std::string &funcs = "") {
+  return R"(
+.func main 0
+    .cpool
+        0: 0
+        1: 1
+        2: )" + std::to_string(kLoopIters) +
+         "\n" + cpool + R"(
+    .names
+        0: i
+)" + names + R"(
+    .code
+        LOAD_CONST 0
+        STORE_FAST 0
+        POP_TOP
+)" + prologue + R"(
+    .label loop
+)" + body + R"(
+        LOAD_FAST 0
+        LOAD_CONST 1
+        BINARY_ADD
+        STORE_FAST 0
+        LOAD_CONST 2
+        COMPARE_OP 0
+        POP_JUMP_IF_TRUE : loop
+        LOAD_CONST 0
+        RETURN_VALUE
+)" + funcs;
+}
+
+/* Nothing but loads and pops besides the loop itself */
+const auto kDispatch = makeLoop(R"(
+        LOAD_FAST 0
+        POP_TOP
+        LOAD_FAST 0
+        POP_TOP
+        LOAD_FAST 0
+        POP_TOP
+        LOAD_FAST 0
+        POP_TOP
+)");
+
+const auto kArith = makeLoop(R"(
+        LOAD_FAST 1
+        LOAD_FAST 0
+        BINARY_ADD
+        LOAD_CONST 1
+        BINARY_SUBTRACT
+        STORE_FAST 1
+        POP_TOP
+)",
+                             "", "        1: sum\n", R"(
+        LOAD_CONST 0
+        STORE_FAST 1
+        POP_TOP
+)");
+
+const auto kCall = makeLoop(R"(
+        LOAD_FAST 0
+        CALL_FUNCTION 1
+        POP_TOP
+)",
+                            "", "        1: id\n", "", R"(
+.func id 1
+    .cpool
+        0: 0
+    .names
+        0: x
+    .code
+        LOAD_FAST 0
+        RETURN_VALUE
+)");
+
+/* Read and write of attribute of instance */
+const auto kAttr = makeLoop(R"(
+        LOAD_FAST 2
+        LOAD_ATTR 3
+        POP_TOP
+        LOAD_CONST 1
+        STORE_ATTR 3
+        POP_TOP
+)",
+                            "",
+                            "        1: Foo\n"
+                            "        2: obj\n"
+                            "        3: a\n",
+                            R"(
+        LOAD_BUILD_CLASS
+        LOAD_CONST 0
+        STORE_ATTR 3
+        STORE_BUILD_CLASS 1
+        INSTANCE_CLASS 1
+        STORE_FAST 2
+        POP_TOP
+)");
+
+const auto kSubscr = makeLoop(R"(
+        LOAD_FAST 1
+        LOAD_CONST 4
+        BINARY_SUBSCR
+        POP_TOP
+)",
+                              "        3: (1, 2, 3, 4, 5, 6, 7, 8)\n"
+                              "        4: 5\n",
+                              "        1: tuple\n", R"(
+        LOAD_CONST 3
+        STORE_FAST 1
+        POP_TOP
+)");
+
+void BM_Loop(benchmark::State &state, const std::string &src,
+             DispatchMode mode) {
+  auto pfile = parseSource(src);
+  auto opts = interpOptions(mode);
+  for (auto _ : state)
+    run(pfile.get(), opts);
+  state.SetItemsProcessed(state.iterations() * kLoopIters);
+}
+
+#define BENCH_LOOP(name, src)                                                  \
+  BENCHMARK_CAPTURE(BM_Loop, name##_threaded, src, DispatchMode::Threaded);    \
+  BENCHMARK_CAPTURE(BM_Loop, name##_callback, src, DispatchMode::Callback);    \
+  BENCHMARK_CAPTURE(BM_Loop, name##_register, src, DispatchMode::Register)
+
+BENCH_LOOP(dispatch, kDispatch);
+BENCH_LOOP(arith, kArith);
+BENCH_LOOP(call, kCall);
+BENCH_LOOP(attr, kAttr);
+BENCH_LOOP(subscr, kSubscr);
+
+#undef BENCH_LOOP
+
+const std::array kSources{PATH("fib.leech"),     PATH("fib_rec.leech"),
+                          PATH("average.leech"), PATH("classWorking.leech"),
+                          PATH("methods.leech"), PATH("shapes.leech")};
+
+void BM_Parse(benchmark::State &state) {
+  std::vector<std::string> texts{};
+  std::int64_t bytes = 0;
+  for (const auto *path : kSources) {
+    texts.push_back(readFile(path));
+    bytes += static_cast<std::int64_t>(texts.back().size());
+  }
+
+  for (auto _ : state)
+    for (const auto &text : texts) {
+      std::istringstream ist(text);
+      yy::Driver driver(ist, std::cerr);
+      benchmark::DoNotOptimize(driver.parse());
+    }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_Parse);
+
+void BM_Deserialize(benchmark::State &state) {
+  std::vector<std::string> images{};
+  std::int64_t bytes = 0;
+  for (const auto *path : kSources) {
+    std::ostringstream ost;
+    parseFile(path)->serialize(ost);
+    images.push_back(ost.str());
+    bytes += static_cast<std::int64_t>(images.back().size());
+  }
+
+  for (auto _ : state)
+    for (const auto &image : images) {
+      std::istringstream ist(image);
+      auto file = LeechFile::deserialize(ist);
+      benchmark::DoNotOptimize(file.code.data());
+    }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_Deserialize);
+} // namespace
@@ -1,6 +1,7 @@
 #ifndef __INCLUDE_COMMON_COMMON_HH__
 #define __INCLUDE_COMMON_COMMON_HH__
 
+#include <array>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -18,7 +19,10 @@ enum class ValueType : std::uint8_t {
   String,
   Tuple,
   Class,
-  None
+  None,
+  /* Runtime only, never serialized */
+  Slice,
+  Iterator
 };
 
 enum class CmpOp : std::uint8_t {
@@ -93,13 +97,15 @@ constexpr std::size_t kInstSize =
 
 struct State;
 
-class Instruction final : public ISerializable {
-  using Callback = void (*)(const Instruction &, State &);
+/**
+ * Plain 2-byte record, so code can be used in place right from a mapped file
+ */
+class Instruction final {
+  using Callback = void (*)(const Instruction &, ArgType, State &);
   Opcodes opcode_{};
   ArgType arg_{};
-  Callback callback{};
 
-  static const std::unordered_map<Opcodes, Callback> opcToCallback;
+  static const std::array<Callback, kOpcodesNum> opcToCallback;
 
 public:
   explicit Instruction(Opcodes opcode, ArgType arg = 0)
@@ -108,10 +114,7 @@ public:
       throw std::invalid_argument(
           "Trying to create Instruction with UNKNOWN opcode");
 
-    if (auto callback_it = opcToCallback.find(opcode_);
-        callback_it != opcToCallback.end())
-      callback = callback_it->second;
-    else
+    if (!isValid())
       throw std::runtime_error{
           "Unknown inst opcode: " +
           std::to_string(static_cast<unsigned>(toUnderlying(opcode_)))};
@@ -122,7 +125,7 @@ public:
 
   Instruction() = default;
 
-  void serialize(std::ostream &ost) const override {
+  void serialize(std::ostream &ost) const {
     serializeNum(ost, toUnderlying(opcode_));
     serializeNum(ost, arg_);
   }
@@ -131,7 +134,15 @@ public:
   [[nodiscard]] auto getArg() const { return arg_; }
   void setArg(ArgType arg) { arg_ = arg; }
 
-  void execute(State &state) const { callback(*this, state); }
+  /* Check opcode of instruction got w/o constructor */
+  [[nodiscard]] bool isValid() const {
+    return Opcodes::UNKNOWN != opcode_ &&
+           toUnderlying(opcode_) < kOpcodesNum;
+  }
+
+  void execute(State &state) const {
+    opcToCallback[toUnderlying(opcode_)](*this, arg_, state);
+  }
 
   static auto deserialize(std::istream &ist) {
     auto opcodeVal = deserializeNum<std::underlying_type_t<Opcodes>>(ist);
@@ -141,6 +152,9 @@ public:
   }
 };
 
+static_assert(std::is_trivially_copyable_v<Instruction> &&
+              sizeof(Instruction) == kInstSize && alignof(Instruction) == 1);
+
 } // namespace leech
 
 #endif // __INCLUDE_COMMON_COMMON_HH__
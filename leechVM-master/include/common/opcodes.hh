@@ -1,7 +1,10 @@
 #ifndef __INCLUDE_COMMON_OPCODES_HH__
 #define __INCLUDE_COMMON_OPCODES_HH__
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <unordered_map>
 
@@ -15,14 +18,102 @@ enum class Opcodes : std::uint8_t {
 #undef LEECH_MAKE_OPCODE
 };
 
+/* Number of opcodes incl. UNKNOWN */
+constexpr std::size_t kOpcodesNum = 1
+#define LEECH_MAKE_OPCODE(opc) +1
+#include "opcodes.ii"
+#undef LEECH_MAKE_OPCODE
+    ;
+
+namespace detail {
+using enum Opcodes;
+#define LEECH_MAKE_OPCODE(opc)
+#define LEECH_MAKE_FUSED_OPCODE(opc, ...)                                      \
+  inline constexpr Opcodes kFused_##opc[] = {__VA_ARGS__};
+#include "opcodes.ii"
+#undef LEECH_MAKE_FUSED_OPCODE
+#undef LEECH_MAKE_OPCODE
+} // namespace detail
+
+/* Sequence superinstruction stands for, empty for regular opcodes */
+constexpr std::span<const Opcodes> getFusedSequence(Opcodes opcode) {
+  switch (opcode) {
+#define LEECH_MAKE_OPCODE(opc)
+#define LEECH_MAKE_FUSED_OPCODE(opc, ...)                                      \
+  case Opcodes::opc:                                                           \
+    return detail::kFused_##opc;
+#include "opcodes.ii"
+#undef LEECH_MAKE_FUSED_OPCODE
+#undef LEECH_MAKE_OPCODE
+  default:
+    return {};
+  }
+}
+
+constexpr bool isFused(Opcodes opcode) {
+  return !getFusedSequence(opcode).empty();
+}
+
+/* Generic opcode quickened one stands for, UNKNOWN for the rest */
+constexpr Opcodes getQuickGeneric(Opcodes opcode) {
+  switch (opcode) {
+#define LEECH_MAKE_OPCODE(opc)
+#define LEECH_MAKE_QUICK_OPCODE(opc, generic)                                  \
+  case Opcodes::opc:                                                           \
+    return Opcodes::generic;
+#include "opcodes.ii"
+#undef LEECH_MAKE_QUICK_OPCODE
+#undef LEECH_MAKE_OPCODE
+  default:
+    return Opcodes::UNKNOWN;
+  }
+}
+
+constexpr bool isQuickened(Opcodes opcode) {
+  return getQuickGeneric(opcode) != Opcodes::UNKNOWN;
+}
+
+/* Whether generic opcode has quickened forms */
+constexpr bool isQuickenable(Opcodes opcode) {
+#define LEECH_MAKE_OPCODE(opc)
+#define LEECH_MAKE_QUICK_OPCODE(opc, generic)                                  \
+  if (opcode == Opcodes::generic)                                              \
+    return true;
+#include "opcodes.ii"
+#undef LEECH_MAKE_QUICK_OPCODE
+#undef LEECH_MAKE_OPCODE
+  return false;
+}
+
+/* Opcode of the source instruction code entry started as: generic form of
+ * quickened opcode, the first one of superinstruction's sequence */
+constexpr Opcodes getOrigOpcode(Opcodes opcode) {
+  if (isFused(opcode))
+    return getFusedSequence(opcode).front();
+  if (isQuickened(opcode))
+    return getQuickGeneric(opcode);
+  return opcode;
+}
+
+/* Number of code entries instruction w/ opcode covers */
+constexpr std::size_t getInstLength(Opcodes opcode) {
+  return isFused(opcode) ? getFusedSequence(opcode).size() : 1;
+}
+
 class OpcodeConv final {
 private:
   static const auto &getStrToOpcodeMap() {
+    /* Superinstructions and quickened opcodes are internal,
+     * so they can't be parsed */
     static std::unordered_map<std::string_view, Opcodes> toOpcodeMap{
 #define LEECH_MAKE_OPCODE(opc) {#opc, Opcodes::opc},
+#define LEECH_MAKE_FUSED_OPCODE(opc, ...)
+#define LEECH_MAKE_QUICK_OPCODE(opc, generic)
 
 #include "opcodes.ii"
 
+#undef LEECH_MAKE_QUICK_OPCODE
+#undef LEECH_MAKE_FUSED_OPCODE
 #undef LEECH_MAKE_OPCODE
     };
     return toOpcodeMap;
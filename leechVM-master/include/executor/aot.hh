@@ -0,0 +1,228 @@
+#ifndef __INCLUDE_EXECUTOR_AOT_HH__
+#define __INCLUDE_EXECUTOR_AOT_HH__
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "executor/executor.hh"
+
+/**
+ * Ahead-of-time compilation: each function of a file is translated to C++
+ * function operating on State, which is compiled to shared object by host
+ * compiler. Generated code calls back into runtime of the executable (rt
+ * below and callbacks of generic instructions), so the executable loading
+ * module has to export its symbols (-rdynamic)
+ */
+namespace leech::aot {
+
+/**
+ * Native code of function: runs the current frame, which has to be just
+ * pushed for the function, until it returns. State is left as RETURN_VALUE
+ * leaves it: frame is popped, result is pushed to caller, nextPC is set
+ */
+using NativeFunc = void (*)(State &state);
+
+/* Functions jumping out of their code have no native code (null func) */
+struct ModuleEntry final {
+  /* Names may hold any bytes, NUL included */
+  const char *name = nullptr;
+  std::size_t nameSize = 0;
+  NativeFunc func = nullptr;
+};
+
+/* Exported by shared object as kModuleSymbol */
+struct ModuleInfo final {
+  std::uint32_t version = 0;
+  /* hashFile() of the file module was built for */
+  std::uint64_t fileHash = 0;
+  std::size_t funcNum = 0;
+  const ModuleEntry *funcs = nullptr;
+};
+
+constexpr std::uint32_t kModuleVersion = 2;
+constexpr const char *kModuleSymbol = "leech_aot_module";
+/* Native calls nest at most this deep, deeper ones are interpreted */
+constexpr std::size_t kMaxNativeDepth = 1U << 12U;
+
+/**
+ * Hash of functions, constants and code of file w/o superinstructions and
+ * quickened opcodes, so it stays the same while file is being run
+ */
+std::uint64_t hashFile(const LeechFile &file);
+
+/* C++ source of module w/ native code of file functions */
+std::string translate(const LeechFile &file);
+
+struct BuildOptions final {
+  /* Empty one stands for the compiler leech was built with */
+  std::string compiler{};
+  /* Compiler and flags are split on whitespace and run w/o shell */
+  std::string flags = "-O2";
+  /* Keep generated source next to shared object as <out>.cc */
+  bool keepSource = false;
+};
+
+/* Translate file and compile it to shared object out */
+void build(const LeechFile &file, const std::filesystem::path &out,
+           const BuildOptions &opts = {});
+
+/* Shared object loaded for the file it was built for */
+class Module final {
+public:
+  struct Func final {
+    const FuncMeta *meta = nullptr;
+    NativeFunc func = nullptr;
+  };
+
+private:
+  void *handle_ = nullptr;
+  /* Indexed as module entries */
+  std::vector<Func> funcs_{};
+  std::unordered_map<const FuncMeta *, NativeFunc> byMeta_{};
+
+public:
+  /* Throws if module was built for another file */
+  Module(const std::filesystem::path &path, const LeechFile &file);
+  ~Module();
+
+  Module(const Module &) = delete;
+  Module &operator=(const Module &) = delete;
+  Module(Module &&) = delete;
+  Module &operator=(Module &&) = delete;
+
+  /* Native code of function, null if it has none */
+  [[nodiscard]] NativeFunc find(const FuncMeta *meta) const {
+    auto found = byMeta_.find(meta);
+    return found == byMeta_.end() ? nullptr : found->second;
+  }
+
+  [[nodiscard]] const Func &getFunc(std::size_t idx) const {
+    return funcs_[idx];
+  }
+  /* Number of functions w/ native code */
+  [[nodiscard]] std::size_t size() const { return byMeta_.size(); }
+};
+
+/**
+ * Run the frame just pushed natively if module of state has code for it
+ * and native calls don't nest too deep. Returns whether it was run
+ */
+bool enter(State &state);
+
+/* Runtime used by generated code */
+namespace rt {
+/* Interpret the current frame from pc until it returns */
+void interpret(State &state, std::uint64_t pc);
+
+/**
+ * Generic instruction at pc run by its callback. Frame it pushes (calls)
+ * is run until it returns. It must not jump
+ */
+void exec(State &state, std::uint64_t pc, Opcodes opcode, ArgType arg);
+
+/* CALL_FUNCTION at pc of function idx of the module */
+void call(State &state, std::uint64_t pc, std::size_t idx);
+
+void ret(State &state);
+
+/**
+ * The current frame of native function. Data stack accesses are checked
+ * as the interpreter does, locals are addressed by resolved slots
+ */
+class Frame final {
+  State &state_;
+  ValueStack &stack_;
+  const FuncMeta *meta_ = nullptr;
+  std::size_t base_ = 0;
+  std::size_t stackBase_ = 0;
+
+public:
+  explicit Frame(State &state)
+      : state_(state), stack_(state.valueStack),
+        meta_(state.getCurFrame().getMeta()),
+        base_(state.getCurFrame().getBase()),
+        stackBase_(base_ + meta_->slotsNum) {}
+
+  [[nodiscard]] std::size_t size() const { return stack_.size() - stackBase_; }
+
+  [[nodiscard]] Value &top() {
+    if (size() == 0)
+      throw std::runtime_error("Trying to top from empty stack!");
+    return stack_.back();
+  }
+
+  void push(const Value &val) { stack_.push_back(val); }
+  void drop() {
+    static_cast<void>(top());
+    stack_.pop_back();
+  }
+
+  void load(std::size_t slot) {
+    const auto &val = stack_[base_ + slot];
+    if (!val.isBound())
+      throw std::invalid_argument(
+          "Trying to push unbound value into stackframe");
+    stack_.push_back(val);
+  }
+  void store(std::size_t slot) { stack_[base_ + slot] = top(); }
+  void loadConst(ArgType idx) { push(Value(meta_->getConst(idx))); }
+
+  /* Both operands of binary instruction are integers */
+  [[nodiscard]] bool isInts() const {
+    return size() >= 2 &&
+           stack_.back().getType() == ValueType::Integer &&
+           stack_[stack_.size() - 2].getType() == ValueType::Integer;
+  }
+  [[nodiscard]] Integer lhs() const {
+    return stack_[stack_.size() - 2].getInt();
+  }
+  [[nodiscard]] Integer rhs() const { return stack_.back().getInt(); }
+  /* Replace operands w/ result */
+  void setResult(const Value &val) {
+    stack_.pop_back();
+    stack_.back() = val;
+  }
+  void dropOperands() { stack_.resize(stack_.size() - 2); }
+
+  [[nodiscard]] bool isFalse() {
+    const auto &val = top();
+    if (val.getType() == ValueType::Integer)
+      return val.getInt() == 0;
+    return val.compare(Value(Integer{0}), CmpOp::EQ);
+  }
+  [[nodiscard]] bool popFalse() {
+    auto res = isFalse();
+    stack_.pop_back();
+    return res;
+  }
+
+  /* Push the next element, false w/ iterator popped if there is none */
+  [[nodiscard]] bool forIter() {
+    auto &iter = top();
+    if (iter.getType() != ValueType::Iterator)
+      throw std::invalid_argument("FOR_ITER w/o iterator on stack");
+    Value val{};
+    if (static_cast<IterObj *>(iter.getObj())->next(val)) {
+      stack_.push_back(val);
+      return true;
+    }
+    stack_.pop_back();
+    return false;
+  }
+
+  void exec(std::uint64_t pc, Opcodes opcode, ArgType arg) {
+    rt::exec(state_, pc, opcode, arg);
+  }
+  void call(std::uint64_t pc, std::size_t idx) { rt::call(state_, pc, idx); }
+  void ret() { rt::ret(state_); }
+  /* Running off function code goes on w/ the code after it */
+  void fallThrough(std::uint64_t pc) { rt::interpret(state_, pc); }
+};
+} // namespace rt
+
+} // namespace leech::aot
+
+#endif // __INCLUDE_EXECUTOR_AOT_HH__
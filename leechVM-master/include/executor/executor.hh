@@ -1,120 +1,371 @@
 #ifndef __INCLUDE_EXECUTOR_EXECUTOR_HH__
 #define __INCLUDE_EXECUTOR_EXECUTOR_HH__
 
+#include <array>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <span>
 #include <stack>
 #include <string_view>
+#include <vector>
 
+#include "executor/jit.hh"
+#include "executor/ngram.hh"
+#include "executor/profiler.hh"
+#include "gc/gc.hh"
 #include "leechfile/leechfile.hh"
+#include "leechfile/regcode.hh"
 
 namespace leech {
 
+namespace aot {
+class Module;
+} // namespace aot
+
 constexpr std::string_view kMainFuncName = "main";
 
+/* Contiguous storage for locals and data stacks of all frames */
+using ValueStack = std::vector<Value>;
+
+constexpr std::size_t kDefaultMaxCallDepth = 1U << 16U;
+constexpr std::size_t kInitValueStackSize = 1U << 12U;
+
+struct CallStackOverflow : public std::runtime_error {
+  explicit CallStackOverflow(std::size_t maxDepth)
+      : std::runtime_error("Call stack overflow: max call depth " +
+                           std::to_string(maxDepth) + " exceeded") {}
+};
+
+/**
+ * Window of the value stack: local slots start from base,
+ * frame's data stack starts right after them
+ */
 class StackFrame final {
   const FuncMeta *pmeta_ = nullptr;
-  std::stack<pLeechObj> dataStack_{};
+  ValueStack *pstack_ = nullptr;
+  gc::Heap *pheap_ = nullptr;
+  std::size_t base_{};
+  std::size_t stackBase_{};
   // TODO: Store pc in frame
   std::uint64_t retAddr_ = {};
-  std::unordered_map<std::string, pLeechObj> vars_{};
+  /* Verified function's data stack never underflows and its indices are
+   * in range, so they are not checked */
+  bool checked_ = true;
+
+  [[nodiscard]] Value &local(std::size_t nameIdx) const {
+    auto slot = checked_ ? pmeta_->slots.at(nameIdx) : pmeta_->slots[nameIdx];
+    return (*pstack_)[base_ + slot];
+  }
 
 public:
-  explicit StackFrame(const FuncMeta *pmeta);
+  StackFrame(const FuncMeta *pmeta, ValueStack *pstack, gc::Heap *pheap,
+             std::size_t base);
 
   StackFrame(const StackFrame &) = delete;
   StackFrame &operator=(const StackFrame &) = delete;
   StackFrame(StackFrame &&) = default;
   StackFrame &operator=(StackFrame &&) = default;
 
-  template <class T, typename... Args> void emplace(Args &&...args) {
-    dataStack_.emplace(new T(std::forward<Args>(args)...));
-  }
-
   [[nodiscard]] auto getRet() const { return retAddr_; }
   template <class T> void setRet(T val) { retAddr_ = val; }
 
-  template <class InpIt> void fillArgs(InpIt beg, InpIt end) {
-    for (auto &name : pmeta_->names) {
-      if (beg == end)
-        break;
-      setVar(name, *beg++);
-    }
-  }
+  [[nodiscard]] auto getBase() const { return base_; }
+  [[nodiscard]] auto getMeta() const { return pmeta_; }
 
-  void setVar(std::string_view name, pLeechObj obj) {
-    setVar(std::string(name), obj);
-  }
+  [[nodiscard]] auto stackSize() const { return pstack_->size() - stackBase_; }
+
+  void setVar(ArgType idx, const Value &val) { local(idx) = val; }
 
-  [[nodiscard]] auto stackSize() const { return dataStack_.size(); }
+  [[nodiscard]] const Value &getVar(ArgType idx) const { return local(idx); }
 
-  void setVar(const std::string &name, pLeechObj obj) { vars_.at(name) = obj; }
+  void push(const Value &val);
 
-  [[nodiscard]] auto getVar(const std::string &name) const {
-    return vars_.at(name);
+  [[nodiscard]] Value getConst(ArgType idx) const {
+    return Value(pmeta_->getConst(idx));
   }
 
-  [[nodiscard]] auto getVar(std::string_view name) const {
-    return getVar(std::string(name));
+  [[nodiscard]] std::string_view getName(ArgType idx) const {
+    return checked_ ? pmeta_->names.at(idx) : pmeta_->names[idx];
   }
 
-  void push(pLeechObj obj);
+  [[nodiscard]] const Value &top() const {
+    if (checked_ && !stackSize())
+      throw std::runtime_error("Trying to top from empty stack!");
+    return pstack_->back();
+  }
 
-  [[nodiscard]] auto getConst(ArgType idx) const {
-    return pmeta_->cstPool.at(idx);
+  /* Value depth entries below the top of data stack */
+  [[nodiscard]] const Value &peek(std::size_t depth) const {
+    if (checked_ && depth >= stackSize())
+      throw std::runtime_error("Trying to peek below stack bottom!");
+    return (*pstack_)[pstack_->size() - 1 - depth];
   }
 
-  [[nodiscard]] std::string_view getName(ArgType idx) const {
-    return pmeta_->names.at(idx);
+  /* Top num entries of data stack, the deepest one first */
+  [[nodiscard]] std::span<const Value> peekTop(std::size_t num) const {
+    if (checked_ && num > stackSize())
+      throw std::runtime_error("Trying to peek below stack bottom!");
+    return {pstack_->data() + pstack_->size() - num, num};
   }
 
-  [[nodiscard]] auto top() const {
-    if (!dataStack_.size())
-      throw std::runtime_error("Trying to top from empty stack!");
-    return dataStack_.top();
+  /* Pop w/ value semantics: class objects are cloned */
+  [[nodiscard]] Value popGetTos() {
+    auto tos = pheap_->clone(top());
+    pop();
+    return tos;
   }
 
-  [[nodiscard]] auto popGetTos() {
-    auto tos = top()->clone();
+  /* Pop for immediate use, the value must not be stored anywhere */
+  [[nodiscard]] Value popTos() {
+    auto tos = top();
     pop();
     return tos;
   }
 
   void pop() {
-    if (!dataStack_.size())
+    if (checked_ && !stackSize())
       throw std::runtime_error("Trying to pop from empty stack!");
-    dataStack_.pop();
+    pstack_->pop_back();
+  }
+};
+
+using FuncStack = std::stack<StackFrame, std::vector<StackFrame>>;
+
+/**
+ * Pre-decoded instruction for threaded dispatch: handler is the address of
+ * the interpreter label for inst's opcode (unused in switch fallback mode),
+ * arg is inst's operand, so handlers don't load it through inst
+ */
+struct DecodedInst final {
+  const void *handler = nullptr;
+  const Instruction *inst = nullptr;
+  ArgType arg = 0;
+};
+
+/**
+ * Polymorphic inline cache of attribute access instruction: maps receiver
+ * shape to field slot, for stores also to shape after adding the field
+ */
+struct AttrCache final {
+  static constexpr std::size_t kMaxEntries = 4;
+
+  struct Entry final {
+    const Shape *shape = nullptr;
+    const Shape *next = nullptr;
+    std::size_t slot = 0;
+  };
+
+  std::array<Entry, kMaxEntries> entries{};
+  std::size_t size = 0;
+  /* Callee of CALL_METHOD, resolved on the first execution */
+  const FuncMeta *func = nullptr;
+
+  [[nodiscard]] const Entry *find(const Shape *shape) const {
+    for (std::size_t i = 0; i < size; ++i)
+      if (entries[i].shape == shape)
+        return &entries[i];
+    return nullptr;
+  }
+
+  /* Megamorphic cache is not updated anymore */
+  const Entry *add(const Entry &entry) {
+    if (size == kMaxEntries)
+      return nullptr;
+    entries[size] = entry;
+    return &entries[size++];
   }
 };
 
-using FuncStack = std::stack<StackFrame>;
+/* Register mode runs code translated to register form, w/o JIT */
+enum class DispatchMode : std::uint8_t { Callback, Threaded, Register };
+
+struct ExecOptions final {
+  DispatchMode mode = DispatchMode::Threaded;
+  std::size_t maxCallDepth = kDefaultMaxCallDepth;
+  /* Max length of opcode n-grams to count, 0 turns profiling off.
+   * Profiling run always uses callback dispatch */
+  std::size_t ngramLen = 0;
+  /* Calls and back-edges of function to compile it to native code,
+   * 0 turns JIT off. JIT is not used by profiling run */
+  std::size_t jitThreshold = jit::kDefaultThreshold;
+  /* Rewrite generic instructions to forms specialized for operand types
+   * they see. Neither profiling nor register run quickens code, nor does
+   * run of shared (const) file */
+  bool quicken = true;
+  /* Profiling run always uses callback dispatch */
+  ProfileMode profile = ProfileMode::Off;
+  std::chrono::microseconds sampleInterval = kDefaultSampleInterval;
+  /* Native code of file functions built ahead of time, calls of functions
+   * it has are dispatched to it. Not used by profiling run */
+  const aot::Module *aot = nullptr;
+};
 
 struct State final {
+  gc::Heap heap{};
   FuncStack funcStack{};
-  LeechFile *pFile{};
+  ValueStack valueStack{};
+  std::size_t maxCallDepth = kDefaultMaxCallDepth;
+  const LeechFile *pFile{};
   std::uint64_t pc{};
   std::optional<std::uint64_t> nextPC{};
-
-  State() = default;
-  explicit State(LeechFile *pfile);
-
-  State(const State &) = default;
-  State &operator=(const State &) = default;
+  /* Inline caches of attribute access instructions, indexed by pc */
+  std::vector<AttrCache> attrCaches{};
+  std::vector<std::uint32_t> attrCacheIdx{};
+  /* Tier-up of hot functions, null if JIT is off */
+  std::unique_ptr<jit::Jit> jit{};
+  /* Code quickened instructions are rewritten in, empty if it is off */
+  std::span<Instruction> quickCode{};
+  /* Sites which missed guard once stay generic, indexed by pc */
+  std::vector<bool> quickMissed{};
+  /* Native code of functions, null if there is none */
+  const aot::Module *aot = nullptr;
+  /* Number of native function activations on the machine stack */
+  std::size_t nativeDepth = 0;
+  /* Threaded dispatch returns once frames drop to this depth, which is
+   * nonzero when native code runs interpreted callee */
+  std::size_t baseDepth = 0;
+  /* Code pre-decoded by threaded dispatch, kept for nested runs */
+  std::vector<DecodedInst> threadedCode{};
+
+  explicit State(const LeechFile *pfile,
+                 std::size_t maxDepth = kDefaultMaxCallDepth);
+
+  State(const State &) = delete;
+  State &operator=(const State &) = delete;
 
   [[nodiscard]] const auto &getInst(std::uint64_t idx) const {
-    return pFile->code.at(idx);
+    if (idx >= pFile->code.size())
+      throw std::out_of_range{"Instruction index is out of code"};
+    return pFile->code[idx];
   }
 
   auto &getCurFrame() { return funcStack.top(); }
+
+  /* Cache of current instruction */
+  AttrCache &getAttrCache() { return attrCaches[attrCacheIdx[pc]]; }
+
+  /* Make code of file being run mutable to rewrite instructions in it */
+  void enableQuickening(LeechFile &file) {
+    if (&file != pFile)
+      throw std::invalid_argument{"Quickening code of file not being run"};
+    quickCode = file.makeCodeMutable();
+    quickMissed.assign(quickCode.size(), false);
+  }
+
+  /* Rewrite current instruction inst to quickened opcode, unless it is not
+   * the code entry (e.g. copy run by deopt) or its guard failed before */
+  void quicken(const Instruction &inst, Opcodes opcode) {
+    if (quickCode.empty() || &inst != &quickCode[pc] || quickMissed[pc])
+      return;
+    quickCode[pc] = Instruction{opcode, inst.getArg()};
+  }
+
+  /* Put generic opcode back in place of current quickened instruction */
+  void dequicken(const Instruction &inst) {
+    if (quickCode.empty() || &inst != &quickCode[pc])
+      return;
+    quickMissed[pc] = true;
+    quickCode[pc] = Instruction{getQuickGeneric(inst.getOpcode()),
+                                inst.getArg()};
+  }
+
+  /**
+   * Create frame for pmeta in place of top argsNum values of current frame:
+   * they become callee's locals, the first popped one goes to names[0]
+   */
+  void pushFrame(const FuncMeta *pmeta, std::size_t argsNum = 0);
+
+  /* Pass args to main before the run, the first one goes to names[0] */
+  void setMainArgs(std::span<const Value> args);
+
+  /* Drop current frame along with its part of value stack */
+  void popFrame() {
+    valueStack.resize(getCurFrame().getBase());
+    funcStack.pop();
+  }
 };
 
+/**
+ * Run state until the last frame returns using direct-threaded dispatch
+ * (computed goto, or switch when compiler lacks labels as values)
+ */
+void executeThreaded(State &state);
+
+/* Replace tuple and slice on top of data stack w/ view of tuple slice */
+void subscriptSlice(State &state);
+
+/* Run state until the last frame returns using register form of its code */
+void executeRegisters(State &state, const reg::RegCode &code);
+
 class Executor final {
-  State state_{};
+  State state_;
+  DispatchMode mode_{};
+  std::optional<NgramProfile> ngrams_{};
+  std::optional<Profile> profile_{};
+  std::chrono::microseconds sampleInterval_{};
+  std::optional<reg::RegCode> regCode_{};
 
 public:
-  explicit Executor(LeechFile *leechFile) : state_(leechFile) {}
+  /**
+   * Executor of file which is not changed by the run, so it may be shared
+   * by executors of other threads. Code is never quickened
+   */
+  Executor(const LeechFile *leechFile, const ExecOptions &opts)
+      : state_(leechFile, opts.maxCallDepth), mode_(opts.mode),
+        sampleInterval_(opts.sampleInterval) {
+    if (opts.ngramLen != 0)
+      ngrams_.emplace(opts.ngramLen);
+    if (opts.profile != ProfileMode::Off)
+      profile_.emplace(leechFile->meta, opts.profile);
+    if (isProfiling())
+      return;
+    state_.aot = opts.aot;
+    if (mode_ == DispatchMode::Register) {
+      regCode_ = reg::translate(*leechFile);
+      return;
+    }
+    if (opts.jitThreshold != 0 && jit::isSupported())
+      state_.jit = std::make_unique<jit::Jit>(leechFile, opts.jitThreshold);
+  }
+
+  Executor(LeechFile *leechFile, const ExecOptions &opts)
+      : Executor(static_cast<const LeechFile *>(leechFile), opts) {
+    if (opts.quicken && !isProfiling() && !regCode_.has_value())
+      state_.enableQuickening(*leechFile);
+  }
+
+  explicit Executor(LeechFile *leechFile,
+                    DispatchMode mode = DispatchMode::Threaded)
+      : Executor(leechFile, ExecOptions{mode}) {}
 
   void execute();
+  /* Run main w/ args instead of no args */
+  void execute(std::span<const Value> args) {
+    state_.setMainArgs(args);
+    execute();
+  }
+
+  [[nodiscard]] const gc::Heap &getHeap() const { return state_.heap; }
+  [[nodiscard]] const auto &getAttrCaches() const {
+    return state_.attrCaches;
+  }
+  [[nodiscard]] const auto &getNgramProfile() const { return ngrams_; }
+  [[nodiscard]] const auto &getProfile() const { return profile_; }
+  [[nodiscard]] const auto &getRegCode() const { return regCode_; }
+  [[nodiscard]] std::optional<jit::JitStats> getJitStats() const {
+    if (state_.jit == nullptr)
+      return std::nullopt;
+    return state_.jit->getStats();
+  }
+
+private:
+  [[nodiscard]] bool isProfiling() const {
+    return ngrams_.has_value() || profile_.has_value();
+  }
+
+  void executeCallbacks();
+  void executeProfiled(const Instruction &inst);
 };
 
 } // namespace leech
@@ -0,0 +1,86 @@
+#ifndef __INCLUDE_EXECUTOR_ISOLATE_HH__
+#define __INCLUDE_EXECUTOR_ISOLATE_HH__
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "executor/executor.hh"
+
+namespace leech {
+
+/**
+ * Run of main of file in an isolate: executor w/ its own heap, stacks,
+ * caches and JIT. Loaded file is immutable and shared by all isolates
+ * running it, args are constants which go to main's names[0], names[1]...
+ */
+struct IsolateJob final {
+  const LeechFile *file = nullptr;
+  std::vector<pLeechObj> args{};
+  /* Native code of file, overrides the one of pool options */
+  const aot::Module *native = nullptr;
+};
+
+struct IsolateStats final {
+  /* Index of the job */
+  std::size_t job = 0;
+  /* Index of the worker thread which ran it */
+  std::size_t worker = 0;
+  std::chrono::nanoseconds time{};
+  gc::GCStats gc{};
+  std::optional<jit::JitStats> jit{};
+  /* Message of exception the run failed w/, empty on success */
+  std::string error{};
+
+  [[nodiscard]] bool failed() const { return !error.empty(); }
+  void print(std::ostream &ost) const;
+};
+
+struct IsolatePoolStats final {
+  std::size_t jobs = 0;
+  std::size_t failed = 0;
+  std::size_t threads = 0;
+  /* Wall time of the whole batch */
+  std::chrono::nanoseconds wallTime{};
+  /* Sum of run times of isolates */
+  std::chrono::nanoseconds busyTime{};
+
+  [[nodiscard]] double getThroughput() const;
+  void print(std::ostream &ost) const;
+};
+
+/**
+ * Runs jobs across a fixed number of worker threads, each of them takes the
+ * next job once it is done w/ the previous one. Isolates don't share
+ * anything mutable, so the only synchronization is taking a job. Output of
+ * PRINT goes to std::cout as is, so lines of different isolates interleave
+ */
+class IsolatePool final {
+  std::size_t threads_ = 1;
+  ExecOptions opts_{};
+  std::vector<IsolateStats> stats_{};
+  IsolatePoolStats poolStats_{};
+
+public:
+  /* threads == 0 uses one thread per hardware thread */
+  explicit IsolatePool(std::size_t threads, const ExecOptions &opts = {});
+
+  /* Run all jobs, stats of the previous batch are dropped */
+  void run(std::span<const IsolateJob> jobs);
+
+  [[nodiscard]] auto getThreads() const { return threads_; }
+  /* Stats of the last batch in job order */
+  [[nodiscard]] const auto &getStats() const { return stats_; }
+  [[nodiscard]] const auto &getPoolStats() const { return poolStats_; }
+
+private:
+  static IsolateStats runJob(const IsolateJob &job, const ExecOptions &opts);
+};
+
+} // namespace leech
+
+#endif // __INCLUDE_EXECUTOR_ISOLATE_HH__
@@ -0,0 +1,163 @@
+#ifndef __INCLUDE_EXECUTOR_JIT_HH__
+#define __INCLUDE_EXECUTOR_JIT_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "leechfile/leechfile.hh"
+
+namespace leech {
+
+struct State;
+
+namespace jit {
+
+constexpr std::size_t kDefaultThreshold = 1000;
+/* Native frames are nested on the machine stack, so their number is capped
+ * separately from State::maxCallDepth */
+constexpr std::size_t kMaxNativeDepth = 1U << 15U;
+constexpr std::size_t kStackSize = 1U << 20U;
+
+/* Whether native code can be emitted for the host */
+constexpr bool isSupported() {
+#if defined(__x86_64__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+/* Interpreter frame to be restored on deopt */
+struct FrameRecord final {
+  const FuncMeta *meta = nullptr;
+  Value *base = nullptr;
+  std::uint64_t pc = 0;
+  /* One past the last value of frame's data stack */
+  Value *top = nullptr;
+};
+
+/**
+ * State shared by native frames of one run. The first two fields are
+ * accessed by compiled code, so their offsets are fixed
+ */
+struct JitContext final {
+  std::int64_t depthLeft = 0;
+  const Value *stackEnd = nullptr;
+  /* Frames of deoptimized run, the innermost one goes first */
+  std::vector<FrameRecord> records{};
+  class Jit *jit = nullptr;
+};
+
+/* Read/write mapping which is turned executable once code is copied */
+class ExecBuffer final {
+  void *buf_ = nullptr;
+  std::size_t size_ = 0;
+
+public:
+  ExecBuffer() = default;
+  explicit ExecBuffer(const std::vector<std::uint8_t> &code);
+
+  ExecBuffer(const ExecBuffer &) = delete;
+  ExecBuffer &operator=(const ExecBuffer &) = delete;
+  ExecBuffer(ExecBuffer &&other) noexcept;
+  ExecBuffer &operator=(ExecBuffer &&other) noexcept;
+  ~ExecBuffer();
+
+  [[nodiscard]] auto *data() const { return static_cast<std::uint8_t *>(buf_); }
+  [[nodiscard]] auto size() const { return size_; }
+};
+
+/* Jump target where the run may be entered via OSR */
+struct OsrTarget final {
+  std::size_t offset = 0;
+  /* Data stack depths compiled code expects there */
+  std::uint64_t minDepth = 0;
+  std::uint64_t maxDepth = 0;
+};
+
+struct JitFunc;
+
+/* Returns 0 if function returned, its value is put to base[0],
+ * or 1 if frames to resume in the interpreter are recorded to context */
+using NativeEntry = std::uint64_t (*)(Value *base, JitContext *ctx,
+                                      JitFunc *func);
+/* Continues run from target w/ data stack ending at top */
+using OsrEntry = std::uint64_t (*)(Value *base, JitContext *ctx, Value *top,
+                                   const void *target);
+
+struct JitFunc final {
+  enum class Status : std::uint8_t { Interpreted, Compiled, Failed };
+
+  /* Called by native call sites: either compiled code or call stub */
+  NativeEntry entry = nullptr;
+  OsrEntry osrEntry = nullptr;
+  const FuncMeta *meta = nullptr;
+  Status status = Status::Interpreted;
+  std::uint64_t counter = 0;
+  /* Bytecode range [begin, end) of the function */
+  std::uint64_t begin = 0;
+  std::uint64_t end = 0;
+  std::unordered_map<std::uint64_t, OsrTarget> osrTargets{};
+  ExecBuffer code{};
+};
+
+struct JitStats final {
+  std::size_t compiled = 0;
+  std::size_t failed = 0;
+  std::uint64_t nativeRuns = 0;
+  std::uint64_t osrEntries = 0;
+  std::uint64_t deopts = 0;
+
+  void print(std::ostream &ost) const;
+};
+
+/**
+ * Baseline template JIT: functions which are called or loop often are
+ * translated to x86-64 by stitching per-opcode code templates.
+ *
+ * Compiled code keeps values on a separate stack laid out exactly like
+ * State::valueStack, so a run is entered by copying the current frame to it
+ * and left by copying frames back. Any instruction w/o a template and any
+ * failed type guard exits to the interpreter (deopt), which re-executes
+ * the instruction
+ */
+class Jit final {
+  const LeechFile *pFile_ = nullptr;
+  std::size_t threshold_ = kDefaultThreshold;
+  std::unordered_map<const FuncMeta *, JitFunc> funcs_{};
+  Value *stack_ = nullptr;
+  JitContext ctx_{};
+  JitStats stats_{};
+
+public:
+  Jit(const LeechFile *pfile, std::size_t threshold);
+
+  Jit(const Jit &) = delete;
+  Jit &operator=(const Jit &) = delete;
+  Jit(Jit &&) = delete;
+  Jit &operator=(Jit &&) = delete;
+  ~Jit();
+
+  /* Called once callee frame is pushed, may run the whole call natively */
+  void onCall(State &state);
+  /* Called on taken backward jump of the current frame to dest */
+  void onBackEdge(State &state, std::uint64_t dest);
+
+  /* Count invocation, compile func once threshold is reached */
+  bool tick(JitFunc &func);
+
+  [[nodiscard]] const auto &getStats() const { return stats_; }
+  [[nodiscard]] auto &getContext() { return ctx_; }
+
+private:
+  bool compile(JitFunc &func);
+  void run(State &state, JitFunc &func, std::uint64_t pc);
+};
+
+} // namespace jit
+} // namespace leech
+
+#endif // __INCLUDE_EXECUTOR_JIT_HH__
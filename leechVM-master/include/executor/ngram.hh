@@ -0,0 +1,69 @@
+#ifndef __INCLUDE_EXECUTOR_NGRAM_HH__
+#define __INCLUDE_EXECUTOR_NGRAM_HH__
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/common.hh"
+
+namespace leech {
+
+/**
+ * Counts opcode n-grams of straight-line runs, i.e. sequences executed
+ * w/o taken branches, calls and returns: the ones fusion pass may replace
+ * by superinstructions
+ */
+class NgramProfile final {
+public:
+  /* Opcodes of n-gram are packed to uint64_t, a byte for each */
+  static constexpr std::size_t kMaxLen = 8;
+  static constexpr std::size_t kDefaultLen = 4;
+
+  using Ngram = std::vector<Opcodes>;
+
+private:
+  std::size_t maxLen_ = kDefaultLen;
+  std::uint64_t window_ = 0;
+  std::size_t runLen_ = 0;
+  std::uint64_t nextPC_ = 0;
+  /* counts_[n - 2] holds n-grams */
+  std::vector<std::unordered_map<std::uint64_t, std::uint64_t>> counts_{};
+
+  static_assert(sizeof(Opcodes) == 1 && kOpcodesNum <= 0x100);
+
+public:
+  explicit NgramProfile(std::size_t maxLen = kDefaultLen);
+
+  void record(std::uint64_t pc, Opcodes opcode) {
+    if (pc != nextPC_)
+      runLen_ = 0;
+    nextPC_ = pc + getInstLength(opcode);
+
+    window_ = (window_ << 8U) | toUnderlying(opcode);
+    runLen_ = std::min(runLen_ + 1, maxLen_);
+    for (std::size_t len = 2; len <= runLen_; ++len)
+      ++counts_[len - 2][window_ & getMask(len)];
+  }
+
+  [[nodiscard]] auto getMaxLen() const { return maxLen_; }
+
+  /* The most frequent n-grams of length len, most frequent first */
+  [[nodiscard]] std::vector<std::pair<Ngram, std::uint64_t>>
+  getTop(std::size_t len, std::size_t num) const;
+
+  void print(std::ostream &ost, std::size_t num) const;
+
+private:
+  static constexpr std::uint64_t getMask(std::size_t len) {
+    return len >= kMaxLen ? ~std::uint64_t{0}
+                          : (std::uint64_t{1} << (8 * len)) - 1;
+  }
+};
+
+} // namespace leech
+
+#endif // __INCLUDE_EXECUTOR_NGRAM_HH__
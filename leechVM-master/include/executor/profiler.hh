@@ -0,0 +1,180 @@
+#ifndef __INCLUDE_EXECUTOR_PROFILER_HH__
+#define __INCLUDE_EXECUTOR_PROFILER_HH__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "common/common.hh"
+#include "leechfile/leechfile.hh"
+
+namespace leech {
+
+enum class ProfileMode : std::uint8_t {
+  Off,
+  /* Count and time every instruction and call */
+  Instrument,
+  /* Take leech call stack on profiling timer signal */
+  Sample
+};
+
+constexpr std::chrono::microseconds kDefaultSampleInterval{1000};
+
+/* Time stamp counter, or nanoseconds where it is not available */
+inline std::uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+#endif
+}
+
+/**
+ * Execution profile of leech program: per-opcode and per-function stats
+ * and the tree of call stacks met during the run (calling context tree),
+ * which is dumped as folded stacks for flamegraph.pl
+ */
+class Profile final {
+public:
+  struct OpcodeStats final {
+    std::uint64_t count = 0;
+    std::uint64_t cycles = 0;
+    std::uint64_t samples = 0;
+  };
+
+  struct FuncStats final {
+    std::string name{};
+    std::uint64_t calls = 0;
+    std::uint64_t selfCycles = 0;
+    /* Recursive calls are counted once */
+    std::uint64_t inclCycles = 0;
+    std::uint64_t selfSamples = 0;
+    std::uint64_t inclSamples = 0;
+  };
+
+private:
+  static constexpr std::size_t kNoParent = SIZE_MAX;
+
+  struct Node final {
+    std::size_t func = 0;
+    std::size_t parent = kNoParent;
+    std::map<std::size_t, std::size_t> children{};
+    std::uint64_t selfCycles = 0;
+    std::uint64_t samples = 0;
+  };
+
+  /* Running function activation */
+  struct Activation final {
+    std::size_t node = 0;
+    std::uint64_t start = 0;
+  };
+
+  ProfileMode mode_ = ProfileMode::Instrument;
+  std::array<OpcodeStats, kOpcodesNum> opcodes_{};
+  std::vector<FuncStats> funcs_{};
+  std::unordered_map<const FuncMeta *, std::size_t> funcIdx_{};
+  /* Activations of each function on the stack, inclusive time is
+   * measured for the outermost one */
+  std::vector<std::size_t> active_{};
+  std::vector<Node> nodes_{};
+  std::vector<Activation> stack_{};
+  std::uint64_t totalSamples_ = 0;
+
+public:
+  Profile(const Meta &meta, ProfileMode mode);
+
+  [[nodiscard]] auto getMode() const { return mode_; }
+  [[nodiscard]] const auto &getOpcodeStats(Opcodes opcode) const {
+    return opcodes_[toUnderlying(opcode)];
+  }
+  [[nodiscard]] std::vector<FuncStats> getFuncStats() const;
+  [[nodiscard]] auto getTotalSamples() const { return totalSamples_; }
+
+  void record(Opcodes opcode, std::uint64_t cycles) {
+    auto &stats = opcodes_[toUnderlying(opcode)];
+    ++stats.count;
+    stats.cycles += cycles;
+    if (!stack_.empty())
+      nodes_[stack_.back().node].selfCycles += cycles;
+  }
+
+  void addSamples(Opcodes opcode, std::uint64_t num) {
+    opcodes_[toUnderlying(opcode)].samples += num;
+    if (!stack_.empty())
+      nodes_[stack_.back().node].samples += num;
+    totalSamples_ += num;
+  }
+
+  /* Follow calls and returns: depth is the size of call stack after
+   * instruction, top is the meta of its top frame */
+  void syncStack(std::size_t depth, const FuncMeta *top) {
+    if (depth != stack_.size())
+      syncStackSlow(depth, top);
+  }
+
+  /* Stop timing of functions still on the stack */
+  void finish();
+
+  void print(std::ostream &ost) const;
+  /* "main;foo;bar weight" lines: self cycles or samples of each stack */
+  void writeFolded(std::ostream &ost) const;
+
+private:
+  void syncStackSlow(std::size_t depth, const FuncMeta *top);
+  void leave();
+  std::size_t getChild(std::size_t parent, std::size_t func);
+  [[nodiscard]] std::string getStackName(std::size_t node) const;
+};
+
+/**
+ * Profiling timer: SIGPROF is delivered every interval of CPU time and
+ * handler only counts it, so the stack is taken by the interpreter loop.
+ * Only one timer may exist at a time
+ */
+class SampleTimer final {
+  /* Lock-free, so it is safe to update from signal handler */
+  static std::atomic<std::uint64_t> pending_;
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+  static volatile std::sig_atomic_t active_;
+
+  struct sigaction oldAction_ {};
+
+public:
+  explicit SampleTimer(std::chrono::microseconds interval);
+
+  SampleTimer(const SampleTimer &) = delete;
+  SampleTimer &operator=(const SampleTimer &) = delete;
+  SampleTimer(SampleTimer &&) = delete;
+  SampleTimer &operator=(SampleTimer &&) = delete;
+  ~SampleTimer();
+
+  /* Number of signals since the last call */
+  static std::uint64_t takePending() {
+    /* Cheap check first, exchange doesn't lose signals between read and
+     * reset */
+    if (pending_.load(std::memory_order_relaxed) == 0)
+      return 0;
+    return pending_.exchange(0, std::memory_order_relaxed);
+  }
+
+private:
+  static void handler(int sig);
+};
+
+} // namespace leech
+
+#endif // __INCLUDE_EXECUTOR_PROFILER_HH__
@@ -0,0 +1,315 @@
+#ifndef __INCLUDE_EXECUTOR_X86ASM_HH__
+#define __INCLUDE_EXECUTOR_X86ASM_HH__
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace leech::jit::x86 {
+
+enum class Reg : std::uint8_t {
+  RAX,
+  RCX,
+  RDX,
+  RBX,
+  RSP,
+  RBP,
+  RSI,
+  RDI,
+  R8,
+  R9,
+  R10,
+  R11,
+  R12,
+  R13,
+  R14,
+  R15
+};
+
+/* Condition codes in encoding order */
+enum class Cond : std::uint8_t {
+  O,
+  NO,
+  B,
+  AE,
+  E,
+  NE,
+  BE,
+  A,
+  S,
+  NS,
+  P,
+  NP,
+  L,
+  GE,
+  LE,
+  G
+};
+
+constexpr Cond invert(Cond cond) {
+  return static_cast<Cond>(static_cast<std::uint8_t>(cond) ^ 1U);
+}
+
+/* [base + disp] memory operand */
+struct Mem final {
+  Reg base{};
+  std::int32_t disp{};
+};
+
+class Label final {
+  std::size_t id_{};
+
+  explicit Label(std::size_t id) : id_(id) {}
+  friend class Assembler;
+};
+
+/**
+ * Minimal x86-64 encoder for the instructions template JIT needs.
+ * Jumps are always rel32, labels are resolved by finalize()
+ */
+class Assembler final {
+  static constexpr std::int64_t kUnbound = -1;
+
+  std::vector<std::uint8_t> code_{};
+  std::vector<std::int64_t> labels_{};
+  /* Position of rel32 field and its label */
+  std::vector<std::pair<std::size_t, std::size_t>> fixups_{};
+
+public:
+  [[nodiscard]] Label newLabel() {
+    labels_.push_back(kUnbound);
+    return Label{labels_.size() - 1};
+  }
+
+  void bind(Label label) {
+    labels_.at(label.id_) = static_cast<std::int64_t>(code_.size());
+  }
+
+  [[nodiscard]] bool isBound(Label label) const {
+    return labels_.at(label.id_) != kUnbound;
+  }
+  [[nodiscard]] std::size_t getOffset(Label label) const {
+    return static_cast<std::size_t>(labels_.at(label.id_));
+  }
+  [[nodiscard]] std::size_t size() const { return code_.size(); }
+
+  /* Patch jumps, returns code ready to be copied to executable memory */
+  const std::vector<std::uint8_t> &finalize() {
+    for (auto [pos, id] : fixups_) {
+      if (labels_[id] == kUnbound)
+        throw std::logic_error{"Jump to unbound label"};
+      auto rel = labels_[id] - static_cast<std::int64_t>(pos + 4);
+      put32(pos, static_cast<std::uint32_t>(static_cast<std::int32_t>(rel)));
+    }
+    fixups_.clear();
+    return code_;
+  }
+
+  /* mov dst, [mem] */
+  void mov(Reg dst, Mem src) { op(0x8B, dst, src); }
+  /* mov [mem], src */
+  void mov(Mem dst, Reg src) { op(0x89, src, dst); }
+  /* mov dst, src */
+  void mov(Reg dst, Reg src) {
+    rex(true, src, dst);
+    emit(0x89);
+    modrm(src, dst);
+  }
+  /* mov dst, imm */
+  void mov(Reg dst, std::int64_t imm) {
+    if (fitsInt32(imm)) {
+      rex(true, Reg::RAX, dst);
+      emit(0xC7);
+      modrm(Reg::RAX, dst);
+      emit32(static_cast<std::uint32_t>(imm));
+      return;
+    }
+    rex(true, Reg::RAX, dst);
+    emit(static_cast<std::uint8_t>(0xB8 + lowBits(dst)));
+    emit64(static_cast<std::uint64_t>(imm));
+  }
+  /* mov qword [mem], sign extended imm32 */
+  void mov64(Mem dst, std::int32_t imm) {
+    op(0xC7, Reg::RAX, dst);
+    emit32(static_cast<std::uint32_t>(imm));
+  }
+  /* mov byte [mem], imm8 */
+  void mov8(Mem dst, std::uint8_t imm) {
+    op(0xC6, Reg::RAX, dst, false);
+    emit(imm);
+  }
+
+  /* cmp byte [mem], imm8 */
+  void cmp8(Mem lhs, std::uint8_t imm) {
+    op(0x80, Reg::RDI /* /7 */, lhs, false);
+    emit(imm);
+  }
+  /* cmp qword [mem], sign extended imm8 */
+  void cmp64(Mem lhs, std::int8_t imm) {
+    op(0x83, Reg::RDI /* /7 */, lhs);
+    emit(static_cast<std::uint8_t>(imm));
+  }
+  void cmp(Reg lhs, Mem rhs) { op(0x3B, lhs, rhs); }
+  void cmp(Reg lhs, Reg rhs) {
+    rex(true, rhs, lhs);
+    emit(0x39);
+    modrm(rhs, lhs);
+  }
+  void add(Reg dst, Mem src) { op(0x03, dst, src); }
+  void sub(Reg dst, Mem src) { op(0x2B, dst, src); }
+
+  /* add/sub reg, imm32 */
+  void add(Reg dst, std::int32_t imm) { aluImm(Reg::RAX /* /0 */, dst, imm); }
+  void sub(Reg dst, std::int32_t imm) { aluImm(Reg::RBP /* /5 */, dst, imm); }
+
+  /* inc/dec qword [mem] */
+  void inc64(Mem dst) { op(0xFF, Reg::RAX /* /0 */, dst); }
+  void dec64(Mem dst) { op(0xFF, Reg::RCX /* /1 */, dst); }
+
+  void lea(Reg dst, Mem src) { op(0x8D, dst, src); }
+
+  /* setcc al; movzx eax, al */
+  void setccEax(Cond cond) {
+    emit(0x0F);
+    emit(static_cast<std::uint8_t>(0x90 + static_cast<std::uint8_t>(cond)));
+    emit(0xC0);
+    emit(0x0F);
+    emit(0xB6);
+    emit(0xC0);
+  }
+
+  void xorEax() {
+    emit(0x31);
+    emit(0xC0);
+  }
+  void movEax(std::uint32_t imm) {
+    emit(0xB8);
+    emit32(imm);
+  }
+  void testEax() {
+    emit(0x85);
+    emit(0xC0);
+  }
+  void testAl() {
+    emit(0x84);
+    emit(0xC0);
+  }
+
+  void jcc(Cond cond, Label label) {
+    emit(0x0F);
+    emit(static_cast<std::uint8_t>(0x80 + static_cast<std::uint8_t>(cond)));
+    fixup(label);
+  }
+  void jmp(Label label) {
+    emit(0xE9);
+    fixup(label);
+  }
+  void jmp(Reg target) {
+    rex(false, Reg::RAX, target);
+    emit(0xFF);
+    modrm(Reg::RSP /* /4 */, target);
+  }
+  void call(Reg target) {
+    rex(false, Reg::RAX, target);
+    emit(0xFF);
+    modrm(Reg::RDX /* /2 */, target);
+  }
+
+  void push(Reg reg) {
+    rex(false, Reg::RAX, reg);
+    emit(static_cast<std::uint8_t>(0x50 + lowBits(reg)));
+  }
+  void pop(Reg reg) {
+    rex(false, Reg::RAX, reg);
+    emit(static_cast<std::uint8_t>(0x58 + lowBits(reg)));
+  }
+  void ret() { emit(0xC3); }
+
+private:
+  static constexpr bool fitsInt32(std::int64_t val) {
+    return val >= std::numeric_limits<std::int32_t>::min() &&
+           val <= std::numeric_limits<std::int32_t>::max();
+  }
+  static constexpr bool fitsInt8(std::int32_t val) {
+    return val >= std::numeric_limits<std::int8_t>::min() &&
+           val <= std::numeric_limits<std::int8_t>::max();
+  }
+  static constexpr std::uint8_t lowBits(Reg reg) {
+    return static_cast<std::uint8_t>(reg) & 7U;
+  }
+  static constexpr unsigned highBit(Reg reg) {
+    return static_cast<unsigned>(reg) >> 3U;
+  }
+
+  void emit(std::uint8_t byte) { code_.push_back(byte); }
+  void emit32(std::uint32_t val) {
+    for (int i = 0; i < 4; ++i, val >>= 8U)
+      emit(static_cast<std::uint8_t>(val));
+  }
+  void emit64(std::uint64_t val) {
+    for (int i = 0; i < 8; ++i, val >>= 8U)
+      emit(static_cast<std::uint8_t>(val));
+  }
+  void put32(std::size_t pos, std::uint32_t val) {
+    for (int i = 0; i < 4; ++i, val >>= 8U)
+      code_[pos + static_cast<std::size_t>(i)] = static_cast<std::uint8_t>(val);
+  }
+
+  void fixup(Label label) {
+    fixups_.emplace_back(code_.size(), label.id_);
+    emit32(0);
+  }
+
+  /* REX prefix, omitted when it's not needed */
+  void rex(bool wide, Reg reg, Reg base) {
+    auto byte = static_cast<std::uint8_t>(0x40 | (wide ? 8U : 0U) |
+                                          (highBit(reg) << 2U) |
+                                          highBit(base));
+    if (byte != 0x40)
+      emit(byte);
+  }
+
+  /* ModRM for register direct operand */
+  void modrm(Reg reg, Reg rm) {
+    emit(static_cast<std::uint8_t>(0xC0 | (lowBits(reg) << 3U) | lowBits(rm)));
+  }
+
+  /* ModRM (+SIB) and displacement for [base + disp] */
+  void modrm(Reg reg, Mem mem) {
+    auto base = lowBits(mem.base);
+    std::uint8_t mod = 0x80;
+    if (mem.disp == 0 && base != 5)
+      mod = 0x00;
+    else if (fitsInt8(mem.disp))
+      mod = 0x40;
+
+    emit(static_cast<std::uint8_t>(mod | (lowBits(reg) << 3U) | base));
+    /* rsp/r12 base needs SIB */
+    if (base == 4)
+      emit(0x24);
+
+    if (mod == 0x40)
+      emit(static_cast<std::uint8_t>(mem.disp));
+    else if (mod == 0x80)
+      emit32(static_cast<std::uint32_t>(mem.disp));
+  }
+
+  void op(std::uint8_t opcode, Reg reg, Mem mem, bool wide = true) {
+    rex(wide, reg, mem.base);
+    emit(opcode);
+    modrm(reg, mem);
+  }
+
+  void aluImm(Reg ext, Reg dst, std::int32_t imm) {
+    rex(true, Reg::RAX, dst);
+    emit(0x81);
+    modrm(ext, dst);
+    emit32(static_cast<std::uint32_t>(imm));
+  }
+};
+
+} // namespace leech::jit::x86
+
+#endif // __INCLUDE_EXECUTOR_X86ASM_HH__
@@ -4,8 +4,15 @@
 #include <array>
 #include <fstream>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "lLexer.hh"
 #include "leechfile/leechfile.hh"
@@ -16,6 +23,13 @@ class Driver final {
 public:
   ~Driver() = default;
   Driver(std::istream &in, std::ostream &out);
+  /* Parse source in memory (e.g. mapped file) w/o copying it as a whole */
+  Driver(std::span<const char> src, std::ostream &out);
+
+  Driver(const Driver &) = delete;
+  Driver &operator=(const Driver &) = delete;
+  Driver(Driver &&) = delete;
+  Driver &operator=(Driver &&) = delete;
 
   parser::token_type yylex(parser::semantic_type *yylval,
                            parser::location_type *yylloc);
@@ -25,17 +39,72 @@ public:
   friend parser;
 
 private:
+  /* Read-only streambuf over source in memory */
+  class SpanBuf final : public std::streambuf {
+  public:
+    SpanBuf() = default;
+    explicit SpanBuf(std::span<const char> src) {
+      auto *begin = const_cast<char *>(src.data());
+      setg(begin, begin, begin + src.size());
+    }
+  };
+
   static inline constexpr size_t numTokens = 10;
+  /* Estimate of source bytes per instruction to reserve code */
+  static inline constexpr std::size_t kSrcBytesPerInst = 24;
 
+  SpanBuf srcBuf_{};
+  std::istream src_{&srcBuf_};
   std::unique_ptr<Lexer> lexer_{};
   std::shared_ptr<leech::LeechFile> leechFile_{
       std::make_shared<leech::LeechFile>()};
-  std::unordered_map<std::string, leech::FuncAddr> labels_{};
-  std::unordered_map<std::string, leech::FuncAddr> forwardBranches_{};
-  leech::Tuple tupleArgs_{};
-  std::string currentFunc_{};
-  std::size_t instrCount_ = 0;
-  std::size_t globalInstrCount_ = 0;
+  /* Instructions are emitted right here, this vector becomes code of
+   * leechFile_ after parse */
+  std::vector<leech::Instruction> code_{};
+  leech::FuncMeta *curFunc_ = nullptr;
+
+  /* Temporaries of parse live in arena until driver is gone */
+  std::pmr::monotonic_buffer_resource arena_{};
+  /* Identifiers are interned in arena, so equal ones are the same view
+   * and maps below compare them by address */
+  std::pmr::unordered_set<std::string_view> idents_{&arena_};
+  struct IdentHash final {
+    std::size_t operator()(std::string_view ident) const {
+      return std::hash<const char *>{}(ident.data());
+    }
+  };
+  struct IdentEq final {
+    bool operator()(std::string_view lhs, std::string_view rhs) const {
+      return lhs.data() == rhs.data();
+    }
+  };
+  template <class T>
+  using IdentMap =
+      std::pmr::unordered_map<std::string_view, T, IdentHash, IdentEq>;
+
+  /* Copies of identifiers owned by leechFile_ */
+  IdentMap<std::string_view> fileStrings_{&arena_};
+  IdentMap<std::optional<leech::Opcodes>> opcodes_{&arena_};
+  /* Labels of the current function */
+  IdentMap<leech::FuncAddr> labels_{&arena_};
+  /* Instructions jumping to label which is not met yet */
+  std::pmr::unordered_multimap<std::string_view, leech::FuncAddr, IdentHash,
+                               IdentEq>
+      forwardBranches_{&arena_};
+  std::pmr::vector<leech::pLeechObj> tupleArgs_{&arena_};
+
+  std::string_view intern(std::string_view ident);
+  std::string_view addString(std::string_view ident);
+  std::optional<leech::Opcodes> getOpcode(std::string_view ident);
+
+  void startFunc(std::string_view name, int argNum);
+  /* Returns label jumped to but not defined in the function if any */
+  std::optional<std::string_view> finishFunc() const;
+  /* Instructions go straight to code. These return false if arg (address
+   * of label) is out of range */
+  bool addLabel(std::string_view name);
+  bool emit(leech::Opcodes opcode, int arg = 0);
+  bool emitJump(leech::Opcodes opcode, std::string_view label);
 };
 
 } // namespace yy
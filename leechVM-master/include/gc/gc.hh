@@ -1,62 +1,71 @@
 #ifndef __INCLUDE_GC_GC_HH__
 #define __INCLUDE_GC_GC_HH__
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <new>
+#include <ostream>
 #include <stdexcept>
 #include <sys/mman.h>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
-namespace leech::gc {
-
-template <std::uintptr_t StartAddr, std::size_t Size> class Region final {
-  template <class T> struct Allocator final {
-    using value_type = T;
-
-    Allocator() = default;
-
-    template <class U> Allocator([[maybe_unused]] const Allocator<U> &other) {}
-
-    [[nodiscard]] auto allocate(std::size_t size) {
-      return Region::allocateInstance<T>(size);
-    }
+#include "leechobj/leechobj.hh"
 
-    void deallocate([[maybe_unused]] T *ptr,
-                    [[maybe_unused]] std::size_t size) noexcept {}
-  };
-
-  static inline auto curOffset = 0;
+namespace leech::gc {
 
-  [[nodiscard]] static auto getStartPtr() {
-    return reinterpret_cast<void *>(StartAddr);
-  }
+/**
+ * Bump allocator over [begin, begin + size) memory chunk
+ */
+class Region final {
+  std::byte *begin_ = nullptr;
+  std::byte *cur_ = nullptr;
+  std::byte *end_ = nullptr;
 
 public:
-  Region() = delete;
-
-  template <class T> static auto getAllocator() { return Allocator<T>(); }
+  Region() = default;
+  Region(void *begin, std::size_t size)
+      : begin_(static_cast<std::byte *>(begin)), cur_(begin_),
+        end_(begin_ + size) {}
+
+  /* Returns nullptr when region is exhausted */
+  [[nodiscard]] void *allocate(std::size_t size) noexcept {
+    if (static_cast<std::size_t>(end_ - cur_) < size)
+      return nullptr;
+    return std::exchange(cur_, cur_ + size);
+  }
 
-  static void reset() { curOffset = 0; }
+  void reset() noexcept { cur_ = begin_; }
 
-  [[nodiscard]] static auto allocateRaw(std::size_t num_of_bytes) {
-    auto newOffset = curOffset + num_of_bytes;
+  [[nodiscard]] bool contains(const void *ptr) const noexcept {
+    auto *bptr = static_cast<const std::byte *>(ptr);
+    return begin_ <= bptr && bptr < end_;
+  }
 
-    if (newOffset > Size)
-      throw std::runtime_error{"Out of memory"};
+  [[nodiscard]] auto begin() const noexcept { return begin_; }
+  [[nodiscard]] auto end() const noexcept { return cur_; }
 
-    return getStartPtr() + std::exchange(curOffset, newOffset);
+  [[nodiscard]] std::size_t used() const noexcept {
+    return static_cast<std::size_t>(cur_ - begin_);
   }
-
-  template <class T>
-  [[nodiscard]] static auto allocateInstance(std::size_t num_elems = 1) {
-    return reinterpret_cast<T *>(allocateRaw(num_elems * sizeof(T)));
+  [[nodiscard]] std::size_t capacity() const noexcept {
+    return static_cast<std::size_t>(end_ - begin_);
+  }
+  [[nodiscard]] std::size_t available() const noexcept {
+    return capacity() - used();
   }
 };
 
+/**
+ * Memory block of a heap. Block is mapped wherever kernel puts it, so any
+ * number of heaps (e.g. one per isolate) may live in the process
+ */
 class MemoryManager final {
   static inline constexpr std::size_t kBlockSizeMB = 32;
   static inline constexpr std::size_t kBlockSize = kBlockSizeMB << 20U;
-  static inline constexpr std::uintptr_t kStartAddr = 0xE000000;
 
   class MMapWrapper final {
     std::size_t size_{};
@@ -90,16 +99,147 @@ class MemoryManager final {
     [[nodiscard]] auto size() const { return size_; }
 
     ~MMapWrapper() { munmap(buf_, size_); }
-  } block_{kBlockSize, kStartAddr};
+  } block_{kBlockSize};
+
+public:
+  [[nodiscard]] auto data() const { return block_.get(); }
+  [[nodiscard]] auto size() const { return block_.size(); }
+};
+
+/**
+ * Header put in front of every heap object
+ */
+struct ObjHeader final {
+  LeechObj *forward = nullptr;
+  std::uint32_t size = 0;
+  std::uint32_t flags = 0;
+
+  static constexpr std::uint32_t kRemembered = 1U;
+};
+
+static_assert(sizeof(ObjHeader) % alignof(std::max_align_t) == 0);
+
+struct GCStats final {
+  std::size_t minorCollections{};
+  std::size_t majorCollections{};
+  /* Bytes requested from heap incl. headers */
+  std::size_t allocatedBytes{};
+  /* Bytes copied from nursery to old space */
+  std::size_t promotedBytes{};
+  std::chrono::nanoseconds totalPause{};
+  std::chrono::nanoseconds maxPause{};
+  /* Bytes occupied by heap objects at the moment of query */
+  std::size_t heapSize{};
+
+  void print(std::ostream &ost) const;
+};
+
+/**
+ * Generational copying heap for LeechObj's created at runtime.
+ * New objects are bump allocated in nursery, minor collection promotes
+ * survivors to old space, major one copies old space to its other half.
+ * Objects outside of the heap (e.g. constants) are immortal and immutable.
+ */
+class Heap final {
+public:
+  using RootsTracer = std::function<void(IValueVisitor &)>;
+
+  static constexpr std::size_t kNurserySize = 4U << 20U;
+  static constexpr std::size_t kAlign = alignof(std::max_align_t);
+
+private:
+  MemoryManager mman_{};
+  Region nursery_{};
+  /* Old space semispaces, old_[curOld_] is in use */
+  Region old_[2]{};
+  std::size_t curOld_ = 0;
+  std::vector<LeechObj *> remembered_{};
+  RootsTracer roots_{};
+  GCStats stats_{};
 
 public:
-  MemoryManager() {
-    if (block_.as<decltype(kStartAddr)>() != kStartAddr)
-      throw std::logic_error{"Trying to create more than one mem block"};
+  Heap();
+  Heap(const Heap &) = delete;
+  Heap &operator=(const Heap &) = delete;
+  Heap(Heap &&) = delete;
+  Heap &operator=(Heap &&) = delete;
+  ~Heap();
+
+  /* Values visited by tracer are the only roots for collection */
+  void setRoots(RootsTracer roots) { roots_ = std::move(roots); }
+
+  template <class T, class... Args> T *make(Args &&...args) {
+    static_assert(std::is_base_of_v<LeechObj, T>);
+    auto *mem = allocate(sizeof(T));
+    try {
+      return new (mem) T(std::forward<Args>(args)...);
+    } catch (...) {
+      /* Keep heap walkable */
+      new (mem) NoneObj();
+      throw;
+    }
+  }
+
+  /**
+   * Copy w/ value semantics: only mutable (class) objects are cloned.
+   * src has to be reachable from roots as allocation may move objects
+   */
+  [[nodiscard]] Value clone(const Value &src);
+
+  /* Has to be called after storing val into heap object owner */
+  void writeBarrier(LeechObj *owner, const Value &val) {
+    if (val.isBoxed() && nursery_.contains(val.getObj()) &&
+        oldSpace().contains(owner))
+      remember(owner);
+  }
+
+  void collectMinor();
+  void collectMajor();
+
+  [[nodiscard]] bool contains(const LeechObj *obj) const {
+    return nursery_.contains(obj) || oldSpace().contains(obj);
+  }
+  [[nodiscard]] bool inNursery(const LeechObj *obj) const {
+    return nursery_.contains(obj);
+  }
+
+  [[nodiscard]] std::size_t getHeapSize() const {
+    return nursery_.used() + oldSpace().used();
+  }
+  [[nodiscard]] std::size_t getCapacity() const {
+    return nursery_.capacity() + oldSpace().capacity();
+  }
+  [[nodiscard]] GCStats getStats() const {
+    auto stats = stats_;
+    stats.heapSize = getHeapSize();
+    return stats;
+  }
+
+  static ObjHeader *getHeader(const LeechObj *obj) {
+    return reinterpret_cast<ObjHeader *>(const_cast<LeechObj *>(obj)) - 1;
   }
 
 private:
+  [[nodiscard]] Region &oldSpace() { return old_[curOld_]; }
+  [[nodiscard]] const Region &oldSpace() const { return old_[curOld_]; }
+
+  static constexpr std::size_t allocSize(std::size_t objSize) {
+    return (sizeof(ObjHeader) + objSize + kAlign - 1) / kAlign * kAlign;
+  }
+
+  /* Get memory for object of objSize bytes w/ initialized header */
+  void *allocate(std::size_t objSize);
+  static void *initHeader(void *mem, std::size_t size);
+
+  void remember(LeechObj *owner);
+  void recordPause(std::chrono::steady_clock::duration pause);
+
+  /* Copy live objects of from regions into to region */
+  void evacuate(std::initializer_list<Region *> from, Region &to,
+                bool traceRemembered);
+  static void destroyAll(const Region &reg);
 };
+
 } // namespace leech::gc
 
 #endif // __INCLUDE_GC_GC_HH__
@@ -1,8 +1,13 @@
 #ifndef __INCLUDE_LEECHVM_LEECHVM_HH__
 #define __INCLUDE_LEECHVM_LEECHVM_HH__
 
+#include <filesystem>
+
+#include "executor/aot.hh"
 #include "executor/executor.hh"
 #include "frontend/frontend.hh"
+#include "leechfile/fusion.hh"
+#include "leechfile/verifier.hh"
 
 namespace leech {
 
@@ -14,12 +19,51 @@ public:
   LeechVM &operator=(const LeechVM &) = delete;
   LeechVM &operator=(LeechVM &&) = delete;
 
+  /* Loaded file is verified, see verify() */
   void generateLeechFile(std::istream &in, bool isFromBinary);
+  /* Use binary in place via mmap */
+  void mapLeechFile(const std::filesystem::path &path);
+  /**
+   * Parse source in place via mmap. W/ cache dir, the parsed file is kept
+   * there as binary named by hash of source, so loading the same source
+   * again maps the binary instead of parsing
+   */
+  void loadSource(const std::filesystem::path &path,
+                  const std::filesystem::path &cacheDir = {});
   void dumpBinary(std::ostream &out);
-  void run();
+  /* Returns number of superinstructions put to code */
+  std::size_t fuseSuperinstructions();
+  /* Compile functions of loaded file to native module */
+  void buildNative(const std::filesystem::path &out,
+                   const aot::BuildOptions &opts = {});
+  /* Run functions of loaded file w/ native code of module built for it */
+  void loadNative(const std::filesystem::path &path);
+  /* Native module is used unless opts have their own one */
+  void run(const ExecOptions &opts = {});
+
+  /* Loaded file, e.g. to share it w/ isolates. It isn't changed by them */
+  [[nodiscard]] std::shared_ptr<const LeechFile> getLeechFile() const {
+    return leechFile_;
+  }
+  /* Loaded native module, null if there is none */
+  [[nodiscard]] const aot::Module *getNative() const { return native_.get(); }
+
+  /* Heap stats of the last run */
+  [[nodiscard]] const auto &getGCStats() const { return gcStats_; }
+  /* Opcode n-grams of the last run if it was profiled */
+  [[nodiscard]] const auto &getNgramProfile() const { return ngramProfile_; }
+  /* Profile of the last run if it was profiled */
+  [[nodiscard]] const auto &getProfile() const { return profile_; }
+  /* JIT stats of the last run if JIT was on */
+  [[nodiscard]] const auto &getJitStats() const { return jitStats_; }
 
 private:
   std::shared_ptr<LeechFile> leechFile_ = nullptr;
+  std::unique_ptr<aot::Module> native_ = nullptr;
+  gc::GCStats gcStats_{};
+  std::optional<NgramProfile> ngramProfile_{};
+  std::optional<Profile> profile_{};
+  std::optional<jit::JitStats> jitStats_{};
 };
 
 } // namespace leech
@@ -0,0 +1,35 @@
+#ifndef __INCLUDE_LEECHFILE_FUSION_HH__
+#define __INCLUDE_LEECHFILE_FUSION_HH__
+
+#include <array>
+#include <span>
+
+#include "leechfile/leechfile.hh"
+
+namespace leech {
+
+constexpr std::array kAllFusedOpcodes{
+#define LEECH_MAKE_OPCODE(opc)
+#define LEECH_MAKE_FUSED_OPCODE(opc, ...) Opcodes::opc,
+#include "common/opcodes.ii"
+#undef LEECH_MAKE_FUSED_OPCODE
+#undef LEECH_MAKE_OPCODE
+};
+
+/**
+ * Peephole pass: put enabled superinstructions in place of the first
+ * instruction of matched sequences. The rest of a sequence stays in code,
+ * so jumps into its middle and return addresses remain valid. Sequences
+ * never cross function starts, cover w/ the least number of dispatches is
+ * chosen. Previously fused code is reverted first.
+ * Returns number of superinstructions put to code
+ */
+std::size_t fuseSuperinstructions(
+    LeechFile &file, std::span<const Opcodes> enabled = kAllFusedOpcodes);
+
+/* Put back original opcodes in place of superinstructions */
+void defuseSuperinstructions(LeechFile &file);
+
+} // namespace leech
+
+#endif // __INCLUDE_LEECHFILE_FUSION_HH__
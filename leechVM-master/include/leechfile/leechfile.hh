@@ -1,11 +1,17 @@
 #ifndef __INCLUDE_LEECHFILE_LEECHFILE_HH__
 #define __INCLUDE_LEECHFILE_LEECHFILE_HH__
 
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <filesystem>
 #include <istream>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -14,11 +20,81 @@
 
 namespace leech {
 
-struct FuncMeta final : public ISerializable {
+/**
+ * On-disk layout of leech binary (host byte order). All sections are
+ * 8-byte aligned, so mapped file is used in place:
+ *   Header | FuncEntry[funcNum] | Instruction[codeNum] | Ref[] | data
+ * Ref tables of constants and then of names of each function follow in
+ * FuncEntry order. Data holds names and serialized constants they refer to
+ */
+namespace image {
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kAlign = 8;
+
+/* Bytes [offset, offset + size) of file */
+struct Ref final {
+  std::uint64_t offset{};
+  std::uint64_t size{};
+};
+
+struct Header final {
+  char magic[8]{};
+  std::uint32_t version{};
+  std::uint32_t instSize{};
+  std::uint64_t fileSize{};
+  std::uint64_t funcNum{};
+  std::uint64_t funcsOffset{};
+  std::uint64_t codeNum{};
+  std::uint64_t codeOffset{};
+};
+
+struct FuncEntry final {
+  Ref name{};
+  std::uint64_t addr{};
+  std::uint64_t argNum{};
+  /* Ref[cstNum] to serialized constants */
+  std::uint64_t cstNum{};
+  std::uint64_t cstOffset{};
+  /* Ref[nameNum] to names */
+  std::uint64_t nameNum{};
+  std::uint64_t namesOffset{};
+};
+} // namespace image
+
+/**
+ * Intern table of constants: equal constants of all functions of a file
+ * share one immutable object. Not thread-safe
+ */
+class ConstTable final {
+  /* Keyed by serialized form, which tells both type and value */
+  std::unordered_map<std::string, pLeechObj> consts_{};
+
+public:
+  /* Mutable objects are returned as is */
+  pLeechObj intern(const pLeechObj &obj);
+  /* Decode serialized constant unless equal one is already interned */
+  pLeechObj intern(std::span<const std::byte> raw);
+
+  [[nodiscard]] auto size() const { return consts_.size(); }
+};
+
+struct FuncMeta final {
   FuncAddr addr{};
   uint64_t argNum{};
-  std::vector<std::shared_ptr<LeechObj>> cstPool{};
-  std::vector<std::string> names{};
+  /* Constants loaded from binary are null until getConst() decodes them */
+  mutable std::vector<std::shared_ptr<LeechObj>> cstPool{};
+  std::vector<std::span<const std::byte>> cstRaw{};
+  /* Table of the owning file lazily loaded constants are interned to */
+  ConstTable *constTable = nullptr;
+  /* Views of strings owned by LeechFile (or of static ones) */
+  std::vector<std::string_view> names{};
+  /* Dense local slot for each name (equal names share the slot), not
+   * serialized: resolved on load by resolveSlots() */
+  std::vector<std::size_t> slots{};
+  std::size_t slotsNum{};
+  /* Max depth of data stack, set by verify(). Frames of verified
+   * functions don't check their data stack bounds and indices */
+  std::optional<std::size_t> maxStack{};
 
   FuncMeta() = default;
 
@@ -30,32 +106,95 @@ struct FuncMeta final : public ISerializable {
 
   ~FuncMeta() = default;
 
-  void serialize(std::ostream &ost) const override;
-  static std::pair<std::string, FuncMeta> deserialize(std::istream &ist);
+  [[nodiscard]] bool isResolved() const {
+    return slots.size() == names.size();
+  }
+  void resolveSlots();
+
+  /* Not thread-safe on the first access of lazily loaded constant */
+  [[nodiscard]] const pLeechObj &getConst(std::size_t idx) const {
+    auto &cst = cstPool.at(idx);
+    if (cst == nullptr)
+      loadConst(idx);
+    return cst;
+  }
+  /* Decode all lazily loaded constants, so getConst() is read-only then */
+  void loadConsts() const;
+
+private:
+  void loadConst(std::size_t idx) const;
 };
 
-struct Meta final : public ISerializable {
+struct Meta final {
   std::unordered_map<std::string, FuncMeta> funcs{};
 
   Meta() = default;
   Meta(std::unordered_map<std::string, FuncMeta> &&funcs_);
   Meta(const std::unordered_map<std::string, FuncMeta> &funcs_);
 
-  void serialize(std::ostream &ost) const override;
-  static Meta deserialize(std::istream &ist);
+  void resolveSlots();
 };
 
+/* Read-only private mapping of whole file, unmapped w/ its last copy */
+struct MappedFile final {
+  std::shared_ptr<const std::byte> data{};
+  std::size_t size = 0;
+
+  [[nodiscard]] std::span<const char> chars() const {
+    return {reinterpret_cast<const char *>(data.get()), size};
+  }
+
+  /* Empty file has no mapping */
+  static MappedFile map(const std::filesystem::path &path);
+};
+
+/**
+ * Leech bytecode file. Code and names may refer to the memory file was
+ * loaded from, so the file is movable only
+ */
 struct LeechFile final : public ISerializable {
   constexpr static std::string_view theLEECH = "theLEECH";
 
   Meta meta{};
-  std::vector<Instruction> code{};
+  std::span<const Instruction> code{};
 
+private:
+  std::vector<Instruction> ownCode_{};
+  std::deque<std::string> ownStrings_{};
+  std::shared_ptr<const std::byte> storage_{};
+  std::unique_ptr<ConstTable> constTable_ = std::make_unique<ConstTable>();
+
+public:
   LeechFile() = default;
   LeechFile(Meta &&meta_, std::vector<Instruction> &&code_);
+
+  LeechFile(const LeechFile &) = delete;
+  LeechFile &operator=(const LeechFile &) = delete;
+  LeechFile(LeechFile &&) = default;
+  LeechFile &operator=(LeechFile &&) = default;
+
+  void setCode(std::vector<Instruction> &&code_);
+  /* Copy mapped code to own storage to patch it */
+  std::span<Instruction> makeCodeMutable();
+  /* Keep string alive as long as file is */
+  std::string_view addString(std::string str);
+  /* Share constant w/ equal ones of all functions */
+  pLeechObj internConst(const pLeechObj &obj) {
+    return constTable_->intern(obj);
+  }
+  [[nodiscard]] const auto &getConstTable() const { return *constTable_; }
+  /* Decode constants of all functions, file may be shared by threads then */
+  void loadConsts() const;
+
   void serialize(std::ostream &ost) const override;
   static LeechFile deserialize(std::istream &ist);
+  /* mmap binary, code and names are used in place w/o copying */
+  static LeechFile mapFile(const std::filesystem::path &path);
   void dump2LeechFormat(std::ostream &ost);
+
+private:
+  static LeechFile load(std::shared_ptr<const std::byte> storage,
+                        std::size_t size);
 };
 
 } // namespace leech
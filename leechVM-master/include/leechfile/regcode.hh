@@ -0,0 +1,106 @@
+#ifndef __INCLUDE_LEECHFILE_REGCODE_HH__
+#define __INCLUDE_LEECHFILE_REGCODE_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "leechfile/leechfile.hh"
+
+namespace leech {
+
+/**
+ * Internal register-based form of leech bytecode. Operands name local slots
+ * and constants directly, so loads feeding an instruction cost no dispatch.
+ * Data stack is kept as is: values which stack code leaves on it are still
+ * pushed, so calls and returns see exactly the same frames
+ */
+namespace reg {
+
+enum class RegOpcode : std::uint8_t {
+  /* dst <- a */
+  Push,
+  Move,
+  /* Drop the top of data stack */
+  Pop,
+  /* dst <- a op b */
+  Add,
+  Sub,
+  Div,
+  Subscr,
+  /* dst <- a cmp b, cmp is arg */
+  Compare,
+  Print,
+  /* Jump to target if a is (not) zero */
+  JumpIfFalse,
+  JumpIfTrue,
+  /* Jump to target if a cmp b is false (true) */
+  JumpIfNotCmp,
+  JumpIfCmp,
+  /* Run stack instruction inst as is */
+  Stack,
+  /* Sentinel after the last instruction */
+  End
+};
+
+enum class OperandKind : std::uint8_t {
+  None,
+  /* Local slot of current frame */
+  Local,
+  /* Constant of RegCode::consts */
+  Const,
+  /* Value popped from data stack, result is pushed to it */
+  Stack,
+  /* Top of data stack which is left there */
+  Top
+};
+
+struct Operand final {
+  OperandKind kind = OperandKind::None;
+  std::uint32_t idx = 0;
+
+  bool operator==(const Operand &) const = default;
+};
+
+struct RegInst final {
+  RegOpcode opcode = RegOpcode::End;
+  std::uint8_t arg = 0;
+  Operand dst{};
+  Operand a{};
+  Operand b{};
+  /* Index of jump destination in RegCode::code */
+  std::uint32_t target = 0;
+  /* Stack code instruction was translated from */
+  std::uint64_t pc = 0;
+  Instruction inst{};
+};
+
+constexpr std::uint32_t kNoEntry = std::numeric_limits<std::uint32_t>::max();
+
+struct RegCode final {
+  std::vector<RegInst> code{};
+  std::vector<Value> consts{};
+  /* Index of register instruction to resume stack code pc from, kNoEntry
+   * unless pc is function start, jump destination or return address */
+  std::vector<std::uint32_t> entries{};
+
+  [[nodiscard]] std::uint32_t getEntry(std::uint64_t pc) const {
+    if (pc >= entries.size() || entries[pc] == kNoEntry)
+      throw std::out_of_range{"No register code entry for pc " +
+                              std::to_string(pc)};
+    return entries[pc];
+  }
+};
+
+/* Translate stack code of func, appending it to res */
+void translateFunc(const LeechFile &file, const FuncMeta &func,
+                   std::uint64_t end, RegCode &res);
+
+/* Translate code of all functions of file, superinstructions are allowed */
+RegCode translate(const LeechFile &file);
+
+} // namespace reg
+} // namespace leech
+
+#endif // __INCLUDE_LEECHFILE_REGCODE_HH__
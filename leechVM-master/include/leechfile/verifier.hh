@@ -0,0 +1,36 @@
+#ifndef __INCLUDE_LEECHFILE_VERIFIER_HH__
+#define __INCLUDE_LEECHFILE_VERIFIER_HH__
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "leechfile/leechfile.hh"
+
+namespace leech {
+
+struct VerifyError : public std::runtime_error {
+  VerifyError(std::string_view func, std::uint64_t pc, const std::string &what)
+      : std::runtime_error("Verification of " + std::string(func) +
+                           " failed at pc " + std::to_string(pc) + ": " +
+                           what) {}
+};
+
+/**
+ * Load-time check of code of all functions by abstract interpretation of
+ * data stack depth. Instructions reachable from function start must:
+ *  - not pop below the bottom of data stack,
+ *  - have constant, name, comparison and jump args in range,
+ *  - stay in function code (no jumps out of it, no running off its end),
+ *  - call existing functions, methods only by CALL_METHOD.
+ * Methods start w/ self on data stack. Throws VerifyError on the first
+ * violation. Sets FuncMeta::maxStack of functions reaching each
+ * instruction w/ the same depth on all paths, the rest (e.g. loops leaving
+ * values on data stack) have unbounded one and stay checked
+ */
+void verify(LeechFile &file);
+
+} // namespace leech
+
+#endif // __INCLUDE_LEECHFILE_VERIFIER_HH__
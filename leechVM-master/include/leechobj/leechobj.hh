@@ -2,23 +2,39 @@
 #define __INCLUDE_LEECHOBJ_LEECHOBJ_HH__
 
 #include <algorithm>
+#include <cstddef>
 #include <istream>
 #include <map>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <optional>
 #include <ostream>
 #include <set>
+#include <span>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "common/common.hh"
 #include "common/opcodes.hh"
+#include "leechobj/shape.hh"
 
 namespace leech {
 
 class LeechObj;
 using pLeechObj = std::shared_ptr<LeechObj>;
 
+class Value;
+
+/* Visitor over values referenced by heap objects, used for GC tracing */
+struct IValueVisitor {
+  virtual void visit(Value &val) = 0;
+  virtual ~IValueVisitor() = default;
+};
+
 class LeechObj : public ISerializable {
   std::size_t size_{};
   ValueType type_{};
@@ -40,7 +56,16 @@ public:
   [[noreturn]] virtual pLeechObj div(LeechObj *obj) const;
   [[noreturn]] virtual pLeechObj subscript(LeechObj *obj) const;
 
+  /* GC support: placement copy/move into getAllocSize() bytes of mem */
+  [[nodiscard]] virtual std::size_t getAllocSize() const = 0;
+  virtual LeechObj *copyTo(void *mem) const = 0;
+  virtual LeechObj *moveTo(void *mem) = 0;
+  /* Visit all values the object refers to */
+  virtual void traceRefs([[maybe_unused]] IValueVisitor &vis) {}
+
   auto getType() const { return type_; }
+  /* Immutable objects are shared instead of being cloned */
+  [[nodiscard]] bool isImmutable() const { return type_ != ValueType::Class; }
 
 protected:
   void serializeTypeNSize(std::ostream &ost) const {
@@ -55,11 +80,102 @@ private:
   virtual void serializeVal(std::ostream &) const = 0;
 };
 
+/* Implements GC support of LeechObj for Derived via its copy/move ctors */
+template <class Derived> class HeapObj : public LeechObj {
+public:
+  using LeechObj::LeechObj;
+
+  [[nodiscard]] std::size_t getAllocSize() const override {
+    return sizeof(Derived);
+  }
+  LeechObj *copyTo(void *mem) const override {
+    return new (mem) Derived(static_cast<const Derived &>(*this));
+  }
+  LeechObj *moveTo(void *mem) override {
+    return new (mem) Derived(std::move(static_cast<Derived &>(*this)));
+  }
+};
+
 inline pLeechObj deserializeObj(std::istream &ist);
 
-class NoneObj final : public LeechObj {
+/* Integers in [kSmallIntMin, kSmallIntMax] are preboxed once per process */
+constexpr Integer kSmallIntMin = -5;
+constexpr Integer kSmallIntMax = 256;
+
+/* Boxed integer, shared one for small values */
+inline pLeechObj makeInt(Integer val);
+
+/**
+ * Tagged value stored on the data stack and in variables.
+ * Integer/Float/None live inline, only String/Tuple/Class objects are boxed.
+ * Boxed objects are not owned: they are either constants kept alive by
+ * FuncMeta or objects of GC heap.
+ */
+class Value final {
+  ValueType type_ = ValueType::Unknown;
+  union {
+    Integer int_ = 0;
+    Float float_;
+    LeechObj *obj_;
+  };
+
 public:
-  NoneObj() : LeechObj(0, ValueType::None) {}
+  Value() = default;
+  explicit Value(Integer val) : type_(ValueType::Integer), int_(val) {}
+  explicit Value(Float val) : type_(ValueType::Float), float_(val) {}
+  explicit Value(LeechObj *obj);
+  explicit Value(const pLeechObj &obj) : Value(obj.get()) {}
+
+  static Value none() {
+    Value val{};
+    val.type_ = ValueType::None;
+    return val;
+  }
+
+  [[nodiscard]] auto getType() const { return type_; }
+  [[nodiscard]] bool isBound() const { return type_ != ValueType::Unknown; }
+  [[nodiscard]] bool isBoxed() const {
+    return type_ == ValueType::String || type_ == ValueType::Tuple ||
+           type_ == ValueType::Class || type_ == ValueType::Slice ||
+           type_ == ValueType::Iterator;
+  }
+
+  [[nodiscard]] auto getInt() const { return int_; }
+  [[nodiscard]] auto getFloat() const { return float_; }
+  [[nodiscard]] auto getObj() const { return isBoxed() ? obj_ : nullptr; }
+  /* Used by GC to update reference to relocated object */
+  void setObj(LeechObj *obj) { obj_ = obj; }
+
+  /**
+   * Get value as object, numbers are boxed on demand.
+   * Boxed objects are returned w/o taking ownership
+   */
+  [[nodiscard]] pLeechObj toObj() const;
+
+  void print() const;
+
+  [[nodiscard]] bool compare(const Value &val, CmpOp op) const;
+  [[nodiscard]] Value add(const Value &val) const;
+  [[nodiscard]] Value sub(const Value &val) const;
+  [[nodiscard]] Value div(const Value &val) const;
+  /* Tuple slices are views allocated in heap, so they aren't done here */
+  [[nodiscard]] Value subscript(const Value &idx) const;
+  /* Number of elements of tuple, characters of string */
+  [[nodiscard]] Integer len() const;
+
+  /* Layout known to JIT compiled code */
+  static constexpr std::size_t getTypeOffset();
+  static constexpr std::size_t getPayloadOffset();
+};
+
+constexpr std::size_t Value::getTypeOffset() { return offsetof(Value, type_); }
+constexpr std::size_t Value::getPayloadOffset() {
+  return offsetof(Value, int_);
+}
+
+class NoneObj final : public HeapObj<NoneObj> {
+public:
+  NoneObj() : HeapObj(0, ValueType::None) {}
 
   void print() const override { std::cout << "None" << std::endl; }
 
@@ -69,25 +185,33 @@ private:
   void serializeVal(std::ostream &) const override {}
 };
 
-template <typename T> class NumberObj final : public LeechObj {
+template <typename T> class NumberObj final : public HeapObj<NumberObj<T>> {
   static_assert(NumberLeech_v<T>);
   T value_{};
 
 public:
+  using LeechObj::getType;
+
   explicit NumberObj(T value)
-      : LeechObj(sizeof(T), typeToValueType<T>()), value_(value) {}
+      : HeapObj<NumberObj<T>>(sizeof(T), typeToValueType<T>()),
+        value_(value) {}
 
   void print() const override { std::cout << value_; }
 
+  static pLeechObj make(T val) {
+    if constexpr (std::is_same_v<T, Integer>)
+      return makeInt(val);
+    else
+      return std::make_shared<NumberObj>(val);
+  }
+
   static pLeechObj deserialize(std::istream &ist) {
     deserializeNum<uint64_t>(ist);
     auto val = deserializeNum<T>(ist);
-    return std::make_unique<NumberObj>(val);
+    return make(val);
   }
 
-  pLeechObj clone() const override {
-    return std::make_unique<NumberObj>(value_);
-  }
+  pLeechObj clone() const override { return make(value_); }
 
   pLeechObj div(LeechObj *obj) const override {
     if (obj->getType() != getType())
@@ -132,14 +256,14 @@ public:
     auto pobj = dynamic_cast<NumberObj *>(obj);
     if (nullptr == pobj)
       throw std::runtime_error("Dynamic cast failed");
-    return std::make_unique<NumberObj>(value_ - pobj->value_);
+    return make(value_ - pobj->value_);
   }
 
   pLeechObj add(LeechObj *obj) const override {
     auto pobj = dynamic_cast<NumberObj *>(obj);
     if (nullptr == pobj)
       throw std::runtime_error("Dynamic cast failed");
-    return std::make_unique<NumberObj>(pobj->value_ + value_);
+    return make(pobj->value_ + value_);
   }
 
   auto getVal() const { return value_; }
@@ -153,15 +277,43 @@ private:
 using IntObj = NumberObj<Integer>;
 using FloatObj = NumberObj<Float>;
 
-class StringObj final : public LeechObj {
+namespace detail {
+/* Aliasing ctor w/ empty owner: no refcounting, no deletion */
+inline pLeechObj borrow(LeechObj *obj) {
+  return pLeechObj(pLeechObj{}, obj);
+}
+} // namespace detail
+
+inline pLeechObj makeInt(Integer val) {
+  if (val < kSmallIntMin || val > kSmallIntMax)
+    return std::make_shared<IntObj>(val);
+
+  static auto cache = [] {
+    std::vector<IntObj> res{};
+    res.reserve(static_cast<std::size_t>(kSmallIntMax - kSmallIntMin + 1));
+    for (auto i = kSmallIntMin; i <= kSmallIntMax; ++i)
+      res.emplace_back(i);
+    return res;
+  }();
+  return detail::borrow(&cache[static_cast<std::size_t>(val - kSmallIntMin)]);
+}
+
+inline pLeechObj makeNone() {
+  static NoneObj none{};
+  return detail::borrow(&none);
+}
+
+class StringObj final : public HeapObj<StringObj> {
   std::string string_;
 
 public:
   explicit StringObj(std::string_view string)
-      : LeechObj(string.size(), ValueType::String), string_(string) {}
+      : HeapObj(string.size(), ValueType::String), string_(string) {}
 
   void print() const override { std::cout << '"' << string_ << '"'; }
 
+  [[nodiscard]] std::size_t size() const { return string_.size(); }
+
   pLeechObj clone() const override {
     return std::make_unique<StringObj>(string_);
   }
@@ -179,13 +331,15 @@ private:
   }
 };
 
-class ClassObj final : public LeechObj {
-
-  std::map<std::string, pLeechObj> fields{};
-  std::set<std::string> methods{};
+/**
+ * Object w/ fields stored in slots, layout is described by its shape
+ */
+class ClassObj final : public HeapObj<ClassObj> {
+  const Shape *shape_ = Shape::getRoot();
+  std::vector<Value> slots_{};
 
 public:
-  explicit ClassObj() : LeechObj(sizeof(ClassObj), ValueType::Class) {}
+  explicit ClassObj() : HeapObj(sizeof(ClassObj), ValueType::Class) {}
 
   ClassObj(ClassObj &&) = default;
   ClassObj(const ClassObj &) = default;
@@ -196,47 +350,61 @@ public:
   void print() const override {
     std::cout << "~~~Class dump:~~~" << std::endl;
     std::cout << "~~~Fields~~~" << std::endl;
-    for (auto &&[key, value] : fields) {
+    for (auto &&[key, slot] : shape_->getSlots()) {
       std::cout << "key: " << key << " = ";
-      value->print();
+      slots_[slot].print();
       std::cout << std::endl;
     }
     std::cout << "~~~Methods~~~" << std::endl;
-    for (auto &&met : methods) {
+    for (auto &&met : shape_->getMethods()) {
       std::cout << met << std::endl;
     }
     std::cout << "~~~~~~~~~~~~~" << std::endl;
   }
 
-  void updateField(std::string_view name, pLeechObj obj) {
-    fields.insert_or_assign(std::string(name), obj);
+  void updateField(std::string_view name, const Value &val) {
+    if (auto slot = shape_->lookup(name); slot.has_value())
+      slots_[*slot] = val;
+    else
+      addSlot(shape_->addField(name), val);
   }
 
   void registerMethod(std::string_view name) {
-    auto res = methods.insert(std::string(name));
-    if (!res.second) // name already exist
+    if (shape_->hasMethod(name)) // name already exist
       throw std::logic_error("Trying to register method 2nd time");
+    shape_ = shape_->addMethod(name);
   }
 
-  void checkMethod(std::string_view name) {
-    auto It = methods.find(std::string(name));
-    if (It == methods.end()) {
+  void checkMethod(std::string_view name) const {
+    if (!shape_->hasMethod(name)) {
       auto msg = std::string("There is no method named ") += std::string(name);
       throw std::logic_error(msg.c_str());
     }
   }
 
-  pLeechObj getField(std::string_view name) const {
-    auto It = fields.find(std::string(name));
-    if (It == fields.end()) {
+  const Value &getField(std::string_view name) const {
+    auto slot = shape_->lookup(name);
+    if (!slot.has_value()) {
       auto msg = std::string("Invalid field name: ") += std::string(name);
       throw std::runtime_error(msg);
-    } else
-      return It->second;
+    }
+    return slots_[*slot];
+  }
+
+  /* Slot access for inline caches, shape has to be checked by the caller */
+  [[nodiscard]] const Shape *getShape() const { return shape_; }
+  [[nodiscard]] const Value &getSlot(std::size_t idx) const {
+    return slots_[idx];
+  }
+  void setSlot(std::size_t idx, const Value &val) { slots_[idx] = val; }
+  /* Move to shape next which is this shape w/ one more field */
+  void addSlot(const Shape *next, const Value &val) {
+    shape_ = next;
+    slots_.push_back(val);
   }
 
-  std::size_t getNumFields() { return fields.size(); }
-  std::size_t getNumMethods() { return methods.size(); }
+  std::size_t getNumFields() { return slots_.size(); }
+  std::size_t getNumMethods() { return shape_->getMethods().size(); }
 
   void serializeVal([[maybe_unused]] std::ostream &ost) const override {
     throw std::runtime_error("Hey buddy, I think you've got the wrong door, "
@@ -245,30 +413,96 @@ public:
 
   pLeechObj clone() const override { return std::make_shared<ClassObj>(*this); }
 
+  void traceRefs(IValueVisitor &vis) override {
+    for (auto &val : slots_)
+      vis.visit(val);
+  }
+
   // TODO :  deserialize
 };
 
 using Tuple = std::vector<pLeechObj>;
 
-class TupleObj final : public LeechObj {
-  Tuple tuple_;
+/**
+ * Immutable tuple. Elements of tuple of numbers of one type are kept unboxed
+ * in Integer or Float array, inline if they fit kInlineBytes. The rest are
+ * kept as Values: boxed elements of constant tuple are owned by it, the ones
+ * of heap tuple are heap objects traced by GC. Out-of-line elements are
+ * shared w/ slice views, so slicing copies nothing
+ */
+class TupleObj final : public HeapObj<TupleObj> {
+public:
+  enum class Kind : std::uint8_t { Ints, Floats, Values };
+
+  static constexpr std::size_t kInlineBytes = 4 * sizeof(Integer);
+
+private:
+  Kind kind_ = Kind::Ints;
+  /* Index of the first element in out-of-line storage */
+  std::size_t offset_ = 0;
+  std::shared_ptr<std::byte> shared_{};
+  /* Boxed elements of constant tuple, parallel to shared storage */
+  std::shared_ptr<const Tuple> owners_{};
+  alignas(Value) std::byte inline_[kInlineBytes]{};
+
+  static_assert(std::is_trivially_copyable_v<Value>);
 
 public:
+  /* Constant tuple of objects */
   template <class InpIt>
+    requires std::is_convertible_v<std::iter_value_t<InpIt>, pLeechObj>
   TupleObj(InpIt begin, InpIt end)
-      : LeechObj(static_cast<std::size_t>(std::distance(begin, end)),
-                 ValueType::Tuple),
-        tuple_(getSize()) {
-    std::move(begin, end, tuple_.begin());
+      : HeapObj(static_cast<std::size_t>(std::distance(begin, end)),
+                ValueType::Tuple) {
+    Tuple objs(getSize());
+    std::move(begin, end, objs.begin());
+
+    std::vector<Value> vals{};
+    vals.reserve(objs.size());
+    for (const auto &obj : objs)
+      vals.emplace_back(obj);
+    init(vals);
+    if (kind_ == Kind::Values)
+      owners_ = std::make_shared<const Tuple>(std::move(objs));
   }
 
   template <class Cont>
   explicit TupleObj(Cont &&cont) : TupleObj(cont.begin(), cont.end()) {}
 
+  /* Heap tuple of values, boxed ones have to be kept alive by GC */
+  explicit TupleObj(std::span<const Value> vals)
+      : HeapObj(vals.size(), ValueType::Tuple) {
+    init(vals);
+  }
+
+  /* View of tuple[begin:end], bounds have to be resolved by the caller */
+  TupleObj(const Value &tuple, std::size_t begin, std::size_t end)
+      : HeapObj(end - begin, ValueType::Tuple) {
+    const auto &src = *static_cast<const TupleObj *>(tuple.getObj());
+    if (begin > end || end > src.size())
+      throw std::out_of_range{"Tuple slice is out of range"};
+
+    kind_ = src.kind_;
+    owners_ = src.owners_;
+    if (src.shared_ == nullptr) {
+      auto elemSize = getElemSize(kind_);
+      std::copy_n(src.inline_ + begin * elemSize, size() * elemSize,
+                  inline_);
+      return;
+    }
+    shared_ = src.shared_;
+    offset_ = src.offset_ + begin;
+  }
+
+  [[nodiscard]] std::size_t size() const { return getSize(); }
+  [[nodiscard]] Kind getKind() const { return kind_; }
+  /* Whether elements are shared w/ other tuples */
+  [[nodiscard]] bool isInline() const { return shared_ == nullptr; }
+
   void print() const override {
     std::cout << '(';
-    for (auto &&elem : tuple_) {
-      elem->print();
+    for (std::size_t i = 0; i < size(); ++i) {
+      get(i).print();
       std::cout << ',';
     }
     std::cout << ')';
@@ -278,21 +512,38 @@ public:
     if (pobj->getType() != ValueType::Integer)
       throw std::invalid_argument("Incorrect subscription index");
 
-    auto *numObj = dynamic_cast<IntObj *>(pobj);
-
-    return tuple_.at(static_cast<std::size_t>(numObj->getVal()));
+    auto idx = checkIdx(static_cast<IntObj *>(pobj)->getVal());
+    if (owners_ != nullptr)
+      return (*owners_)[offset_ + idx];
+    return get(idx).toObj();
   }
 
+  [[nodiscard]] Value at(Integer idx) const { return get(checkIdx(idx)); }
+
   pLeechObj clone() const override {
-    Tuple res;
-    res.reserve(tuple_.size());
+    if (owners_ == nullptr)
+      return std::make_unique<TupleObj>(*this);
 
-    for (auto &&elem : tuple_)
-      res.push_back(elem->clone());
+    /* Mutable elements of constant tuple are cloned */
+    Tuple res;
+    res.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i) {
+      const auto &elem = (*owners_)[offset_ + i];
+      res.push_back(elem->isImmutable() ? elem : elem->clone());
+    }
 
     return std::make_unique<TupleObj>(std::move(res));
   }
 
+  void traceRefs(IValueVisitor &vis) override {
+    /* Elements of constant tuple are constants */
+    if (kind_ != Kind::Values || owners_ != nullptr)
+      return;
+    auto *vals = const_cast<Value *>(data<Value>());
+    for (std::size_t i = 0; i < size(); ++i)
+      vis.visit(vals[i]);
+  }
+
   static pLeechObj deserialize(std::istream &ist) {
     auto len = deserializeNum<uint64_t>(ist);
     Tuple tuple{};
@@ -303,9 +554,164 @@ public:
   }
 
 private:
+  static std::size_t getElemSize(Kind kind) {
+    return kind == Kind::Values ? sizeof(Value) : sizeof(Integer);
+  }
+
+  template <class T> [[nodiscard]] const T *data() const {
+    const auto *base = shared_ == nullptr ? inline_ : shared_.get();
+    return std::launder(reinterpret_cast<const T *>(base)) + offset_;
+  }
+
+  [[nodiscard]] Value get(std::size_t pos) const {
+    switch (kind_) {
+    case Kind::Ints:
+      return Value(data<Integer>()[pos]);
+    case Kind::Floats:
+      return Value(data<Float>()[pos]);
+    default:
+      return data<Value>()[pos];
+    }
+  }
+
+  [[nodiscard]] std::size_t checkIdx(Integer idx) const {
+    if (idx < 0 || static_cast<std::size_t>(idx) >= size())
+      throw std::out_of_range{"Tuple index is out of range"};
+    return static_cast<std::size_t>(idx);
+  }
+
+  /* Pick representation for vals and copy them to storage */
+  void init(std::span<const Value> vals) {
+    auto isOf = [vals](ValueType type) {
+      return std::all_of(vals.begin(), vals.end(),
+                         [type](const auto &val) {
+                           return val.getType() == type;
+                         });
+    };
+    kind_ = isOf(ValueType::Integer) ? Kind::Ints
+            : isOf(ValueType::Float) ? Kind::Floats
+                                     : Kind::Values;
+
+    /* Values are never inline: slices share them to let GC update them */
+    auto bytes = vals.size() * getElemSize(kind_);
+    std::byte *mem = inline_;
+    if (kind_ == Kind::Values || bytes > kInlineBytes) {
+      shared_ = {static_cast<std::byte *>(::operator new(bytes)),
+                 [](std::byte *ptr) { ::operator delete(ptr); }};
+      mem = shared_.get();
+    }
+
+    for (std::size_t i = 0; i < vals.size(); ++i)
+      switch (kind_) {
+      case Kind::Ints:
+        new (mem + i * sizeof(Integer)) Integer(vals[i].getInt());
+        break;
+      case Kind::Floats:
+        new (mem + i * sizeof(Float)) Float(vals[i].getFloat());
+        break;
+      default:
+        new (mem + i * sizeof(Value)) Value(vals[i]);
+      }
+  }
+
   void serializeVal(std::ostream &ost) const override {
-    for (auto &&ptr : tuple_)
-      ptr->serialize(ost);
+    for (std::size_t i = 0; i < size(); ++i)
+      get(i).toObj()->serialize(ost);
+  }
+};
+
+/* Bounds of tuple slice, missing ones are None */
+class SliceObj final : public HeapObj<SliceObj> {
+  std::optional<Integer> begin_{};
+  std::optional<Integer> end_{};
+
+public:
+  SliceObj(std::optional<Integer> begin, std::optional<Integer> end)
+      : HeapObj(sizeof(SliceObj), ValueType::Slice), begin_(begin),
+        end_(end) {}
+
+  void print() const override {
+    auto printBound = [](const std::optional<Integer> &bound) {
+      if (bound.has_value())
+        std::cout << *bound;
+      else
+        std::cout << "None";
+    };
+    std::cout << "slice(";
+    printBound(begin_);
+    std::cout << ", ";
+    printBound(end_);
+    std::cout << ')';
+  }
+
+  pLeechObj clone() const override {
+    return std::make_unique<SliceObj>(*this);
+  }
+
+  [[nodiscard]] auto getBegin() const { return begin_; }
+  [[nodiscard]] auto getEnd() const { return end_; }
+
+  /* [begin, end) of sequence of len elements: negative bounds count from
+   * its end, the ones out of it are clamped */
+  [[nodiscard]] std::pair<std::size_t, std::size_t>
+  resolve(std::size_t len) const {
+    auto slen = static_cast<Integer>(len);
+    auto clamp = [slen](std::optional<Integer> bound, Integer dflt) {
+      auto val = bound.value_or(dflt);
+      if (val < 0)
+        val += slen;
+      return static_cast<std::size_t>(std::clamp<Integer>(val, 0, slen));
+    };
+    auto begin = clamp(begin_, 0);
+    return {begin, std::max(begin, clamp(end_, slen))};
+  }
+
+private:
+  void serializeVal([[maybe_unused]] std::ostream &ost) const override {
+    throw std::runtime_error("Slices can't be serialized");
+  }
+};
+
+/**
+ * Iterator over tuple or integer range [next, end). Elements are produced
+ * as Values, so steps allocate nothing. Iterators are shared, not cloned
+ */
+class IterObj final : public HeapObj<IterObj> {
+  /* Tuple iterated over, None for range */
+  Value seq_{};
+  Integer next_ = 0;
+  Integer end_ = 0;
+
+public:
+  explicit IterObj(const Value &tuple)
+      : HeapObj(sizeof(IterObj), ValueType::Iterator), seq_(tuple),
+        end_(tuple.len()) {}
+
+  IterObj(Integer begin, Integer end)
+      : HeapObj(sizeof(IterObj), ValueType::Iterator), seq_(Value::none()),
+        next_(begin), end_(end) {}
+
+  /* Store the next element to val, false if there are no more */
+  bool next(Value &val) {
+    if (next_ >= end_)
+      return false;
+    if (seq_.getType() == ValueType::Tuple)
+      val = static_cast<const TupleObj *>(seq_.getObj())->at(next_);
+    else
+      val = Value(next_);
+    ++next_;
+    return true;
+  }
+
+  void print() const override { std::cout << "<iterator>"; }
+
+  pLeechObj clone() const override { return std::make_unique<IterObj>(*this); }
+
+  void traceRefs(IValueVisitor &vis) override { vis.visit(seq_); }
+
+private:
+  void serializeVal([[maybe_unused]] std::ostream &ost) const override {
+    throw std::runtime_error("Iterators can't be serialized");
   }
 };
 
@@ -327,6 +733,126 @@ inline pLeechObj deserializeObj(std::istream &ist) {
   }
 }
 
+/**
+ * Value definitions
+ */
+
+inline Value::Value(LeechObj *obj) {
+  if (nullptr == obj)
+    return;
+
+  type_ = obj->getType();
+  switch (type_) {
+  case ValueType::Integer:
+    int_ = static_cast<IntObj *>(obj)->getVal();
+    break;
+  case ValueType::Float:
+    float_ = static_cast<FloatObj *>(obj)->getVal();
+    break;
+  case ValueType::None:
+    break;
+  default:
+    obj_ = obj;
+  }
+}
+
+inline pLeechObj Value::toObj() const {
+  switch (type_) {
+  case ValueType::Integer:
+    return makeInt(int_);
+  case ValueType::Float:
+    return std::make_shared<FloatObj>(float_);
+  case ValueType::None:
+    return makeNone();
+  default:
+    return detail::borrow(getObj());
+  }
+}
+
+inline void Value::print() const {
+  switch (type_) {
+  case ValueType::Integer:
+    std::cout << int_;
+    break;
+  case ValueType::Float:
+    std::cout << float_;
+    break;
+  case ValueType::Unknown:
+    throw std::runtime_error("Trying to print unbound value");
+  case ValueType::None:
+    std::cout << "None" << std::endl;
+    break;
+  default:
+    obj_->print();
+  }
+}
+
+inline bool Value::compare(const Value &val, CmpOp op) const {
+  if (type_ != ValueType::Integer || val.type_ != ValueType::Integer)
+    return toObj()->compare(val.toObj().get(), op);
+
+  switch (op) {
+  case CmpOp::LE:
+    return int_ < val.int_;
+  case CmpOp::LEQ:
+    return int_ <= val.int_;
+  case CmpOp::EQ:
+    return int_ == val.int_;
+  case CmpOp::NEQ:
+    return int_ != val.int_;
+  case CmpOp::GR:
+    return int_ > val.int_;
+  case CmpOp::GREQ:
+    return int_ >= val.int_;
+
+  default:
+    throw std::runtime_error("Uknown cmp op type");
+  }
+}
+
+inline Value Value::add(const Value &val) const {
+  if (type_ == ValueType::Integer && val.type_ == ValueType::Integer)
+    return Value(val.int_ + int_);
+  if (type_ == ValueType::Float && val.type_ == ValueType::Float)
+    return Value(val.float_ + float_);
+  return Value(toObj()->add(val.toObj().get()));
+}
+
+inline Value Value::sub(const Value &val) const {
+  if (type_ == ValueType::Integer && val.type_ == ValueType::Integer)
+    return Value(int_ - val.int_);
+  if (type_ == ValueType::Float && val.type_ == ValueType::Float)
+    return Value(float_ - val.float_);
+  return Value(toObj()->sub(val.toObj().get()));
+}
+
+inline Value Value::div(const Value &val) const {
+  if (type_ == ValueType::Integer && val.type_ == ValueType::Integer)
+    return Value(static_cast<Float>(int_) / static_cast<Float>(val.int_));
+  if (type_ == ValueType::Float && val.type_ == ValueType::Float)
+    return Value(float_ / val.float_);
+  return Value(toObj()->div(val.toObj().get()));
+}
+
+inline Value Value::subscript(const Value &idx) const {
+  if (type_ == ValueType::Tuple && idx.type_ == ValueType::Integer)
+    return static_cast<TupleObj *>(obj_)->at(idx.int_);
+  if (idx.type_ == ValueType::Slice)
+    throw std::logic_error("Slicing value w/o heap to put view to");
+  return Value(toObj()->subscript(idx.toObj().get()));
+}
+
+inline Integer Value::len() const {
+  switch (type_) {
+  case ValueType::Tuple:
+    return static_cast<Integer>(static_cast<TupleObj *>(obj_)->size());
+  case ValueType::String:
+    return static_cast<Integer>(static_cast<StringObj *>(obj_)->size());
+  default:
+    throw std::invalid_argument("Value has no length");
+  }
+}
+
 } // namespace leech
 
 #endif // __INCLUDE_LEECHOBJ_LEECHOBJ_HH__
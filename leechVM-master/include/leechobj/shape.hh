@@ -0,0 +1,107 @@
+#ifndef __INCLUDE_LEECHOBJ_SHAPE_HH__
+#define __INCLUDE_LEECHOBJ_SHAPE_HH__
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace leech {
+
+/**
+ * Hidden class of ClassObj: maps field names to slot indices and holds
+ * registered methods. Shapes are immutable and shared between objects,
+ * adding a field or a method moves object to the child shape, so objects
+ * built the same way end up w/ the same shape.
+ */
+class Shape final {
+public:
+  using SlotMap = std::map<std::string, std::size_t, std::less<>>;
+  using MethodSet = std::set<std::string, std::less<>>;
+
+private:
+  using Transitions =
+      std::map<std::string, std::unique_ptr<Shape>, std::less<>>;
+
+  std::uint32_t id_ = 0;
+  SlotMap slots_{};
+  MethodSet methods_{};
+  /* Children are created lazily, shape tree may be shared by threads */
+  mutable Transitions fieldTrans_{};
+  mutable Transitions methodTrans_{};
+  mutable std::mutex transMutex_{};
+
+  static std::uint32_t nextId() {
+    static std::atomic<std::uint32_t> lastId{0};
+    return lastId.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Shape(SlotMap slots, MethodSet methods)
+      : id_(nextId()), slots_(std::move(slots)), methods_(std::move(methods)) {}
+
+public:
+  Shape(const Shape &) = delete;
+  Shape &operator=(const Shape &) = delete;
+  Shape(Shape &&) = delete;
+  Shape &operator=(Shape &&) = delete;
+  ~Shape() = default;
+
+  /* Shape of an object w/o fields and methods */
+  static const Shape *getRoot() {
+    static const Shape root{{}, {}};
+    return &root;
+  }
+
+  [[nodiscard]] auto getId() const { return id_; }
+  [[nodiscard]] const auto &getSlots() const { return slots_; }
+  [[nodiscard]] const auto &getMethods() const { return methods_; }
+  [[nodiscard]] auto getNumSlots() const { return slots_.size(); }
+
+  [[nodiscard]] std::optional<std::size_t>
+  lookup(std::string_view name) const {
+    if (auto It = slots_.find(name); It != slots_.end())
+      return It->second;
+    return std::nullopt;
+  }
+
+  [[nodiscard]] bool hasMethod(std::string_view name) const {
+    return methods_.find(name) != methods_.end();
+  }
+
+  /* Child shape w/ field name put to the next slot */
+  [[nodiscard]] const Shape *addField(std::string_view name) const {
+    return getChild(fieldTrans_, name, [this, name] {
+      auto slots = slots_;
+      slots.emplace(name, slots_.size());
+      return std::unique_ptr<Shape>(new Shape(std::move(slots), methods_));
+    });
+  }
+
+  [[nodiscard]] const Shape *addMethod(std::string_view name) const {
+    return getChild(methodTrans_, name, [this, name] {
+      auto methods = methods_;
+      methods.emplace(name);
+      return std::unique_ptr<Shape>(new Shape(slots_, std::move(methods)));
+    });
+  }
+
+private:
+  template <class Factory>
+  const Shape *getChild(Transitions &trans, std::string_view name,
+                        Factory factory) const {
+    std::lock_guard lock{transMutex_};
+    auto It = trans.find(name);
+    if (It == trans.end())
+      It = trans.emplace(name, factory()).first;
+    return It->second.get();
+  }
+};
+
+} // namespace leech
+
+#endif // __INCLUDE_LEECHOBJ_SHAPE_HH__
@@ -0,0 +1,485 @@
+#include <dlfcn.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "executor/aot.hh"
+
+#ifndef LEECH_AOT_CXX
+#define LEECH_AOT_CXX "c++"
+#endif
+#ifndef LEECH_AOT_INCLUDE_DIR
+#define LEECH_AOT_INCLUDE_DIR ""
+#endif
+
+extern char **environ;
+
+namespace leech::aot {
+namespace {
+/* Restores variable on scope exit, exceptions included */
+template <typename T> class Restore final {
+  T &var_;
+  T old_;
+
+public:
+  Restore(T &var, T val) : var_(var), old_(std::exchange(var, val)) {}
+  ~Restore() { var_ = old_; }
+
+  Restore(const Restore &) = delete;
+  Restore &operator=(const Restore &) = delete;
+  Restore(Restore &&) = delete;
+  Restore &operator=(Restore &&) = delete;
+};
+
+void runNative(State &state, NativeFunc func) {
+  Restore depth{state.nativeDepth, state.nativeDepth + 1};
+  func(state);
+}
+
+/* Functions sorted by name, which gives module entry index */
+std::vector<std::pair<std::string_view, const FuncMeta *>>
+sortByName(const LeechFile &file) {
+  std::vector<std::pair<std::string_view, const FuncMeta *>> res{};
+  for (const auto &[name, func] : file.meta.funcs)
+    res.emplace_back(name, &func);
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+/* Instructions which may continue at pc of their arg */
+bool isJump(Opcodes opcode) {
+  switch (opcode) {
+  case Opcodes::POP_JUMP_IF_FALSE:
+  case Opcodes::POP_JUMP_IF_TRUE:
+  case Opcodes::JUMP_IF_FALSE_OR_POP:
+  case Opcodes::JUMP_IF_TRUE_OR_POP:
+  case Opcodes::JUMP_FORWARD:
+  case Opcodes::JUMP_ABSOLUTE:
+  case Opcodes::FOR_ITER:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool isCondJump(Opcodes opcode) {
+  return opcode == Opcodes::POP_JUMP_IF_FALSE ||
+         opcode == Opcodes::POP_JUMP_IF_TRUE;
+}
+
+std::string_view getCmpOperator(ArgType arg) {
+  switch (static_cast<CmpOp>(arg)) {
+  case CmpOp::LE:
+    return "<";
+  case CmpOp::LEQ:
+    return "<=";
+  case CmpOp::EQ:
+    return "==";
+  case CmpOp::NEQ:
+    return "!=";
+  case CmpOp::GR:
+    return ">";
+  case CmpOp::GREQ:
+    return ">=";
+  default:
+    return {};
+  }
+}
+
+/**
+ * Function body is emitted instruction by instruction: jumps become goto's
+ * to labels of their destinations, the most frequent instructions work on
+ * the value stack inline, the rest run their interpreter callbacks
+ */
+class FuncTranslator final {
+  const LeechFile &file_;
+  const FuncMeta &func_;
+  std::uint64_t begin_ = 0;
+  std::uint64_t end_ = 0;
+  /* Module entry index of function name */
+  const std::unordered_map<std::string_view, std::size_t> &indices_;
+  std::ostream &out_;
+  std::vector<bool> isLabel_{};
+
+public:
+  FuncTranslator(const LeechFile &file, const FuncMeta &func,
+                 std::uint64_t end,
+                 const std::unordered_map<std::string_view, std::size_t> &idx,
+                 std::ostream &out)
+      : file_(file), func_(func), begin_(func.addr), end_(end), indices_(idx),
+        out_(out) {
+    if (!func_.isResolved())
+      throw std::logic_error("Translating function w/ unresolved local slots");
+    if (begin_ > end_ || end_ > file_.code.size())
+      throw std::out_of_range{"Function code is out of file code"};
+  }
+
+  /* Jumps out of function are left to the interpreter */
+  [[nodiscard]] bool isTranslatable() const {
+    for (auto pc = begin_; pc < end_; ++pc) {
+      auto arg = file_.code[pc].getArg();
+      if (isJump(getOpcode(pc)) && (arg < begin_ || arg >= end_))
+        return false;
+    }
+    return true;
+  }
+
+  void run(std::size_t idx) {
+    isLabel_.assign(end_ - begin_, false);
+    for (auto pc = begin_; pc < end_; ++pc)
+      if (isJump(getOpcode(pc)))
+        isLabel_[file_.code[pc].getArg() - begin_] = true;
+
+    out_ << "void f" << idx << "(State &state) {\n"
+         << "  rt::Frame f{state};\n";
+    for (auto pc = begin_; pc < end_; ++pc) {
+      if (isLabel_[pc - begin_])
+        out_ << "L" << pc << ":\n";
+      pc += translate(pc);
+    }
+    out_ << "  f.fallThrough(" << end_ << ");\n}\n\n";
+  }
+
+private:
+  [[nodiscard]] Opcodes getOpcode(std::uint64_t pc) const {
+    return getOrigOpcode(file_.code[pc].getOpcode());
+  }
+
+  void emitGeneric(std::uint64_t pc, Opcodes opcode, ArgType arg) {
+    out_ << "  f.exec(" << pc << ", Opcodes::"
+         << OpcodeConv::toName(opcode).value() << ", " << unsigned{arg}
+         << ");\n";
+  }
+
+  /* Returns number of extra instructions consumed */
+  std::uint64_t translate(std::uint64_t pc) {
+    auto opcode = getOpcode(pc);
+    auto arg = file_.code[pc].getArg();
+
+    switch (opcode) {
+    case Opcodes::LOAD_FAST:
+      out_ << "  f.load(" << func_.slots.at(arg) << ");\n";
+      return 0;
+    case Opcodes::STORE_FAST:
+      out_ << "  f.store(" << func_.slots.at(arg) << ");\n";
+      return 0;
+    case Opcodes::LOAD_CONST:
+      out_ << "  f.loadConst(" << unsigned{arg} << ");\n";
+      return 0;
+    case Opcodes::POP_TOP:
+      out_ << "  f.drop();\n";
+      return 0;
+    case Opcodes::BINARY_ADD:
+    case Opcodes::BINARY_SUBTRACT:
+      out_ << "  if (f.isInts())\n    f.setResult(Value(f.lhs() "
+           << (opcode == Opcodes::BINARY_ADD ? '+' : '-')
+           << " f.rhs()));\n  else\n  ";
+      emitGeneric(pc, opcode, arg);
+      return 0;
+    case Opcodes::COMPARE_OP:
+      return compare(pc, arg);
+    case Opcodes::POP_JUMP_IF_FALSE:
+      out_ << "  if (f.popFalse())\n    goto L" << unsigned{arg} << ";\n";
+      return 0;
+    case Opcodes::POP_JUMP_IF_TRUE:
+      out_ << "  if (!f.popFalse())\n    goto L" << unsigned{arg} << ";\n";
+      return 0;
+    case Opcodes::JUMP_IF_FALSE_OR_POP:
+      out_ << "  if (f.isFalse())\n    goto L" << unsigned{arg}
+           << ";\n  f.drop();\n";
+      return 0;
+    case Opcodes::JUMP_IF_TRUE_OR_POP:
+      out_ << "  if (!f.isFalse())\n    goto L" << unsigned{arg}
+           << ";\n  f.drop();\n";
+      return 0;
+    case Opcodes::JUMP_FORWARD:
+    case Opcodes::JUMP_ABSOLUTE:
+      out_ << "  goto L" << unsigned{arg} << ";\n";
+      return 0;
+    case Opcodes::FOR_ITER:
+      out_ << "  if (!f.forIter())\n    goto L" << unsigned{arg} << ";\n";
+      return 0;
+    case Opcodes::RETURN_VALUE:
+      out_ << "  f.ret();\n  return;\n";
+      return 0;
+    case Opcodes::CALL_FUNCTION:
+      if (auto found = indices_.find(func_.names.at(arg));
+          found != indices_.end()) {
+        out_ << "  f.call(" << pc << ", " << found->second << ");\n";
+        return 0;
+      }
+      emitGeneric(pc, opcode, arg);
+      return 0;
+    default:
+      emitGeneric(pc, opcode, arg);
+      return 0;
+    }
+  }
+
+  std::uint64_t compare(std::uint64_t pc, ArgType arg) {
+    auto cmp = getCmpOperator(arg);
+    if (cmp.empty()) {
+      emitGeneric(pc, Opcodes::COMPARE_OP, arg);
+      return 0;
+    }
+
+    auto next = pc + 1;
+    if (next >= end_ || isLabel_[next - begin_] ||
+        !isCondJump(getOpcode(next))) {
+      out_ << "  if (f.isInts())\n    f.setResult(Value(Integer{f.lhs() "
+           << cmp << " f.rhs()}));\n  else\n  ";
+      emitGeneric(pc, Opcodes::COMPARE_OP, arg);
+      return 0;
+    }
+
+    /* Result of comparison is used by the jump only */
+    auto neg = getOpcode(next) == Opcodes::POP_JUMP_IF_FALSE ? "!" : "";
+    auto dest = unsigned{file_.code[next].getArg()};
+    out_ << "  if (f.isInts()) {\n"
+         << "    auto res = f.lhs() " << cmp << " f.rhs();\n"
+         << "    f.dropOperands();\n"
+         << "    if (" << neg << "res)\n      goto L" << dest << ";\n"
+         << "  } else {\n  ";
+    emitGeneric(pc, Opcodes::COMPARE_OP, arg);
+    out_ << "    if (" << (*neg != '\0' ? "" : "!") << "f.popFalse())\n"
+         << "      goto L" << dest << ";\n  }\n";
+    return 1;
+  }
+};
+
+/* FNV-1a */
+std::uint64_t hashBytes(std::string_view bytes) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (auto byte : bytes) {
+    hash ^= static_cast<unsigned char>(byte);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/* Contents of C++ string literal of bytes. Octal escapes take at most
+ * three digits, so they don't swallow the following characters */
+std::string escape(std::string_view bytes) {
+  std::string res{};
+  for (auto byte : bytes) {
+    auto code = static_cast<unsigned char>(byte);
+    if (code >= ' ' && code < 0x7f && byte != '"' && byte != '\\' &&
+        byte != '?') {
+      res += byte;
+      continue;
+    }
+    res += '\\';
+    res += static_cast<char>('0' + ((code >> 6U) & 7U));
+    res += static_cast<char>('0' + ((code >> 3U) & 7U));
+    res += static_cast<char>('0' + (code & 7U));
+  }
+  return res;
+}
+
+/* Append whitespace separated words of str */
+void splitArgs(const std::string &str, std::vector<std::string> &args) {
+  std::istringstream ist{str};
+  for (std::string arg; ist >> arg;)
+    args.push_back(std::move(arg));
+}
+
+/* Run args[0] w/ args w/o shell, exit status or -1 if it didn't exit */
+int spawn(const std::vector<std::string> &args) {
+  std::vector<char *> argv{};
+  for (const auto &arg : args)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  pid_t pid{};
+  if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) !=
+      0)
+    return -1;
+  int status = 0;
+  while (waitpid(pid, &status, 0) == -1)
+    if (errno != EINTR)
+      return -1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+} // namespace
+
+std::uint64_t hashFile(const LeechFile &file) {
+  std::ostringstream ost;
+  for (const auto &[name, func] : sortByName(file)) {
+    ost << name << ' ' << func->addr << ' ' << func->argNum << '\n';
+    for (auto fname : func->names)
+      ost << fname << ' ';
+    for (std::size_t i = 0; i < func->cstPool.size(); ++i)
+      func->getConst(i)->serialize(ost);
+    ost << '\n';
+  }
+  for (const auto &inst : file.code)
+    Instruction{getOrigOpcode(inst.getOpcode()), inst.getArg()}.serialize(ost);
+  return hashBytes(ost.str());
+}
+
+std::string translate(const LeechFile &file) {
+  auto funcs = sortByName(file);
+  std::unordered_map<std::string_view, std::size_t> indices{};
+  for (std::size_t i = 0; i < funcs.size(); ++i)
+    indices.emplace(funcs[i].first, i);
+
+  /* Function code ends where the next one starts */
+  std::vector<std::uint64_t> addrs{};
+  for (const auto &[name, func] : funcs)
+    addrs.push_back(func->addr);
+  std::sort(addrs.begin(), addrs.end());
+  auto getEnd = [&](std::uint64_t addr) {
+    auto It = std::upper_bound(addrs.begin(), addrs.end(), addr);
+    return It == addrs.end() ? file.code.size() : *It;
+  };
+
+  std::ostringstream ost;
+  ost << "// Generated by leech --aot, do not edit\n"
+      << "#include \"executor/aot.hh\"\n\n"
+      << "namespace {\nusing namespace leech;\nusing namespace leech::aot;\n\n";
+
+  std::vector<bool> hasCode(funcs.size(), false);
+  for (std::size_t i = 0; i < funcs.size(); ++i) {
+    const auto &[name, func] = funcs[i];
+    FuncTranslator translator{file, *func, getEnd(func->addr), indices, ost};
+    ost << "// \"" << escape(name) << "\"\n";
+    if (!translator.isTranslatable()) {
+      ost << "/* jumps out of its code, so it is interpreted */\n\n";
+      continue;
+    }
+    translator.run(i);
+    hasCode[i] = true;
+  }
+
+  ost << "const ModuleEntry kFuncs[] = {\n";
+  for (std::size_t i = 0; i < funcs.size(); ++i) {
+    const auto &name = funcs[i].first;
+    ost << "    {\"" << escape(name) << "\", " << name.size() << ", ";
+    if (hasCode[i])
+      ost << "&f" << i;
+    else
+      ost << "nullptr";
+    ost << "},\n";
+  }
+  ost << "};\n} // namespace\n\n"
+      << "extern \"C\" const ModuleInfo " << kModuleSymbol << "{"
+      << kModuleVersion << ", " << hashFile(file) << "ULL, " << funcs.size()
+      << ", kFuncs};\n";
+  return ost.str();
+}
+
+void build(const LeechFile &file, const std::filesystem::path &out,
+           const BuildOptions &opts) {
+  auto src = out.string() + ".cc";
+  {
+    std::ofstream ost(src);
+    if (!ost.is_open())
+      throw std::runtime_error("Can't write native module source " + src);
+    ost << translate(file);
+  }
+
+  std::vector<std::string> args{};
+  splitArgs(opts.compiler.empty() ? LEECH_AOT_CXX : opts.compiler, args);
+  if (args.empty())
+    throw std::invalid_argument("Empty native module compiler");
+  args.emplace_back("-std=c++20");
+  splitArgs(opts.flags, args);
+  args.insert(args.end(), {"-fPIC", "-shared"});
+  if (std::string inc = LEECH_AOT_INCLUDE_DIR; !inc.empty())
+    args.push_back("-I" + inc);
+  args.insert(args.end(), {"-o", out.string(), src});
+
+  auto status = spawn(args);
+  if (!opts.keepSource)
+    std::filesystem::remove(src);
+  if (status != 0) {
+    std::string cmd{};
+    for (const auto &arg : args)
+      cmd += (cmd.empty() ? "" : " ") + arg;
+    throw std::runtime_error("Compiling native module failed: " + cmd);
+  }
+}
+
+Module::Module(const std::filesystem::path &path, const LeechFile &file) {
+  /* Path w/o slash would be looked up in library search path */
+  auto abs = std::filesystem::absolute(path);
+  handle_ = dlopen(abs.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle_ == nullptr)
+    throw std::runtime_error(std::string{"Can't load native module: "} +
+                             dlerror());
+
+  try {
+    const auto *info =
+        static_cast<const ModuleInfo *>(dlsym(handle_, kModuleSymbol));
+    if (info == nullptr || info->version != kModuleVersion)
+      throw std::runtime_error("Not a native module of this leech: " +
+                               path.string());
+    if (info->fileHash != hashFile(file))
+      throw std::runtime_error("Native module " + path.string() +
+                               " was built for another file");
+
+    for (std::size_t i = 0; i < info->funcNum; ++i) {
+      const auto &entry = info->funcs[i];
+      const auto *meta =
+          &file.meta.funcs.at(std::string{entry.name, entry.nameSize});
+      funcs_.push_back({meta, entry.func});
+      if (entry.func != nullptr)
+        byMeta_.emplace(meta, entry.func);
+    }
+  } catch (...) {
+    dlclose(handle_);
+    throw;
+  }
+}
+
+Module::~Module() { dlclose(handle_); }
+
+bool enter(State &state) {
+  if (state.aot == nullptr || state.nativeDepth >= kMaxNativeDepth)
+    return false;
+  auto func = state.aot->find(state.getCurFrame().getMeta());
+  if (func == nullptr)
+    return false;
+  runNative(state, func);
+  return true;
+}
+
+namespace rt {
+void interpret(State &state, std::uint64_t pc) {
+  Restore base{state.baseDepth, state.funcStack.size() - 1};
+  state.pc = pc;
+  executeThreaded(state);
+}
+
+void exec(State &state, std::uint64_t pc, Opcodes opcode, ArgType arg) {
+  auto depth = state.funcStack.size();
+  state.pc = pc;
+  state.nextPC.reset();
+  Instruction{opcode, arg}.execute(state);
+  if (state.funcStack.size() > depth && !enter(state))
+    interpret(state, state.nextPC.value());
+}
+
+void call(State &state, std::uint64_t pc, std::size_t idx) {
+  const auto &callee = state.aot->getFunc(idx);
+  auto &curFrame = state.getCurFrame();
+  /* Whole data stack is passed as args in place */
+  curFrame.setRet(pc + 1);
+  state.pushFrame(callee.meta, curFrame.stackSize());
+  if (callee.func != nullptr && state.nativeDepth < kMaxNativeDepth)
+    runNative(state, callee.func);
+  else
+    interpret(state, callee.meta->addr);
+}
+
+void ret(State &state) {
+  Instruction{Opcodes::RETURN_VALUE}.execute(state);
+}
+} // namespace rt
+
+} // namespace leech::aot
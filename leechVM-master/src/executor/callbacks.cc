@@ -1,261 +1,372 @@
+#include <optional>
 #include <stdexcept>
 #include <unordered_map>
 
 #include "common/common.hh"
+#include "executor/aot.hh"
 #include "executor/executor.hh"
 
 namespace {
 using namespace leech;
 
-void execute_POP_TOP([[maybe_unused]] const Instruction &inst, State &state) {
+/* Taken jump, backward ones let JIT find hot loops */
+void jumpTo(State &state, std::uint64_t dest) {
+  state.nextPC = dest;
+  if (dest <= state.pc && state.jit != nullptr)
+    state.jit->onBackEdge(state, dest);
+}
+
+bool isFalse(const Value &val) {
+  return val.compare(Value(Integer{0}), CmpOp::EQ);
+}
+
+void execute_POP_TOP([[maybe_unused]] const Instruction &inst,
+                     [[maybe_unused]] ArgType arg, State &state) {
   state.getCurFrame().pop();
 }
 void execute_ROT_TWO([[maybe_unused]] const Instruction &inst,
+                     [[maybe_unused]] ArgType arg,
                      [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_ROT_THREE([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DUP_TOP([[maybe_unused]] const Instruction &inst,
+                     [[maybe_unused]] ArgType arg,
                      [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DUP_TOP_TWO([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_ROT_FOUR([[maybe_unused]] const Instruction &inst,
+                      [[maybe_unused]] ArgType arg,
                       [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_NOP([[maybe_unused]] const Instruction &inst,
-                 [[maybe_unused]] State &state) {
+                 [[maybe_unused]] ArgType arg, [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_UNARY_POSITIVE([[maybe_unused]] const Instruction &inst,
+                            [[maybe_unused]] ArgType arg,
                             [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_UNARY_NEGATIVE([[maybe_unused]] const Instruction &inst,
+                            [[maybe_unused]] ArgType arg,
                             [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_UNARY_NOT([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_UNARY_INVERT([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_MATRIX_MULTIPLY([[maybe_unused]] const Instruction &inst,
+                                    [[maybe_unused]] ArgType arg,
                                     [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_MATRIX_MULTIPLY([[maybe_unused]] const Instruction &inst,
+                                     [[maybe_unused]] ArgType arg,
                                      [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_POWER([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_MULTIPLY([[maybe_unused]] const Instruction &inst,
+                             [[maybe_unused]] ArgType arg,
                              [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_MODULO([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_BINARY_ADD([[maybe_unused]] const Instruction &inst,
+/* Quicken arithmetic instruction for numeric operands of the same type */
+void quickenNumeric(const Instruction &inst, State &state, const Value &lhs,
+                    const Value &rhs, Opcodes intOpc, Opcodes floatOpc) {
+  if (lhs.getType() != rhs.getType())
+    return;
+  if (lhs.getType() == ValueType::Integer)
+    state.quicken(inst, intOpc);
+  else if (lhs.getType() == ValueType::Float)
+    state.quicken(inst, floatOpc);
+}
+
+void execute_BINARY_ADD(const Instruction &inst, [[maybe_unused]] ArgType arg,
                         State &state) {
   auto &curFrame = state.getCurFrame();
-  auto tos1 = curFrame.popGetTos();
-  auto tos2 = curFrame.popGetTos();
+  auto tos1 = curFrame.popTos();
+  auto tos2 = curFrame.popTos();
 
-  curFrame.push(tos1->add(tos2.get()));
+  curFrame.push(tos1.add(tos2));
+  quickenNumeric(inst, state, tos2, tos1, Opcodes::BINARY_ADD__INT,
+                 Opcodes::BINARY_ADD__FLOAT);
 }
-void execute_BINARY_SUBTRACT([[maybe_unused]] const Instruction &inst,
-                             State &state) {
+void execute_BINARY_SUBTRACT(const Instruction &inst,
+                             [[maybe_unused]] ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto tos1 = curFrame.popGetTos();
-  auto tos2 = curFrame.popGetTos();
+  auto tos1 = curFrame.popTos();
+  auto tos2 = curFrame.popTos();
 
-  curFrame.push(tos2->sub(tos1.get()));
+  curFrame.push(tos2.sub(tos1));
+  quickenNumeric(inst, state, tos2, tos1, Opcodes::BINARY_SUBTRACT__INT,
+                 Opcodes::BINARY_SUBTRACT__FLOAT);
 }
-void execute_BINARY_SUBSCR([[maybe_unused]] const Instruction &inst,
-                           State &state) {
+void execute_BINARY_SUBSCR(const Instruction &inst,
+                           [[maybe_unused]] ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto idx = curFrame.popGetTos();
-  auto tuple = curFrame.popGetTos();
+  if (curFrame.top().getType() == ValueType::Slice) {
+    subscriptSlice(state);
+    return;
+  }
+  auto idx = curFrame.popTos();
+  auto tuple = curFrame.popTos();
 
-  curFrame.push(tuple->subscript(idx.get()));
+  curFrame.push(tuple.subscript(idx));
+  if (tuple.getType() == ValueType::Tuple &&
+      idx.getType() == ValueType::Integer)
+    state.quicken(inst, Opcodes::BINARY_SUBSCR__TUPLE_INT);
 }
 void execute_BINARY_FLOOR_DIVIDE([[maybe_unused]] const Instruction &inst,
+                                 [[maybe_unused]] ArgType arg,
                                  [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_BINARY_TRUE_DIVIDE([[maybe_unused]] const Instruction &inst,
-                                State &state) {
+void execute_BINARY_TRUE_DIVIDE(const Instruction &inst,
+                                [[maybe_unused]] ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto two = curFrame.popGetTos();
-  auto one = curFrame.popGetTos();
+  auto two = curFrame.popTos();
+  auto one = curFrame.popTos();
 
-  curFrame.push(one->div(two.get()));
+  curFrame.push(one.div(two));
+  quickenNumeric(inst, state, one, two, Opcodes::BINARY_TRUE_DIVIDE__INT,
+                 Opcodes::BINARY_TRUE_DIVIDE__FLOAT);
 }
 void execute_INPLACE_FLOOR_DIVIDE([[maybe_unused]] const Instruction &inst,
+                                  [[maybe_unused]] ArgType arg,
                                   [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_TRUE_DIVIDE([[maybe_unused]] const Instruction &inst,
+                                 [[maybe_unused]] ArgType arg,
                                  [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_GET_LEN([[maybe_unused]] const Instruction &inst,
-                     [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+                     [[maybe_unused]] ArgType arg, State &state) {
+  auto &curFrame = state.getCurFrame();
+  curFrame.push(Value(curFrame.top().len()));
 }
 void execute_MATCH_MAPPING([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_MATCH_SEQUENCE([[maybe_unused]] const Instruction &inst,
+                            [[maybe_unused]] ArgType arg,
                             [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_MATCH_KEYS([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_COPY_DICT_WITHOUT_KEYS([[maybe_unused]] const Instruction &inst,
+                                    [[maybe_unused]] ArgType arg,
                                     [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_WITH_EXCEPT_START([[maybe_unused]] const Instruction &inst,
+                               [[maybe_unused]] ArgType arg,
                                [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_GET_AITER([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_GET_ANEXT([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BEFORE_ASYNC_WITH([[maybe_unused]] const Instruction &inst,
+                               [[maybe_unused]] ArgType arg,
                                [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_END_ASYNC_FOR([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_ADD([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_SUBTRACT([[maybe_unused]] const Instruction &inst,
+                              [[maybe_unused]] ArgType arg,
                               [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_MULTIPLY([[maybe_unused]] const Instruction &inst,
+                              [[maybe_unused]] ArgType arg,
                               [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_MODULO([[maybe_unused]] const Instruction &inst,
+                            [[maybe_unused]] ArgType arg,
                             [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_STORE_SUBSCR([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DELETE_SUBSCR([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_LSHIFT([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_RSHIFT([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_AND([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_XOR([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BINARY_OR([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_POWER([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_GET_ITER([[maybe_unused]] const Instruction &inst,
-                      [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+                      [[maybe_unused]] ArgType arg, State &state) {
+  auto &curFrame = state.getCurFrame();
+  const auto &seq = curFrame.top();
+  IterObj *iter = nullptr;
+  switch (seq.getType()) {
+  case ValueType::Tuple:
+    /* Tuple is read after allocation as GC may move it */
+    iter = state.heap.make<IterObj>(curFrame.top());
+    break;
+  case ValueType::Slice: {
+    /* Slice start:stop is iterated as range(start, stop) */
+    const auto *slice = static_cast<const SliceObj *>(seq.getObj());
+    if (!slice->getEnd().has_value())
+      throw std::invalid_argument("Iterating range w/o end");
+    iter = state.heap.make<IterObj>(slice->getBegin().value_or(0),
+                                    *slice->getEnd());
+    break;
+  }
+  case ValueType::Iterator:
+    return;
+  default:
+    throw std::invalid_argument("Value is not iterable");
+  }
+  curFrame.pop();
+  curFrame.push(Value(iter));
 }
 void execute_GET_YIELD_FROM_ITER([[maybe_unused]] const Instruction &inst,
+                                 [[maybe_unused]] ArgType arg,
                                  [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_PRINT_EXPR([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_YIELD_FROM([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_GET_AWAITABLE([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_LOAD_ASSERTION_ERROR([[maybe_unused]] const Instruction &inst,
+                                  [[maybe_unused]] ArgType arg,
                                   [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_LSHIFT([[maybe_unused]] const Instruction &inst,
+                            [[maybe_unused]] ArgType arg,
                             [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_RSHIFT([[maybe_unused]] const Instruction &inst,
+                            [[maybe_unused]] ArgType arg,
                             [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_AND([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_XOR([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_INPLACE_OR([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_LIST_TO_TUPLE([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_RETURN_VALUE([[maybe_unused]] const Instruction &inst,
-                          State &state) {
+                          [[maybe_unused]] ArgType arg, State &state) {
   auto &fstack = state.funcStack;
   auto tos = state.getCurFrame().popGetTos();
 
-  fstack.pop();
+  state.popFrame();
 
   if (!fstack.empty()) {
     state.nextPC = state.getCurFrame().getRet();
@@ -263,306 +374,412 @@ void execute_RETURN_VALUE([[maybe_unused]] const Instruction &inst,
   }
 }
 void execute_IMPORT_STAR([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_SETUP_ANNOTATIONS([[maybe_unused]] const Instruction &inst,
+                               [[maybe_unused]] ArgType arg,
                                [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_YIELD_VALUE([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_POP_BLOCK([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_POP_EXCEPT([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_HAVE_ARGUMENT([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_STORE_NAME([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DELETE_NAME([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_UNPACK_SEQUENCE([[maybe_unused]] const Instruction &inst,
+                             [[maybe_unused]] ArgType arg,
                              [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_FOR_ITER([[maybe_unused]] const Instruction &inst,
-                      [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+void execute_FOR_ITER([[maybe_unused]] const Instruction &inst, ArgType arg,
+                      State &state) {
+  auto &curFrame = state.getCurFrame();
+  const auto &iter = curFrame.top();
+  if (iter.getType() != ValueType::Iterator)
+    throw std::invalid_argument("FOR_ITER w/o iterator on stack");
+
+  Value val{};
+  if (static_cast<IterObj *>(iter.getObj())->next(val)) {
+    curFrame.push(val);
+    return;
+  }
+  curFrame.pop();
+  jumpTo(state, arg);
 }
 void execute_UNPACK_EX([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DELETE_ATTR([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_STORE_GLOBAL([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DELETE_GLOBAL([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_ROT_N([[maybe_unused]] const Instruction &inst,
+                   [[maybe_unused]] ArgType arg,
                    [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_LOAD_CONST(const Instruction &inst, State &state) {
+void execute_LOAD_CONST([[maybe_unused]] const Instruction &inst, ArgType arg,
+                        State &state) {
   auto &curFrame = state.getCurFrame();
-  curFrame.push(curFrame.getConst(inst.getArg()));
+  curFrame.push(curFrame.getConst(arg));
 }
 void execute_LOAD_NAME([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_BUILD_TUPLE([[maybe_unused]] const Instruction &inst,
-                         [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+void execute_BUILD_TUPLE([[maybe_unused]] const Instruction &inst, ArgType arg,
+                         State &state) {
+  auto &curFrame = state.getCurFrame();
+  auto num = static_cast<std::size_t>(arg);
+  /* Tuple is shared as immutable, so it gets own copies of class objects.
+   * Elements stay on data stack while they and tuple are allocated, so GC
+   * updates them */
+  auto &stack = state.valueStack;
+  for (auto i = stack.size() - curFrame.peekTop(num).size(); i < stack.size();
+       ++i)
+    stack[i] = state.heap.clone(stack[i]);
+  auto *tuple = state.heap.make<TupleObj>(curFrame.peekTop(num));
+  for (std::size_t i = 0; i < num; ++i)
+    curFrame.pop();
+  curFrame.push(Value(tuple));
 }
 void execute_BUILD_LIST([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BUILD_SET([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BUILD_MAP([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_COMPARE_OP(const Instruction &inst, State &state) {
+void execute_COMPARE_OP(const Instruction &inst, ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto op = static_cast<CmpOp>(inst.getArg());
-  auto tos1 = curFrame.popGetTos();
-  auto tos2 = curFrame.popGetTos();
+  auto op = static_cast<CmpOp>(arg);
+  auto tos1 = curFrame.popTos();
+  auto tos2 = curFrame.popTos();
 
-  bool res = tos2->compare(tos1.get(), op);
+  bool res = tos2.compare(tos1, op);
 
-  curFrame.emplace<IntObj>(static_cast<Integer>(res));
+  curFrame.push(Value(static_cast<Integer>(res)));
+  if (tos1.getType() == ValueType::Integer &&
+      tos2.getType() == ValueType::Integer)
+    state.quicken(inst, Opcodes::COMPARE_OP__INT);
 }
 void execute_IMPORT_NAME([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_IMPORT_FROM([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_JUMP_FORWARD([[maybe_unused]] const Instruction &inst,
-                          [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+void execute_JUMP_FORWARD([[maybe_unused]] const Instruction &inst, ArgType arg,
+                          State &state) {
+  jumpTo(state, arg);
 }
 void execute_JUMP_IF_FALSE_OR_POP([[maybe_unused]] const Instruction &inst,
-                                  [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+                                  ArgType arg, State &state) {
+  auto &curFrame = state.getCurFrame();
+  if (isFalse(curFrame.top()))
+    jumpTo(state, arg);
+  else
+    curFrame.pop();
 }
 void execute_JUMP_IF_TRUE_OR_POP([[maybe_unused]] const Instruction &inst,
-                                 [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+                                 ArgType arg, State &state) {
+  auto &curFrame = state.getCurFrame();
+  if (!isFalse(curFrame.top()))
+    jumpTo(state, arg);
+  else
+    curFrame.pop();
 }
 void execute_JUMP_ABSOLUTE([[maybe_unused]] const Instruction &inst,
-                           [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+                           ArgType arg, State &state) {
+  jumpTo(state, arg);
 }
-void execute_POP_JUMP_IF_FALSE(const Instruction &inst, State &state) {
+void execute_POP_JUMP_IF_FALSE([[maybe_unused]] const Instruction &inst,
+                               ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto dest = inst.getArg();
-  auto tos = curFrame.popGetTos();
-  IntObj fal(0);
+  auto dest = arg;
+  auto tos = curFrame.popTos();
+  Value fal(Integer{0});
 
-  bool res = tos->compare(&fal, CmpOp::EQ);
+  bool res = tos.compare(fal, CmpOp::EQ);
   if (res)
-    state.nextPC = dest;
+    jumpTo(state, dest);
 }
-void execute_POP_JUMP_IF_TRUE(const Instruction &inst, State &state) {
+void execute_POP_JUMP_IF_TRUE([[maybe_unused]] const Instruction &inst,
+                              ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto dest = inst.getArg();
-  auto tos = curFrame.popGetTos();
-  IntObj fal(0);
+  auto dest = arg;
+  auto tos = curFrame.popTos();
+  Value fal(Integer{0});
 
-  bool res = tos->compare(&fal, CmpOp::EQ);
+  bool res = tos.compare(fal, CmpOp::EQ);
   if (!res)
-    state.nextPC = dest;
+    jumpTo(state, dest);
 }
 void execute_LOAD_GLOBAL([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_IS_OP([[maybe_unused]] const Instruction &inst,
+                   [[maybe_unused]] ArgType arg,
                    [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_CONTAINS_OP([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_RERAISE([[maybe_unused]] const Instruction &inst,
+                     [[maybe_unused]] ArgType arg,
                      [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_JUMP_IF_NOT_EXC_MATCH([[maybe_unused]] const Instruction &inst,
+                                   [[maybe_unused]] ArgType arg,
                                    [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_SETUP_FINALLY([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_LOAD_FAST(const Instruction &inst, State &state) {
+void execute_LOAD_FAST([[maybe_unused]] const Instruction &inst, ArgType arg,
+                       State &state) {
   auto &curFrame = state.getCurFrame();
-  auto name = curFrame.getName(inst.getArg());
-  curFrame.push(curFrame.getVar(name));
+  curFrame.push(curFrame.getVar(arg));
 }
-void execute_STORE_FAST(const Instruction &inst, State &state) {
+void execute_STORE_FAST([[maybe_unused]] const Instruction &inst, ArgType arg,
+                        State &state) {
   auto &curFrame = state.getCurFrame();
-  auto name = curFrame.getName(inst.getArg());
-  curFrame.setVar(name, curFrame.top());
+  curFrame.setVar(arg, curFrame.top());
 }
 void execute_DELETE_FAST([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_GEN_START([[maybe_unused]] const Instruction &inst,
+                       [[maybe_unused]] ArgType arg,
                        [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_RAISE_VARARGS([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_CALL_FUNCTION(const Instruction &inst, State &state) {
+void execute_CALL_FUNCTION([[maybe_unused]] const Instruction &inst,
+                           ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto idx = inst.getArg();
+  auto idx = arg;
   auto fName = std::string(curFrame.getName(idx));
 
   auto *fMeta = &state.pFile->meta.funcs.at(fName);
   state.nextPC = fMeta->addr;
 
-  /* Get args from data stack */
-  std::vector<pLeechObj> args(curFrame.stackSize());
-  std::generate(args.begin(), args.end(),
-                [&curFrame] { return curFrame.popGetTos(); });
-
+  /* Whole data stack is passed as args in place */
   curFrame.setRet(state.pc + 1);
-  state.funcStack.emplace(fMeta);
-
-  state.getCurFrame().fillArgs(args.begin(), args.end());
+  state.pushFrame(fMeta, curFrame.stackSize());
+  if (aot::enter(state))
+    return;
+  if (state.jit != nullptr)
+    state.jit->onCall(state);
 }
 void execute_MAKE_FUNCTION([[maybe_unused]] const Instruction &inst,
+                           [[maybe_unused]] ArgType arg,
                            [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_BUILD_SLICE([[maybe_unused]] const Instruction &inst,
-                         [[maybe_unused]] State &state) {
-  throw std::logic_error{"Function is not implemented yet"};
+void execute_BUILD_SLICE([[maybe_unused]] const Instruction &inst, ArgType arg,
+                         State &state) {
+  if (arg != 2)
+    throw std::invalid_argument("Slice step is not supported");
+
+  auto getBound = [](const Value &val) -> std::optional<Integer> {
+    switch (val.getType()) {
+    case ValueType::Integer:
+      return val.getInt();
+    case ValueType::None:
+      return std::nullopt;
+    default:
+      throw std::invalid_argument("Slice bounds must be integers or None");
+    }
+  };
+
+  auto &curFrame = state.getCurFrame();
+  auto end = getBound(curFrame.popTos());
+  auto begin = getBound(curFrame.popTos());
+  curFrame.push(Value(state.heap.make<SliceObj>(begin, end)));
 }
 void execute_LOAD_CLOSURE([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_LOAD_DEREF([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_STORE_DEREF([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DELETE_DEREF([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_CALL_FUNCTION_KW([[maybe_unused]] const Instruction &inst,
+                              [[maybe_unused]] ArgType arg,
                               [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_CALL_FUNCTION_EX([[maybe_unused]] const Instruction &inst,
+                              [[maybe_unused]] ArgType arg,
                               [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_SETUP_WITH([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_EXTENDED_ARG([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_LIST_APPEND([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_SET_ADD([[maybe_unused]] const Instruction &inst,
+                     [[maybe_unused]] ArgType arg,
                      [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_MAP_ADD([[maybe_unused]] const Instruction &inst,
+                     [[maybe_unused]] ArgType arg,
                      [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_LOAD_CLASSDEREF([[maybe_unused]] const Instruction &inst,
+                             [[maybe_unused]] ArgType arg,
                              [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_MATCH_CLASS([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_SETUP_ASYNC_WITH([[maybe_unused]] const Instruction &inst,
+                              [[maybe_unused]] ArgType arg,
                               [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_FORMAT_VALUE([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BUILD_CONST_KEY_MAP([[maybe_unused]] const Instruction &inst,
+                                 [[maybe_unused]] ArgType arg,
                                  [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_BUILD_STRING([[maybe_unused]] const Instruction &inst,
+                          [[maybe_unused]] ArgType arg,
                           [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_LOAD_METHOD([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 
 void execute_LIST_EXTEND([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_SET_UPDATE([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DICT_MERGE([[maybe_unused]] const Instruction &inst,
+                        [[maybe_unused]] ArgType arg,
                         [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
 void execute_DICT_UPDATE([[maybe_unused]] const Instruction &inst,
+                         [[maybe_unused]] ArgType arg,
                          [[maybe_unused]] State &state) {
   throw std::logic_error{"Function is not implemented yet"};
 }
-void execute_PRINT([[maybe_unused]] const Instruction &inst, State &state) {
-  state.getCurFrame().popGetTos()->print();
+void execute_PRINT([[maybe_unused]] const Instruction &inst,
+                   [[maybe_unused]] ArgType arg, State &state) {
+  state.getCurFrame().popTos().print();
   std::cout << std::endl;
 }
 
@@ -571,7 +788,7 @@ void printDebugInfo(
   [[maybe_unused]] std::string_view op,
   [[maybe_unused]] std::string_view name,
   [[maybe_unused]] const State & state,
-  [[maybe_unused]] std::shared_ptr<ClassObj> pClassObj) {
+  [[maybe_unused]] const ClassObj *pClassObj) {
   #ifdef DEBUG_PRINT
   std::cout << std::endl;
   std::cout << "PC = " <<  state.pc << std::endl << op << " " << name << std::endl;
@@ -583,79 +800,109 @@ void printDebugInfo(
   [[maybe_unused]] std::string_view op,
   [[maybe_unused]] std::string_view name,
   [[maybe_unused]] const State & state,
-  [[maybe_unused]] std::shared_ptr<ClassObj> pClassObj,
-  [[maybe_unused]] std::shared_ptr<LeechObj> attr) {
+  [[maybe_unused]] const ClassObj *pClassObj,
+  [[maybe_unused]] const Value &attr) {
   #ifdef DEBUG_PRINT
   std::cout << std::endl;
   std::cout << "PC = " <<  state.pc << std::endl << op << " " << name << " = ";
-  attr->print();
+  attr.print();
   std::cout << std::endl;
   pClassObj ->print();
   std::cout << std::endl;
   #endif
 }
 
-std::shared_ptr<ClassObj> safeConvertToClass(std::shared_ptr<LeechObj> pLeech,
+ClassObj *safeConvertToClass(const Value &val,
   std::string_view funcName) {
-  if (pLeech->getType() != ValueType::Class) {
+  if (val.getType() != ValueType::Class) {
     auto msg = std::string(funcName) += std::string(" Trying to convert class from invalid leechObj");
     throw std::runtime_error(msg.c_str());
   }
-  return std::static_pointer_cast<ClassObj>(pLeech);
+  return static_cast<ClassObj *>(val.getObj());
 }
 
 void execute_LOAD_BUILD_CLASS([[maybe_unused]] const Instruction &inst,
-                              [[maybe_unused]] State &state) {
+                              [[maybe_unused]] ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  curFrame.push(std::make_shared<ClassObj>());
+  curFrame.push(Value(state.heap.make<ClassObj>()));
 }
 
 void execute_STORE_BUILD_CLASS([[maybe_unused]] const Instruction &inst,
-                       [[maybe_unused]] State &state) {
+                               ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto name = curFrame.getName(inst.getArg());
+  auto name = curFrame.getName(arg);
   auto leechObj = curFrame.popGetTos();
   auto pClassObj = safeConvertToClass(leechObj, "StoreBuildClass");
-  curFrame.setVar(name, pClassObj);
+  curFrame.setVar(arg, leechObj);
   printDebugInfo("StoreBuildClass", name, state, pClassObj);
 }
 
 
-void execute_STORE_ATTR([[maybe_unused]] const Instruction &inst,
-                        [[maybe_unused]] State &state) {
+void execute_STORE_ATTR([[maybe_unused]] const Instruction &inst, ArgType arg,
+                        State &state) {
   auto &curFrame = state.getCurFrame();
-  auto name = curFrame.getName(inst.getArg());
+  auto name = curFrame.getName(arg);
   auto attr = curFrame.popGetTos();
-  auto leechObj = curFrame.top();
-  auto pClassObj = safeConvertToClass(leechObj, "StoreAttr");
-  pClassObj->updateField(name, attr);
+  auto pClassObj = safeConvertToClass(curFrame.top(), "StoreAttr");
+
+  auto &cache = state.getAttrCache();
+  const auto *shape = pClassObj->getShape();
+  const auto *entry = cache.find(shape);
+  if (entry == nullptr) {
+    auto slot = shape->lookup(name);
+    entry = cache.add(slot.has_value()
+                          ? AttrCache::Entry{shape, shape, *slot}
+                          : AttrCache::Entry{shape, shape->addField(name),
+                                             shape->getNumSlots()});
+  }
+
+  if (entry == nullptr)
+    pClassObj->updateField(name, attr);
+  else if (entry->next == shape)
+    pClassObj->setSlot(entry->slot, attr);
+  else
+    pClassObj->addSlot(entry->next, attr);
+  state.heap.writeBarrier(pClassObj, attr);
   printDebugInfo("StoreAttr", name, state, pClassObj, attr);
 }
 
-void execute_LOAD_ATTR([[maybe_unused]] const Instruction &inst,
-                       [[maybe_unused]] State &state) {
+void execute_LOAD_ATTR([[maybe_unused]] const Instruction &inst, ArgType arg,
+                       State &state) {
   auto &curFrame = state.getCurFrame();
-  auto name = curFrame.getName(inst.getArg());
-  auto leechObj = curFrame.top();
-  auto pClassObj = safeConvertToClass(leechObj, "StoreBuildClass");
-  auto attr = pClassObj->getField(name);
+  auto name = curFrame.getName(arg);
+  auto pClassObj = safeConvertToClass(curFrame.top(), "StoreBuildClass");
+
+  auto &cache = state.getAttrCache();
+  const auto *shape = pClassObj->getShape();
+  const auto *entry = cache.find(shape);
+  if (entry == nullptr) {
+    auto slot = shape->lookup(name);
+    if (slot.has_value())
+      entry = cache.add({shape, shape, *slot});
+  }
+
+  auto attr = entry != nullptr ? pClassObj->getSlot(entry->slot)
+                               : pClassObj->getField(name);
   curFrame.push(attr);
   printDebugInfo("LoadAttr", name, state, pClassObj, attr);
 }
 
 void execute_INSTANCE_CLASS([[maybe_unused]] const Instruction &inst,
-                              [[maybe_unused]] State &state) {
+                            ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto name = curFrame.getName(inst.getArg());
-  auto leechObj = curFrame.getVar(name);
-  auto pClassObj = safeConvertToClass(leechObj, "StoreBuildClass");
-  curFrame.push(pClassObj->clone());
-  printDebugInfo("InstanceClass", name, state, pClassObj);
+  auto name = curFrame.getName(arg);
+  const auto &leechObj = curFrame.getVar(arg);
+  safeConvertToClass(leechObj, "StoreBuildClass");
+  /* Variable is rooted so it stays valid if clone triggers collection */
+  auto instance = state.heap.clone(leechObj);
+  curFrame.push(instance);
+  printDebugInfo("InstanceClass", name, state,
+                 safeConvertToClass(instance, "InstanceClass"));
 }
 void execute_REGISTER_METHOD([[maybe_unused]] const Instruction &inst,
-                             [[maybe_unused]] State &state) {
+                             ArgType arg, State &state) {
   auto &curFrame = state.getCurFrame();
-  auto idx = inst.getArg();
+  auto idx = arg;
   auto fName = std::string(curFrame.getName(idx));
 
   auto leechObj = curFrame.top();
@@ -663,38 +910,358 @@ void execute_REGISTER_METHOD([[maybe_unused]] const Instruction &inst,
   pClassObj->registerMethod(fName);
   printDebugInfo("Method registered", fName, state, pClassObj);
 }
-void execute_CALL_METHOD([[maybe_unused]] const Instruction &inst,
-                         [[maybe_unused]] State &state) {
+void execute_CALL_METHOD([[maybe_unused]] const Instruction &inst, ArgType arg,
+                         State &state) {
   auto &curFrame = state.getCurFrame();
-  auto idx = inst.getArg();
-  auto fName = std::string(curFrame.getName(idx));
+  auto idx = arg;
+  auto fName = curFrame.getName(idx);
 
-  auto *fMeta = &state.pFile->meta.funcs.at(fName);
+  auto &cache = state.getAttrCache();
+  if (cache.func == nullptr)
+    cache.func = &state.pFile->meta.funcs.at(std::string(fName));
+  const auto *fMeta = cache.func;
   state.nextPC = fMeta->addr;
   auto numArgs = fMeta->argNum;
 
-  /* Get args from data stack */
-  std::vector<pLeechObj> args(numArgs);
-  std::generate(args.begin(), args.end(),
-                [&curFrame] { return curFrame.popGetTos(); });
-
-  auto leechObj = curFrame.top();
+  /* Object is right under the args on data stack */
+  if (curFrame.stackSize() <= numArgs)
+    throw std::runtime_error("Trying to top from empty stack!");
+  auto leechObj = state.valueStack[state.valueStack.size() - numArgs - 1];
   auto pClassObj = safeConvertToClass(leechObj, "CallMethod");
-  pClassObj->checkMethod(fName);
-
+  /* Only shapes having the method get to the cache */
+  if (const auto *shape = pClassObj->getShape();
+      cache.find(shape) == nullptr) {
+    pClassObj->checkMethod(fName);
+    cache.add({shape, shape, 0});
+  }
 
+  /* Args are passed in place */
   curFrame.setRet(state.pc + 1);
-  state.funcStack.emplace(fMeta);
+  state.pushFrame(fMeta, numArgs);
+
+  /* Reload object as passing args may have moved it */
+  auto &calleeFrame = state.getCurFrame();
+  auto self = state.valueStack[calleeFrame.getBase() - 1];
+  calleeFrame.push(self);
+  aot::enter(state);
+}
+
 
-  state.getCurFrame().push(pClassObj);
-  state.getCurFrame().fillArgs(args.begin(), args.end());
+// SUPERINSTRUCTIONS
+/* Arg of k-th instruction of fused sequence, which is kept in code */
+ArgType getFusedArg(const Instruction &inst, std::size_t k) {
+  return (&inst)[k].getArg();
+}
+
+/* Local as LOAD_FAST would push it */
+const Value &loadFast(const StackFrame &frame, ArgType idx) {
+  const auto &val = frame.getVar(idx);
+  if (!val.isBound())
+    throw std::invalid_argument("Trying to push unbound value into stackframe");
+  return val;
+}
+
+void execute_LOAD_FAST__LOAD_CONST(const Instruction &inst, ArgType arg,
+                                   State &state) {
+  auto &curFrame = state.getCurFrame();
+  curFrame.push(curFrame.getVar(arg));
+  curFrame.push(curFrame.getConst(getFusedArg(inst, 1)));
+}
+void execute_LOAD_FAST__LOAD_FAST(const Instruction &inst, ArgType arg,
+                                  State &state) {
+  auto &curFrame = state.getCurFrame();
+  curFrame.push(curFrame.getVar(arg));
+  curFrame.push(curFrame.getVar(getFusedArg(inst, 1)));
+}
+void execute_STORE_FAST__LOAD_FAST(const Instruction &inst, ArgType arg,
+                                   State &state) {
+  auto &curFrame = state.getCurFrame();
+  curFrame.setVar(arg, curFrame.top());
+  curFrame.push(curFrame.getVar(getFusedArg(inst, 1)));
+}
+void execute_LOAD_FAST__LOAD_CONST__BINARY_ADD(const Instruction &inst,
+                                               ArgType arg, State &state) {
+  auto &curFrame = state.getCurFrame();
+  const auto &var = loadFast(curFrame, arg);
+  auto cst = curFrame.getConst(getFusedArg(inst, 1));
+
+  curFrame.push(cst.add(var));
+}
+void execute_LOAD_FAST__LOAD_CONST__BINARY_SUBTRACT(const Instruction &inst,
+                                                    ArgType arg, State &state) {
+  auto &curFrame = state.getCurFrame();
+  const auto &var = loadFast(curFrame, arg);
+  auto cst = curFrame.getConst(getFusedArg(inst, 1));
+
+  curFrame.push(var.sub(cst));
+}
+void execute_COMPARE_OP__POP_JUMP_IF_FALSE(const Instruction &inst, ArgType arg,
+                                           State &state) {
+  auto &curFrame = state.getCurFrame();
+  auto op = static_cast<CmpOp>(arg);
+  auto tos1 = curFrame.popTos();
+  auto tos2 = curFrame.popTos();
+
+  if (!tos2.compare(tos1, op))
+    jumpTo(state, getFusedArg(inst, 1));
+}
+void execute_LOAD_FAST__LOAD_CONST__COMPARE_OP__POP_JUMP_IF_FALSE(
+    const Instruction &inst, ArgType arg, State &state) {
+  auto &curFrame = state.getCurFrame();
+  const auto &var = loadFast(curFrame, arg);
+  auto cst = curFrame.getConst(getFusedArg(inst, 1));
+  auto op = static_cast<CmpOp>(getFusedArg(inst, 2));
+
+  if (!var.compare(cst, op))
+    jumpTo(state, getFusedArg(inst, 3));
+}
+
+
+// QUICKENED INSTRUCTIONS
+/* Guard miss: site goes back to generic form for good and runs it */
+void dequicken(const Instruction &inst, State &state) {
+  auto generic = Instruction{getQuickGeneric(inst.getOpcode()), inst.getArg()};
+  state.dequicken(inst);
+  generic.execute(state);
+}
+
+/* Whether two values on top of data stack have types lhs and rhs */
+bool topTypesAre(const StackFrame &frame, ValueType lhs, ValueType rhs) {
+  return frame.stackSize() >= 2 && frame.peek(0).getType() == rhs &&
+         frame.peek(1).getType() == lhs;
+}
+
+/* Binary instruction on operands of the same type, run if guard holds */
+template <ValueType Type, class Op>
+void binaryQuick(const Instruction &inst, State &state, Op op) {
+  auto &curFrame = state.getCurFrame();
+  if (!topTypesAre(curFrame, Type, Type)) {
+    dequicken(inst, state);
+    return;
+  }
+  auto rhs = curFrame.popTos();
+  auto lhs = curFrame.popTos();
+
+  if constexpr (Type == ValueType::Integer)
+    curFrame.push(op(lhs.getInt(), rhs.getInt()));
+  else
+    curFrame.push(op(lhs.getFloat(), rhs.getFloat()));
+}
+
+void execute_BINARY_ADD__INT(const Instruction &inst,
+                             [[maybe_unused]] ArgType arg, State &state) {
+  binaryQuick<ValueType::Integer>(
+      inst, state, [](Integer lhs, Integer rhs) { return Value(lhs + rhs); });
+}
+void execute_BINARY_ADD__FLOAT(const Instruction &inst,
+                               [[maybe_unused]] ArgType arg, State &state) {
+  binaryQuick<ValueType::Float>(
+      inst, state, [](Float lhs, Float rhs) { return Value(lhs + rhs); });
+}
+void execute_BINARY_SUBTRACT__INT(const Instruction &inst,
+                                  [[maybe_unused]] ArgType arg, State &state) {
+  binaryQuick<ValueType::Integer>(
+      inst, state, [](Integer lhs, Integer rhs) { return Value(lhs - rhs); });
+}
+void execute_BINARY_SUBTRACT__FLOAT(const Instruction &inst,
+                                    [[maybe_unused]] ArgType arg,
+                                    State &state) {
+  binaryQuick<ValueType::Float>(
+      inst, state, [](Float lhs, Float rhs) { return Value(lhs - rhs); });
+}
+void execute_BINARY_TRUE_DIVIDE__INT(const Instruction &inst,
+                                     [[maybe_unused]] ArgType arg,
+                                     State &state) {
+  binaryQuick<ValueType::Integer>(inst, state, [](Integer lhs, Integer rhs) {
+    return Value(static_cast<Float>(lhs) / static_cast<Float>(rhs));
+  });
+}
+void execute_BINARY_TRUE_DIVIDE__FLOAT(const Instruction &inst,
+                                       [[maybe_unused]] ArgType arg,
+                                       State &state) {
+  binaryQuick<ValueType::Float>(
+      inst, state, [](Float lhs, Float rhs) { return Value(lhs / rhs); });
+}
+void execute_COMPARE_OP__INT(const Instruction &inst, ArgType arg,
+                             State &state) {
+  binaryQuick<ValueType::Integer>(
+      inst, state, [op = static_cast<CmpOp>(arg)](Integer lhs,
+                                                            Integer rhs) {
+        return Value(static_cast<Integer>(Value(lhs).compare(Value(rhs), op)));
+      });
+}
+void execute_BINARY_SUBSCR__TUPLE_INT(const Instruction &inst,
+                                      [[maybe_unused]] ArgType arg,
+                                      State &state) {
+  auto &curFrame = state.getCurFrame();
+  if (!topTypesAre(curFrame, ValueType::Tuple, ValueType::Integer)) {
+    dequicken(inst, state);
+    return;
+  }
+  auto idx = curFrame.popTos().getInt();
+  auto tuple = curFrame.popTos();
+
+  curFrame.push(static_cast<const TupleObj *>(tuple.getObj())->at(idx));
 }
 
 } // namespace
 
-const std::unordered_map<leech::Opcodes, leech::Instruction::Callback>
+void leech::subscriptSlice(State &state) {
+  auto &curFrame = state.getCurFrame();
+  const auto &seq = curFrame.peek(1);
+  if (seq.getType() != ValueType::Tuple)
+    throw std::invalid_argument("Only tuples can be sliced");
+
+  auto len = static_cast<const TupleObj *>(seq.getObj())->size();
+  auto [begin, end] =
+      static_cast<const SliceObj *>(curFrame.top().getObj())->resolve(len);
+  /* Tuple is read by view after allocation as GC may move it */
+  auto *view = state.heap.make<TupleObj>(curFrame.peek(1), begin, end);
+  curFrame.pop();
+  curFrame.pop();
+  curFrame.push(Value(view));
+}
+
+const std::array<leech::Instruction::Callback, leech::kOpcodesNum>
     leech::Instruction::opcToCallback = {
-#define LEECH_MAKE_OPCODE(op) {Opcodes::op, execute_##op},
+        nullptr,
+#define LEECH_MAKE_OPCODE(op) execute_##op,
 #include "common/opcodes.ii"
 #undef LEECH_MAKE_OPCODE
 };
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+    !defined(LEECH_NO_COMPUTED_GOTO)
+#define LEECH_COMPUTED_GOTO
+#endif
+
+namespace {
+/* Opcodes whose instructions may rewrite themselves in code */
+constexpr bool mayRewrite(Opcodes opcode) {
+  return isQuickenable(opcode) || isQuickened(opcode);
+}
+
+/* Opcodes which may set State::nextPC or pop the last frame */
+constexpr bool mayBranch(Opcodes opcode) {
+  if (isFused(opcode))
+    return mayBranch(getFusedSequence(opcode).back());
+
+  switch (opcode) {
+  case Opcodes::RETURN_VALUE:
+  case Opcodes::CALL_FUNCTION:
+  case Opcodes::CALL_METHOD:
+  case Opcodes::FOR_ITER:
+  case Opcodes::JUMP_FORWARD:
+  case Opcodes::JUMP_ABSOLUTE:
+  case Opcodes::JUMP_IF_FALSE_OR_POP:
+  case Opcodes::JUMP_IF_TRUE_OR_POP:
+  case Opcodes::POP_JUMP_IF_FALSE:
+  case Opcodes::POP_JUMP_IF_TRUE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/* Sentinel placed after the last instruction to catch running off the code */
+const Instruction kCodeEnd{};
+} // namespace
+
+#ifdef LEECH_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+void leech::executeThreaded(State &state) {
+  const auto &code = state.pFile->code;
+  auto &pc = state.pc;
+
+#ifdef LEECH_COMPUTED_GOTO
+  static const void *const labels[] = {
+      &&L_UNKNOWN,
+#define LEECH_MAKE_OPCODE(opc) &&L_##opc,
+#include "common/opcodes.ii"
+#undef LEECH_MAKE_OPCODE
+  };
+#define LEECH_LABEL(opc) &&L_##opc
+#define LEECH_HANDLER(opc) L_##opc:
+#define LEECH_DISPATCH() goto *(cur = &decoded[pc])->handler
+#define LEECH_REDECODE()                                                       \
+  cur->handler = labels[toUnderlying(cur->inst->getOpcode())]
+#else
+#define LEECH_LABEL(opc) nullptr
+#define LEECH_HANDLER(opc) case Opcodes::opc:
+#define LEECH_DISPATCH() continue
+#define LEECH_REDECODE() (void)cur
+#endif
+
+  /* Pre-decode code once, so dispatch is a single indirect jump */
+  auto &decoded = state.threadedCode;
+  if (decoded.empty()) {
+    decoded.reserve(code.size() + 1);
+    for (const auto &inst : code) {
+#ifdef LEECH_COMPUTED_GOTO
+      decoded.push_back(
+          {labels[toUnderlying(inst.getOpcode())], &inst, inst.getArg()});
+#else
+      decoded.push_back({nullptr, &inst, inst.getArg()});
+#endif
+    }
+    decoded.push_back({LEECH_LABEL(UNKNOWN), &kCodeEnd});
+  }
+
+  if (pc >= code.size())
+    throw std::out_of_range{"PC is out of code bounds"};
+
+  DecodedInst *cur = nullptr;
+
+#ifdef LEECH_COMPUTED_GOTO
+  LEECH_DISPATCH();
+#else
+  for (;;) {
+    cur = &decoded[pc];
+    switch (cur->inst->getOpcode()) {
+#endif
+
+  LEECH_HANDLER(UNKNOWN) {
+    throw std::out_of_range{"PC is out of code bounds"};
+  }
+
+#define LEECH_MAKE_OPCODE(opc)                                                 \
+  LEECH_HANDLER(opc) {                                                         \
+    if constexpr (mayBranch(Opcodes::opc)) {                                   \
+      state.nextPC.reset();                                                    \
+      execute_##opc(*cur->inst, cur->arg, state);                              \
+      if (state.funcStack.size() <= state.baseDepth)                           \
+        return;                                                                \
+      pc = state.nextPC.value_or(pc + getInstLength(Opcodes::opc));            \
+      if (pc >= code.size())                                                   \
+        throw std::out_of_range{"PC is out of code bounds"};                   \
+    } else {                                                                   \
+      execute_##opc(*cur->inst, cur->arg, state);                              \
+      /* Quickening changed the opcode in code */                              \
+      if constexpr (mayRewrite(Opcodes::opc))                                  \
+        LEECH_REDECODE();                                                      \
+      pc += getInstLength(Opcodes::opc);                                       \
+    }                                                                          \
+    LEECH_DISPATCH();                                                          \
+  }
+#include "common/opcodes.ii"
+#undef LEECH_MAKE_OPCODE
+
+#ifndef LEECH_COMPUTED_GOTO
+    default:
+      throw std::runtime_error{"Unknown inst opcode in threaded dispatch"};
+    }
+  }
+#endif
+
+#undef LEECH_REDECODE
+#undef LEECH_DISPATCH
+#undef LEECH_HANDLER
+#undef LEECH_LABEL
+}
+
+#ifdef LEECH_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
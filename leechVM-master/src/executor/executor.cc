@@ -1,41 +1,164 @@
+#include <algorithm>
+
+#include "executor/aot.hh"
 #include "executor/executor.hh"
 
 namespace leech {
-StackFrame::StackFrame(const FuncMeta *pmeta) : pmeta_(pmeta) {
+StackFrame::StackFrame(const FuncMeta *pmeta, ValueStack *pstack,
+                       gc::Heap *pheap, std::size_t base)
+    : pmeta_(pmeta), pstack_(pstack), pheap_(pheap), base_(base) {
   if (pmeta_ == nullptr)
     throw std::invalid_argument("Creating stack frame w/ Null func meta");
+  if (!pmeta_->isResolved())
+    throw std::logic_error("Creating stack frame w/ unresolved local slots");
 
-  for (auto &name : pmeta_->names)
-    vars_.emplace(name, nullptr);
+  stackBase_ = base_ + pmeta_->slotsNum;
+  checked_ = !pmeta_->maxStack.has_value();
 }
 
-void StackFrame::push(pLeechObj obj) {
-  if (nullptr == obj)
-    throw std::invalid_argument("Trying to push nullptr into stackframe");
+void StackFrame::push(const Value &val) {
+  if (!val.isBound())
+    throw std::invalid_argument("Trying to push unbound value into stackframe");
 
-  dataStack_.push(obj);
+  pstack_->push_back(val);
 }
 
-State::State(LeechFile *pfile) : pFile(pfile) {
+State::State(const LeechFile *pfile, std::size_t maxDepth)
+    : maxCallDepth(maxDepth), pFile(pfile) {
   if (nullptr == pFile)
     throw std::invalid_argument("Trying to execute null leech file");
+
+  std::vector<StackFrame> frames{};
+  frames.reserve(std::min(maxCallDepth, kInitValueStackSize));
+  funcStack = FuncStack{std::move(frames)};
+  valueStack.reserve(kInitValueStackSize);
+  heap.setRoots([this](IValueVisitor &vis) {
+    for (auto &val : valueStack)
+      vis.visit(val);
+  });
+
+  attrCacheIdx.resize(pFile->code.size());
+  for (std::size_t i = 0; i < pFile->code.size(); ++i)
+    switch (pFile->code[i].getOpcode()) {
+    case Opcodes::LOAD_ATTR:
+    case Opcodes::STORE_ATTR:
+    case Opcodes::CALL_METHOD:
+      attrCacheIdx[i] = static_cast<std::uint32_t>(attrCaches.size());
+      attrCaches.emplace_back();
+      break;
+    default:
+      break;
+    }
+
   auto &meta = pFile->meta;
   auto *mainFrame = &meta.funcs.at(std::string(kMainFuncName));
   pc = mainFrame->addr;
-  funcStack.emplace(mainFrame);
+  pushFrame(mainFrame);
+}
+
+void State::setMainArgs(std::span<const Value> args) {
+  if (funcStack.size() != 1 || getCurFrame().stackSize() != 0)
+    throw std::logic_error{"Passing args to main after the run started"};
+
+  const auto *mainMeta = getCurFrame().getMeta();
+  popFrame();
+  /* Pushed as caller would do: the first arg is on top */
+  for (auto It = args.rbegin(); It != args.rend(); ++It)
+    valueStack.push_back(*It);
+  pushFrame(mainMeta, args.size());
+}
+
+void State::pushFrame(const FuncMeta *pmeta, std::size_t argsNum) {
+  if (funcStack.size() >= maxCallDepth)
+    throw CallStackOverflow{maxCallDepth};
+  if (!funcStack.empty() && getCurFrame().stackSize() < argsNum)
+    throw std::runtime_error("Trying to pop from empty stack!");
+
+  auto base = valueStack.size() - argsNum;
+  funcStack.emplace(pmeta, &valueStack, &heap, base);
+
+  /* Args were pushed in reverse order, put them to slots of names[i] */
+  auto args = valueStack.begin() + static_cast<std::ptrdiff_t>(base);
+  std::reverse(args, valueStack.end());
+
+  std::size_t slotsFilled = 0;
+  auto toFill = std::min(argsNum, pmeta->names.size());
+  for (std::size_t i = 0; i < toFill; ++i) {
+    /* slots[i] <= i, so the arg is never overwritten before being read */
+    auto slot = pmeta->slots[i];
+    valueStack[base + slot] = heap.clone(valueStack[base + i]);
+    slotsFilled = std::max(slotsFilled, slot + 1);
+  }
+
+  /* Drop extra args and leave the rest of slots unbound */
+  valueStack.resize(base + slotsFilled);
+  valueStack.resize(base + pmeta->slotsNum);
+
+  /* Verified function's data stack is preallocated, so it never grows */
+  if (pmeta->maxStack.has_value()) {
+    auto size = valueStack.size() + *pmeta->maxStack;
+    if (size > valueStack.capacity())
+      valueStack.reserve(std::max(size, 2 * valueStack.capacity()));
+  }
 }
 
 void Executor::execute() {
+  /* Native main returns when the run is over */
+  if (aot::enter(state_))
+    return;
+  if (regCode_.has_value())
+    executeRegisters(state_, *regCode_);
+  else if (mode_ == DispatchMode::Threaded && !isProfiling())
+    executeThreaded(state_);
+  else
+    executeCallbacks();
+}
+
+void Executor::executeCallbacks() {
   auto &fStack = state_.funcStack;
+  std::optional<SampleTimer> timer{};
+  if (profile_.has_value()) {
+    if (profile_->getMode() == ProfileMode::Sample)
+      timer.emplace(sampleInterval_);
+    profile_->syncStack(fStack.size(), fStack.top().getMeta());
+  }
+
   while (fStack.size() != 0) {
     auto &curInst = state_.getInst(state_.pc);
+    if (ngrams_.has_value())
+      ngrams_->record(state_.pc, curInst.getOpcode());
 
     state_.nextPC.reset();
 
-    curInst.execute(state_);
+    if (profile_.has_value())
+      executeProfiled(curInst);
+    else
+      curInst.execute(state_);
 
-    state_.pc = state_.nextPC.value_or(state_.pc + 1);
+    state_.pc =
+        state_.nextPC.value_or(state_.pc + getInstLength(curInst.getOpcode()));
   }
+
+  if (profile_.has_value())
+    profile_->finish();
+}
+
+void Executor::executeProfiled(const Instruction &inst) {
+  auto opcode = inst.getOpcode();
+  if (profile_->getMode() == ProfileMode::Instrument) {
+    auto start = readCycles();
+    inst.execute(state_);
+    profile_->record(opcode, readCycles() - start);
+  } else {
+    inst.execute(state_);
+    /* Samples are charged to the stack instruction ran on */
+    if (auto num = SampleTimer::takePending(); num != 0)
+      profile_->addSamples(opcode, num);
+  }
+
+  auto &fStack = state_.funcStack;
+  profile_->syncStack(fStack.size(),
+                      fStack.empty() ? nullptr : fStack.top().getMeta());
 }
 
 } // namespace leech
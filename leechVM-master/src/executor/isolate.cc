@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "executor/isolate.hh"
+
+namespace leech {
+namespace {
+using MilliSec = std::chrono::duration<double, std::milli>;
+} // namespace
+
+void IsolateStats::print(std::ostream &ost) const {
+  ost << "Isolate " << job << " (worker " << worker << "): "
+      << MilliSec(time).count() << " ms";
+  if (failed())
+    ost << ", failed: " << error;
+  ost << std::endl;
+  gc.print(ost);
+  if (jit.has_value())
+    jit->print(ost);
+}
+
+double IsolatePoolStats::getThroughput() const {
+  auto sec = std::chrono::duration<double>(wallTime).count();
+  return sec == 0 ? 0.0 : static_cast<double>(jobs) / sec;
+}
+
+void IsolatePoolStats::print(std::ostream &ost) const {
+  auto wall = MilliSec(wallTime).count();
+  ost << "Isolates: " << jobs << " runs (" << failed << " failed) on "
+      << threads << " threads in " << wall << " ms, " << getThroughput()
+      << " runs/s" << std::endl;
+  /* Average number of isolates running at once */
+  ost << "Isolates: busy " << MilliSec(busyTime).count() << " ms, parallelism "
+      << (wall == 0 ? 0.0 : MilliSec(busyTime).count() / wall) << std::endl;
+}
+
+IsolatePool::IsolatePool(std::size_t threads, const ExecOptions &opts)
+    : threads_(threads), opts_(opts) {
+  if (threads_ == 0)
+    threads_ = std::max(1U, std::thread::hardware_concurrency());
+  if (opts_.profile == ProfileMode::Sample && threads_ > 1)
+    throw std::invalid_argument{
+        "Sampling profiler can't run in several isolates at once"};
+}
+
+IsolateStats IsolatePool::runJob(const IsolateJob &job,
+                                 const ExecOptions &opts) {
+  IsolateStats stats{};
+  auto start = std::chrono::steady_clock::now();
+  try {
+    if (job.file == nullptr)
+      throw std::invalid_argument("Trying to execute null leech file");
+
+    auto jobOpts = opts;
+    if (job.native != nullptr)
+      jobOpts.aot = job.native;
+    Executor exec(job.file, jobOpts);
+    std::vector<Value> args{};
+    args.reserve(job.args.size());
+    for (const auto &arg : job.args)
+      args.emplace_back(arg);
+    exec.execute(args);
+
+    stats.gc = exec.getHeap().getStats();
+    stats.jit = exec.getJitStats();
+  } catch (const std::exception &e) {
+    stats.error = e.what();
+  }
+  stats.time = std::chrono::steady_clock::now() - start;
+  return stats;
+}
+
+void IsolatePool::run(std::span<const IsolateJob> jobs) {
+  stats_.assign(jobs.size(), {});
+  /* Constants of mapped file are decoded and interned on first use, do it
+   * here so isolates only read the shared file */
+  for (const auto &job : jobs)
+    if (job.file != nullptr)
+      job.file->loadConsts();
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::atomic<std::size_t> next{0};
+  auto work = [&](std::size_t worker) {
+    for (auto idx = next++; idx < jobs.size(); idx = next++) {
+      auto &stats = stats_[idx];
+      stats = runJob(jobs[idx], opts_);
+      stats.job = idx;
+      stats.worker = worker;
+    }
+  };
+
+  auto num = std::min(threads_, jobs.size());
+  std::vector<std::jthread> workers{};
+  workers.reserve(num);
+  for (std::size_t i = 1; i < num; ++i)
+    workers.emplace_back(work, i);
+  /* Calling thread is the worker 0 */
+  work(0);
+  workers.clear();
+
+  poolStats_ = {};
+  poolStats_.jobs = jobs.size();
+  poolStats_.threads = std::max<std::size_t>(num, 1);
+  poolStats_.wallTime = std::chrono::steady_clock::now() - start;
+  for (const auto &stats : stats_) {
+    poolStats_.failed += stats.failed() ? 1U : 0U;
+    poolStats_.busyTime += stats.time;
+  }
+}
+
+} // namespace leech
@@ -0,0 +1,905 @@
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <optional>
+#include <utility>
+
+#include "executor/executor.hh"
+#include "executor/jit.hh"
+
+#if defined(__x86_64__)
+#include "executor/x86asm.hh"
+#endif
+
+namespace leech::jit {
+namespace {
+/* Status returned by compiled code */
+constexpr std::uint64_t kReturned = 0;
+constexpr std::uint64_t kDeopt = 1;
+
+#if defined(__x86_64__)
+static_assert(sizeof(Value) == 16 && Value::getTypeOffset() == 0 &&
+              Value::getPayloadOffset() == 8);
+
+/* Runtime helpers called from compiled code */
+void recordFrame(JitContext *ctx, const FuncMeta *meta, Value *base,
+                 std::uint64_t pc, Value *top) noexcept {
+  /* Capacity is reserved for the deepest native stack */
+  ctx->records.push_back({meta, base, pc, top});
+}
+
+bool subscript(Value *tuple, const Value *idx) noexcept {
+  if (tuple->getType() != ValueType::Tuple ||
+      idx->getType() != ValueType::Integer)
+    return false;
+
+  try {
+    *tuple = tuple->subscript(*idx);
+    return true;
+  } catch (...) {
+    /* Let the interpreter report the error */
+    return false;
+  }
+}
+
+/* Store the next element of iterator to val, false if it is exhausted */
+bool forIter(Value *iter, Value *val) noexcept {
+  return static_cast<IterObj *>(iter->getObj())->next(*val);
+}
+
+/* Entry of function w/o native code */
+std::uint64_t callStub(Value *base, JitContext *ctx, JitFunc *func) noexcept {
+  if (ctx->jit->tick(*func))
+    return func->entry(base, ctx, func);
+
+  recordFrame(ctx, func->meta, base, func->begin,
+              base + func->meta->slotsNum);
+  return kDeopt;
+}
+
+/* Address of data or function as immediate */
+template <class T> std::int64_t toImm(T *ptr) {
+  return std::bit_cast<std::int64_t>(ptr);
+}
+
+constexpr std::int32_t kValueSize = 16;
+/* Frames larger than that are left to the interpreter */
+constexpr std::uint64_t kMaxFrameSize = 1U << 20U;
+
+/* Possible data stack depths at instruction */
+struct Depth final {
+  static constexpr auto kAny = std::numeric_limits<std::uint64_t>::max();
+
+  std::uint64_t lo = 0;
+  std::uint64_t hi = 0;
+
+  [[nodiscard]] bool isExact() const { return lo == hi; }
+
+  /* Depth after instruction which takes need values and pushes
+   * num = pushed - popped ones, none if the stack is always too short */
+  [[nodiscard]] std::optional<Depth> apply(std::uint64_t need,
+                                           std::int64_t num) const {
+    if (hi < need)
+      return std::nullopt;
+    auto shift = [num](std::uint64_t val) {
+      if (val == kAny)
+        return kAny;
+      return static_cast<std::uint64_t>(static_cast<std::int64_t>(val) + num);
+    };
+    return Depth{shift(std::max(lo, need)), shift(hi)};
+  }
+};
+
+/* Opcode which compiled code sees: fused sequences keep their parts in code,
+ * so head is translated as the first instruction of the sequence, quickened
+ * instruction is translated as generic one */
+Opcodes decode(const Instruction &inst) {
+  return getOrigOpcode(inst.getOpcode());
+}
+
+std::optional<x86::Cond> toCond(ArgType arg) {
+  using x86::Cond;
+  switch (static_cast<CmpOp>(arg)) {
+  case CmpOp::LE:
+    return Cond::L;
+  case CmpOp::LEQ:
+    return Cond::LE;
+  case CmpOp::EQ:
+    return Cond::E;
+  case CmpOp::NEQ:
+    return Cond::NE;
+  case CmpOp::GR:
+    return Cond::G;
+  case CmpOp::GREQ:
+    return Cond::GE;
+  default:
+    return std::nullopt;
+  }
+}
+
+/**
+ * Translates one function. Register usage of compiled code:
+ *   rbx - frame base (locals), r12 - JitContext, r13 - data stack top
+ */
+class Compiler final {
+  using Reg = x86::Reg;
+  using Mem = x86::Mem;
+  using Label = x86::Label;
+
+  const LeechFile &file_;
+  std::unordered_map<const FuncMeta *, JitFunc> &funcs_;
+  JitFunc &func_;
+  const FuncMeta &meta_;
+  JitContext &ctx_;
+  std::uint64_t begin_ = 0;
+  std::uint64_t end_ = 0;
+  std::int32_t slotsNum_ = 0;
+
+  std::vector<std::optional<Depth>> depths_{};
+  std::vector<bool> isTarget_{};
+  std::vector<bool> isCheck_{};
+
+  x86::Assembler as_{};
+  std::vector<Label> labels_{};
+  Label epilogue_;
+  std::size_t osrOffset_ = 0;
+  std::map<std::uint64_t, Label> deopts_{};
+  /* Cold stubs of call sites: label, pc */
+  std::vector<std::pair<Label, std::uint64_t>> overflows_{};
+  std::vector<std::pair<Label, std::uint64_t>> callDeopts_{};
+
+public:
+  Compiler(const LeechFile &file,
+           std::unordered_map<const FuncMeta *, JitFunc> &funcs,
+           JitFunc &func, JitContext &ctx)
+      : file_(file), funcs_(funcs), func_(func), meta_(*func.meta), ctx_(ctx),
+        begin_(func.begin), end_(func.end),
+        slotsNum_(static_cast<std::int32_t>(func.meta->slotsNum)),
+        epilogue_(as_.newLabel()) {}
+
+  bool compile() {
+    if (meta_.slotsNum > kMaxFrameSize || begin_ >= end_)
+      return false;
+
+    analyze();
+    emit();
+
+    func_.code = ExecBuffer{as_.finalize()};
+    func_.entry = std::bit_cast<NativeEntry>(func_.code.data());
+    func_.osrEntry = std::bit_cast<OsrEntry>(func_.code.data() + osrOffset_);
+    return true;
+  }
+
+private:
+  [[nodiscard]] bool inRange(std::uint64_t pc) const {
+    return pc >= begin_ && pc < end_;
+  }
+  [[nodiscard]] std::size_t idx(std::uint64_t pc) const { return pc - begin_; }
+  [[nodiscard]] const Instruction &inst(std::uint64_t pc) const {
+    return file_.code[pc];
+  }
+
+  /* Callee of CALL_FUNCTION at pc if it is known */
+  [[nodiscard]] const JitFunc *getCallee(std::uint64_t pc) const {
+    auto nameIdx = inst(pc).getArg();
+    if (nameIdx >= meta_.names.size())
+      return nullptr;
+
+    auto It = file_.meta.funcs.find(std::string(meta_.names[nameIdx]));
+    if (It == file_.meta.funcs.end())
+      return nullptr;
+
+    const auto &callee = funcs_.at(&It->second);
+    if (callee.status == JitFunc::Status::Failed ||
+        callee.meta->slotsNum > kMaxFrameSize)
+      return nullptr;
+    return &callee;
+  }
+
+  [[nodiscard]] bool canCall(std::uint64_t pc) const {
+    return depths_[idx(pc)]->isExact() && getCallee(pc) != nullptr;
+  }
+
+  /* Depth of data stack before each instruction reachable from the entry */
+  void analyze() {
+    auto size = end_ - begin_;
+    depths_.assign(size, std::nullopt);
+    isTarget_.assign(size, false);
+    isCheck_.assign(size, false);
+
+    std::vector<std::uint64_t> worklist{begin_};
+    depths_[0] = Depth{};
+    isCheck_[0] = true;
+
+    auto next = [&](std::uint64_t pc, std::optional<Depth> depth) {
+      if (!inRange(pc) || !depth.has_value())
+        return;
+      auto &cur = depths_[idx(pc)];
+      if (!cur.has_value()) {
+        cur = depth;
+        worklist.push_back(pc);
+        return;
+      }
+
+      /* Depth growing along a loop is widened to unbounded at once */
+      Depth merged{std::min(cur->lo, depth->lo),
+                   depth->hi > cur->hi ? Depth::kAny : cur->hi};
+      if (merged.lo != cur->lo || merged.hi != cur->hi) {
+        cur = merged;
+        worklist.push_back(pc);
+      }
+    };
+
+    auto jump = [&](std::uint64_t dest, std::optional<Depth> depth) {
+      next(dest, depth);
+      if (inRange(dest))
+        isTarget_[idx(dest)] = isCheck_[idx(dest)] = true;
+    };
+
+    while (!worklist.empty()) {
+      auto pc = worklist.back();
+      worklist.pop_back();
+      auto depth = *depths_[idx(pc)];
+
+      switch (decode(inst(pc))) {
+      case Opcodes::LOAD_FAST:
+      case Opcodes::LOAD_CONST:
+        next(pc + 1, depth.apply(0, 1));
+        break;
+      case Opcodes::STORE_FAST:
+        next(pc + 1, depth.apply(1, 0));
+        break;
+      case Opcodes::POP_TOP:
+        next(pc + 1, depth.apply(1, -1));
+        break;
+      case Opcodes::BINARY_ADD:
+      case Opcodes::BINARY_SUBTRACT:
+      case Opcodes::BINARY_SUBSCR:
+        next(pc + 1, depth.apply(2, -1));
+        break;
+      case Opcodes::COMPARE_OP:
+        if (toCond(inst(pc).getArg()).has_value())
+          next(pc + 1, depth.apply(2, -1));
+        break;
+      case Opcodes::POP_JUMP_IF_FALSE:
+      case Opcodes::POP_JUMP_IF_TRUE:
+        next(pc + 1, depth.apply(1, -1));
+        jump(inst(pc).getArg(), depth.apply(1, -1));
+        break;
+      case Opcodes::JUMP_FORWARD:
+      case Opcodes::JUMP_ABSOLUTE:
+        jump(inst(pc).getArg(), depth);
+        break;
+      /* Allocating instructions are run by interpreter after deopt, loops
+       * after them are entered by OSR */
+      case Opcodes::GET_ITER:
+        next(pc + 1, depth.apply(1, 0));
+        break;
+      case Opcodes::BUILD_SLICE:
+        next(pc + 1, depth.apply(2, -1));
+        break;
+      case Opcodes::FOR_ITER:
+        /* Exhausted iterator is popped */
+        next(pc + 1, depth.apply(1, 1));
+        jump(inst(pc).getArg(), depth.apply(1, -1));
+        break;
+      case Opcodes::CALL_FUNCTION:
+        /* Arguments are shuffled by code specialized for their number */
+        if (canCall(pc)) {
+          next(pc + 1, Depth{1, 1});
+          if (inRange(pc + 1))
+            isCheck_[idx(pc + 1)] = true;
+        }
+        break;
+      default:
+        /* No successors: deopt */
+        break;
+      }
+    }
+  }
+
+  /* Max growth of data stack till the next check of its bound */
+  [[nodiscard]] std::int32_t getGrowth(std::uint64_t from) const {
+    std::int32_t num = 0;
+    std::int32_t max = 0;
+    for (auto pc = from; inRange(pc) && depths_[idx(pc)].has_value(); ++pc) {
+      if (pc != from && isCheck_[idx(pc)])
+        break;
+
+      switch (decode(inst(pc))) {
+      case Opcodes::LOAD_FAST:
+      case Opcodes::LOAD_CONST:
+      case Opcodes::FOR_ITER:
+        max = std::max(max, ++num);
+        continue;
+      case Opcodes::STORE_FAST:
+        continue;
+      case Opcodes::POP_TOP:
+      case Opcodes::BINARY_ADD:
+      case Opcodes::BINARY_SUBTRACT:
+      case Opcodes::BINARY_SUBSCR:
+      case Opcodes::COMPARE_OP:
+      case Opcodes::POP_JUMP_IF_FALSE:
+      case Opcodes::POP_JUMP_IF_TRUE:
+        --num;
+        continue;
+      default:
+        break;
+      }
+      break;
+    }
+    return max;
+  }
+
+  static Mem local(std::int64_t slot) {
+    return {Reg::RBX, static_cast<std::int32_t>(slot * kValueSize)};
+  }
+  /* k-th value from the top of data stack */
+  static Mem tos(std::int32_t k) { return {Reg::R13, -k * kValueSize}; }
+  static Mem payload(Mem mem) { return {mem.base, mem.disp + 8}; }
+
+  Label deopt(std::uint64_t pc) {
+    auto It = deopts_.find(pc);
+    if (It == deopts_.end())
+      It = deopts_.emplace(pc, as_.newLabel()).first;
+    return It->second;
+  }
+
+  void copyValue(Mem dst, Mem src) {
+    as_.mov(Reg::RAX, src);
+    as_.mov(Reg::RCX, payload(src));
+    as_.mov(dst, Reg::RAX);
+    as_.mov(payload(dst), Reg::RCX);
+  }
+
+  void guardType(Mem val, ValueType type, std::uint64_t pc) {
+    as_.cmp8(val, toUnderlying(type));
+    as_.jcc(x86::Cond::NE, deopt(pc));
+  }
+
+  void guardNotType(Mem val, ValueType type, std::uint64_t pc) {
+    as_.cmp8(val, toUnderlying(type));
+    as_.jcc(x86::Cond::E, deopt(pc));
+  }
+
+  /* Deopt if data stack has less than need values */
+  void checkDepth(std::uint64_t pc, std::uint64_t need) {
+    if (depths_[idx(pc)]->lo >= need)
+      return;
+    as_.lea(Reg::RAX, local(slotsNum_ + static_cast<std::int64_t>(need)));
+    as_.cmp(Reg::R13, Reg::RAX);
+    as_.jcc(x86::Cond::B, deopt(pc));
+  }
+
+  /* Deopt if there is no room for num values after end */
+  void checkBound(Mem end, std::uint64_t pc) {
+    as_.lea(Reg::RAX, end);
+    as_.cmp(Reg::RAX, Mem{Reg::R12, ctxOffset(&ctx_.stackEnd)});
+    as_.jcc(x86::Cond::A, deopt(pc));
+  }
+
+  template <class T> std::int32_t ctxOffset(const T *field) const {
+    return static_cast<std::int32_t>(reinterpret_cast<const char *>(field) -
+                                     reinterpret_cast<const char *>(&ctx_));
+  }
+
+  void emit() {
+    labels_.clear();
+    for (auto pc = begin_; pc < end_; ++pc)
+      labels_.push_back(as_.newLabel());
+
+    /* Entry: rdi - frame base, rsi - context */
+    emitPrologue();
+    as_.lea(Reg::R13, local(slotsNum_));
+
+    for (auto pc = begin_; pc < end_; ++pc) {
+      if (!depths_[idx(pc)].has_value())
+        continue;
+
+      as_.bind(labels_[idx(pc)]);
+      if (isCheck_[idx(pc)])
+        if (auto growth = getGrowth(pc); growth != 0)
+          checkBound(tos(-growth), pc);
+
+      if (emitInst(pc))
+        ++pc;
+    }
+
+    /* OSR entry: rdx - data stack top, rcx - target */
+    auto osrEntry = as_.size();
+    emitPrologue();
+    as_.mov(Reg::R13, Reg::RDX);
+    as_.jmp(Reg::RCX);
+
+    emitCold();
+
+    for (auto pc = begin_; pc < end_; ++pc)
+      if (auto &depth = depths_[idx(pc)];
+          depth.has_value() && (isTarget_[idx(pc)] || pc == begin_))
+        func_.osrTargets[pc] = {as_.getOffset(labels_[idx(pc)]), depth->lo,
+                                depth->hi};
+
+    osrOffset_ = osrEntry;
+  }
+
+  void emitPrologue() {
+    as_.push(Reg::RBX);
+    as_.push(Reg::R12);
+    as_.push(Reg::R13);
+    as_.mov(Reg::RBX, Reg::RDI);
+    as_.mov(Reg::R12, Reg::RSI);
+  }
+
+  void emitCold() {
+    for (auto [label, pc] : overflows_) {
+      as_.bind(label);
+      as_.inc64(Mem{Reg::R12, ctxOffset(&ctx_.depthLeft)});
+      as_.jmp(deopt(pc));
+    }
+
+    /* Callee was deoptimized: caller resumes after the call in interpreter */
+    for (auto [label, pc] : callDeopts_) {
+      as_.bind(label);
+      as_.lea(Reg::R13, local(slotsNum_));
+      as_.jmp(deopt(pc + 1));
+    }
+
+    for (auto [pc, label] : deopts_) {
+      as_.bind(label);
+      as_.mov(Reg::RDI, Reg::R12);
+      as_.mov(Reg::RSI, toImm(&meta_));
+      as_.mov(Reg::RDX, Reg::RBX);
+      as_.mov(Reg::RCX, static_cast<std::int64_t>(pc));
+      as_.mov(Reg::R8, Reg::R13);
+      as_.mov(Reg::RAX, toImm(&recordFrame));
+      as_.call(Reg::RAX);
+      as_.movEax(static_cast<std::uint32_t>(kDeopt));
+      as_.jmp(epilogue_);
+    }
+
+    as_.bind(epilogue_);
+    as_.pop(Reg::R13);
+    as_.pop(Reg::R12);
+    as_.pop(Reg::RBX);
+    as_.ret();
+  }
+
+  /* Jump to bytecode dest, which may be outside the function */
+  Label jumpTarget(std::uint64_t dest) {
+    return inRange(dest) ? labels_[idx(dest)] : deopt(dest);
+  }
+
+  /* Returns true if the next instruction is merged into this one */
+  bool emitInst(std::uint64_t pc) {
+    const auto &cur = inst(pc);
+    auto arg = cur.getArg();
+
+    switch (decode(cur)) {
+    case Opcodes::LOAD_FAST: {
+      auto slot = local(static_cast<std::int64_t>(meta_.slots.at(arg)));
+      guardNotType(slot, ValueType::Unknown, pc);
+      copyValue(tos(0), slot);
+      as_.add(Reg::R13, kValueSize);
+      break;
+    }
+    case Opcodes::LOAD_CONST: {
+      /* Constants are owned by FuncMeta, so boxed ones never move */
+      Value cst{meta_.getConst(arg)};
+      std::int64_t raw[2]{};
+      std::memcpy(raw, &cst, sizeof(raw));
+      as_.mov(Reg::RAX, raw[0]);
+      as_.mov(tos(0), Reg::RAX);
+      as_.mov(Reg::RAX, raw[1]);
+      as_.mov(payload(tos(0)), Reg::RAX);
+      as_.add(Reg::R13, kValueSize);
+      break;
+    }
+    case Opcodes::STORE_FAST:
+      checkDepth(pc, 1);
+      copyValue(local(static_cast<std::int64_t>(meta_.slots.at(arg))), tos(1));
+      break;
+    case Opcodes::POP_TOP:
+      checkDepth(pc, 1);
+      as_.sub(Reg::R13, kValueSize);
+      break;
+    case Opcodes::BINARY_ADD:
+    case Opcodes::BINARY_SUBTRACT:
+      checkDepth(pc, 2);
+      guardType(tos(1), ValueType::Integer, pc);
+      guardType(tos(2), ValueType::Integer, pc);
+      as_.mov(Reg::RAX, payload(tos(2)));
+      if (decode(cur) == Opcodes::BINARY_ADD)
+        as_.add(Reg::RAX, payload(tos(1)));
+      else
+        as_.sub(Reg::RAX, payload(tos(1)));
+      as_.mov(payload(tos(2)), Reg::RAX);
+      as_.sub(Reg::R13, kValueSize);
+      break;
+    case Opcodes::BINARY_SUBSCR:
+      checkDepth(pc, 2);
+      as_.lea(Reg::RDI, tos(2));
+      as_.lea(Reg::RSI, tos(1));
+      as_.mov(Reg::RAX, toImm(&subscript));
+      as_.call(Reg::RAX);
+      as_.testAl();
+      as_.jcc(x86::Cond::E, deopt(pc));
+      as_.sub(Reg::R13, kValueSize);
+      break;
+    case Opcodes::COMPARE_OP:
+      if (!toCond(arg).has_value()) {
+        as_.jmp(deopt(pc));
+        break;
+      }
+      return emitCompare(pc);
+    case Opcodes::POP_JUMP_IF_FALSE:
+    case Opcodes::POP_JUMP_IF_TRUE:
+      checkDepth(pc, 1);
+      guardType(tos(1), ValueType::Integer, pc);
+      as_.sub(Reg::R13, kValueSize);
+      as_.cmp64(payload(tos(0)), 0);
+      as_.jcc(decode(cur) == Opcodes::POP_JUMP_IF_FALSE ? x86::Cond::E
+                                                        : x86::Cond::NE,
+              jumpTarget(arg));
+      break;
+    case Opcodes::JUMP_FORWARD:
+    case Opcodes::JUMP_ABSOLUTE:
+      as_.jmp(jumpTarget(arg));
+      break;
+    case Opcodes::FOR_ITER: {
+      checkDepth(pc, 1);
+      guardType(tos(1), ValueType::Iterator, pc);
+      as_.lea(Reg::RDI, tos(1));
+      as_.lea(Reg::RSI, tos(0));
+      as_.mov(Reg::RAX, toImm(&forIter));
+      as_.call(Reg::RAX);
+      as_.testAl();
+      auto more = as_.newLabel();
+      as_.jcc(x86::Cond::NE, more);
+      as_.sub(Reg::R13, kValueSize);
+      as_.jmp(jumpTarget(arg));
+      as_.bind(more);
+      as_.add(Reg::R13, kValueSize);
+      break;
+    }
+    case Opcodes::CALL_FUNCTION:
+      if (!canCall(pc)) {
+        as_.jmp(deopt(pc));
+        break;
+      }
+      emitCall(pc);
+      break;
+    case Opcodes::RETURN_VALUE:
+      checkDepth(pc, 1);
+      /* Returned objects are cloned by the interpreter */
+      guardNotType(tos(1), ValueType::Class, pc);
+      copyValue(local(0), tos(1));
+      as_.xorEax();
+      as_.jmp(epilogue_);
+      return false;
+    default:
+      as_.jmp(deopt(pc));
+      return false;
+    }
+
+    if (!inRange(pc + 1))
+      as_.jmp(deopt(pc + 1));
+    return false;
+  }
+
+  /* COMPARE_OP is merged w/ the following conditional jump if possible */
+  bool emitCompare(std::uint64_t pc) {
+    auto cond = *toCond(inst(pc).getArg());
+    checkDepth(pc, 2);
+    guardType(tos(1), ValueType::Integer, pc);
+    guardType(tos(2), ValueType::Integer, pc);
+    as_.mov(Reg::RAX, payload(tos(2)));
+    as_.cmp(Reg::RAX, payload(tos(1)));
+
+    auto jumpPC = pc + 1;
+    auto jump = inRange(jumpPC) ? decode(inst(jumpPC)) : Opcodes::UNKNOWN;
+    bool canMerge = (jump == Opcodes::POP_JUMP_IF_FALSE ||
+                     jump == Opcodes::POP_JUMP_IF_TRUE) &&
+                    !isCheck_[idx(jumpPC)];
+    if (!canMerge) {
+      as_.setccEax(cond);
+      as_.mov(payload(tos(2)), Reg::RAX);
+      as_.sub(Reg::R13, kValueSize);
+      if (!inRange(pc + 1))
+        as_.jmp(deopt(pc + 1));
+      return false;
+    }
+
+    as_.lea(Reg::R13, tos(2));
+    as_.jcc(jump == Opcodes::POP_JUMP_IF_FALSE ? x86::invert(cond) : cond,
+            jumpTarget(inst(jumpPC).getArg()));
+    if (!inRange(jumpPC + 1))
+      as_.jmp(deopt(jumpPC + 1));
+    return true;
+  }
+
+  /**
+   * Whole data stack of n values is passed as args like State::pushFrame
+   * does: reversed args go to callee's slots of names[i], the rest of
+   * callee's slots are unbound. Callee frame starts at caller's data stack
+   */
+  void emitCall(std::uint64_t pc) {
+    const auto *callee = getCallee(pc);
+    const auto &cmeta = *callee->meta;
+    auto num = depths_[idx(pc)]->lo;
+    auto calleeSlots = static_cast<std::int64_t>(cmeta.slotsNum);
+    auto toFill = std::min<std::uint64_t>(num, cmeta.names.size());
+    auto stackBase = static_cast<std::int64_t>(slotsNum_);
+    auto arg = [&](std::uint64_t i) {
+      return local(stackBase + static_cast<std::int64_t>(num - 1 - i));
+    };
+
+    checkBound(local(stackBase + std::max(static_cast<std::int64_t>(num),
+                                          calleeSlots)),
+               pc);
+    /* Arguments are cloned by the interpreter */
+    for (std::uint64_t i = 0; i < toFill; ++i)
+      guardNotType(arg(i), ValueType::Class, pc);
+
+    auto overflow = as_.newLabel();
+    overflows_.emplace_back(overflow, pc);
+    as_.dec64(Mem{Reg::R12, ctxOffset(&ctx_.depthLeft)});
+    as_.jcc(x86::Cond::S, overflow);
+
+    /* Final source of each filled slot */
+    std::uint64_t slotsFilled = 0;
+    std::map<std::uint64_t, std::uint64_t> srcOf{};
+    for (std::uint64_t i = 0; i < toFill; ++i) {
+      auto slot = cmeta.slots[i];
+      srcOf[slot] = i;
+      slotsFilled = std::max(slotsFilled, slot + 1);
+    }
+    /* Not overwritten positions keep reversed args */
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> moves{};
+    for (std::uint64_t pos = 0; pos < slotsFilled; ++pos) {
+      auto It = srcOf.find(pos);
+      auto src = It == srcOf.end() ? pos : It->second;
+      /* Reversed arg i is at stack position num - 1 - i */
+      if (num - 1 - src != pos)
+        moves.emplace_back(pos, num - 1 - src);
+    }
+    emitMoves(moves, stackBase);
+
+    for (auto pos = static_cast<std::int64_t>(slotsFilled); pos < calleeSlots;
+         ++pos)
+      as_.mov8(local(stackBase + pos), toUnderlying(ValueType::Unknown));
+
+    as_.lea(Reg::RDI, local(stackBase));
+    as_.mov(Reg::RSI, Reg::R12);
+    as_.mov(Reg::RDX, toImm(callee));
+    as_.mov(Reg::RAX, toImm(&callee->entry));
+    as_.mov(Reg::RAX, Mem{Reg::RAX, 0});
+    as_.call(Reg::RAX);
+    as_.inc64(Mem{Reg::R12, ctxOffset(&ctx_.depthLeft)});
+    as_.testEax();
+
+    auto calleeDeopt = as_.newLabel();
+    callDeopts_.emplace_back(calleeDeopt, pc);
+    as_.jcc(x86::Cond::NE, calleeDeopt);
+
+    /* Returned value is put to callee's base */
+    as_.lea(Reg::R13, local(stackBase + 1));
+  }
+
+  /* Parallel copy of values dst <- src, positions are relative to base */
+  void emitMoves(
+      const std::vector<std::pair<std::uint64_t, std::uint64_t>> &moves,
+      std::int64_t base) {
+    auto pos = [base](std::uint64_t p) {
+      return local(base + static_cast<std::int64_t>(p));
+    };
+
+    bool overlap = std::any_of(moves.begin(), moves.end(), [&](auto &mv) {
+      return std::any_of(moves.begin(), moves.end(),
+                         [&](auto &other) { return other.second == mv.first; });
+    });
+    if (!overlap) {
+      for (auto [dst, src] : moves)
+        copyValue(pos(dst), pos(src));
+      return;
+    }
+
+    /* Sources are saved on the machine stack first */
+    auto tmpSize = static_cast<std::int32_t>(moves.size()) * kValueSize;
+    as_.sub(Reg::RSP, tmpSize);
+    for (std::size_t i = 0; i < moves.size(); ++i)
+      copyValue(Mem{Reg::RSP, static_cast<std::int32_t>(i) * kValueSize},
+                pos(moves[i].second));
+    for (std::size_t i = 0; i < moves.size(); ++i)
+      copyValue(pos(moves[i].first),
+                Mem{Reg::RSP, static_cast<std::int32_t>(i) * kValueSize});
+    as_.add(Reg::RSP, tmpSize);
+  }
+};
+#endif // __x86_64__
+} // namespace
+
+void JitStats::print(std::ostream &ost) const {
+  ost << "JIT: compiled " << compiled << ", failed " << failed
+      << ", native runs " << nativeRuns << ", OSR entries " << osrEntries
+      << ", deopts " << deopts << std::endl;
+}
+
+ExecBuffer::ExecBuffer(const std::vector<std::uint8_t> &code)
+    : size_(code.size()) {
+  buf_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (buf_ == MAP_FAILED) {
+    buf_ = nullptr;
+    throw std::runtime_error{"mmap() of JIT code failed"};
+  }
+
+  std::memcpy(buf_, code.data(), size_);
+  if (mprotect(buf_, size_, PROT_READ | PROT_EXEC) != 0) {
+    munmap(buf_, size_);
+    buf_ = nullptr;
+    throw std::runtime_error{"mprotect() of JIT code failed"};
+  }
+}
+
+ExecBuffer::ExecBuffer(ExecBuffer &&other) noexcept
+    : buf_(std::exchange(other.buf_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {}
+
+ExecBuffer &ExecBuffer::operator=(ExecBuffer &&other) noexcept {
+  std::swap(buf_, other.buf_);
+  std::swap(size_, other.size_);
+  return *this;
+}
+
+ExecBuffer::~ExecBuffer() {
+  if (buf_ != nullptr)
+    munmap(buf_, size_);
+}
+
+Jit::Jit(const LeechFile *pfile, std::size_t threshold)
+    : pFile_(pfile), threshold_(threshold) {
+  std::vector<const FuncMeta *> metas{};
+  for (const auto &[name, meta] : pFile_->meta.funcs)
+    metas.push_back(&meta);
+  std::sort(metas.begin(), metas.end(),
+            [](auto *lhs, auto *rhs) { return lhs->addr < rhs->addr; });
+
+  for (std::size_t i = 0; i < metas.size(); ++i) {
+    auto &func = funcs_[metas[i]];
+    func.meta = metas[i];
+    func.begin = metas[i]->addr;
+    func.end = i + 1 < metas.size() ? metas[i + 1]->addr : pFile_->code.size();
+#if defined(__x86_64__)
+    func.entry = &callStub;
+#endif
+  }
+
+  auto size = kStackSize * sizeof(Value);
+  auto *buf = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+  if (buf == MAP_FAILED)
+    throw std::runtime_error{"mmap() of JIT stack failed"};
+
+  stack_ = static_cast<Value *>(buf);
+  ctx_.stackEnd = stack_ + kStackSize;
+  ctx_.jit = this;
+  ctx_.records.reserve(kMaxNativeDepth + 2);
+}
+
+Jit::~Jit() { munmap(stack_, kStackSize * sizeof(Value)); }
+
+bool Jit::tick(JitFunc &func) {
+  if (func.status != JitFunc::Status::Interpreted)
+    return func.status == JitFunc::Status::Compiled;
+  if (++func.counter < threshold_)
+    return false;
+
+  bool res = false;
+  try {
+    res = compile(func);
+  } catch (...) {
+    res = false;
+  }
+
+  func.status = res ? JitFunc::Status::Compiled : JitFunc::Status::Failed;
+  ++(res ? stats_.compiled : stats_.failed);
+  return res;
+}
+
+bool Jit::compile([[maybe_unused]] JitFunc &func) {
+#if defined(__x86_64__)
+  return Compiler{*pFile_, funcs_, func, ctx_}.compile();
+#else
+  return false;
+#endif
+}
+
+void Jit::onCall(State &state) {
+  auto It = funcs_.find(state.getCurFrame().getMeta());
+  if (It == funcs_.end() || !tick(It->second))
+    return;
+  run(state, It->second, It->second.begin);
+}
+
+void Jit::onBackEdge(State &state, std::uint64_t dest) {
+  auto &frame = state.getCurFrame();
+  auto It = funcs_.find(frame.getMeta());
+  if (It == funcs_.end())
+    return;
+
+  auto &func = It->second;
+  if (dest < func.begin || dest >= func.end || !tick(func))
+    return;
+
+  /* Interpreter may get to dest w/ the stack compiled code doesn't expect,
+   * e.g. by jumping from another function */
+  auto target = func.osrTargets.find(dest);
+  auto depth = frame.stackSize();
+  if (target == func.osrTargets.end() || depth < target->second.minDepth ||
+      depth > target->second.maxDepth)
+    return;
+
+  ++stats_.osrEntries;
+  run(state, func, dest);
+}
+
+void Jit::run([[maybe_unused]] State &state, [[maybe_unused]] JitFunc &func,
+              [[maybe_unused]] std::uint64_t pc) {
+#if defined(__x86_64__)
+  auto &valueStack = state.valueStack;
+  auto base = state.getCurFrame().getBase();
+  auto num = valueStack.size() - base;
+  /* Leave some room for callees */
+  if (num > kStackSize / 2)
+    return;
+
+  std::copy_n(valueStack.begin() + static_cast<std::ptrdiff_t>(base), num,
+              stack_);
+  ctx_.depthLeft = static_cast<std::int64_t>(
+      std::min(state.maxCallDepth - state.funcStack.size(), kMaxNativeDepth));
+  ctx_.records.clear();
+  ++stats_.nativeRuns;
+
+  std::uint64_t status = kDeopt;
+  if (pc == func.begin && num == func.meta->slotsNum)
+    status = func.entry(stack_, &ctx_, &func);
+  else
+    status = func.osrEntry(stack_, &ctx_, stack_ + num,
+                           func.code.data() + func.osrTargets.at(pc).offset);
+
+  if (status == kReturned) {
+    /* The same as RETURN_VALUE */
+    auto res = stack_[0];
+    state.popFrame();
+    if (!state.funcStack.empty()) {
+      state.nextPC = state.getCurFrame().getRet();
+      state.getCurFrame().push(res);
+    }
+    return;
+  }
+
+  /* Native stack is laid out as value stack above the entry frame, so
+   * values are copied back as is and frames are restored on top of them */
+  ++stats_.deopts;
+  const auto &records = ctx_.records;
+  auto size = static_cast<std::size_t>(records.front().top - stack_);
+  valueStack.resize(base + size);
+  std::copy_n(stack_, size,
+              valueStack.begin() + static_cast<std::ptrdiff_t>(base));
+
+  for (auto It = records.rbegin(); std::next(It) != records.rend(); ++It) {
+    const auto &inner = *std::next(It);
+    state.getCurFrame().setRet(It->pc);
+    state.funcStack.emplace(
+        inner.meta, &valueStack, &state.heap,
+        base + static_cast<std::size_t>(inner.base - stack_));
+  }
+  state.nextPC = records.front().pc;
+#endif
+}
+
+} // namespace leech::jit
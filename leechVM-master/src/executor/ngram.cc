@@ -0,0 +1,55 @@
+#include <iomanip>
+#include <stdexcept>
+#include <tuple>
+
+#include "executor/ngram.hh"
+
+namespace leech {
+
+NgramProfile::NgramProfile(std::size_t maxLen) : maxLen_(maxLen) {
+  if (maxLen_ < 2 || maxLen_ > kMaxLen)
+    throw std::invalid_argument("N-gram length has to be in [2, " +
+                                std::to_string(kMaxLen) + "]");
+  counts_.resize(maxLen_ - 1);
+}
+
+std::vector<std::pair<NgramProfile::Ngram, std::uint64_t>>
+NgramProfile::getTop(std::size_t len, std::size_t num) const {
+  if (len < 2 || len > maxLen_)
+    return {};
+
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> sorted(
+      counts_[len - 2].begin(), counts_[len - 2].end());
+  num = std::min(num, sorted.size());
+  std::partial_sort(sorted.begin(),
+                    sorted.begin() + static_cast<std::ptrdiff_t>(num),
+                    sorted.end(), [](const auto &lhs, const auto &rhs) {
+                      return std::tie(rhs.second, lhs.first) <
+                             std::tie(lhs.second, rhs.first);
+                    });
+
+  std::vector<std::pair<Ngram, std::uint64_t>> top{};
+  for (std::size_t i = 0; i < num; ++i) {
+    auto [packed, count] = sorted[i];
+    Ngram ngram(len);
+    /* The last executed opcode is in the lowest byte */
+    for (auto It = ngram.rbegin(); It != ngram.rend(); ++It, packed >>= 8U)
+      *It = static_cast<Opcodes>(packed & 0xFFU);
+    top.emplace_back(std::move(ngram), count);
+  }
+  return top;
+}
+
+void NgramProfile::print(std::ostream &ost, std::size_t num) const {
+  for (std::size_t len = 2; len <= maxLen_; ++len) {
+    ost << "Top " << num << " opcode " << len << "-grams:" << std::endl;
+    for (const auto &[ngram, count] : getTop(len, num)) {
+      ost << std::setw(12) << count << " ";
+      for (auto opcode : ngram)
+        ost << " " << OpcodeConv::toName(opcode).value_or("UNKNOWN");
+      ost << std::endl;
+    }
+  }
+}
+
+} // namespace leech
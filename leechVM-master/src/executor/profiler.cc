@@ -0,0 +1,270 @@
+#include <sys/time.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+#include "executor/profiler.hh"
+
+namespace leech {
+
+Profile::Profile(const Meta &meta, ProfileMode mode) : mode_(mode) {
+  /* Sort by name to keep output stable */
+  std::map<std::string_view, const FuncMeta *> byName{};
+  for (const auto &[name, func] : meta.funcs)
+    byName.emplace(name, &func);
+
+  for (const auto &[name, func] : byName) {
+    funcIdx_.emplace(func, funcs_.size());
+    funcs_.push_back({std::string(name)});
+  }
+  active_.resize(funcs_.size());
+}
+
+std::size_t Profile::getChild(std::size_t parent, std::size_t func) {
+  if (parent != kNoParent) {
+    auto &children = nodes_[parent].children;
+    if (auto It = children.find(func); It != children.end())
+      return It->second;
+  }
+
+  auto idx = nodes_.size();
+  nodes_.push_back({func, parent});
+  if (parent != kNoParent)
+    nodes_[parent].children.emplace(func, idx);
+  return idx;
+}
+
+void Profile::syncStackSlow(std::size_t depth, const FuncMeta *top) {
+  while (stack_.size() > depth)
+    leave();
+
+  /* Calls push one frame at a time */
+  while (stack_.size() < depth) {
+    auto func = funcIdx_.at(top);
+    /* Roots of different runs share the node */
+    std::size_t node = 0;
+    if (stack_.empty()) {
+      auto It = std::find_if(nodes_.begin(), nodes_.end(), [func](auto &nd) {
+        return nd.parent == kNoParent && nd.func == func;
+      });
+      node = It == nodes_.end() ? getChild(kNoParent, func)
+                                : static_cast<std::size_t>(It - nodes_.begin());
+    } else
+      node = getChild(stack_.back().node, func);
+
+    ++funcs_[func].calls;
+    std::uint64_t start = 0;
+    if (active_[func]++ == 0 && mode_ == ProfileMode::Instrument)
+      start = readCycles();
+    stack_.push_back({node, start});
+  }
+}
+
+void Profile::leave() {
+  auto act = stack_.back();
+  stack_.pop_back();
+
+  auto func = nodes_[act.node].func;
+  if (--active_[func] == 0 && mode_ == ProfileMode::Instrument)
+    funcs_[func].inclCycles += readCycles() - act.start;
+}
+
+void Profile::finish() {
+  while (!stack_.empty())
+    leave();
+}
+
+std::vector<Profile::FuncStats> Profile::getFuncStats() const {
+  auto res = funcs_;
+  /* Each sample is inclusive for every distinct function on its stack */
+  std::vector<std::size_t> onStack(funcs_.size());
+  std::vector<std::pair<std::size_t, bool>> dfs{};
+  for (std::size_t i = 0; i < nodes_.size(); ++i)
+    if (nodes_[i].parent == kNoParent)
+      dfs.emplace_back(i, false);
+
+  while (!dfs.empty()) {
+    auto [idx, visited] = dfs.back();
+    dfs.pop_back();
+    const auto &node = nodes_[idx];
+    if (visited) {
+      --onStack[node.func];
+      continue;
+    }
+
+    auto &stats = res[node.func];
+    stats.selfCycles += node.selfCycles;
+    stats.selfSamples += node.samples;
+    ++onStack[node.func];
+    for (std::size_t func = 0; func < res.size(); ++func)
+      if (onStack[func] != 0)
+        res[func].inclSamples += node.samples;
+
+    dfs.emplace_back(idx, true);
+    for (auto [func, child] : node.children)
+      dfs.emplace_back(child, false);
+  }
+  return res;
+}
+
+namespace {
+double percent(std::uint64_t part, std::uint64_t total) {
+  return total == 0 ? 0.0
+                    : 100.0 * static_cast<double>(part) /
+                          static_cast<double>(total);
+}
+} // namespace
+
+void Profile::print(std::ostream &ost) const {
+  bool sampled = mode_ == ProfileMode::Sample;
+  auto flags = ost.flags();
+  ost << std::fixed << std::setprecision(2);
+
+  std::vector<std::pair<Opcodes, OpcodeStats>> ops{};
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < opcodes_.size(); ++i) {
+    const auto &stats = opcodes_[i];
+    auto weight = sampled ? stats.samples : stats.cycles;
+    if (stats.count == 0 && stats.samples == 0)
+      continue;
+    ops.emplace_back(static_cast<Opcodes>(i), stats);
+    total += weight;
+  }
+  auto weightOf = [sampled](const OpcodeStats &stats) {
+    return sampled ? stats.samples : stats.cycles;
+  };
+  std::sort(ops.begin(), ops.end(), [&](const auto &lhs, const auto &rhs) {
+    return weightOf(lhs.second) > weightOf(rhs.second);
+  });
+
+  std::size_t width = 8;
+  for (const auto &[opcode, stats] : ops)
+    width = std::max(width,
+                     OpcodeConv::toName(opcode).value_or("").size() + 2);
+
+  ost << std::left << std::setw(static_cast<int>(width)) << "Opcode"
+      << std::right;
+  if (sampled)
+    ost << std::setw(12) << "Samples" << std::setw(9) << "%" << std::endl;
+  else
+    ost << std::setw(12) << "Count" << std::setw(16) << "Cycles"
+        << std::setw(12) << "Cycles/op" << std::setw(9) << "%" << std::endl;
+
+  for (const auto &[opcode, stats] : ops) {
+    ost << std::left << std::setw(static_cast<int>(width))
+        << OpcodeConv::toName(opcode).value_or("UNKNOWN") << std::right;
+    if (!sampled)
+      ost << std::setw(12) << stats.count << std::setw(16) << stats.cycles
+          << std::setw(12)
+          << static_cast<double>(stats.cycles) /
+                 static_cast<double>(std::max<std::uint64_t>(stats.count, 1));
+    else
+      ost << std::setw(12) << stats.samples;
+    ost << std::setw(9) << percent(weightOf(stats), total) << std::endl;
+  }
+  ost << std::endl;
+
+  auto funcs = getFuncStats();
+  auto selfOf = [sampled](const FuncStats &stats) {
+    return sampled ? stats.selfSamples : stats.selfCycles;
+  };
+  auto inclOf = [sampled](const FuncStats &stats) {
+    return sampled ? stats.inclSamples : stats.inclCycles;
+  };
+  std::sort(funcs.begin(), funcs.end(), [&](const auto &lhs, const auto &rhs) {
+    return selfOf(lhs) > selfOf(rhs);
+  });
+  /* Inclusive time of the root is the whole run w/ profiling overhead */
+  std::uint64_t selfTotal = 0;
+  std::uint64_t inclTotal = 0;
+  for (const auto &stats : funcs) {
+    selfTotal += selfOf(stats);
+    inclTotal = std::max(inclTotal, inclOf(stats));
+  }
+
+  const char *unit = sampled ? "samples" : "cycles";
+  ost << std::left << std::setw(24) << "Function" << std::right
+      << std::setw(12) << "Calls" << std::setw(16)
+      << (std::string("Self ") + unit) << std::setw(9) << "Self %"
+      << std::setw(16) << (std::string("Incl ") + unit) << std::setw(9)
+      << "Incl %" << std::endl;
+  for (const auto &stats : funcs) {
+    if (stats.calls == 0)
+      continue;
+    ost << std::left << std::setw(24) << stats.name << std::right
+        << std::setw(12) << stats.calls << std::setw(16) << selfOf(stats)
+        << std::setw(9) << percent(selfOf(stats), selfTotal) << std::setw(16)
+        << inclOf(stats) << std::setw(9) << percent(inclOf(stats), inclTotal)
+        << std::endl;
+  }
+
+  ost.flags(flags);
+}
+
+std::string Profile::getStackName(std::size_t node) const {
+  std::vector<std::size_t> path{};
+  for (auto idx = node; idx != kNoParent; idx = nodes_[idx].parent)
+    path.push_back(nodes_[idx].func);
+
+  std::string res{};
+  for (auto It = path.rbegin(); It != path.rend(); ++It) {
+    if (!res.empty())
+      res += ';';
+    res += funcs_[*It].name;
+  }
+  return res;
+}
+
+void Profile::writeFolded(std::ostream &ost) const {
+  for (std::size_t i = 0; i < nodes_.size(); ++i) {
+    const auto &node = nodes_[i];
+    auto weight =
+        mode_ == ProfileMode::Sample ? node.samples : node.selfCycles;
+    if (weight != 0)
+      ost << getStackName(i) << ' ' << weight << '\n';
+  }
+}
+
+std::atomic<std::uint64_t> SampleTimer::pending_{0};
+volatile std::sig_atomic_t SampleTimer::active_ = 0;
+
+void SampleTimer::handler([[maybe_unused]] int sig) {
+  pending_.fetch_add(1, std::memory_order_relaxed);
+}
+
+SampleTimer::SampleTimer(std::chrono::microseconds interval) {
+  if (active_ != 0)
+    throw std::logic_error{"Trying to start more than one sample timer"};
+  if (interval.count() <= 0)
+    throw std::invalid_argument{"Sampling interval must be positive"};
+
+  struct sigaction action {};
+  action.sa_handler = &SampleTimer::handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  if (sigaction(SIGPROF, &action, &oldAction_) != 0)
+    throw std::runtime_error{"sigaction() failed"};
+
+  itimerval timer{};
+  auto sec = std::chrono::duration_cast<std::chrono::seconds>(interval);
+  timer.it_interval.tv_sec = sec.count();
+  timer.it_interval.tv_usec = (interval - sec).count();
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    sigaction(SIGPROF, &oldAction_, nullptr);
+    throw std::runtime_error{"setitimer() failed"};
+  }
+
+  pending_.store(0, std::memory_order_relaxed);
+  active_ = 1;
+}
+
+SampleTimer::~SampleTimer() {
+  itimerval timer{};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  sigaction(SIGPROF, &oldAction_, nullptr);
+  active_ = 0;
+}
+
+} // namespace leech
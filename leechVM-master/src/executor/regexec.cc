@@ -0,0 +1,150 @@
+#include "executor/executor.hh"
+
+namespace leech {
+namespace {
+using reg::OperandKind;
+using reg::RegOpcode;
+
+/* Operand access relative to the current frame */
+class RegFrame final {
+  State &state_;
+  const reg::RegCode &code_;
+  std::size_t base_ = 0;
+
+public:
+  RegFrame(State &state, const reg::RegCode &code)
+      : state_(state), code_(code) {
+    reload();
+  }
+
+  /* Frame may change after stack instruction */
+  void reload() { base_ = state_.getCurFrame().getBase(); }
+
+  Value read(const reg::Operand &opnd) {
+    switch (opnd.kind) {
+    case OperandKind::Local: {
+      const auto &val = state_.valueStack[base_ + opnd.idx];
+      if (!val.isBound())
+        throw std::invalid_argument(
+            "Trying to push unbound value into stackframe");
+      return val;
+    }
+    case OperandKind::Const:
+      return code_.consts[opnd.idx];
+    case OperandKind::Stack:
+      return state_.getCurFrame().popTos();
+    case OperandKind::Top:
+      return state_.getCurFrame().top();
+    default:
+      throw std::logic_error{"Reading register instruction w/o operand"};
+    }
+  }
+
+  void write(const reg::Operand &opnd, const Value &val) {
+    if (opnd.kind == OperandKind::Local)
+      state_.valueStack[base_ + opnd.idx] = val;
+    else
+      state_.getCurFrame().push(val);
+  }
+};
+
+bool isTrue(const Value &val) {
+  return !val.compare(Value(Integer{0}), CmpOp::EQ);
+}
+} // namespace
+
+void executeRegisters(State &state, const reg::RegCode &code) {
+  std::size_t rpc = code.getEntry(state.pc);
+  RegFrame frame{state, code};
+
+  for (;;) {
+    const auto &inst = code.code[rpc++];
+    switch (inst.opcode) {
+    case RegOpcode::Push:
+    case RegOpcode::Move:
+      frame.write(inst.dst, frame.read(inst.a));
+      break;
+    case RegOpcode::Pop:
+      state.getCurFrame().pop();
+      break;
+    /* Operands are read as stack code pops them: rhs goes first */
+    case RegOpcode::Add: {
+      auto rhs = frame.read(inst.b);
+      auto lhs = frame.read(inst.a);
+      frame.write(inst.dst, rhs.add(lhs));
+      break;
+    }
+    case RegOpcode::Sub: {
+      auto rhs = frame.read(inst.b);
+      auto lhs = frame.read(inst.a);
+      frame.write(inst.dst, lhs.sub(rhs));
+      break;
+    }
+    case RegOpcode::Div: {
+      auto rhs = frame.read(inst.b);
+      auto lhs = frame.read(inst.a);
+      frame.write(inst.dst, lhs.div(rhs));
+      break;
+    }
+    case RegOpcode::Subscr: {
+      auto rhs = frame.read(inst.b);
+      auto lhs = frame.read(inst.a);
+      if (rhs.getType() != ValueType::Slice) {
+        frame.write(inst.dst, lhs.subscript(rhs));
+        break;
+      }
+      /* View is allocated w/ operands on data stack as GC roots */
+      auto &curFrame = state.getCurFrame();
+      curFrame.push(lhs);
+      curFrame.push(rhs);
+      subscriptSlice(state);
+      if (inst.dst.kind == OperandKind::Local)
+        frame.write(inst.dst, curFrame.popTos());
+      break;
+    }
+    case RegOpcode::Compare: {
+      auto rhs = frame.read(inst.b);
+      auto lhs = frame.read(inst.a);
+      auto res = lhs.compare(rhs, static_cast<CmpOp>(inst.arg));
+      frame.write(inst.dst, Value(static_cast<Integer>(res)));
+      break;
+    }
+    case RegOpcode::Print:
+      frame.read(inst.a).print();
+      std::cout << std::endl;
+      break;
+    case RegOpcode::JumpIfFalse:
+      if (!isTrue(frame.read(inst.a)))
+        rpc = inst.target;
+      break;
+    case RegOpcode::JumpIfTrue:
+      if (isTrue(frame.read(inst.a)))
+        rpc = inst.target;
+      break;
+    case RegOpcode::JumpIfNotCmp:
+    case RegOpcode::JumpIfCmp: {
+      auto rhs = frame.read(inst.b);
+      auto lhs = frame.read(inst.a);
+      if (lhs.compare(rhs, static_cast<CmpOp>(inst.arg)) ==
+          (inst.opcode == RegOpcode::JumpIfCmp))
+        rpc = inst.target;
+      break;
+    }
+    case RegOpcode::Stack:
+      state.pc = inst.pc;
+      state.nextPC.reset();
+      inst.inst.execute(state);
+      if (state.funcStack.empty())
+        return;
+      if (state.nextPC.has_value())
+        rpc = code.getEntry(*state.nextPC);
+      frame.reload();
+      break;
+    case RegOpcode::End:
+    default:
+      throw std::out_of_range{"PC is out of code bounds"};
+    }
+  }
+}
+
+} // namespace leech
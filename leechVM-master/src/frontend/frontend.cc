@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <limits>
+
 #include "frontend/frontend.hh"
 
 namespace yy {
@@ -5,9 +8,18 @@ namespace yy {
 Driver::Driver(std::istream &in, std::ostream &out)
     : lexer_{std::make_unique<Lexer>(in, out)} {}
 
+Driver::Driver(std::span<const char> src, std::ostream &out)
+    : srcBuf_{src}, lexer_{std::make_unique<Lexer>(src_, out)} {
+  code_.reserve(src.size() / kSrcBytesPerInst);
+}
+
 bool Driver::parse() {
   parser parser(this);
   bool res = parser.parse();
+  if (!res) {
+    leechFile_->setCode(std::move(code_));
+    leechFile_->meta.resolveSlots();
+  }
   return !res;
 }
 
@@ -15,16 +27,83 @@ parser::token_type Driver::yylex(parser::semantic_type *yylval,
                                  parser::location_type *yylloc) {
   parser::token_type token = static_cast<parser::token_type>(lexer_->yylex());
   if (token == yy::parser::token_type::IDENTIFIER) {
-    std::string name(lexer_->YYText());
-    parser::semantic_type tmp;
-    tmp.as<std::string>() = name;
-    yylval->swap<std::string>(tmp);
+    auto len = static_cast<std::size_t>(lexer_->YYLeng());
+    yylval->emplace<std::string_view>(intern({lexer_->YYText(), len}));
   } else if (token == yy::parser::token_type::INTEGER) {
-    yylval->as<int>() = std::atoi(lexer_->YYText());
+    yylval->emplace<int>(std::atoi(lexer_->YYText()));
   }
 
   *yylloc = lexer_->getCurLocation();
   return token;
 }
 
+std::string_view Driver::intern(std::string_view ident) {
+  auto found = idents_.find(ident);
+  if (found != idents_.end())
+    return *found;
+
+  auto *chars = static_cast<char *>(arena_.allocate(ident.size(), 1));
+  std::copy(ident.begin(), ident.end(), chars);
+  return *idents_.emplace(chars, ident.size()).first;
+}
+
+std::string_view Driver::addString(std::string_view ident) {
+  auto [it, isNew] = fileStrings_.try_emplace(ident);
+  if (isNew)
+    it->second = leechFile_->addString(std::string(ident));
+  return it->second;
+}
+
+std::optional<leech::Opcodes> Driver::getOpcode(std::string_view ident) {
+  auto [it, isNew] = opcodes_.try_emplace(ident);
+  if (isNew)
+    it->second = leech::OpcodeConv::fromName(ident);
+  return it->second;
+}
+
+void Driver::startFunc(std::string_view name, int argNum) {
+  curFunc_ = &leechFile_->meta.funcs[std::string(name)];
+  curFunc_->addr = code_.size();
+  curFunc_->argNum = static_cast<std::size_t>(argNum);
+  labels_.clear();
+  forwardBranches_.clear();
+}
+
+std::optional<std::string_view> Driver::finishFunc() const {
+  if (forwardBranches_.empty())
+    return std::nullopt;
+  return forwardBranches_.begin()->first;
+}
+
+bool Driver::addLabel(std::string_view name) {
+  /* Jump args are absolute addresses in file code */
+  auto addr = code_.size();
+  auto [begin, end] = forwardBranches_.equal_range(name);
+  if (begin != end && addr > std::numeric_limits<leech::ArgType>::max())
+    return false;
+  for (auto it = begin; it != end; ++it)
+    code_[it->second].setArg(static_cast<leech::ArgType>(addr));
+  forwardBranches_.erase(name);
+  labels_[name] = addr;
+  return true;
+}
+
+bool Driver::emit(leech::Opcodes opcode, int arg) {
+  if (arg < 0 || arg > std::numeric_limits<leech::ArgType>::max())
+    return false;
+  code_.emplace_back(opcode, static_cast<leech::ArgType>(arg));
+  return true;
+}
+
+bool Driver::emitJump(leech::Opcodes opcode, std::string_view label) {
+  auto found = labels_.find(label);
+  if (found == labels_.end()) {
+    forwardBranches_.emplace(label, code_.size());
+    return emit(opcode);
+  }
+  if (found->second > std::numeric_limits<leech::ArgType>::max())
+    return false;
+  return emit(opcode, static_cast<int>(found->second));
+}
+
 } // namespace yy
@@ -27,7 +27,7 @@ namespace yy
   { parser::token_type yylex(parser::semantic_type* yylval, parser::location_type* yylloc, Driver* driver); }
 }
 
-%token <std::string> IDENTIFIER
+%token <std::string_view> IDENTIFIER
 %token <int> INTEGER
 %token FUNC_DECL              ".func"
        CPOLL_DECL             ".cpool"
@@ -39,11 +39,11 @@ namespace yy
        RRB                    ")"
        COMMA                  ","
 
-%nterm<leech::Instruction>      instruction;
+%nterm<leech::Opcodes>          opcode;
 %nterm<leech::pLeechObj>        leechObj
 %nterm<leech::pLeechObj>        primitiveTy
 %nterm<leech::pLeechObj>        tupple
-%nterm<std::string>             nameEntry
+%nterm<std::string_view>        nameEntry
 
 %%
 
@@ -53,16 +53,14 @@ funcList:           funcList func                             {};
                   | func                                      {};
 
 func:               funcHeader
-                        cpollBlock namesBlock codeBlock       {};
+                        cpollBlock namesBlock codeBlock       {
+                                                                if (auto label = driver->finishFunc()) {
+                                                                  error(@$, "Undefined label " + std::string(*label));
+                                                                  YYERROR;
+                                                                }
+                                                              };
 
-funcHeader:         FUNC_DECL IDENTIFIER INTEGER              {
-                                                                driver->currentFunc_ = $2;
-                                                                driver->leechFile_->meta.funcs[$2].addr = driver->globalInstrCount_;
-                                                                driver->leechFile_->meta.funcs[$2].argNum = $3;
-                                                                driver->instrCount_ = 0;
-                                                                driver->labels_.clear();
-                                                                driver->forwardBranches_.clear();
-                                                              }
+funcHeader:         FUNC_DECL IDENTIFIER INTEGER              { driver->startFunc($2, $3); }
 
 cpollBlock:         CPOLL_DECL constants                      {};
                   | /* empty */                               {};
@@ -71,15 +69,14 @@ constants:          constants leechObjEntry                   {};
                   | leechObjEntry                             {};
 
 leechObjEntry:      INTEGER COLON leechObj                    {
-                                                                auto&& currentFunc = driver->currentFunc_;
-                                                                driver->leechFile_->meta.funcs[currentFunc].cstPool.emplace_back($3);
+                                                                driver->curFunc_->cstPool.emplace_back(driver->leechFile_->internConst($3));
                                                               };
 
 leechObj:           primitiveTy                               { $$ = $1; };
                   | tupple                                    { $$ = $1; };
 
-primitiveTy:        IDENTIFIER                                { $$ = std::make_shared<leech::StringObj>($1); };
-                  | INTEGER                                   { $$ = std::make_shared<leech::NumberObj<std::int64_t>>($1); };
+primitiveTy:        IDENTIFIER                                { $$ = std::make_shared<leech::StringObj>(std::string($1)); };
+                  | INTEGER                                   { $$ = leech::makeInt($1); };
 
 tupple:             LRB tuppleArgs RRB                        {
                                                                 auto&& args = driver->tupleArgs_;
@@ -92,14 +89,8 @@ tuppleArgs:         tuppleArgs COMMA primitiveTy              { driver->tupleArg
 namesBlock:         NAMES_DECL names                          {};
                   | /* empty */                               {};
 
-names:              names nameEntry                           {
-                                                                auto&& currentFunc = driver->currentFunc_;
-                                                                driver->leechFile_->meta.funcs[currentFunc].names.emplace_back($2);
-                                                              };
-                  | nameEntry                                 {
-                                                                auto&& currentFunc = driver->currentFunc_;
-                                                                driver->leechFile_->meta.funcs[currentFunc].names.emplace_back($1);
-                                                              };
+names:              names nameEntry                           { driver->curFunc_->names.emplace_back(driver->addString($2)); };
+                  | nameEntry                                 { driver->curFunc_->names.emplace_back(driver->addString($1)); };
 
 nameEntry:          INTEGER COLON IDENTIFIER                  { $$ = $3; };
 
@@ -110,37 +101,34 @@ code:               code codeEntry                            {};
                   | codeEntry                                 {};
 
 codeEntry:          LABEL IDENTIFIER                          {
-                                                                auto&& it = driver->forwardBranches_.find($2);
-                                                                if (it != driver->forwardBranches_.end()) {
-                                                                  driver->leechFile_->code[it->second].setArg(driver->instrCount_);
+                                                                if (!driver->addLabel($2)) {
+                                                                  error(@2, "Label address is out of range");
+                                                                  YYERROR;
                                                                 }
-                                                                driver->labels_[$2] = driver->instrCount_;
-                                                              };
-                  | instruction                               {
-                                                                driver->leechFile_->code.push_back($1);
-                                                                ++driver->instrCount_;
-                                                                ++driver->globalInstrCount_;
                                                               };
+                  | instruction                               {};
 
-instruction:        IDENTIFIER                                {
-                                                                // TODO: process invalid opcode
-                                                                auto opcode = leech::OpcodeConv::fromName($1).value();
-                                                                $$ = leech::Instruction(opcode);
+opcode:             IDENTIFIER                                {
+                                                                auto opcode = driver->getOpcode($1);
+                                                                if (!opcode.has_value()) {
+                                                                  error(@1, "Unknown opcode " + std::string($1));
+                                                                  YYERROR;
+                                                                }
+                                                                $$ = *opcode;
                                                               };
-                  | IDENTIFIER INTEGER                        {
-                                                                // TODO: process invalid opcode
-                                                                auto opcode = leech::OpcodeConv::fromName($1).value();
-                                                                $$ = leech::Instruction(opcode, $2);
+
+/* Instructions are emitted to code as soon as they are parsed */
+instruction:        opcode                                    { driver->emit($1); };
+                  | opcode INTEGER                            {
+                                                                if (!driver->emit($1, $2)) {
+                                                                  error(@2, "Instruction arg is out of range");
+                                                                  YYERROR;
+                                                                }
                                                               };
-                  | IDENTIFIER COLON IDENTIFIER               {
-                                                                // TODO: process invalid opcode
-                                                                auto opcode = leech::OpcodeConv::fromName($1).value();
-                                                                auto&& it = driver->labels_.find($3);
-                                                                if (it != driver->labels_.end()) {
-                                                                  $$ = leech::Instruction(opcode, it->second);
-                                                                } else {
-                                                                  driver->forwardBranches_[$3] = driver->globalInstrCount_;
-                                                                  $$ = leech::Instruction(opcode);
+                  | opcode COLON IDENTIFIER                   {
+                                                                if (!driver->emitJump($1, $3)) {
+                                                                  error(@3, "Label address is out of range");
+                                                                  YYERROR;
                                                                 }
                                                               };
 %%
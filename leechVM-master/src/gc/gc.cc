@@ -1 +1,208 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
 #include "gc/gc.hh"
+
+namespace leech::gc {
+namespace {
+LeechObj *getObject(ObjHeader *hdr) {
+  return std::launder(reinterpret_cast<LeechObj *>(hdr + 1));
+}
+
+/**
+ * Cheney style copying: moves every reachable object of from regions to
+ * to region and patches visited values with the new location
+ */
+class Evacuator final : public IValueVisitor {
+  std::initializer_list<Region *> from_;
+  Region &to_;
+
+public:
+  Evacuator(std::initializer_list<Region *> from, Region &to)
+      : from_(from), to_(to) {}
+
+  void visit(Value &val) override {
+    if (!val.isBoxed())
+      return;
+
+    auto *obj = val.getObj();
+    if (std::none_of(from_.begin(), from_.end(),
+                     [obj](auto *reg) { return reg->contains(obj); }))
+      return;
+
+    auto *hdr = Heap::getHeader(obj);
+    if (hdr->forward == nullptr) {
+      auto *mem = to_.allocate(hdr->size);
+      /* Some roots already point to copies by now, heap can't be restored */
+      if (mem == nullptr) {
+        std::cerr << "leech heap: Out of memory during collection"
+                  << std::endl;
+        std::abort();
+      }
+
+      auto *newHdr = new (mem) ObjHeader{nullptr, hdr->size, 0};
+      hdr->forward = obj->moveTo(newHdr + 1);
+    }
+    val.setObj(hdr->forward);
+  }
+};
+} // namespace
+
+void GCStats::print(std::ostream &ost) const {
+  using MilliSec = std::chrono::duration<double, std::milli>;
+  ost << "GC: minor " << minorCollections << ", major " << majorCollections
+      << ", allocated " << allocatedBytes << " B, promoted " << promotedBytes
+      << " B, heap size " << heapSize << " B" << std::endl;
+  ost << "GC pause: total " << MilliSec(totalPause).count() << " ms, max "
+      << MilliSec(maxPause).count() << " ms" << std::endl;
+}
+
+Heap::Heap() {
+  auto *block = static_cast<std::byte *>(mman_.data());
+  auto oldSize = (mman_.size() - kNurserySize) / 2 / kAlign * kAlign;
+
+  nursery_ = Region(block, kNurserySize);
+  old_[0] = Region(block + kNurserySize, oldSize);
+  old_[1] = Region(block + kNurserySize + oldSize, oldSize);
+}
+
+Heap::~Heap() {
+  destroyAll(nursery_);
+  destroyAll(oldSpace());
+}
+
+Value Heap::clone(const Value &src) {
+  if (!src.isBoxed() || src.getObj()->isImmutable())
+    return src;
+
+  auto *mem = allocate(src.getObj()->getAllocSize());
+  try {
+    return Value(src.getObj()->copyTo(mem));
+  } catch (...) {
+    /* Keep heap walkable */
+    new (mem) NoneObj();
+    throw;
+  }
+}
+
+void *Heap::initHeader(void *mem, std::size_t size) {
+  return new (mem) ObjHeader{nullptr, static_cast<std::uint32_t>(size), 0} + 1;
+}
+
+void *Heap::allocate(std::size_t objSize) {
+  auto size = allocSize(objSize);
+  if (size > UINT32_MAX)
+    throw std::length_error{"Too large object for leech heap"};
+
+  stats_.allocatedBytes += size;
+  if (auto *mem = nursery_.allocate(size); mem != nullptr)
+    return initHeader(mem, size);
+
+  if (size <= nursery_.capacity()) {
+    collectMinor();
+    if (auto *mem = nursery_.allocate(size); mem != nullptr)
+      return initHeader(mem, size);
+  }
+
+  /* Large objects are put straight to old space */
+  if (oldSpace().available() < size)
+    collectMajor();
+
+  auto *mem = oldSpace().allocate(size);
+  if (mem == nullptr)
+    throw std::runtime_error{"Out of memory"};
+
+  auto *obj = initHeader(mem, size);
+  /* Object may get references to nursery during construction */
+  remember(static_cast<LeechObj *>(obj));
+  return obj;
+}
+
+void Heap::remember(LeechObj *owner) {
+  auto *hdr = getHeader(owner);
+  if ((hdr->flags & ObjHeader::kRemembered) != 0)
+    return;
+
+  hdr->flags |= ObjHeader::kRemembered;
+  remembered_.push_back(owner);
+}
+
+void Heap::collectMinor() {
+  /* All of nursery may survive */
+  if (oldSpace().available() < nursery_.used()) {
+    collectMajor();
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  auto promotedFrom = oldSpace().used();
+  evacuate({&nursery_}, oldSpace(), true);
+  stats_.promotedBytes += oldSpace().used() - promotedFrom;
+
+  destroyAll(nursery_);
+  nursery_.reset();
+
+  for (auto *obj : remembered_)
+    getHeader(obj)->flags &= ~ObjHeader::kRemembered;
+  remembered_.clear();
+
+  ++stats_.minorCollections;
+  recordPause(std::chrono::steady_clock::now() - start);
+}
+
+void Heap::collectMajor() {
+  auto start = std::chrono::steady_clock::now();
+
+  auto &from = oldSpace();
+  auto &to = old_[1 - curOld_];
+  to.reset();
+  evacuate({&nursery_, &from}, to, false);
+
+  destroyAll(nursery_);
+  destroyAll(from);
+  nursery_.reset();
+  from.reset();
+  curOld_ = 1 - curOld_;
+  remembered_.clear();
+
+  ++stats_.majorCollections;
+  recordPause(std::chrono::steady_clock::now() - start);
+}
+
+void Heap::recordPause(std::chrono::steady_clock::duration pause) {
+  auto pauseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(pause);
+  stats_.totalPause += pauseNs;
+  stats_.maxPause = std::max(stats_.maxPause, pauseNs);
+}
+
+void Heap::evacuate(std::initializer_list<Region *> from, Region &to,
+                    bool traceRemembered) {
+  Evacuator evac{from, to};
+  auto *scan = to.end();
+
+  if (roots_)
+    roots_(evac);
+  if (traceRemembered)
+    for (auto *obj : remembered_)
+      obj->traceRefs(evac);
+
+  /* Copied objects are the gray ones: trace them until none is left */
+  while (scan != to.end()) {
+    auto *hdr = reinterpret_cast<ObjHeader *>(scan);
+    getObject(hdr)->traceRefs(evac);
+    scan += hdr->size;
+  }
+}
+
+void Heap::destroyAll(const Region &reg) {
+  for (auto *cur = reg.begin(); cur != reg.end();) {
+    auto *hdr = reinterpret_cast<ObjHeader *>(cur);
+    cur += hdr->size;
+    /* Moved-out objects are destroyed as well */
+    getObject(hdr)->~LeechObj();
+  }
+}
+
+} // namespace leech::gc
@@ -1,10 +1,64 @@
+#include <iomanip>
+#include <unistd.h>
+
 #include "leechVM/leechVM.hh"
 
 namespace leech {
+namespace {
+/* FNV-1a of source and of binary format it is cached in */
+std::uint64_t hashSource(std::span<const char> src) {
+  constexpr std::uint64_t kPrime = 0x100000001b3;
+  std::uint64_t hash = 0xcbf29ce484222325;
+  auto mix = [&hash](std::uint64_t byte) { hash = (hash ^ byte) * kPrime; };
+  mix(image::kVersion);
+  mix(sizeof(Instruction));
+  for (auto sym : src)
+    mix(static_cast<unsigned char>(sym));
+  return hash;
+}
+
+std::filesystem::path getCachePath(const std::filesystem::path &cacheDir,
+                                   std::span<const char> src) {
+  std::ostringstream name;
+  name << std::hex << std::setfill('0') << std::setw(16) << hashSource(src)
+       << '-' << std::dec << src.size() << ".bin";
+  return cacheDir / name.str();
+}
+
+/* Cache is best effort: file which can't be written is just not cached */
+void storeCache(const LeechFile &file, const std::filesystem::path &path) {
+  std::error_code err{};
+  std::filesystem::create_directories(path.parent_path(), err);
+  if (err)
+    return;
+
+  /* Loads running at the same time see either no file or a complete one */
+  auto tmp = path;
+  tmp += ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    file.serialize(out);
+    if (!out.flush()) {
+      std::filesystem::remove(tmp, err);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp, path, err);
+  if (err)
+    std::filesystem::remove(tmp, err);
+}
+} // namespace
 
-void LeechVM::run() {
-  Executor exec(leechFile_.get());
+void LeechVM::run(const ExecOptions &opts) {
+  auto runOpts = opts;
+  if (runOpts.aot == nullptr)
+    runOpts.aot = native_.get();
+  Executor exec(leechFile_.get(), runOpts);
   exec.execute();
+  gcStats_ = exec.getHeap().getStats();
+  ngramProfile_ = exec.getNgramProfile();
+  profile_ = exec.getProfile();
+  jitStats_ = exec.getJitStats();
 }
 
 void LeechVM::generateLeechFile(std::istream &in, bool isFromBinary) {
@@ -18,6 +72,52 @@ void LeechVM::generateLeechFile(std::istream &in, bool isFromBinary) {
     }
     leechFile_ = driver.getLeechFile();
   }
+  verify(*leechFile_);
+}
+
+void LeechVM::mapLeechFile(const std::filesystem::path &path) {
+  leechFile_ = std::make_shared<LeechFile>(LeechFile::mapFile(path));
+  verify(*leechFile_);
+}
+
+void LeechVM::loadSource(const std::filesystem::path &path,
+                         const std::filesystem::path &cacheDir) {
+  auto src = MappedFile::map(path);
+  std::filesystem::path cached{};
+  if (!cacheDir.empty()) {
+    cached = getCachePath(cacheDir, src.chars());
+    if (std::filesystem::exists(cached)) {
+      try {
+        mapLeechFile(cached);
+        return;
+      } catch (const std::runtime_error &) {
+        /* Corrupted cache is replaced w/ the file parsed again */
+      }
+    }
+  }
+
+  std::stringstream out;
+  yy::Driver driver{src.chars(), out};
+  if (!driver.parse())
+    throw std::runtime_error(out.str());
+  leechFile_ = driver.getLeechFile();
+  verify(*leechFile_);
+
+  if (!cached.empty())
+    storeCache(*leechFile_, cached);
+}
+
+std::size_t LeechVM::fuseSuperinstructions() {
+  return leech::fuseSuperinstructions(*leechFile_);
+}
+
+void LeechVM::buildNative(const std::filesystem::path &out,
+                          const aot::BuildOptions &opts) {
+  aot::build(*leechFile_, out, opts);
+}
+
+void LeechVM::loadNative(const std::filesystem::path &path) {
+  native_ = std::make_unique<aot::Module>(path, *leechFile_);
 }
 
 void LeechVM::dumpBinary(std::ostream &out) { leechFile_->serialize(out); }
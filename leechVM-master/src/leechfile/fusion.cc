@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <vector>
+
+#include "leechfile/fusion.hh"
+
+namespace leech {
+namespace {
+bool matches(std::span<const Instruction> code, std::size_t pos,
+             std::span<const Opcodes> seq) {
+  if (code.size() - pos < seq.size())
+    return false;
+  return std::equal(seq.begin(), seq.end(), code.subspan(pos).begin(),
+                    [](Opcodes opc, const Instruction &inst) {
+                      return opc == inst.getOpcode();
+                    });
+}
+} // namespace
+
+void defuseSuperinstructions(LeechFile &file) {
+  auto isOrig = [](const auto &inst) {
+    return getOrigOpcode(inst.getOpcode()) == inst.getOpcode();
+  };
+  if (std::all_of(file.code.begin(), file.code.end(), isOrig))
+    return;
+
+  for (auto &inst : file.makeCodeMutable())
+    if (!isOrig(inst))
+      inst = Instruction{getOrigOpcode(inst.getOpcode()), inst.getArg()};
+}
+
+std::size_t fuseSuperinstructions(LeechFile &file,
+                                  std::span<const Opcodes> enabled) {
+  defuseSuperinstructions(file);
+  const auto &code = file.code;
+  auto size = code.size();
+
+  /* Fused sequence may not contain function start but the first inst */
+  std::vector<bool> isFuncStart(size + 1, false);
+  for (const auto &[name, fm] : file.meta.funcs)
+    if (fm.addr < size)
+      isFuncStart[fm.addr] = true;
+
+  /* nextFuncStart[i] is the first function start after i */
+  std::vector<std::size_t> nextFuncStart(size + 1, size);
+  for (std::size_t i = size; i-- > 0;)
+    nextFuncStart[i] = isFuncStart[i + 1] ? i + 1 : nextFuncStart[i + 1];
+
+  /* dispatches[i] is the least number of dispatches to run code[i:] through,
+   * choice[i] is superinstruction starting cover of code[i:] */
+  std::vector<std::size_t> dispatches(size + 1, 0);
+  std::vector<Opcodes> choice(size, Opcodes::UNKNOWN);
+  for (std::size_t i = size; i-- > 0;) {
+    dispatches[i] = dispatches[i + 1] + 1;
+    for (auto opc : enabled) {
+      auto seq = getFusedSequence(opc);
+      if (seq.empty() || i + seq.size() > nextFuncStart[i] ||
+          !matches(code, i, seq))
+        continue;
+
+      /* Prefer longer sequence on tie */
+      auto cost = dispatches[i + seq.size()] + 1;
+      if (cost < dispatches[i] ||
+          (cost == dispatches[i] && choice[i] != Opcodes::UNKNOWN &&
+           seq.size() > getInstLength(choice[i]))) {
+        dispatches[i] = cost;
+        choice[i] = opc;
+      }
+    }
+  }
+
+  std::vector<std::pair<std::size_t, Opcodes>> toFuse{};
+  for (std::size_t i = 0; i < size; i += getInstLength(choice[i]))
+    if (choice[i] != Opcodes::UNKNOWN)
+      toFuse.emplace_back(i, choice[i]);
+
+  if (toFuse.empty())
+    return 0;
+
+  auto mutCode = file.makeCodeMutable();
+  for (auto [pos, opc] : toFuse)
+    mutCode[pos] = Instruction{opc, mutCode[pos].getArg()};
+
+  return toFuse.size();
+}
+
+} // namespace leech
@@ -1,74 +1,144 @@
 #include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
 
 #include "leechfile/leechfile.hh"
 
 namespace leech {
+namespace {
+constexpr std::uint64_t alignUp(std::uint64_t val) {
+  return (val + image::kAlign - 1) / image::kAlign * image::kAlign;
+}
+
+/* Read-only istream over memory */
+class SpanBuf final : public std::streambuf {
+public:
+  explicit SpanBuf(std::span<const std::byte> data) {
+    auto *begin =
+        const_cast<char *>(reinterpret_cast<const char *>(data.data()));
+    setg(begin, begin, begin + data.size());
+  }
+};
+
+/* Bounds and alignment checked access to loaded image */
+class ImageView final {
+  const std::byte *base_ = nullptr;
+  std::size_t size_{};
+
+public:
+  ImageView(const std::byte *base, std::size_t size)
+      : base_(base), size_(size) {}
+
+  template <class T>
+  [[nodiscard]] std::span<const T> get(std::uint64_t offset,
+                                       std::uint64_t num) const {
+    if (offset % alignof(T) != 0)
+      throw std::runtime_error{"Misaligned section in leech file"};
+    if (offset > size_ || num > (size_ - offset) / sizeof(T))
+      throw std::runtime_error{"Leech file is truncated"};
+    return {reinterpret_cast<const T *>(base_ + offset), num};
+  }
+
+  [[nodiscard]] std::string_view getString(const image::Ref &ref) const {
+    auto chars = get<char>(ref.offset, ref.size);
+    return {chars.data(), chars.size()};
+  }
+};
+} // namespace
+
+/**
+ * ConstTable definitions
+ */
+
+pLeechObj ConstTable::intern(const pLeechObj &obj) {
+  if (obj == nullptr || !obj->isImmutable())
+    return obj;
+
+  std::ostringstream key{};
+  obj->serialize(key);
+  return consts_.try_emplace(std::move(key).str(), obj).first->second;
+}
+
+pLeechObj ConstTable::intern(std::span<const std::byte> raw) {
+  std::string key(reinterpret_cast<const char *>(raw.data()), raw.size());
+  if (auto It = consts_.find(key); It != consts_.end())
+    return It->second;
+
+  SpanBuf buf{raw};
+  std::istream ist{&buf};
+  auto obj = deserializeObj(ist);
+  if (obj == nullptr)
+    return obj;
+  return consts_.emplace(std::move(key), std::move(obj)).first->second;
+}
 
 /**
  * FuncMeta definitions
  */
 
-FuncMeta::FuncMeta(const FuncMeta &fm) : addr(fm.addr), names(fm.names) {
+namespace {
+/* Immutable constants are shared by copies */
+pLeechObj copyConst(const pLeechObj &cst) {
+  return cst == nullptr || cst->isImmutable() ? cst : cst->clone();
+}
+} // namespace
+
+FuncMeta::FuncMeta(const FuncMeta &fm)
+    : addr(fm.addr), argNum(fm.argNum), cstRaw(fm.cstRaw),
+      constTable(fm.constTable), names(fm.names), slots(fm.slots),
+      slotsNum(fm.slotsNum), maxStack(fm.maxStack) {
   std::transform(fm.cstPool.begin(), fm.cstPool.end(),
-                 std::back_inserter(cstPool),
-                 [](const auto &cst) { return cst->clone(); });
+                 std::back_inserter(cstPool), copyConst);
 }
 
 FuncMeta &FuncMeta::operator=(const FuncMeta &fm) {
   addr = fm.addr;
+  argNum = fm.argNum;
+  cstRaw = fm.cstRaw;
+  constTable = fm.constTable;
   names = fm.names;
+  slots = fm.slots;
+  slotsNum = fm.slotsNum;
+  maxStack = fm.maxStack;
+  cstPool.clear();
   std::transform(fm.cstPool.begin(), fm.cstPool.end(),
-                 std::back_inserter(cstPool),
-                 [](const auto &cst) { return cst->clone(); });
+                 std::back_inserter(cstPool), copyConst);
   return *this;
 }
 
-void FuncMeta::serialize(std::ostream &ost) const {
-  /* Write function address */
-  serializeNum<FuncAddr>(ost, addr);
-
-  /* Write function argument num */
-  serializeNum<uint64_t>(ost, argNum);
-
-  /* Write constant pool */
-  auto cstNum = cstPool.size();
-  serializeNum<std::uint64_t>(ost, cstNum);
-  for (const auto &cst : cstPool)
-    cst->serialize(ost);
-
-  /* Write names */
-  auto nameNum = names.size();
-  serializeNum<std::uint64_t>(ost, nameNum);
-  for (const auto &name : names)
-    serializeString(ost, name);
+void FuncMeta::resolveSlots() {
+  std::unordered_map<std::string_view, std::size_t> nameToSlot{};
+  slots.clear();
+  slots.reserve(names.size());
+  for (const auto &name : names) {
+    auto [it, _] = nameToSlot.emplace(name, nameToSlot.size());
+    slots.push_back(it->second);
+  }
+  slotsNum = nameToSlot.size();
 }
 
-std::pair<std::string, FuncMeta> FuncMeta::deserialize(std::istream &ist) {
-  auto nameLen = deserializeNum<uint64_t>(ist);
-  auto name = deserializeString(ist, nameLen);
+void FuncMeta::loadConst(std::size_t idx) const {
+  if (idx >= cstRaw.size())
+    return;
 
-  auto addr = deserializeNum<FuncAddr>(ist);
-  auto argNum = deserializeNum<uint64_t>(ist);
-
-  auto cstNum = deserializeNum<uint64_t>(ist);
-  std::vector<pLeechObj> cstPool{};
-  for (uint64_t i = 0; i < cstNum; ++i)
-    cstPool.push_back(deserializeObj(ist));
-
-  auto nameNum = deserializeNum<uint64_t>(ist);
-  std::vector<std::string> names{};
-  for (uint64_t i = 0; i < nameNum; ++i) {
-    auto len = deserializeNum<uint64_t>(ist);
-    names.push_back(deserializeString(ist, len));
+  if (constTable != nullptr) {
+    cstPool[idx] = constTable->intern(cstRaw[idx]);
+    return;
   }
+  SpanBuf buf{cstRaw[idx]};
+  std::istream ist{&buf};
+  cstPool[idx] = deserializeObj(ist);
+}
 
-  FuncMeta fm{};
-  fm.addr = addr;
-  fm.argNum = argNum;
-  fm.cstPool = std::move(cstPool);
-  fm.names = std::move(names);
-
-  return {name, std::move(fm)};
+void FuncMeta::loadConsts() const {
+  for (std::size_t i = 0; i < cstPool.size(); ++i)
+    static_cast<void>(getConst(i));
 }
 
 /**
@@ -76,68 +146,226 @@ std::pair<std::string, FuncMeta> FuncMeta::deserialize(std::istream &ist) {
  */
 
 Meta::Meta(std::unordered_map<std::string, FuncMeta> &&funcs_)
-    : funcs(funcs_) {}
+    : funcs(std::move(funcs_)) {}
 
 Meta::Meta(const std::unordered_map<std::string, FuncMeta> &funcs_)
     : funcs(funcs_) {}
 
-void Meta::serialize(std::ostream &ost) const {
-  /* Write function number */
-  auto funcNum = funcs.size();
-  serializeNum<std::uint64_t>(ost, funcNum);
+void Meta::resolveSlots() {
+  for (auto &&[name, fm] : funcs)
+    fm.resolveSlots();
+}
 
-  /* Write functions meta */
-  for (auto &&[name, fm] : funcs) {
-    serializeString(ost, name);
-    fm.serialize(ost);
+/**
+ * LeechFile definitions
+ */
+
+LeechFile::LeechFile(Meta &&meta_, std::vector<Instruction> &&code_)
+    : meta(std::move(meta_)) {
+  setCode(std::move(code_));
+  for (auto &&[name, fm] : meta.funcs) {
+    fm.constTable = constTable_.get();
+    for (auto &cst : fm.cstPool)
+      cst = internConst(cst);
   }
 }
 
-Meta Meta::deserialize(std::istream &ist) {
-  auto fnum = deserializeNum<uint64_t>(ist);
-  std::unordered_map<std::string, FuncMeta> funcs{};
-  for (uint64_t i = 0; i < fnum; ++i) {
-    auto &&[name, meta] = FuncMeta::deserialize(ist);
-    funcs[name] = meta;
-  }
+void LeechFile::setCode(std::vector<Instruction> &&code_) {
+  ownCode_ = std::move(code_);
+  code = ownCode_;
+}
 
-  return {funcs};
+std::span<Instruction> LeechFile::makeCodeMutable() {
+  if (code.data() != ownCode_.data())
+    setCode({code.begin(), code.end()});
+  return ownCode_;
 }
 
-/**
- * LeechFile definitions
- */
+std::string_view LeechFile::addString(std::string str) {
+  return ownStrings_.emplace_back(std::move(str));
+}
 
-LeechFile::LeechFile(Meta &&meta_, std::vector<Instruction> &&code_)
-    : meta(meta_), code(code_) {}
+void LeechFile::loadConsts() const {
+  for (const auto &[_, fm] : meta.funcs)
+    fm.loadConsts();
+}
 
 void LeechFile::serialize(std::ostream &ost) const {
-  /* Write magic */
-  auto magic = reinterpret_cast<const std::uint64_t *>(theLEECH.data());
-  serializeNum<uint64_t>(ost, *magic);
-
-  /* Write meta */
-  meta.serialize(ost);
+  /* Functions are written in code order for reproducible output */
+  std::vector<std::pair<std::string_view, const FuncMeta *>> funcs{};
+  for (const auto &[name, fm] : meta.funcs)
+    funcs.emplace_back(name, &fm);
+  std::sort(funcs.begin(), funcs.end(), [](const auto &lhs, const auto &rhs) {
+    return std::tie(lhs.second->addr, lhs.first) <
+           std::tie(rhs.second->addr, rhs.first);
+  });
+
+  image::Header header{};
+  std::copy(theLEECH.begin(), theLEECH.end(), header.magic);
+  header.version = image::kVersion;
+  header.instSize = sizeof(Instruction);
+  header.funcNum = funcs.size();
+  header.funcsOffset = alignUp(sizeof(header));
+  header.codeNum = code.size();
+  header.codeOffset =
+      header.funcsOffset + funcs.size() * sizeof(image::FuncEntry);
+
+  /* Ref tables follow code, data follows them */
+  auto refsOffset = alignUp(header.codeOffset + code.size_bytes());
+  auto dataOffset = refsOffset;
+  for (const auto &[name, fm] : funcs)
+    dataOffset += (fm->cstPool.size() + fm->names.size()) * sizeof(image::Ref);
+
+  std::string data{};
+  auto addData = [&data, dataOffset](std::string_view bytes) {
+    image::Ref ref{dataOffset + data.size(), bytes.size()};
+    data.append(bytes);
+    data.resize(alignUp(data.size()));
+    return ref;
+  };
+
+  std::vector<image::FuncEntry> entries{};
+  std::vector<image::Ref> refs{};
+  for (const auto &[name, fm] : funcs) {
+    auto &entry = entries.emplace_back();
+    entry.name = addData(name);
+    entry.addr = fm->addr;
+    entry.argNum = fm->argNum;
+
+    entry.cstNum = fm->cstPool.size();
+    entry.cstOffset = refsOffset + refs.size() * sizeof(image::Ref);
+    for (std::size_t i = 0; i < fm->cstPool.size(); ++i) {
+      std::ostringstream cst{};
+      fm->getConst(i)->serialize(cst);
+      refs.push_back(addData(cst.str()));
+    }
 
-  /* Write code */
-  serializeNum<uint64_t>(ost, code.size());
-  for (const auto &inst : code)
-    inst.serialize(ost);
+    entry.nameNum = fm->names.size();
+    entry.namesOffset = refsOffset + refs.size() * sizeof(image::Ref);
+    for (const auto &fname : fm->names)
+      refs.push_back(addData(fname));
+  }
+  header.fileSize = dataOffset + data.size();
+
+  auto write = [&ost](const auto *ptr, std::size_t size) {
+    ost.write(reinterpret_cast<const char *>(ptr),
+              static_cast<std::streamsize>(size));
+  };
+  auto pad = [&ost](std::uint64_t from, std::uint64_t upto) {
+    for (; from < upto; ++from)
+      ost.put('\0');
+  };
+
+  write(&header, sizeof(header));
+  pad(sizeof(header), header.funcsOffset);
+  write(entries.data(), entries.size() * sizeof(image::FuncEntry));
+  /* Superinstructions and quickened opcodes are internal:
+   * write the original ones */
+  for (auto inst : code) {
+    inst = Instruction{getOrigOpcode(inst.getOpcode()), inst.getArg()};
+    write(&inst, sizeof(inst));
+  }
+  pad(header.codeOffset + code.size_bytes(), refsOffset);
+  write(refs.data(), refs.size() * sizeof(image::Ref));
+  write(data.data(), data.size());
 }
 
 LeechFile LeechFile::deserialize(std::istream &ist) {
-  auto magic = deserializeString(ist, theLEECH.size());
-  if (magic != theLEECH)
-    throw std::runtime_error{"Wrong magic number value"};
+  std::string bytes{std::istreambuf_iterator<char>(ist), {}};
+
+  /* Copy to 8-byte aligned storage */
+  auto buf = std::make_shared<std::vector<std::uint64_t>>(
+      alignUp(bytes.size()) / sizeof(std::uint64_t));
+  std::memcpy(buf->data(), bytes.data(), bytes.size());
+  std::shared_ptr<const std::byte> storage{
+      buf, reinterpret_cast<const std::byte *>(buf->data())};
+
+  return load(std::move(storage), bytes.size());
+}
+
+MappedFile MappedFile::map(const std::filesystem::path &path) {
+  auto fail = [&path](std::string_view what) {
+    return std::runtime_error{std::string(what) + ": " + path.string()};
+  };
+
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw fail("Can't open file");
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size < 0) {
+    close(fd);
+    throw fail("Can't get size of file");
+  }
+
+  auto size = static_cast<std::size_t>(st.st_size);
+  if (size == 0) {
+    close(fd);
+    return {};
+  }
+
+  auto *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+    throw fail("Can't mmap file");
 
-  auto meta = Meta::deserialize(ist);
+  std::shared_ptr<const std::byte> data{
+      static_cast<const std::byte *>(addr), [size](const std::byte *ptr) {
+        munmap(const_cast<std::byte *>(ptr), size);
+      }};
+  return {std::move(data), size};
+}
+
+LeechFile LeechFile::mapFile(const std::filesystem::path &path) {
+  auto mapped = MappedFile::map(path);
+  if (mapped.size == 0)
+    throw std::runtime_error{"Leech file is empty: " + path.string()};
+  return load(std::move(mapped.data), mapped.size);
+}
+
+LeechFile LeechFile::load(std::shared_ptr<const std::byte> storage,
+                          std::size_t size) {
+  ImageView view{storage.get(), size};
+
+  const auto &header = view.get<image::Header>(0, 1).front();
+  if (std::string_view(header.magic, sizeof(header.magic)) != theLEECH)
+    throw std::runtime_error{"Wrong magic number value"};
+  if (header.version != image::kVersion)
+    throw std::runtime_error{"Unsupported leech file version " +
+                             std::to_string(header.version)};
+  if (header.instSize != sizeof(Instruction) || header.fileSize != size)
+    throw std::runtime_error{"Leech file is corrupted"};
+
+  LeechFile file{};
+  for (const auto &entry :
+       view.get<image::FuncEntry>(header.funcsOffset, header.funcNum)) {
+    FuncMeta fm{};
+    fm.addr = entry.addr;
+    fm.argNum = entry.argNum;
+    fm.constTable = file.constTable_.get();
+
+    fm.cstPool.resize(entry.cstNum);
+    for (const auto &ref :
+         view.get<image::Ref>(entry.cstOffset, entry.cstNum))
+      fm.cstRaw.push_back(view.get<std::byte>(ref.offset, ref.size));
+
+    for (const auto &ref :
+         view.get<image::Ref>(entry.namesOffset, entry.nameNum))
+      fm.names.push_back(view.getString(ref));
+    fm.resolveSlots();
+
+    file.meta.funcs.emplace(view.getString(entry.name), std::move(fm));
+  }
 
-  auto instNum = deserializeNum<uint64_t>(ist);
-  std::vector<Instruction> code{};
-  for (uint64_t i = 0; i < instNum; ++i)
-    code.push_back(Instruction::deserialize(ist));
+  file.code = view.get<Instruction>(header.codeOffset, header.codeNum);
+  if (!std::all_of(file.code.begin(), file.code.end(), [](const auto &inst) {
+        return inst.isValid() &&
+               getOrigOpcode(inst.getOpcode()) == inst.getOpcode();
+      }))
+    throw std::runtime_error{"Unknown inst opcode in leech file"};
 
-  return {std::move(meta), std::move(code)};
+  file.storage_ = std::move(storage);
+  return file;
 }
 
 void LeechFile::dump2LeechFormat(std::ostream &ost) {
@@ -148,7 +376,7 @@ void LeechFile::dump2LeechFormat(std::ostream &ost) {
     ost << blockOffset << ".cpool" << std::endl;
     for (std::size_t i = 0; i < fmeta.cstPool.size(); ++i) {
       ost << dataOffset << i << ": ";
-      fmeta.cstPool[i]->print();
+      fmeta.getConst(i)->print();
       ost << std::endl;
     }
     ost << blockOffset << ".names" << std::endl;
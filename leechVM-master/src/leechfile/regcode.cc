@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <optional>
+
+#include "leechfile/regcode.hh"
+
+namespace leech::reg {
+namespace {
+bool isCondJump(Opcodes opcode) {
+  return opcode == Opcodes::POP_JUMP_IF_FALSE ||
+         opcode == Opcodes::POP_JUMP_IF_TRUE;
+}
+
+/* Instructions which may continue at pc of their arg */
+bool isJump(Opcodes opcode) {
+  switch (opcode) {
+  case Opcodes::POP_JUMP_IF_FALSE:
+  case Opcodes::POP_JUMP_IF_TRUE:
+  case Opcodes::JUMP_IF_FALSE_OR_POP:
+  case Opcodes::JUMP_IF_TRUE_OR_POP:
+  case Opcodes::JUMP_FORWARD:
+  case Opcodes::JUMP_ABSOLUTE:
+  case Opcodes::FOR_ITER:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool isCall(Opcodes opcode) {
+  return opcode == Opcodes::CALL_FUNCTION || opcode == Opcodes::CALL_METHOD;
+}
+
+/* Stack code is translated as if it had no superinstructions
+ * and quickened instructions */
+Opcodes getOrigOpcode(const Instruction &inst) {
+  return leech::getOrigOpcode(inst.getOpcode());
+}
+
+/**
+ * Loads are not emitted but kept on the virtual stack of pending operands,
+ * which is the top part of frame's data stack. Instruction consuming them
+ * takes them as operands, the rest are pushed (flushed) before anything
+ * which may observe data stack: calls, jumps, stack instructions
+ */
+class FuncTranslator final {
+  const LeechFile &file_;
+  const FuncMeta &func_;
+  std::uint64_t begin_ = 0;
+  std::uint64_t end_ = 0;
+  RegCode &res_;
+  std::vector<bool> isEntry_{};
+  std::vector<Operand> pending_{};
+  /* Last emitted instruction if the only thing it did to data stack
+   * was pushing its result */
+  std::optional<std::size_t> lastPush_{};
+  /* Jumps w/ stack code destination in RegInst::target */
+  std::vector<std::size_t> jumps_{};
+
+public:
+  FuncTranslator(const LeechFile &file, const FuncMeta &func,
+                 std::uint64_t end, RegCode &res)
+      : file_(file), func_(func), begin_(func.addr), end_(end), res_(res) {
+    if (!func_.isResolved())
+      throw std::logic_error("Translating function w/ unresolved local slots");
+    if (begin_ > end_ || end_ > file_.code.size())
+      throw std::out_of_range{"Function code is out of file code"};
+  }
+
+  void run() {
+    findEntries();
+    if (res_.entries.size() < file_.code.size())
+      res_.entries.resize(file_.code.size(), kNoEntry);
+
+    for (auto pc = begin_; pc < end_; ++pc) {
+      if (isEntry_[pc - begin_]) {
+        flush();
+        /* Jumps here don't push result of the previous instruction */
+        lastPush_.reset();
+        res_.entries[pc] = static_cast<std::uint32_t>(res_.code.size());
+      }
+      pc += translate(pc);
+    }
+    flush();
+
+    for (auto idx : jumps_) {
+      auto &inst = res_.code[idx];
+      if (inst.target < begin_ || inst.target >= end_)
+        throw std::out_of_range{"Jump out of function at pc " +
+                                std::to_string(inst.pc)};
+      inst.target = res_.getEntry(inst.target);
+    }
+  }
+
+private:
+  void findEntries() {
+    isEntry_.assign(end_ - begin_, false);
+    if (begin_ == end_)
+      return;
+
+    isEntry_[0] = true;
+    for (auto pc = begin_; pc < end_; ++pc) {
+      auto opcode = getOrigOpcode(file_.code[pc]);
+      auto arg = file_.code[pc].getArg();
+      if (isJump(opcode) && arg >= begin_ && arg < end_)
+        isEntry_[arg - begin_] = true;
+      /* Return address */
+      if (isCall(opcode) && pc + 1 < end_)
+        isEntry_[pc + 1 - begin_] = true;
+    }
+  }
+
+  /* Returns number of extra stack instructions consumed */
+  std::uint64_t translate(std::uint64_t pc) {
+    const auto &inst = file_.code[pc];
+    auto opcode = getOrigOpcode(inst);
+    auto arg = inst.getArg();
+
+    switch (opcode) {
+    case Opcodes::LOAD_FAST:
+      pending_.push_back(getLocal(arg));
+      lastPush_.reset();
+      return 0;
+    case Opcodes::LOAD_CONST:
+      pending_.push_back(getConst(arg));
+      lastPush_.reset();
+      return 0;
+    case Opcodes::STORE_FAST:
+      store(pc, getLocal(arg));
+      return 0;
+    case Opcodes::POP_TOP:
+      if (!pending_.empty())
+        pending_.pop_back();
+      else
+        emit({RegOpcode::Pop, 0, {}, {}, {}, 0, pc});
+      return 0;
+    case Opcodes::BINARY_ADD:
+      return binary(pc, RegOpcode::Add);
+    case Opcodes::BINARY_SUBTRACT:
+      return binary(pc, RegOpcode::Sub);
+    case Opcodes::BINARY_TRUE_DIVIDE:
+      return binary(pc, RegOpcode::Div);
+    case Opcodes::BINARY_SUBSCR:
+      return binary(pc, RegOpcode::Subscr);
+    case Opcodes::COMPARE_OP:
+      return compare(pc, arg);
+    case Opcodes::POP_JUMP_IF_FALSE:
+    case Opcodes::POP_JUMP_IF_TRUE: {
+      auto cond = take();
+      flush();
+      auto op = opcode == Opcodes::POP_JUMP_IF_FALSE ? RegOpcode::JumpIfFalse
+                                                     : RegOpcode::JumpIfTrue;
+      emitJump({op, 0, {}, cond, {}, arg, pc});
+      return 0;
+    }
+    case Opcodes::PRINT: {
+      /* Nothing is pushed, so the rest of pending operands may stay */
+      auto val = take();
+      emit({RegOpcode::Print, 0, {}, val, {}, 0, pc});
+      return 0;
+    }
+    default:
+      flush();
+      emit({RegOpcode::Stack, 0, {}, {}, {}, 0, pc, Instruction{opcode, arg}});
+      return 0;
+    }
+  }
+
+  Operand getLocal(ArgType nameIdx) const {
+    return {OperandKind::Local,
+            static_cast<std::uint32_t>(func_.slots.at(nameIdx))};
+  }
+
+  Operand getConst(ArgType idx) {
+    auto cst = Value(func_.getConst(idx));
+    res_.consts.push_back(cst);
+    return {OperandKind::Const,
+            static_cast<std::uint32_t>(res_.consts.size() - 1)};
+  }
+
+  /* Operand for the top of data stack, popping it */
+  Operand take() {
+    if (pending_.empty())
+      return {OperandKind::Stack};
+    auto opnd = pending_.back();
+    pending_.pop_back();
+    return opnd;
+  }
+
+  void emit(const RegInst &inst) {
+    lastPush_.reset();
+    res_.code.push_back(inst);
+  }
+
+  void emitPush(const RegInst &inst) {
+    emit(inst);
+    lastPush_ = res_.code.size() - 1;
+  }
+
+  void emitJump(const RegInst &inst) {
+    jumps_.push_back(res_.code.size());
+    emit(inst);
+  }
+
+  /* Push pending operands [0, num) */
+  void flush(std::size_t num) {
+    for (std::size_t i = 0; i < num; ++i)
+      emitPush({RegOpcode::Push, 0, {OperandKind::Stack}, pending_[i]});
+    pending_.erase(pending_.begin(),
+                   pending_.begin() + static_cast<std::ptrdiff_t>(num));
+  }
+
+  void flush() { flush(pending_.size()); }
+
+  std::uint64_t binary(std::uint64_t pc, RegOpcode op, std::uint8_t arg = 0) {
+    auto rhs = take();
+    auto lhs = take();
+    /* Result goes above the rest of data stack */
+    flush();
+    emitPush({op, arg, {OperandKind::Stack}, lhs, rhs, 0, pc});
+    return 0;
+  }
+
+  std::uint64_t compare(std::uint64_t pc, std::uint8_t cmp) {
+    auto next = pc + 1;
+    if (next >= end_ || isEntry_[next - begin_] ||
+        !isCondJump(getOrigOpcode(file_.code[next])))
+      return binary(pc, RegOpcode::Compare, cmp);
+
+    auto rhs = take();
+    auto lhs = take();
+    flush();
+    auto op = getOrigOpcode(file_.code[next]) == Opcodes::POP_JUMP_IF_FALSE
+                  ? RegOpcode::JumpIfNotCmp
+                  : RegOpcode::JumpIfCmp;
+    emitJump({op, cmp, {}, lhs, rhs, file_.code[next].getArg(), pc});
+    return 1;
+  }
+
+  /* Local is set to the top of data stack, which stays there */
+  void store(std::uint64_t pc, Operand local) {
+    if (pending_.empty()) {
+      if (lastPush_.has_value()) {
+        /* Result is put to local directly and pushed when needed */
+        res_.code[*lastPush_].dst = local;
+        lastPush_.reset();
+        pending_.push_back(local);
+      } else
+        emit({RegOpcode::Move, 0, local, {OperandKind::Top}, {}, 0, pc});
+      return;
+    }
+
+    auto top = pending_.back();
+    if (top == local)
+      return;
+    /* Pending loads of local must be done before it is changed */
+    auto It = std::find(pending_.rbegin(), pending_.rend(), local);
+    flush(static_cast<std::size_t>(pending_.rend() - It));
+    emit({RegOpcode::Move, 0, local, top, {}, 0, pc});
+  }
+};
+} // namespace
+
+void translateFunc(const LeechFile &file, const FuncMeta &func,
+                   std::uint64_t end, RegCode &res) {
+  FuncTranslator{file, func, end, res}.run();
+}
+
+RegCode translate(const LeechFile &file) {
+  std::vector<const FuncMeta *> funcs{};
+  for (const auto &[name, func] : file.meta.funcs)
+    funcs.push_back(&func);
+  std::sort(funcs.begin(), funcs.end(),
+            [](auto *lhs, auto *rhs) { return lhs->addr < rhs->addr; });
+
+  RegCode res{};
+  res.entries.assign(file.code.size(), kNoEntry);
+  for (std::size_t i = 0; i < funcs.size(); ++i) {
+    auto end = i + 1 < funcs.size() ? funcs[i + 1]->addr : file.code.size();
+    translateFunc(file, *funcs[i], end, res);
+  }
+  res.code.push_back({RegOpcode::End, 0, {}, {}, {}, 0, file.code.size()});
+  return res;
+}
+
+} // namespace leech::reg
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+#include "leechfile/verifier.hh"
+
+namespace leech {
+namespace {
+struct FuncRange final {
+  std::string_view name{};
+  FuncMeta *meta = nullptr;
+  std::uint64_t begin = 0;
+  std::uint64_t end = 0;
+};
+
+/* Function code ends where the next one starts */
+std::vector<FuncRange> getRanges(LeechFile &file) {
+  std::vector<FuncRange> res{};
+  for (auto &[name, func] : file.meta.funcs)
+    res.push_back({name, &func, func.addr, 0});
+  std::sort(res.begin(), res.end(), [](const auto &lhs, const auto &rhs) {
+    return lhs.begin < rhs.begin;
+  });
+  for (std::size_t i = 0; i < res.size(); ++i)
+    res[i].end = i + 1 < res.size() ? res[i + 1].begin : file.code.size();
+  return res;
+}
+
+class FuncVerifier final {
+  const LeechFile &file_;
+  const FuncRange &func_;
+  const FuncMeta &meta_;
+  /* Names of functions called by CALL_METHOD */
+  const std::unordered_set<std::string_view> &methods_;
+  /* The least depth of data stack before instruction on paths to it, none
+   * if it is not reached */
+  std::vector<std::optional<std::size_t>> depth_{};
+  std::vector<std::uint64_t> work_{};
+  std::size_t max_ = 0;
+  /* Depth is the same on all paths to each instruction */
+  bool balanced_ = true;
+
+public:
+  FuncVerifier(const LeechFile &file, const FuncRange &func,
+               const std::unordered_set<std::string_view> &methods)
+      : file_(file), func_(func), meta_(*func.meta), methods_(methods) {
+    if (func_.begin > func_.end || func_.end > file_.code.size())
+      fail(func_.begin, "Function code is out of file code");
+    depth_.resize(func_.end - func_.begin);
+  }
+
+  /* Returns max depth of data stack, none if it is not bounded */
+  std::optional<std::size_t> run() {
+    if (func_.begin == func_.end)
+      fail(func_.begin, "Function has no code");
+    reach(func_.begin, func_.begin, methods_.contains(func_.name) ? 1 : 0);
+    while (!work_.empty()) {
+      auto pc = work_.back();
+      work_.pop_back();
+      step(pc, *depth_[pc - func_.begin]);
+    }
+    if (!balanced_)
+      return std::nullopt;
+    return max_;
+  }
+
+private:
+  [[noreturn]] void fail(std::uint64_t pc, const std::string &what) const {
+    throw VerifyError{func_.name, pc, what};
+  }
+
+  /* Instruction at pc continues at dest w/ depth */
+  void reach(std::uint64_t pc, std::uint64_t dest, std::size_t depth) {
+    if (dest == func_.end && dest != pc)
+      fail(pc, "Running off function code");
+    if (dest < func_.begin || dest >= func_.end)
+      fail(pc, "Jump out of function code to " + std::to_string(dest));
+
+    /* Instructions only see the least depth, so it is enough to check
+     * underflow. The least one only decreases, so analysis terminates */
+    auto &known = depth_[dest - func_.begin];
+    if (known.has_value() && *known != depth)
+      balanced_ = false;
+    if (!known.has_value() || depth < *known) {
+      known = depth;
+      max_ = std::max(max_, depth);
+      work_.push_back(dest);
+    }
+  }
+
+  void need(std::uint64_t pc, std::size_t depth, std::size_t num) const {
+    if (depth < num)
+      fail(pc, "Data stack underflow");
+  }
+
+  void checkName(std::uint64_t pc, ArgType arg) const {
+    if (arg >= meta_.names.size())
+      fail(pc, "Name index " + std::to_string(unsigned{arg}) +
+                   " is out of range");
+  }
+
+  const FuncMeta &getCallee(std::uint64_t pc, ArgType arg) const {
+    checkName(pc, arg);
+    auto found = file_.meta.funcs.find(std::string(meta_.names[arg]));
+    if (found == file_.meta.funcs.end())
+      fail(pc, "Call of unknown function " + std::string(meta_.names[arg]));
+    return found->second;
+  }
+
+  void step(std::uint64_t pc, std::size_t depth) {
+    auto opcode = getOrigOpcode(file_.code[pc].getOpcode());
+    auto arg = file_.code[pc].getArg();
+    auto next = pc + 1;
+
+    switch (opcode) {
+    case Opcodes::LOAD_CONST:
+      if (arg >= meta_.cstPool.size())
+        fail(pc, "Constant index " + std::to_string(unsigned{arg}) +
+                     " is out of range");
+      reach(pc, next, depth + 1);
+      return;
+    case Opcodes::LOAD_FAST:
+    case Opcodes::INSTANCE_CLASS:
+      checkName(pc, arg);
+      reach(pc, next, depth + 1);
+      return;
+    case Opcodes::LOAD_BUILD_CLASS:
+      reach(pc, next, depth + 1);
+      return;
+    case Opcodes::STORE_FAST:
+    case Opcodes::REGISTER_METHOD:
+      checkName(pc, arg);
+      need(pc, depth, 1);
+      reach(pc, next, depth);
+      return;
+    case Opcodes::STORE_BUILD_CLASS:
+      checkName(pc, arg);
+      need(pc, depth, 1);
+      reach(pc, next, depth - 1);
+      return;
+    case Opcodes::LOAD_ATTR:
+      checkName(pc, arg);
+      need(pc, depth, 1);
+      reach(pc, next, depth + 1);
+      return;
+    case Opcodes::STORE_ATTR:
+      checkName(pc, arg);
+      need(pc, depth, 2);
+      reach(pc, next, depth - 1);
+      return;
+    case Opcodes::POP_TOP:
+    case Opcodes::PRINT:
+      need(pc, depth, 1);
+      reach(pc, next, depth - 1);
+      return;
+    case Opcodes::COMPARE_OP:
+      if (arg > toUnderlying(CmpOp::GREQ))
+        fail(pc, "Unknown comparison " + std::to_string(unsigned{arg}));
+      [[fallthrough]];
+    case Opcodes::BINARY_ADD:
+    case Opcodes::BINARY_SUBTRACT:
+    case Opcodes::BINARY_TRUE_DIVIDE:
+    case Opcodes::BINARY_SUBSCR:
+      need(pc, depth, 2);
+      reach(pc, next, depth - 1);
+      return;
+    case Opcodes::GET_LEN:
+      need(pc, depth, 1);
+      reach(pc, next, depth + 1);
+      return;
+    case Opcodes::GET_ITER:
+      need(pc, depth, 1);
+      reach(pc, next, depth);
+      return;
+    case Opcodes::BUILD_TUPLE:
+      need(pc, depth, arg);
+      reach(pc, next, depth - arg + 1);
+      return;
+    case Opcodes::BUILD_SLICE:
+      if (arg != 2)
+        fail(pc, "Slice step is not supported");
+      need(pc, depth, 2);
+      reach(pc, next, depth - 1);
+      return;
+    case Opcodes::RETURN_VALUE:
+      need(pc, depth, 1);
+      return;
+    case Opcodes::JUMP_FORWARD:
+    case Opcodes::JUMP_ABSOLUTE:
+      reach(pc, arg, depth);
+      return;
+    case Opcodes::POP_JUMP_IF_FALSE:
+    case Opcodes::POP_JUMP_IF_TRUE:
+      need(pc, depth, 1);
+      reach(pc, next, depth - 1);
+      reach(pc, arg, depth - 1);
+      return;
+    case Opcodes::JUMP_IF_FALSE_OR_POP:
+    case Opcodes::JUMP_IF_TRUE_OR_POP:
+      need(pc, depth, 1);
+      reach(pc, next, depth - 1);
+      reach(pc, arg, depth);
+      return;
+    case Opcodes::FOR_ITER:
+      need(pc, depth, 1);
+      reach(pc, next, depth + 1);
+      reach(pc, arg, depth - 1);
+      return;
+    case Opcodes::CALL_FUNCTION:
+      /* Whole data stack is passed, result is pushed to empty one */
+      static_cast<void>(getCallee(pc, arg));
+      if (methods_.contains(meta_.names[arg]))
+        fail(pc, "Method is called as function");
+      reach(pc, next, 1);
+      return;
+    case Opcodes::CALL_METHOD: {
+      /* Args and object under them are replaced w/ result */
+      auto argNum = getCallee(pc, arg).argNum;
+      need(pc, depth, argNum + 1);
+      reach(pc, next, depth - argNum);
+      return;
+    }
+    default:
+      fail(pc, "Unsupported instruction " +
+                   std::string(OpcodeConv::toName(opcode).value_or("?")));
+    }
+  }
+};
+} // namespace
+
+void verify(LeechFile &file) {
+  auto ranges = getRanges(file);
+
+  std::unordered_set<std::string_view> methods{};
+  for (const auto &func : ranges)
+    for (auto pc = func.begin; pc < func.end && pc < file.code.size(); ++pc) {
+      const auto &inst = file.code[pc];
+      if (getOrigOpcode(inst.getOpcode()) == Opcodes::CALL_METHOD &&
+          inst.getArg() < func.meta->names.size())
+        methods.insert(func.meta->names[inst.getArg()]);
+    }
+
+  for (const auto &func : ranges)
+    func.meta->maxStack = FuncVerifier{file, func, methods}.run();
+}
+
+} // namespace leech
@@ -0,0 +1,907 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "test_header.hh"
+
+#include "config.hh"
+#include "executor/aot.hh"
+#include "executor/executor.hh"
+#include "executor/isolate.hh"
+#include "frontend/frontend.hh"
+#include "leechfile/fusion.hh"
+#include "leechfile/verifier.hh"
+
+#define PATH(test) TESTS_DIR test
+
+using namespace leech;
+
+namespace {
+std::shared_ptr<LeechFile> parseLeech(const char *path) {
+  std::ifstream file(path);
+  EXPECT_TRUE(file.is_open());
+  yy::Driver driver(file, std::cout);
+  EXPECT_TRUE(driver.parse());
+  return driver.getLeechFile();
+}
+
+std::shared_ptr<LeechFile> parseLeechSource(const std::string &src) {
+  std::istringstream ist(src);
+  yy::Driver driver(ist, std::cout);
+  EXPECT_TRUE(driver.parse());
+  return driver.getLeechFile();
+}
+
+std::string runLeech(LeechFile *pfile, const ExecOptions &opts) {
+  testing::internal::CaptureStdout();
+  Executor exec(pfile, opts);
+  exec.execute();
+  return testing::internal::GetCapturedStdout();
+}
+
+std::string runLeech(LeechFile *pfile, DispatchMode mode) {
+  return runLeech(pfile, ExecOptions{mode});
+}
+
+ExecOptions jitOptions(DispatchMode mode, std::size_t threshold) {
+  ExecOptions opts{mode};
+  opts.jitThreshold = threshold;
+  return opts;
+}
+
+/* Native module of file built to temp dir */
+std::filesystem::path buildNative(const LeechFile &file,
+                                  const std::string &name) {
+  auto out = std::filesystem::temp_directory_path() /
+             ("leech_aot_" + name + ".so");
+  aot::build(file, out);
+  return out;
+}
+} // namespace
+
+TEST(executor, fibThreaded) {
+  auto pfile = parseLeech(PATH("fib.leech"));
+  auto out = runLeech(pfile.get(), DispatchMode::Threaded);
+  EXPECT_EQ(out, "817770325994397771\n");
+  EXPECT_EQ(out, runLeech(pfile.get(), DispatchMode::Callback));
+}
+
+TEST(executor, averageThreaded) {
+  auto pfile = parseLeech(PATH("average.leech"));
+  auto out = runLeech(pfile.get(), DispatchMode::Threaded);
+  EXPECT_EQ(out, runLeech(pfile.get(), DispatchMode::Callback));
+}
+
+TEST(executor, classWorkingThreaded) {
+  auto pfile = parseLeech(PATH("classWorking.leech"));
+  auto out = runLeech(pfile.get(), DispatchMode::Threaded);
+  EXPECT_EQ(out, runLeech(pfile.get(), DispatchMode::Callback));
+}
+
+TEST(executor, methodsThreaded) {
+  auto pfile = parseLeech(PATH("methods.leech"));
+  auto out = runLeech(pfile.get(), DispatchMode::Threaded);
+  EXPECT_EQ(out, runLeech(pfile.get(), DispatchMode::Callback));
+}
+
+TEST(executor, callDepthLimit) {
+  FuncMeta fm{};
+  fm.names = {"main"};
+  fm.resolveSlots();
+  LeechFile file{Meta{{{"main", fm}}},
+                 {Instruction(Opcodes::CALL_FUNCTION, 0),
+                  Instruction(Opcodes::RETURN_VALUE)}};
+
+  for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback,
+                    DispatchMode::Register}) {
+    Executor exec(&file, ExecOptions{mode, 100});
+    EXPECT_THROW(exec.execute(), CallStackOverflow);
+  }
+}
+
+TEST(executor, attrCacheShapes) {
+  auto pfile = parseLeech(PATH("shapes.leech"));
+  for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback}) {
+    testing::internal::CaptureStdout();
+    Executor exec(pfile.get(), mode);
+    exec.execute();
+    auto out = testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(out, "1\n2\n1\n5\n5\n5\n");
+    /* Objects built the same way share shape: getx and setx see 2 ones */
+    std::size_t maxEntries = 0;
+    for (const auto &cache : exec.getAttrCaches())
+      maxEntries = std::max(maxEntries, cache.size);
+    EXPECT_EQ(maxEntries, 2);
+  }
+}
+
+TEST(AttrCache, Polymorphic) {
+  // Assign
+  AttrCache cache{};
+  const auto *root = Shape::getRoot();
+  const auto *shapeX = root->addField("x");
+  const auto *shapeY = root->addField("y");
+
+  // Act
+  cache.add({shapeX, shapeX, 0});
+  cache.add({shapeY, shapeY->addField("x"), 1});
+
+  // Assert
+  EXPECT_EQ(root->addField("x"), shapeX);
+  EXPECT_EQ(cache.find(shapeX)->slot, 0);
+  EXPECT_EQ(cache.find(shapeY)->next, shapeY->addField("x"));
+  EXPECT_EQ(cache.find(root), nullptr);
+  for (std::size_t i = cache.size; i < AttrCache::kMaxEntries; ++i)
+    EXPECT_NE(cache.add({root->addField(std::to_string(i)), root, 0}),
+              nullptr);
+  EXPECT_EQ(cache.add({root, root, 0}), nullptr);
+}
+
+TEST(executor, superinstructions) {
+  for (const auto *path : {PATH("fib.leech"), PATH("fib_rec.leech"),
+                           PATH("average.leech"), PATH("classWorking.leech"),
+                           PATH("methods.leech"), PATH("shapes.leech")}) {
+    auto pfile = parseLeech(path);
+    auto ref = runLeech(pfile.get(), DispatchMode::Callback);
+
+    fuseSuperinstructions(*pfile);
+    EXPECT_EQ(runLeech(pfile.get(), DispatchMode::Threaded), ref) << path;
+    EXPECT_EQ(runLeech(pfile.get(), DispatchMode::Callback), ref) << path;
+  }
+}
+
+TEST(executor, fibRecFused) {
+  auto pfile = parseLeech(PATH("fib_rec.leech"));
+  EXPECT_EQ(fuseSuperinstructions(*pfile), 3U);
+  EXPECT_EQ(pfile->code[0].getOpcode(),
+            Opcodes::LOAD_FAST__LOAD_CONST__COMPARE_OP__POP_JUMP_IF_FALSE);
+  EXPECT_EQ(runLeech(pfile.get(), DispatchMode::Threaded), "832040\n");
+}
+
+TEST(executor, ngramProfile) {
+  auto pfile = parseLeech(PATH("fib_rec.leech"));
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), ExecOptions{DispatchMode::Threaded,
+                                         kDefaultMaxCallDepth, 4});
+  exec.execute();
+  static_cast<void>(testing::internal::GetCapturedStdout());
+
+  const auto &profile = exec.getNgramProfile();
+  ASSERT_TRUE(profile.has_value());
+  std::map<NgramProfile::Ngram, std::uint64_t> counts{};
+  for (const auto &[ngram, count] : profile->getTop(3, 100))
+    counts[ngram] = count;
+  /* Each call runs compare, each non-leaf one runs 2 subtractions */
+  auto calls = counts[{Opcodes::LOAD_CONST, Opcodes::COMPARE_OP,
+                       Opcodes::POP_JUMP_IF_FALSE}];
+  EXPECT_EQ(profile->getTop(3, 1).front().second, calls);
+  NgramProfile::Ngram sub{Opcodes::LOAD_FAST, Opcodes::LOAD_CONST,
+                          Opcodes::BINARY_SUBTRACT};
+  EXPECT_EQ(counts[sub], calls - 1);
+  /* Taken branch breaks straight-line run */
+  for (const auto &[ngram, count] : profile->getTop(2, 100))
+    EXPECT_NE(ngram, (NgramProfile::Ngram{Opcodes::POP_JUMP_IF_FALSE,
+                                          Opcodes::LOAD_FAST}));
+  EXPECT_TRUE(profile->getTop(4, 100).size() > 0);
+  EXPECT_TRUE(profile->getTop(5, 100).empty());
+}
+
+TEST(executor, jitEquivalence) {
+  for (const auto *path : {PATH("fib.leech"), PATH("fib_rec.leech"),
+                           PATH("average.leech"), PATH("classWorking.leech"),
+                           PATH("methods.leech"), PATH("shapes.leech")})
+    for (bool fuse : {false, true}) {
+      auto pfile = parseLeech(path);
+      if (fuse)
+        fuseSuperinstructions(*pfile);
+      auto ref = runLeech(pfile.get(), jitOptions(DispatchMode::Callback, 0));
+
+      for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback})
+        EXPECT_EQ(runLeech(pfile.get(), jitOptions(mode, 1)), ref) << path;
+    }
+}
+
+TEST(executor, jitFibRec) {
+  auto pfile = parseLeech(PATH("fib_rec.leech"));
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), jitOptions(DispatchMode::Threaded, 1));
+  exec.execute();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "832040\n");
+
+  if (!jit::isSupported())
+    return;
+  auto stats = exec.getJitStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->compiled, 1U);
+  EXPECT_EQ(stats->nativeRuns, 1U);
+  /* The whole recursion runs natively */
+  EXPECT_EQ(stats->deopts, 0U);
+}
+
+TEST(executor, jitCallDepthLimit) {
+  FuncMeta fm{};
+  fm.names = {"main"};
+  fm.resolveSlots();
+  LeechFile file{Meta{{{"main", fm}}},
+                 {Instruction(Opcodes::CALL_FUNCTION, 0),
+                  Instruction(Opcodes::RETURN_VALUE)}};
+
+  for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback}) {
+    auto opts = jitOptions(mode, 1);
+    opts.maxCallDepth = 100;
+    Executor exec(&file, opts);
+    EXPECT_THROW(exec.execute(), CallStackOverflow);
+  }
+}
+
+TEST(executor, profileInstrument) {
+  auto pfile = parseLeech(PATH("fib_rec.leech"));
+  ExecOptions opts{};
+  opts.profile = ProfileMode::Instrument;
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), opts);
+  exec.execute();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "832040\n");
+
+  const auto &profile = exec.getProfile();
+  ASSERT_TRUE(profile.has_value());
+  std::map<std::string, Profile::FuncStats> funcs{};
+  for (const auto &stats : profile->getFuncStats())
+    funcs[stats.name] = stats;
+
+  /* Each call of fib runs one compare, each function returns once */
+  auto calls = profile->getOpcodeStats(Opcodes::COMPARE_OP).count;
+  EXPECT_EQ(funcs["fib"].calls, calls);
+  EXPECT_EQ(funcs["main"].calls, 1U);
+  EXPECT_EQ(profile->getOpcodeStats(Opcodes::RETURN_VALUE).count, calls + 1);
+  EXPECT_GE(funcs["main"].inclCycles, funcs["fib"].inclCycles);
+  EXPECT_GE(funcs["fib"].inclCycles, funcs["fib"].selfCycles);
+
+  std::stringstream folded{};
+  profile->writeFolded(folded);
+  EXPECT_NE(folded.str().find("main;fib;fib "), std::string::npos);
+}
+
+TEST(executor, profileSample) {
+  auto pfile = parseLeech(PATH("fib_rec.leech"));
+  ExecOptions opts{};
+  opts.profile = ProfileMode::Sample;
+  opts.sampleInterval = std::chrono::microseconds(100);
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), opts);
+  exec.execute();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "832040\n");
+
+  const auto &profile = exec.getProfile();
+  ASSERT_TRUE(profile.has_value());
+  EXPECT_GT(profile->getTotalSamples(), 0U);
+
+  std::stringstream folded{};
+  profile->writeFolded(folded);
+  std::string line{};
+  while (std::getline(folded, line))
+    EXPECT_EQ(line.rfind("main", 0), 0U) << line;
+}
+
+TEST(executor, registerEquivalence) {
+  for (const auto *path : {PATH("fib.leech"), PATH("fib_rec.leech"),
+                           PATH("average.leech"), PATH("classWorking.leech"),
+                           PATH("methods.leech"), PATH("shapes.leech")})
+    for (bool fuse : {false, true}) {
+      auto pfile = parseLeech(path);
+      if (fuse)
+        fuseSuperinstructions(*pfile);
+      auto ref = runLeech(pfile.get(), jitOptions(DispatchMode::Threaded, 0));
+      EXPECT_EQ(runLeech(pfile.get(), DispatchMode::Register), ref) << path;
+    }
+}
+
+TEST(executor, registerFib) {
+  auto pfile = parseLeech(PATH("fib.leech"));
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), DispatchMode::Register);
+  exec.execute();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "817770325994397771\n");
+
+  const auto &regCode = exec.getRegCode();
+  ASSERT_TRUE(regCode.has_value());
+  /* Loads are folded into operands */
+  EXPECT_LT(regCode->code.size(), pfile->code.size());
+  EXPECT_FALSE(exec.getJitStats().has_value());
+}
+
+namespace {
+/* sum(1, 2), then sum(1 / 2, 2 / 2) if floats is set */
+std::string makeSumSource(bool floats) {
+  std::string src = R"(
+.func sum 2
+    .cpool
+        0: 0
+    .names
+        0: a
+        1: b
+    .code
+        LOAD_FAST 0
+        LOAD_FAST 1
+        BINARY_ADD
+        RETURN_VALUE
+.func main 0
+    .cpool
+        0: 0
+        1: 1
+        2: 2
+    .names
+        0: sum
+    .code
+        LOAD_CONST 1
+        LOAD_CONST 2
+        CALL_FUNCTION 0
+        PRINT
+)";
+  if (floats)
+    src += R"(
+        LOAD_CONST 1
+        LOAD_CONST 2
+        BINARY_TRUE_DIVIDE
+        LOAD_CONST 2
+        LOAD_CONST 2
+        BINARY_TRUE_DIVIDE
+        CALL_FUNCTION 0
+        PRINT
+)";
+  return src + R"(
+        LOAD_CONST 0
+        RETURN_VALUE
+)";
+}
+
+ExecOptions quickOptions(DispatchMode mode, bool quicken) {
+  auto opts = jitOptions(mode, 0);
+  opts.quicken = quicken;
+  return opts;
+}
+} // namespace
+
+TEST(executor, quickening) {
+  for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback}) {
+    auto pfile = parseLeechSource(makeSumSource(false));
+    EXPECT_EQ(runLeech(pfile.get(), quickOptions(mode, true)), "3\n");
+    EXPECT_EQ(pfile->code[2].getOpcode(), Opcodes::BINARY_ADD__INT);
+    /* Quickened code is run as is */
+    EXPECT_EQ(runLeech(pfile.get(), quickOptions(mode, false)), "3\n");
+
+    /* Float operands miss the guard, site stays generic */
+    pfile = parseLeechSource(makeSumSource(true));
+    auto ref = runLeech(pfile.get(), quickOptions(mode, false));
+    EXPECT_EQ(pfile->code[2].getOpcode(), Opcodes::BINARY_ADD);
+    EXPECT_EQ(runLeech(pfile.get(), quickOptions(mode, true)), ref);
+    EXPECT_EQ(pfile->code[2].getOpcode(), Opcodes::BINARY_ADD);
+    EXPECT_EQ(pfile->code[10].getOpcode(), Opcodes::BINARY_TRUE_DIVIDE__INT);
+  }
+}
+
+TEST(executor, quickenedSubscr) {
+  auto pfile = parseLeech(PATH("average.leech"));
+  auto ref = runLeech(pfile.get(), quickOptions(DispatchMode::Threaded, false));
+  EXPECT_EQ(runLeech(pfile.get(), quickOptions(DispatchMode::Threaded, true)),
+            ref);
+  auto quickened = std::count_if(
+      pfile->code.begin(), pfile->code.end(), [](const auto &inst) {
+        return inst.getOpcode() == Opcodes::BINARY_SUBSCR__TUPLE_INT ||
+               inst.getOpcode() == Opcodes::COMPARE_OP__INT;
+      });
+  EXPECT_EQ(quickened, 3);
+
+  /* Binary file keeps the generic opcodes */
+  std::stringstream sst;
+  pfile->serialize(sst);
+  auto loaded = LeechFile::deserialize(sst);
+  EXPECT_TRUE(std::none_of(loaded.code.begin(), loaded.code.end(),
+                           [](const auto &inst) {
+                             return isQuickened(inst.getOpcode());
+                           }));
+}
+
+TEST(executor, mainArgs) {
+  auto pfile = parseLeechSource(R"(
+.func main 2
+    .cpool
+        0: 0
+    .names
+        0: a
+        1: b
+    .code
+        LOAD_FAST 0
+        LOAD_FAST 1
+        BINARY_SUBTRACT
+        PRINT
+        LOAD_CONST 0
+        RETURN_VALUE
+)");
+  std::vector<Value> args{Value(Integer{10}), Value(Integer{3})};
+
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), ExecOptions{});
+  exec.execute(args);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "7\n");
+  EXPECT_THROW(exec.execute(args), std::logic_error);
+}
+
+TEST(executor, isolatePool) {
+  std::shared_ptr<const LeechFile> pfile = parseLeech(PATH("fib.leech"));
+  std::vector<Instruction> code(pfile->code.begin(), pfile->code.end());
+  std::vector<IsolateJob> jobs(8, IsolateJob{pfile.get()});
+  jobs.push_back({});
+
+  IsolatePool pool{4};
+  testing::internal::CaptureStdout();
+  pool.run(jobs);
+  auto out = testing::internal::GetCapturedStdout();
+
+  /* Lines of isolates may interleave */
+  std::size_t found = 0;
+  for (auto pos = out.find("817770325994397771"); pos != std::string::npos;
+       pos = out.find("817770325994397771", pos + 1))
+    ++found;
+  EXPECT_EQ(found, 8U);
+
+  const auto &stats = pool.getStats();
+  ASSERT_EQ(stats.size(), jobs.size());
+  for (std::size_t i = 0; i < stats.size(); ++i) {
+    EXPECT_EQ(stats[i].job, i);
+    EXPECT_LT(stats[i].worker, 4U);
+    EXPECT_EQ(stats[i].failed(), i == 8) << stats[i].error;
+  }
+  EXPECT_EQ(pool.getPoolStats().jobs, 9U);
+  EXPECT_EQ(pool.getPoolStats().failed, 1U);
+  EXPECT_EQ(pool.getPoolStats().threads, 4U);
+  /* Shared file is left as is */
+  EXPECT_TRUE(std::equal(code.begin(), code.end(), pfile->code.begin(),
+                         pfile->code.end(),
+                         [](const auto &lhs, const auto &rhs) {
+                           return lhs.getOpcode() == rhs.getOpcode() &&
+                                  lhs.getArg() == rhs.getArg();
+                         }));
+}
+
+TEST(executor, isolatePoolMapped) {
+  /* Constants of mapped file are decoded lazily, pool has to do it before
+   * isolates share the file */
+  auto path = std::filesystem::temp_directory_path() / "leech_isolate.bin";
+  {
+    std::ofstream out{path, std::ios::binary};
+    parseLeech(PATH("fib.leech"))->serialize(out);
+  }
+  auto file = LeechFile::mapFile(path);
+  std::filesystem::remove(path);
+  std::vector<IsolateJob> jobs(8, IsolateJob{&file});
+
+  IsolatePool pool{4};
+  testing::internal::CaptureStdout();
+  pool.run(jobs);
+  auto out = testing::internal::GetCapturedStdout();
+
+  std::size_t found = 0;
+  for (auto pos = out.find("817770325994397771"); pos != std::string::npos;
+       pos = out.find("817770325994397771", pos + 1))
+    ++found;
+  EXPECT_EQ(found, 8U);
+  EXPECT_EQ(pool.getPoolStats().failed, 0U);
+  for (const auto &[_, fm] : file.meta.funcs)
+    for (const auto &cst : fm.cstPool)
+      EXPECT_NE(cst, nullptr);
+}
+
+TEST(executor, tuples) {
+  auto pfile = parseLeechSource(R"(
+.func main 0
+    .cpool
+        0: (1, 2, 3, 4, 5, 6, 7, 8)
+        1: 2
+        2: 6
+        3: 0
+        4: str
+    .names
+        0: view
+    .code
+        LOAD_CONST 0
+        LOAD_CONST 1
+        LOAD_CONST 2
+        BUILD_SLICE 2
+        BINARY_SUBSCR
+        STORE_FAST 0
+        GET_LEN
+        PRINT
+        PRINT
+        LOAD_FAST 0
+        LOAD_CONST 3
+        BINARY_SUBSCR
+        PRINT
+        LOAD_CONST 1
+        LOAD_CONST 4
+        LOAD_FAST 0
+        BUILD_TUPLE 3
+        PRINT
+        LOAD_CONST 3
+        RETURN_VALUE
+)");
+  const char *ref = "4\n(3,4,5,6,)\n3\n(2,\"str\",(3,4,5,6,),)\n";
+  for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback,
+                    DispatchMode::Register})
+    EXPECT_EQ(runLeech(pfile.get(), mode), ref);
+}
+
+TEST(executor, tupleOwnsClassObjects) {
+  /* x.a = 1; t = (x,); x.a = 2; print x.a, t[0].a */
+  auto pfile = parseLeechSource(R"(
+.func main 0
+    .cpool
+        0: 1
+        1: 2
+        2: 0
+    .names
+        0: foo
+        1: a
+        2: x
+        3: t
+    .code
+        LOAD_BUILD_CLASS
+        LOAD_CONST 0
+        STORE_ATTR 1
+        STORE_BUILD_CLASS 0
+        INSTANCE_CLASS 0
+        STORE_FAST 2
+        BUILD_TUPLE 1
+        STORE_FAST 3
+        POP_TOP
+        LOAD_FAST 2
+        LOAD_CONST 1
+        STORE_ATTR 1
+        LOAD_ATTR 1
+        PRINT
+        POP_TOP
+        LOAD_FAST 3
+        LOAD_CONST 2
+        BINARY_SUBSCR
+        LOAD_ATTR 1
+        PRINT
+        POP_TOP
+        LOAD_CONST 2
+        RETURN_VALUE
+)");
+  for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback,
+                    DispatchMode::Register})
+    EXPECT_EQ(runLeech(pfile.get(), mode), "2\n1\n");
+}
+
+TEST(executor, tuplesSurviveGC) {
+  /* t = (t, i) for i in [0, 100000), then sum of i walking the chain */
+  auto pfile = parseLeechSource(R"(
+.func main 0
+    .cpool
+        0: 0
+        1: 1
+        2: 100000
+        3: 2
+    .names
+        0: t
+        1: i
+        2: s
+    .code
+        LOAD_CONST 0
+        BUILD_TUPLE 1
+        STORE_FAST 0
+        POP_TOP
+        LOAD_CONST 0
+        STORE_FAST 1
+        POP_TOP
+    .label build
+        LOAD_FAST 0
+        LOAD_FAST 1
+        BUILD_TUPLE 2
+        STORE_FAST 0
+        POP_TOP
+        LOAD_FAST 1
+        LOAD_CONST 1
+        BINARY_ADD
+        STORE_FAST 1
+        LOAD_CONST 2
+        COMPARE_OP 0
+        POP_JUMP_IF_TRUE : build
+        LOAD_CONST 0
+        STORE_FAST 2
+    .label walk
+        POP_TOP
+        LOAD_FAST 2
+        LOAD_FAST 0
+        LOAD_CONST 1
+        BINARY_SUBSCR
+        BINARY_ADD
+        STORE_FAST 2
+        POP_TOP
+        LOAD_FAST 0
+        LOAD_CONST 0
+        BINARY_SUBSCR
+        STORE_FAST 0
+        GET_LEN
+        LOAD_CONST 3
+        COMPARE_OP 2
+        POP_JUMP_IF_TRUE : walk
+        LOAD_FAST 2
+        PRINT
+        LOAD_CONST 0
+        RETURN_VALUE
+)");
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), jitOptions(DispatchMode::Threaded, 0));
+  exec.execute();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "4999950000\n");
+  EXPECT_GT(exec.getHeap().getStats().minorCollections, 0U);
+}
+
+TEST(executor, forIter) {
+  auto pfile = parseLeechSource(R"(
+.func main 0
+    .cpool
+        0: (1, 2, 3, 4, 5)
+        1: 0
+        2: 10
+        3: 1
+    .names
+        0: s
+        1: x
+    .code
+        LOAD_CONST 1
+        STORE_FAST 0
+        POP_TOP
+        LOAD_CONST 0
+        GET_ITER
+    .label tuple
+        FOR_ITER : tupleEnd
+        STORE_FAST 1
+        POP_TOP
+        LOAD_FAST 0
+        LOAD_FAST 1
+        BINARY_ADD
+        STORE_FAST 0
+        POP_TOP
+        JUMP_ABSOLUTE : tuple
+    .label tupleEnd
+        LOAD_FAST 0
+        PRINT
+        LOAD_CONST 1
+        LOAD_CONST 2
+        BUILD_SLICE 2
+        GET_ITER
+    .label range
+        FOR_ITER : rangeEnd
+        LOAD_FAST 0
+        BINARY_ADD
+        STORE_FAST 0
+        POP_TOP
+        JUMP_ABSOLUTE : range
+    .label rangeEnd
+        LOAD_FAST 0
+        PRINT
+        LOAD_CONST 1
+        JUMP_IF_TRUE_OR_POP : print
+        LOAD_CONST 3
+        JUMP_IF_TRUE_OR_POP : print
+        LOAD_CONST 2
+    .label print
+        PRINT
+        JUMP_FORWARD : end
+        LOAD_CONST 2
+        PRINT
+    .label end
+        LOAD_CONST 1
+        RETURN_VALUE
+)");
+  const char *ref = "15\n60\n1\n";
+  for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback,
+                    DispatchMode::Register})
+    EXPECT_EQ(runLeech(pfile.get(), mode), ref);
+
+  testing::internal::CaptureStdout();
+  Executor exec(pfile.get(), jitOptions(DispatchMode::Threaded, 1));
+  exec.execute();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), ref);
+  if (!jit::isSupported())
+    return;
+  /* Loops are entered in native code by backward jumps */
+  EXPECT_GT(exec.getJitStats()->osrEntries, 0U);
+}
+
+TEST(executor, forIterNoAlloc) {
+  auto pfile = parseLeechSource(R"(
+.func main 0
+    .cpool
+        0: (0)
+        1: 0
+        2: 1000000
+    .names
+        0: s
+    .code
+        LOAD_CONST 1
+        STORE_FAST 0
+        POP_TOP
+        LOAD_CONST 0
+        GET_ITER
+    .label tuple
+        FOR_ITER : range
+        LOAD_FAST 0
+        BINARY_ADD
+        STORE_FAST 0
+        POP_TOP
+        JUMP_ABSOLUTE : tuple
+    .label range
+        LOAD_CONST 1
+        LOAD_CONST 2
+        BUILD_SLICE 2
+        GET_ITER
+    .label loop
+        FOR_ITER : end
+        LOAD_FAST 0
+        BINARY_ADD
+        STORE_FAST 0
+        POP_TOP
+        JUMP_ABSOLUTE : loop
+    .label end
+        LOAD_FAST 0
+        PRINT
+        LOAD_CONST 1
+        RETURN_VALUE
+)");
+  Tuple big{};
+  for (Integer i = 0; i < 1000000; ++i)
+    big.push_back(makeInt(i));
+  pfile->meta.funcs.at("main").cstPool[0] =
+      std::make_shared<TupleObj>(std::move(big));
+
+  for (const auto &opts : {jitOptions(DispatchMode::Threaded, 0),
+                           jitOptions(DispatchMode::Register, 0),
+                           jitOptions(DispatchMode::Threaded, 1)}) {
+    testing::internal::CaptureStdout();
+    Executor exec(pfile.get(), opts);
+    exec.execute();
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "999999000000\n");
+    /* Two iterators and the slice */
+    EXPECT_LT(exec.getHeap().getStats().allocatedBytes, 1024U);
+  }
+}
+
+TEST(executor, aotEquivalence) {
+  for (const auto *path : {PATH("fib.leech"), PATH("fib_rec.leech"),
+                           PATH("average.leech"), PATH("classWorking.leech"),
+                           PATH("methods.leech"), PATH("shapes.leech")}) {
+    auto pfile = parseLeech(path);
+    auto ref = runLeech(pfile.get(), jitOptions(DispatchMode::Callback, 0));
+    auto so = buildNative(*pfile, std::filesystem::path(path).stem());
+    aot::Module module{so, *pfile};
+    EXPECT_GT(module.size(), 0U) << path;
+
+    for (auto opts : {jitOptions(DispatchMode::Threaded, 0),
+                      jitOptions(DispatchMode::Threaded, 1),
+                      jitOptions(DispatchMode::Callback, 0),
+                      jitOptions(DispatchMode::Register, 0)}) {
+      opts.aot = &module;
+      EXPECT_EQ(runLeech(pfile.get(), opts), ref) << path;
+    }
+    /* Superinstructions don't change the file module was built for */
+    fuseSuperinstructions(*pfile);
+    ExecOptions opts{};
+    opts.aot = &module;
+    EXPECT_EQ(runLeech(pfile.get(), opts), ref) << path;
+    std::filesystem::remove(so);
+  }
+}
+
+TEST(executor, aotEscaping) {
+  auto pfile = parseLeech(PATH("fib.leech"));
+  const std::string name{"a\"b\\c*/\n\0?'d", 12};
+  pfile->meta.funcs.emplace(name, pfile->meta.funcs.at("main"));
+  auto ref = runLeech(pfile.get(), ExecOptions{});
+
+  /* Compiler runs w/o shell, so quotes in paths are kept as is */
+  auto so = buildNative(*pfile, "it's; name");
+  aot::Module module{so, *pfile};
+  std::filesystem::remove(so);
+  /* fib, main and its copy under escaped name */
+  ASSERT_EQ(module.size(), 3U);
+  EXPECT_NE(module.find(&pfile->meta.funcs.at(name)), nullptr);
+
+  ExecOptions opts{};
+  opts.aot = &module;
+  EXPECT_EQ(runLeech(pfile.get(), opts), ref);
+}
+
+TEST(executor, aotDeepCalls) {
+  auto pfile = parseLeechSource(R"(
+.func sum 1
+    .cpool
+        0: 0
+        1: 1
+    .names
+        0: n
+        1: sum
+    .code
+        LOAD_FAST 0
+        LOAD_CONST 0
+        COMPARE_OP 2
+        POP_JUMP_IF_FALSE : rec
+        LOAD_CONST 0
+        RETURN_VALUE
+    .label rec
+        LOAD_FAST 0
+        LOAD_CONST 1
+        BINARY_SUBTRACT
+        CALL_FUNCTION 1
+        LOAD_FAST 0
+        BINARY_ADD
+        RETURN_VALUE
+
+.func main 0
+    .cpool
+        0: 0
+        1: 20000
+    .names
+        0: sum
+    .code
+        LOAD_CONST 1
+        CALL_FUNCTION 0
+        PRINT
+        LOAD_CONST 0
+        RETURN_VALUE
+)");
+  auto so = buildNative(*pfile, "deep");
+  aot::Module module{so, *pfile};
+  EXPECT_EQ(module.size(), 2U);
+
+  /* Calls nested deeper than native limit are interpreted */
+  ExecOptions opts{};
+  opts.aot = &module;
+  EXPECT_EQ(runLeech(pfile.get(), opts), "200010000\n");
+
+  /* Module is tied to the file it was built for */
+  auto other = parseLeech(PATH("fib_rec.leech"));
+  EXPECT_THROW((aot::Module{so, *other}), std::runtime_error);
+  std::filesystem::remove(so);
+}
+
+TEST(executor, verifiedEquivalence) {
+  for (const auto *path : {PATH("fib.leech"), PATH("fib_rec.leech"),
+                           PATH("average.leech"), PATH("classWorking.leech"),
+                           PATH("methods.leech"), PATH("shapes.leech")}) {
+    auto pfile = parseLeech(path);
+    auto ref = runLeech(pfile.get(), jitOptions(DispatchMode::Callback, 0));
+
+    verify(*pfile);
+    for (auto mode : {DispatchMode::Threaded, DispatchMode::Callback,
+                      DispatchMode::Register})
+      EXPECT_EQ(runLeech(pfile.get(), jitOptions(mode, 0)), ref) << path;
+    EXPECT_EQ(runLeech(pfile.get(), jitOptions(DispatchMode::Threaded, 1)),
+              ref)
+        << path;
+  }
+}
+
+TEST(executor, verifiedStackBound) {
+  auto pfile = parseLeech(PATH("fib_rec.leech"));
+  verify(*pfile);
+  EXPECT_EQ(pfile->meta.funcs.at("fib").maxStack, 3U);
+  EXPECT_EQ(pfile->meta.funcs.at("main").maxStack, 1U);
+  EXPECT_EQ(runLeech(pfile.get(), DispatchMode::Threaded), "832040\n");
+
+  /* Loop of fib leaves values on data stack */
+  auto unbalanced = parseLeech(PATH("fib.leech"));
+  verify(*unbalanced);
+  EXPECT_FALSE(unbalanced->meta.funcs.at("fib").maxStack.has_value());
+}
+
+#undef PATH
+
+#include "test_footer.hh"
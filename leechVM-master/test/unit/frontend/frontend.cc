@@ -1,9 +1,12 @@
+#include <filesystem>
 #include <fstream>
+#include <memory>
 
 #include "test_header.hh"
 
 #include "config.hh"
 #include "frontend/frontend.hh"
+#include "leechVM/leechVM.hh"
 
 #define PATH(test) TESTS_DIR test
 
@@ -25,6 +28,105 @@ TEST(frontend, averageLexicalErr) {
   file.close();
 }
 
+TEST(frontend, mappedSource) {
+  std::ifstream file(PATH("fib_rec.leech"));
+  yy::Driver streamed(file, std::cout);
+  ASSERT_TRUE(streamed.parse());
+
+  auto src = leech::MappedFile::map(PATH("fib_rec.leech"));
+  yy::Driver mapped(src.chars(), std::cout);
+  ASSERT_TRUE(mapped.parse());
+
+  auto lhs = streamed.getLeechFile();
+  auto rhs = mapped.getLeechFile();
+  ASSERT_TRUE(std::equal(lhs->code.begin(), lhs->code.end(),
+                         rhs->code.begin(), rhs->code.end(),
+                         [](const auto &lhsInst, const auto &rhsInst) {
+                           return lhsInst.getOpcode() == rhsInst.getOpcode() &&
+                                  lhsInst.getArg() == rhsInst.getArg();
+                         }));
+  for (const auto &[name, func] : lhs->meta.funcs) {
+    const auto &other = rhs->meta.funcs.at(name);
+    EXPECT_EQ(func.addr, other.addr);
+    EXPECT_EQ(func.names, other.names);
+    EXPECT_EQ(func.cstPool, other.cstPool);
+  }
+}
+
+TEST(frontend, internedNames) {
+  std::string_view src = R"(
+.func main 0
+    .names
+        0: n
+        1: id
+    .code
+        LOAD_FAST 0
+        CALL_FUNCTION 1
+        RETURN_VALUE
+.func id 1
+    .names
+        0: n
+    .code
+        LOAD_FAST 0
+        RETURN_VALUE
+)";
+  yy::Driver driver({src.data(), src.size()}, std::cout);
+  ASSERT_TRUE(driver.parse());
+  const auto &funcs = driver.getLeechFile()->meta.funcs;
+  EXPECT_EQ(funcs.at("main").names[0].data(), funcs.at("id").names[0].data());
+}
+
+TEST(frontend, undefinedLabel) {
+  std::string_view src = R"(
+.func main 0
+    .code
+        JUMP_ABSOLUTE : end
+)";
+  yy::Driver driver({src.data(), src.size()}, std::cout);
+  EXPECT_FALSE(driver.parse());
+}
+
+TEST(frontend, unknownOpcode) {
+  std::string_view src = R"(
+.func main 0
+    .code
+        LOAD_NOTHING 0
+)";
+  yy::Driver driver({src.data(), src.size()}, std::cout);
+  EXPECT_FALSE(driver.parse());
+}
+
+TEST(frontend, sourceCache) {
+  auto dir = std::filesystem::temp_directory_path() / "leech_source_cache";
+  std::filesystem::remove_all(dir);
+
+  /* VMs are too large to keep three of them on the stack */
+  auto parsed = std::make_unique<leech::LeechVM>();
+  parsed->loadSource(PATH("fib_rec.leech"), dir);
+  ASSERT_EQ(std::distance(std::filesystem::directory_iterator(dir),
+                          std::filesystem::directory_iterator()),
+            1);
+  auto cached = std::filesystem::directory_iterator(dir)->path();
+
+  auto mapped = std::make_unique<leech::LeechVM>();
+  mapped->loadSource(PATH("fib_rec.leech"), dir);
+  const auto &lhs = parsed->getLeechFile()->code;
+  const auto &rhs = mapped->getLeechFile()->code;
+  ASSERT_EQ(lhs.size(), rhs.size());
+  /* Mapped binary is used in place */
+  EXPECT_NE(rhs.data(), lhs.data());
+  EXPECT_EQ(mapped->getLeechFile()->meta.funcs.at("fib").maxStack, 3U);
+
+  /* Corrupted cache is parsed again and replaced */
+  std::ofstream(cached, std::ios::trunc) << "garbage";
+  auto reparsed = std::make_unique<leech::LeechVM>();
+  reparsed->loadSource(PATH("fib_rec.leech"), dir);
+  EXPECT_EQ(reparsed->getLeechFile()->code.size(), lhs.size());
+  EXPECT_GT(std::filesystem::file_size(cached), 7U);
+
+  std::filesystem::remove_all(dir);
+}
+
 #undef PATH
 
 #include "test_footer.hh"
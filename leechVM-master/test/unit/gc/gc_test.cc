@@ -7,9 +7,165 @@ using namespace leech;
 TEST(MemManager, DoubleMMap)
 {
   gc::MemoryManager mman;
+  gc::MemoryManager other;
 
+  auto *begin = static_cast<std::byte *>(mman.data());
+  auto *otherBegin = static_cast<std::byte *>(other.data());
+  EXPECT_TRUE(otherBegin + other.size() <= begin ||
+              begin + mman.size() <= otherBegin);
+}
+
+namespace {
+struct HeapFixture : public testing::Test {
+  gc::Heap heap{};
+  std::vector<Value> roots{};
+
+  HeapFixture() {
+    heap.setRoots([this](IValueVisitor &vis) {
+      for (auto &val : roots)
+        vis.visit(val);
+    });
+  }
+
+  ClassObj *asClass(const Value &val) {
+    return static_cast<ClassObj *>(val.getObj());
+  }
+};
+} // namespace
+
+TEST(Region, Bump) {
+  // Assign
+  alignas(16) std::byte buf[64];
+  gc::Region reg(buf, sizeof(buf));
+
+  // Act
+  auto *first = reg.allocate(48);
+  auto *second = reg.allocate(32);
+  auto *third = reg.allocate(16);
+
+  // Assert
+  EXPECT_EQ(first, buf);
+  EXPECT_EQ(second, nullptr);
+  EXPECT_EQ(third, buf + 48);
+  EXPECT_EQ(reg.used(), 64);
+  reg.reset();
+  EXPECT_EQ(reg.available(), 64);
+}
+
+TEST_F(HeapFixture, Clone) {
+  // Assign
+  roots.emplace_back(heap.make<ClassObj>());
+  StringObj str("str");
+  Value strVal(&str);
+
+  // Act
+  auto clsCopy = heap.clone(roots[0]);
+  auto strCopy = heap.clone(strVal);
+
+  // Assert
+  EXPECT_TRUE(heap.inNursery(clsCopy.getObj()));
+  EXPECT_NE(roots[0].getObj(), clsCopy.getObj());
+  EXPECT_EQ(strVal.getObj(), strCopy.getObj());
+}
+
+TEST_F(HeapFixture, MinorCollection) {
+  // Assign
+  auto *inner = heap.make<ClassObj>();
+  inner->updateField("val", Value(Integer{42}));
+  auto *outer = heap.make<ClassObj>();
+  outer->updateField("inner", Value(inner));
+  roots.emplace_back(outer);
+  for (int i = 0; i < 100; ++i)
+    heap.make<ClassObj>();
+  auto sizeBefore = heap.getHeapSize();
+
+  // Act
+  heap.collectMinor();
+
+  // Assert
+  auto *newOuter = asClass(roots[0]);
+  const auto &newInner = newOuter->getField("inner");
+  EXPECT_FALSE(heap.inNursery(newOuter));
+  EXPECT_TRUE(heap.contains(newOuter));
+  EXPECT_FALSE(heap.inNursery(newInner.getObj()));
+  EXPECT_EQ(asClass(newInner)->getField("val").getInt(), 42);
+  EXPECT_LT(heap.getHeapSize(), sizeBefore);
+  EXPECT_EQ(heap.getStats().minorCollections, 1);
+  EXPECT_GT(heap.getStats().promotedBytes, 0);
+}
+
+TEST_F(HeapFixture, WriteBarrier) {
+  // Assign
+  roots.emplace_back(heap.make<ClassObj>());
+  heap.collectMinor();
+  auto *old = asClass(roots[0]);
+
+  // Act
+  auto *young = heap.make<ClassObj>();
+  young->updateField("val", Value(Integer{7}));
+  Value youngVal(young);
+  old->updateField("young", youngVal);
+  heap.writeBarrier(old, youngVal);
+  heap.collectMinor();
+
+  // Assert
+  const auto &field = asClass(roots[0])->getField("young");
+  EXPECT_FALSE(heap.inNursery(field.getObj()));
+  EXPECT_EQ(asClass(field)->getField("val").getInt(), 7);
+}
+
+TEST_F(HeapFixture, MajorCollection) {
+  // Assign
+  roots.emplace_back(heap.make<ClassObj>());
+  roots.emplace_back(heap.make<ClassObj>());
+  heap.collectMinor();
+  auto promoted = heap.getHeapSize();
+  asClass(roots[0])->updateField("val", Value(Integer{1}));
+  roots.pop_back();
+
+  // Act
+  heap.collectMajor();
+
+  // Assert
+  EXPECT_LT(heap.getHeapSize(), promoted);
+  EXPECT_EQ(asClass(roots[0])->getField("val").getInt(), 1);
+  EXPECT_EQ(heap.getStats().majorCollections, 1);
+}
+
+TEST_F(HeapFixture, AllocationTriggersCollection) {
+  // Assign
+  roots.emplace_back(heap.make<ClassObj>());
+
+  // Act
+  for (int i = 0; i < 1000000; ++i) {
+    auto *obj = heap.make<ClassObj>();
+    obj->updateField("prev", roots[0]);
+    heap.writeBarrier(obj, roots[0]);
+    if (i % 1000 == 0)
+      roots[0] = Value(obj);
+  }
+
+  // Assert
+  const auto &stats = heap.getStats();
+  EXPECT_GT(stats.minorCollections, 0);
+  EXPECT_LE(heap.getHeapSize(), heap.getCapacity());
+  EXPECT_GE(stats.maxPause.count(), 0);
+  EXPECT_GT(stats.allocatedBytes, heap.getCapacity());
+}
+
+TEST_F(HeapFixture, LiveDataOverflow) {
+  /* Chain of live objects outgrows old space during major collection */
+  auto fill = [this] {
+    roots.emplace_back(heap.make<ClassObj>());
+    for (;;) {
+      auto *obj = heap.make<ClassObj>();
+      obj->updateField("prev", roots[0]);
+      heap.writeBarrier(obj, roots[0]);
+      roots[0] = Value(obj);
+    }
+  };
 
-  EXPECT_THROW(gc::MemoryManager(), std::logic_error);
+  EXPECT_DEATH(fill(), "Out of memory during collection");
 }
 
 #include "test_footer.hh"
@@ -1,7 +1,13 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 #include <string_view>
 
+#include "leechfile/fusion.hh"
 #include "leechfile/leechfile.hh"
+#include "leechfile/regcode.hh"
+#include "leechfile/verifier.hh"
 #include "test_header.hh"
 
 using namespace leech;
@@ -10,16 +16,393 @@ TEST(Serialize, Empty) {
   // Assign
   LeechFile cf{};
   std::ostringstream oss{};
-  std::string_view ans{"theLEECH"
-                       "\x0\x0\x0\x0\x0\x0\x0\x0"
-                       "\x0\x0\x0\x0\x0\x0\x0\x0",
-                       24};
 
   // Act
   cf.serialize(oss);
 
   // Assert
-  EXPECT_EQ(oss.str(), ans);
+  auto res = oss.str();
+  ASSERT_EQ(res.size(), sizeof(image::Header));
+  image::Header header{};
+  std::memcpy(&header, res.data(), sizeof(header));
+  EXPECT_EQ(std::string_view(header.magic, 8), LeechFile::theLEECH);
+  EXPECT_EQ(header.version, image::kVersion);
+  EXPECT_EQ(header.fileSize, res.size());
+  EXPECT_EQ(header.funcNum, 0U);
+  EXPECT_EQ(header.codeNum, 0U);
+}
+
+TEST(FuncMeta, ResolveSlots) {
+  // Assign
+  FuncMeta fm{};
+  fm.names = {"a", "b", "a", "c"};
+
+  // Act
+  fm.resolveSlots();
+
+  // Assert
+  ASSERT_TRUE(fm.isResolved());
+  EXPECT_EQ(fm.slotsNum, 3U);
+  EXPECT_EQ(fm.slots, (std::vector<std::size_t>{0, 1, 0, 2}));
+}
+
+TEST(Deserialize, RoundTrip) {
+  // Assign
+  FuncMeta fm{};
+  fm.addr = 0;
+  fm.argNum = 2;
+  fm.cstPool.push_back(std::make_shared<IntObj>(1));
+  fm.names = {"x", "y"};
+  LeechFile cf{Meta{{{"main", fm}}},
+               {Instruction(Opcodes::LOAD_CONST, 0),
+                Instruction(Opcodes::RETURN_VALUE)}};
+  std::stringstream ss{};
+
+  // Act
+  cf.serialize(ss);
+  auto res = LeechFile::deserialize(ss);
+
+  // Assert
+  const auto &resFm = res.meta.funcs.at("main");
+  EXPECT_EQ(resFm.argNum, 2U);
+  EXPECT_EQ(resFm.names, fm.names);
+  EXPECT_TRUE(resFm.isResolved());
+  EXPECT_EQ(resFm.slotsNum, 2U);
+  EXPECT_EQ(res.code.size(), 2U);
+  EXPECT_EQ(res.code[0].getArg(), 0);
+  ASSERT_EQ(resFm.cstPool.size(), 1U);
+  EXPECT_EQ(resFm.cstPool[0], nullptr);
+  EXPECT_EQ(Value(resFm.getConst(0)).getInt(), 1);
+}
+
+namespace {
+LeechFile makeFile() {
+  FuncMeta fm{};
+  fm.cstPool.push_back(std::make_shared<StringObj>("str"));
+  fm.names = {"x"};
+  return {Meta{{{"main", fm}}},
+          {Instruction(Opcodes::LOAD_CONST, 0),
+           Instruction(Opcodes::STORE_FAST, 0),
+           Instruction(Opcodes::RETURN_VALUE)}};
+}
+} // namespace
+
+TEST(Deserialize, MapFile) {
+  // Assign
+  auto path = std::filesystem::temp_directory_path() / "leechfile_test.bin";
+  {
+    std::ofstream out{path, std::ios::binary};
+    makeFile().serialize(out);
+  }
+
+  // Act
+  auto res = LeechFile::mapFile(path);
+  std::filesystem::remove(path);
+
+  // Assert
+  const auto &fm = res.meta.funcs.at("main");
+  EXPECT_EQ(fm.names, (std::vector<std::string_view>{"x"}));
+  EXPECT_EQ(fm.getConst(0)->getType(), ValueType::String);
+  ASSERT_EQ(res.code.size(), 3U);
+  EXPECT_EQ(res.code[1].getOpcode(), Opcodes::STORE_FAST);
+}
+
+TEST(Deserialize, WrongMagic) {
+  // Assign
+  std::stringstream ss{};
+  makeFile().serialize(ss);
+  auto bytes = ss.str();
+  bytes[0] = 'L';
+  std::istringstream ist{bytes};
+
+  // Act & Assert
+  EXPECT_THROW(static_cast<void>(LeechFile::deserialize(ist)),
+               std::runtime_error);
+}
+
+TEST(Deserialize, Truncated) {
+  // Assign
+  std::stringstream ss{};
+  makeFile().serialize(ss);
+  auto bytes = ss.str();
+  bytes.resize(bytes.size() / 2);
+  std::istringstream ist{bytes};
+
+  // Act & Assert
+  EXPECT_THROW(static_cast<void>(LeechFile::deserialize(ist)),
+               std::runtime_error);
+}
+
+TEST(Deserialize, InvalidOpcode) {
+  // Assign
+  std::stringstream ss{};
+  auto file = makeFile();
+  file.serialize(ss);
+  auto bytes = ss.str();
+  image::Header header{};
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  bytes[header.codeOffset] = static_cast<char>(0xFF);
+  std::istringstream ist{bytes};
+
+  // Act & Assert
+  EXPECT_THROW(static_cast<void>(LeechFile::deserialize(ist)),
+               std::runtime_error);
+}
+
+TEST(ConstTable, Deduplicate) {
+  // Assign
+  FuncMeta foo{};
+  foo.cstPool = {std::make_shared<StringObj>("str"), makeInt(1000)};
+  FuncMeta bar{};
+  bar.addr = 1;
+  bar.cstPool = {makeInt(1000), std::make_shared<StringObj>("str"),
+                 std::make_shared<StringObj>("other")};
+  LeechFile cf{Meta{{{"foo", foo}, {"bar", bar}}},
+               {Instruction(Opcodes::RETURN_VALUE),
+                Instruction(Opcodes::RETURN_VALUE)}};
+  std::stringstream ss{};
+  cf.serialize(ss);
+
+  // Act
+  auto res = LeechFile::deserialize(ss);
+  const auto &rfoo = res.meta.funcs.at("foo");
+  const auto &rbar = res.meta.funcs.at("bar");
+
+  // Assert
+  for (const auto *file : {&cf, &res}) {
+    const auto &ffoo = file->meta.funcs.at("foo");
+    const auto &fbar = file->meta.funcs.at("bar");
+    EXPECT_EQ(ffoo.getConst(0).get(), fbar.getConst(1).get());
+    EXPECT_EQ(ffoo.getConst(1).get(), fbar.getConst(0).get());
+    EXPECT_NE(ffoo.getConst(0).get(), fbar.getConst(2).get());
+  }
+  EXPECT_EQ(res.getConstTable().size(), 3U);
+  /* Copies share immutable constants */
+  FuncMeta copy{rfoo};
+  EXPECT_EQ(copy.getConst(0).get(), rbar.getConst(1).get());
+}
+
+TEST(Fusion, LeastDispatches) {
+  // Assign
+  FuncMeta fm{};
+  fm.names = {"x"};
+  LeechFile cf{Meta{{{"main", fm}}},
+               {Instruction(Opcodes::STORE_FAST, 0),
+                Instruction(Opcodes::LOAD_FAST, 0),
+                Instruction(Opcodes::LOAD_CONST, 1),
+                Instruction(Opcodes::BINARY_SUBTRACT),
+                Instruction(Opcodes::RETURN_VALUE)}};
+
+  // Act
+  auto num = fuseSuperinstructions(cf);
+
+  // Assert
+  EXPECT_EQ(num, 1U);
+  EXPECT_EQ(cf.code[0].getOpcode(), Opcodes::STORE_FAST);
+  EXPECT_EQ(cf.code[1].getOpcode(),
+            Opcodes::LOAD_FAST__LOAD_CONST__BINARY_SUBTRACT);
+  EXPECT_EQ(cf.code[1].getArg(), 0);
+  /* Rest of sequence is kept for jumps into it */
+  EXPECT_EQ(cf.code[2].getOpcode(), Opcodes::LOAD_CONST);
+  EXPECT_EQ(cf.code[2].getArg(), 1);
+}
+
+TEST(Fusion, FunctionBoundary) {
+  // Assign
+  FuncMeta foo{};
+  foo.addr = 2;
+  LeechFile cf{Meta{{{"main", FuncMeta{}}, {"foo", foo}}},
+               {Instruction(Opcodes::LOAD_FAST, 0),
+                Instruction(Opcodes::LOAD_FAST, 1),
+                Instruction(Opcodes::LOAD_CONST, 0),
+                Instruction(Opcodes::RETURN_VALUE)}};
+
+  // Act
+  fuseSuperinstructions(cf);
+
+  // Assert
+  EXPECT_EQ(cf.code[0].getOpcode(), Opcodes::LOAD_FAST__LOAD_FAST);
+  EXPECT_EQ(cf.code[1].getOpcode(), Opcodes::LOAD_FAST);
+}
+
+TEST(Fusion, SerializeOriginal) {
+  // Assign
+  auto cf = makeFile();
+  cf.setCode({Instruction(Opcodes::LOAD_FAST, 0),
+              Instruction(Opcodes::LOAD_CONST, 0),
+              Instruction(Opcodes::RETURN_VALUE)});
+  ASSERT_EQ(fuseSuperinstructions(cf), 1U);
+  std::stringstream ss{};
+
+  // Act
+  cf.serialize(ss);
+  auto res = LeechFile::deserialize(ss);
+  defuseSuperinstructions(cf);
+
+  // Assert
+  ASSERT_EQ(res.code.size(), 3U);
+  EXPECT_EQ(res.code[0].getOpcode(), Opcodes::LOAD_FAST);
+  EXPECT_EQ(cf.code[0].getOpcode(), Opcodes::LOAD_FAST);
+  EXPECT_EQ(OpcodeConv::fromName("LOAD_FAST__LOAD_CONST"), std::nullopt);
+}
+
+TEST(RegCode, FoldLoads) {
+  // Assign
+  FuncMeta fm{};
+  fm.names = {"x"};
+  fm.cstPool = {std::make_shared<NumberObj<Integer>>(1)};
+  fm.resolveSlots();
+  LeechFile cf{Meta{{{"main", fm}}},
+               {Instruction(Opcodes::LOAD_FAST, 0),
+                Instruction(Opcodes::LOAD_CONST, 0),
+                Instruction(Opcodes::BINARY_ADD),
+                Instruction(Opcodes::STORE_FAST, 0),
+                Instruction(Opcodes::POP_TOP),
+                Instruction(Opcodes::LOAD_FAST, 0),
+                Instruction(Opcodes::RETURN_VALUE)}};
+
+  // Act
+  auto res = reg::translate(cf);
+
+  // Assert
+  using reg::OperandKind;
+  ASSERT_EQ(res.code.size(), 4U);
+  /* Sum is stored to x directly and popped w/o being pushed */
+  EXPECT_EQ(res.code[0].opcode, reg::RegOpcode::Add);
+  EXPECT_EQ(res.code[0].dst, (reg::Operand{OperandKind::Local, 0}));
+  EXPECT_EQ(res.code[0].a, (reg::Operand{OperandKind::Local, 0}));
+  EXPECT_EQ(res.code[0].b.kind, OperandKind::Const);
+  EXPECT_EQ(res.code[1].opcode, reg::RegOpcode::Push);
+  EXPECT_EQ(res.code[2].opcode, reg::RegOpcode::Stack);
+  EXPECT_EQ(res.code[2].pc, 6U);
+  EXPECT_EQ(res.code[3].opcode, reg::RegOpcode::End);
+  EXPECT_EQ(res.getEntry(0), 0U);
+  EXPECT_THROW(static_cast<void>(res.getEntry(1)), std::out_of_range);
+}
+
+TEST(RegCode, JumpEntries) {
+  // Assign
+  FuncMeta fm{};
+  fm.names = {"x", "f"};
+  fm.cstPool = {std::make_shared<NumberObj<Integer>>(0)};
+  fm.resolveSlots();
+  LeechFile cf{Meta{{{"main", fm}}},
+               {Instruction(Opcodes::LOAD_FAST, 0),
+                Instruction(Opcodes::LOAD_CONST, 0),
+                Instruction(Opcodes::COMPARE_OP, 2),
+                Instruction(Opcodes::POP_JUMP_IF_FALSE, 6),
+                Instruction(Opcodes::CALL_FUNCTION, 1),
+                Instruction(Opcodes::POP_TOP),
+                Instruction(Opcodes::LOAD_CONST, 0),
+                Instruction(Opcodes::RETURN_VALUE)}};
+  fuseSuperinstructions(cf);
+
+  // Act
+  auto res = reg::translate(cf);
+
+  // Assert
+  ASSERT_EQ(res.code.size(), 6U);
+  EXPECT_EQ(res.code[0].opcode, reg::RegOpcode::JumpIfNotCmp);
+  EXPECT_EQ(res.code[0].target, res.getEntry(6));
+  /* Return address and jump destination */
+  EXPECT_EQ(res.getEntry(5), 2U);
+  EXPECT_EQ(res.getEntry(6), 3U);
+  EXPECT_EQ(res.code[res.getEntry(6)].opcode, reg::RegOpcode::Push);
+}
+
+namespace {
+/* File of main w/ constant 0, names x and main */
+LeechFile makeMain(std::vector<Instruction> &&code) {
+  FuncMeta fm{};
+  fm.cstPool = {std::make_shared<NumberObj<Integer>>(0)};
+  fm.names = {"x", "main"};
+  fm.resolveSlots();
+  return {Meta{{{"main", fm}}}, std::move(code)};
+}
+} // namespace
+
+TEST(Verifier, MaxStack) {
+  // Assign
+  auto cf = makeMain({Instruction(Opcodes::LOAD_FAST, 0),
+                      Instruction(Opcodes::LOAD_CONST, 0),
+                      Instruction(Opcodes::COMPARE_OP, 2),
+                      Instruction(Opcodes::POP_JUMP_IF_FALSE, 6),
+                      Instruction(Opcodes::LOAD_CONST, 0),
+                      Instruction(Opcodes::RETURN_VALUE),
+                      Instruction(Opcodes::LOAD_FAST, 0),
+                      Instruction(Opcodes::LOAD_FAST, 0),
+                      Instruction(Opcodes::LOAD_CONST, 0),
+                      Instruction(Opcodes::BUILD_TUPLE, 3),
+                      Instruction(Opcodes::RETURN_VALUE)});
+  fuseSuperinstructions(cf);
+
+  // Act
+  verify(cf);
+
+  // Assert
+  EXPECT_EQ(cf.meta.funcs.at("main").maxStack, 3U);
+}
+
+TEST(Verifier, Rejects) {
+  // Assign
+  using Code = std::vector<Instruction>;
+  std::vector<Code> codes{
+      /* Underflow */
+      {Instruction(Opcodes::POP_TOP), Instruction(Opcodes::RETURN_VALUE)},
+      /* Constant index */
+      {Instruction(Opcodes::LOAD_CONST, 1), Instruction(Opcodes::RETURN_VALUE)},
+      /* Name index */
+      {Instruction(Opcodes::LOAD_FAST, 2), Instruction(Opcodes::RETURN_VALUE)},
+      /* Jump out of function */
+      {Instruction(Opcodes::JUMP_ABSOLUTE, 7)},
+      /* Running off function code */
+      {Instruction(Opcodes::LOAD_CONST, 0)},
+      /* Underflow on one of paths to pc 4 */
+      {Instruction(Opcodes::LOAD_CONST, 0), Instruction(Opcodes::LOAD_CONST, 0),
+       Instruction(Opcodes::POP_JUMP_IF_FALSE, 4),
+       Instruction(Opcodes::POP_TOP), Instruction(Opcodes::POP_TOP),
+       Instruction(Opcodes::LOAD_CONST, 0), Instruction(Opcodes::RETURN_VALUE)},
+      /* Call of unknown function */
+      {Instruction(Opcodes::CALL_FUNCTION, 0),
+       Instruction(Opcodes::RETURN_VALUE)},
+      /* Unimplemented instruction */
+      {Instruction(Opcodes::ROT_TWO), Instruction(Opcodes::RETURN_VALUE)}};
+
+  for (auto &code : codes) {
+    auto cf = makeMain(std::move(code));
+
+    // Act & Assert
+    EXPECT_THROW(verify(cf), VerifyError);
+  }
+}
+
+TEST(Verifier, Unbalanced) {
+  // Assign
+  /* Each iteration leaves a value on data stack */
+  auto cf = makeMain({Instruction(Opcodes::LOAD_CONST, 0),
+                      Instruction(Opcodes::LOAD_FAST, 0),
+                      Instruction(Opcodes::POP_JUMP_IF_TRUE, 0),
+                      Instruction(Opcodes::RETURN_VALUE)});
+
+  // Act
+  verify(cf);
+
+  // Assert
+  EXPECT_FALSE(cf.meta.funcs.at("main").maxStack.has_value());
+}
+
+TEST(Verifier, CallResetsStack) {
+  // Assign
+  auto cf = makeMain({Instruction(Opcodes::LOAD_CONST, 0),
+                      Instruction(Opcodes::LOAD_CONST, 0),
+                      Instruction(Opcodes::CALL_FUNCTION, 1),
+                      Instruction(Opcodes::POP_TOP),
+                      Instruction(Opcodes::POP_TOP),
+                      Instruction(Opcodes::RETURN_VALUE)});
+
+  // Act & Assert
+  /* Whole data stack is passed, so only result is left to pop */
+  EXPECT_THROW(verify(cf), VerifyError);
 }
 
 #include "test_footer.hh"
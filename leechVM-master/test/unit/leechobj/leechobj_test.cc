@@ -87,4 +87,180 @@ TEST(Serialize, None) {
   EXPECT_EQ(ss.str(), answ);
 }
 
+TEST(Value, Inline) {
+  // Assign
+  Value one(Integer{1});
+  Value two(Integer{2});
+  Value half(Float{0.5});
+
+  // Act
+  auto sum = one.add(two);
+  auto diff = one.sub(two);
+  auto quot = one.div(two);
+  auto fsum = half.add(half);
+
+  // Assert
+  EXPECT_FALSE(sum.isBoxed());
+  EXPECT_EQ(sum.getType(), ValueType::Integer);
+  EXPECT_EQ(sum.getInt(), 3);
+  EXPECT_EQ(diff.getInt(), -1);
+  EXPECT_EQ(quot.getType(), ValueType::Float);
+  EXPECT_DOUBLE_EQ(quot.getFloat(), 0.5);
+  EXPECT_DOUBLE_EQ(fsum.getFloat(), 1.0);
+  EXPECT_TRUE(one.compare(two, CmpOp::LE));
+  EXPECT_THROW(static_cast<void>(one.add(half)), std::runtime_error);
+  EXPECT_THROW(static_cast<void>(half.compare(half, CmpOp::EQ)), std::invalid_argument);
+}
+
+TEST(Value, Unbox) {
+  // Assign
+  Value num(pLeechObj{std::make_shared<IntObj>(42)});
+  Value none(pLeechObj{std::make_shared<NoneObj>()});
+  /* Values don't own boxed objects */
+  pLeechObj strObj = std::make_shared<StringObj>("str");
+  Value str(strObj);
+  Value unbound{};
+
+  // Assert
+  EXPECT_FALSE(num.isBoxed());
+  EXPECT_EQ(num.getInt(), 42);
+  EXPECT_EQ(none.getType(), ValueType::None);
+  EXPECT_FALSE(none.isBoxed());
+  EXPECT_TRUE(str.isBoxed());
+  EXPECT_EQ(str.getType(), ValueType::String);
+  EXPECT_FALSE(unbound.isBound());
+}
+
+TEST(Value, Subscript) {
+  // Assign
+  Tuple tup;
+  tup.emplace_back(new NumberObj<Integer>(7));
+  tup.emplace_back(new StringObj("seven"));
+  pLeechObj tupleObj = std::make_shared<TupleObj>(std::move(tup));
+  Value tuple(tupleObj);
+
+  // Act
+  auto first = tuple.subscript(Value(Integer{0}));
+  auto second = tuple.subscript(Value(Integer{1}));
+
+  // Assert
+  EXPECT_EQ(first.getType(), ValueType::Integer);
+  EXPECT_EQ(first.getInt(), 7);
+  EXPECT_EQ(second.getType(), ValueType::String);
+  EXPECT_THROW(static_cast<void>(tuple.subscript(Value(Float{0}))), std::invalid_argument);
+}
+
+TEST(SmallInt, Shared) {
+  // Act
+  auto zero = makeInt(0);
+  auto big = makeInt(kSmallIntMax + 1);
+
+  // Assert
+  EXPECT_EQ(zero.get(), makeInt(0).get());
+  EXPECT_EQ(zero.get(), Value(Integer{0}).toObj().get());
+  EXPECT_EQ(zero.get(), IntObj(0).clone().get());
+  EXPECT_EQ(makeInt(kSmallIntMin).get(), makeInt(kSmallIntMin).get());
+  EXPECT_NE(big.get(), makeInt(kSmallIntMax + 1).get());
+  EXPECT_EQ(Value(big).getInt(), kSmallIntMax + 1);
+}
+
+TEST(Immutable, CloneShares) {
+  // Assign
+  Tuple tup;
+  tup.emplace_back(std::make_shared<StringObj>("str"));
+  tup.emplace_back(std::make_shared<ClassObj>());
+  TupleObj tuple(std::move(tup));
+
+  // Act
+  auto res = tuple.clone();
+
+  // Assert
+  EXPECT_TRUE(tuple.isImmutable());
+  EXPECT_FALSE(ClassObj{}.isImmutable());
+  auto *copy = static_cast<TupleObj *>(res.get());
+  EXPECT_EQ(copy->at(0).getObj(), tuple.at(0).getObj());
+  EXPECT_NE(copy->at(1).getObj(), tuple.at(1).getObj());
+}
+
+TEST(Tuple, Unboxed) {
+  // Assign
+  Tuple ints;
+  Tuple mixed;
+  for (Integer i = 0; i < 8; ++i) {
+    ints.push_back(makeInt(i));
+    mixed.push_back(makeInt(i));
+  }
+  mixed.push_back(std::make_shared<StringObj>("str"));
+  std::vector<Value> floats{Value(Float{0.5}), Value(Float{1.5})};
+
+  // Act
+  TupleObj intTuple(std::move(ints));
+  TupleObj mixedTuple(std::move(mixed));
+  TupleObj floatTuple{std::span<const Value>(floats)};
+
+  // Assert
+  EXPECT_EQ(intTuple.getKind(), TupleObj::Kind::Ints);
+  EXPECT_FALSE(intTuple.isInline());
+  EXPECT_EQ(intTuple.at(7).getInt(), 7);
+  EXPECT_EQ(mixedTuple.getKind(), TupleObj::Kind::Values);
+  EXPECT_EQ(mixedTuple.at(8).getType(), ValueType::String);
+  EXPECT_EQ(floatTuple.getKind(), TupleObj::Kind::Floats);
+  EXPECT_TRUE(floatTuple.isInline());
+  EXPECT_EQ(floatTuple.at(1).getFloat(), 1.5);
+  EXPECT_THROW(static_cast<void>(floatTuple.at(2)), std::out_of_range);
+  EXPECT_THROW(static_cast<void>(floatTuple.at(-1)), std::out_of_range);
+}
+
+TEST(Tuple, SliceView) {
+  // Assign
+  Tuple tup;
+  for (Integer i = 0; i < 8; ++i)
+    tup.push_back(makeInt(i * 10));
+  auto tuple = std::make_shared<TupleObj>(std::move(tup));
+  auto [begin, end] = SliceObj(-6, std::nullopt).resolve(tuple->size());
+
+  // Act
+  TupleObj view(Value(tuple), begin, end);
+  TupleObj small(Value(&view), 1, 3);
+  std::vector<Value> few{Value(Integer{1}), Value(Integer{2})};
+  TupleObj fewTuple{std::span<const Value>(few)};
+  TupleObj fewView(Value(&fewTuple), 1, 2);
+
+  // Assert
+  EXPECT_EQ(view.size(), 6U);
+  EXPECT_FALSE(view.isInline());
+  EXPECT_EQ(view.at(0).getInt(), 20);
+  EXPECT_EQ(view.at(5).getInt(), 70);
+  EXPECT_EQ(Value(&view).len(), 6);
+  EXPECT_FALSE(small.isInline());
+  EXPECT_EQ(small.at(1).getInt(), 40);
+  /* Slice of inline tuple is copied */
+  EXPECT_TRUE(fewView.isInline());
+  EXPECT_EQ(fewView.at(0).getInt(), 2);
+  EXPECT_EQ(SliceObj(5, 2).resolve(8), std::make_pair(5UL, 5UL));
+  EXPECT_EQ(SliceObj(std::nullopt, 100).resolve(8), std::make_pair(0UL, 8UL));
+}
+
+TEST(Serialize, UnboxedTuple) {
+  // Assign
+  Tuple tup;
+  tup.push_back(makeInt(1));
+  tup.push_back(makeInt(-1));
+  TupleObj tuple(std::move(tup));
+  std::ostringstream ss;
+
+  // Act
+  tuple.serialize(ss);
+  std::istringstream ist(ss.str());
+  auto res = deserializeObj(ist);
+
+  // Assert
+  EXPECT_EQ(ss.str().size(),
+            (1 + sizeof(std::size_t)) * 3 + 2 * sizeof(Integer));
+  ASSERT_EQ(res->getType(), ValueType::Tuple);
+  auto *loaded = static_cast<TupleObj *>(res.get());
+  EXPECT_EQ(loaded->getKind(), TupleObj::Kind::Ints);
+  EXPECT_EQ(loaded->at(1).getInt(), -1);
+}
+
 #include "test_footer.hh"
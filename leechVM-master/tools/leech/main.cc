@@ -1,22 +1,118 @@
 #include <filesystem>
+#include <memory>
+#include <sstream>
+#include <vector>
 
 #include <CLI/App.hpp>
 #include <CLI/Config.hpp>
 #include <CLI/Formatter.hpp>
 
+#include "executor/isolate.hh"
 #include "leechVM/leechVM.hh"
 #include "timer/timer.hh"
 
 namespace fs = std::filesystem;
 
+namespace {
+/* Whitespace separated integers of --args */
+std::vector<leech::pLeechObj> parseArgs(const std::string &str) {
+  std::istringstream ist(str);
+  std::vector<leech::pLeechObj> res{};
+  for (leech::Integer val = 0; ist >> val;)
+    res.push_back(leech::makeInt(val));
+  if (!ist.eof())
+    throw std::invalid_argument("main args must be integers: " + str);
+  return res;
+}
+} // namespace
+
 int main(int argc, char **argv) try {
   CLI::App app{"LeechVM"};
-  fs::path input{};
+  std::vector<fs::path> inputs{};
   fs::path binaryOutput{};
+  fs::path aotOutput{};
+  leech::aot::BuildOptions aotOpts{};
+  fs::path nativeModule{};
+  fs::path cacheDir{};
   bool fromBinary = false;
-  app.add_option("input", input, "input file")->required();
+  bool callbackDispatch = false;
+  bool registerDispatch = false;
+  bool gcStats = false;
+  bool noFuse = false;
+  bool noQuicken = false;
+  std::size_t ngramLen = 0;
+  std::size_t ngramTop = 10;
+  bool noJit = false;
+  bool jitStats = false;
+  std::size_t jitThreshold = leech::jit::kDefaultThreshold;
+  bool profile = false;
+  std::size_t sampleInterval = 0;
+  fs::path foldedOutput{};
+  std::size_t maxCallDepth = leech::kDefaultMaxCallDepth;
+  std::size_t threads = 0;
+  std::vector<std::string> argSets{};
+  std::size_t repeat = 1;
+  bool isolateStats = false;
+  app.add_option("input", inputs,
+                 "input files, several ones are run in isolates")
+      ->required();
   app.add_option("--dump", binaryOutput, "leech -> dinary dump");
   app.add_flag("--bin", fromBinary, "execute from binary");
+  app.add_option("--cache", cacheDir,
+                 "keep parsed sources in given dir as binaries, so the "
+                 "same source isn't parsed again");
+  app.add_option("--aot", aotOutput,
+                 "compile functions to native module (shared object), "
+                 "only translate them to C++ if it ends w/ .cc");
+  app.add_option("--aot-cxx", aotOpts.compiler,
+                 "compiler of native module, the one leech was built w/ "
+                 "by default");
+  app.add_option("--aot-flags", aotOpts.flags,
+                 "flags to compile native module w/");
+  app.add_option("--native", nativeModule,
+                 "run w/ native module built by --aot for the input")
+      ->check(CLI::ExistingFile);
+  app.add_flag("--callback", callbackDispatch,
+               "use reference callback dispatch instead of threaded one");
+  app.add_flag("--registers", registerDispatch,
+               "run code translated to register form, w/o JIT");
+  app.add_option("--max-depth", maxCallDepth, "max call stack depth")
+      ->check(CLI::PositiveNumber);
+  app.add_flag("--gc-stats", gcStats, "print GC statistics after run");
+  app.add_flag("--no-fuse", noFuse, "don't use superinstructions");
+  app.add_flag("--no-quicken", noQuicken,
+               "don't specialize instructions for operand types");
+  app.add_option("--ngrams", ngramLen,
+                 "print the most frequent opcode n-grams of length up to "
+                 "given one, runs w/o superinstructions")
+      ->check(CLI::Range(std::size_t{2}, leech::NgramProfile::kMaxLen));
+  app.add_option("--ngrams-top", ngramTop, "number of n-grams to print")
+      ->check(CLI::PositiveNumber);
+  app.add_flag("--no-jit", noJit, "don't compile hot functions to native code");
+  app.add_option("--jit-threshold", jitThreshold,
+                 "calls and loop iterations of function to compile it")
+      ->check(CLI::PositiveNumber);
+  app.add_flag("--jit-stats", jitStats, "print JIT statistics after run");
+  app.add_flag("--profile", profile,
+               "print per-opcode and per-function cycles after run");
+  app.add_option("--profile-sample", sampleInterval,
+                 "profile by sampling call stack every given number of "
+                 "microseconds of CPU time")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--folded", foldedOutput,
+                 "write folded call stacks of profile for flamegraph.pl");
+  auto *threadsOpt =
+      app.add_option("--threads", threads,
+                     "run in isolates on given number of threads, "
+                     "0 for one per core");
+  app.add_option("--args", argSets,
+                 "run main of each input w/ given whitespace separated "
+                 "integers, may be repeated")
+      ->allow_extra_args(false);
+  app.add_option("--repeat", repeat, "run each input and args set N times")
+      ->check(CLI::PositiveNumber);
+  app.add_flag("--isolate-stats", isolateStats,
+               "print time, GC and JIT statistics of each isolate");
 
   try {
     app.parse(argc, argv);
@@ -24,22 +120,111 @@ int main(int argc, char **argv) try {
     return app.exit(e);
   }
 
-  std::fstream in(input.c_str());
-  if (!in.is_open()) {
-    throw std::invalid_argument("can't find input file");
+  bool isolated = inputs.size() > 1 || !argSets.empty() || repeat > 1 ||
+                  threadsOpt->count() != 0;
+  if (isolated && (!binaryOutput.empty() || !aotOutput.empty() ||
+                   ngramLen != 0 || profile || sampleInterval != 0 ||
+                   !foldedOutput.empty()))
+    throw std::invalid_argument(
+        "dump and profiling options can't be used w/ isolates");
+  if (inputs.size() > 1 && !nativeModule.empty())
+    throw std::invalid_argument("native module is built for single input");
+
+  std::vector<std::unique_ptr<leech::LeechVM>> vms{};
+  for (const auto &input : inputs) {
+    auto &vm = *vms.emplace_back(std::make_unique<leech::LeechVM>());
+    if (fromBinary) {
+      vm.mapLeechFile(input);
+    } else {
+      if (!fs::is_regular_file(input)) {
+        throw std::invalid_argument("can't find input file");
+      }
+      vm.loadSource(input, cacheDir);
+    }
+    if (!nativeModule.empty())
+      vm.loadNative(nativeModule);
+    if (isolated && !noFuse)
+      vm.fuseSuperinstructions();
   }
 
-  leech::LeechVM vm;
-  vm.generateLeechFile(in, fromBinary);
+  if (isolated) {
+    leech::ExecOptions opts{};
+    opts.mode = callbackDispatch   ? leech::DispatchMode::Callback
+                : registerDispatch ? leech::DispatchMode::Register
+                                   : leech::DispatchMode::Threaded;
+    opts.maxCallDepth = maxCallDepth;
+    opts.jitThreshold = noJit ? 0 : jitThreshold;
+
+    std::vector<std::vector<leech::pLeechObj>> args{};
+    for (const auto &str : argSets)
+      args.push_back(parseArgs(str));
+    if (args.empty())
+      args.emplace_back();
+
+    std::vector<leech::IsolateJob> jobs{};
+    for (const auto &vm : vms)
+      for (const auto &set : args)
+        for (std::size_t i = 0; i < repeat; ++i)
+          jobs.push_back({vm->getLeechFile().get(), set, vm->getNative()});
+
+    leech::IsolatePool pool{threads, opts};
+    pool.run(jobs);
+    for (const auto &stats : pool.getStats()) {
+      if (isolateStats)
+        stats.print(std::cout);
+      else if (stats.failed())
+        std::cerr << "Isolate " << stats.job << ": " << stats.error
+                  << std::endl;
+    }
+    pool.getPoolStats().print(std::cout);
+    return pool.getPoolStats().failed == 0 ? 0 : 1;
+  }
+
+  auto &vm = *vms.front();
   if (!binaryOutput.empty()) {
     std::ofstream out(binaryOutput.c_str());
     vm.dumpBinary(out);
+  } else if (aotOutput.extension() == ".cc") {
+    std::ofstream out(aotOutput);
+    out << leech::aot::translate(*vm.getLeechFile());
+  } else if (!aotOutput.empty()) {
+    vm.buildNative(aotOutput, aotOpts);
   } else {
+    if (!noFuse && ngramLen == 0)
+      vm.fuseSuperinstructions();
+
     timer::Timer timer;
-    vm.run();
+    leech::ExecOptions opts{};
+    opts.mode = callbackDispatch   ? leech::DispatchMode::Callback
+                : registerDispatch ? leech::DispatchMode::Register
+                                   : leech::DispatchMode::Threaded;
+    opts.maxCallDepth = maxCallDepth;
+    opts.ngramLen = ngramLen;
+    opts.jitThreshold = noJit ? 0 : jitThreshold;
+    opts.quicken = !noQuicken;
+    if (sampleInterval != 0) {
+      opts.profile = leech::ProfileMode::Sample;
+      opts.sampleInterval = std::chrono::microseconds(sampleInterval);
+    } else if (profile || !foldedOutput.empty())
+      opts.profile = leech::ProfileMode::Instrument;
+    vm.run(opts);
     auto time = timer.elapsed_mcs();
     std::cout << "Time: " << static_cast<double>(time) * 1e-3 << " ms"
               << std::endl;
+    if (gcStats)
+      vm.getGCStats().print(std::cout);
+    if (const auto &ngrams = vm.getNgramProfile(); ngrams.has_value())
+      ngrams->print(std::cout, ngramTop);
+    if (const auto &stats = vm.getJitStats(); jitStats && stats.has_value())
+      stats->print(std::cout);
+    if (const auto &prof = vm.getProfile(); prof.has_value()) {
+      if (profile || sampleInterval != 0)
+        prof->print(std::cout);
+      if (!foldedOutput.empty()) {
+        std::ofstream out(foldedOutput);
+        prof->writeFolded(out);
+      }
+    }
   }
 } catch (const std::exception &e) {
   std::cerr << e.what() << std::endl;